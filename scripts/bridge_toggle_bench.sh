@@ -0,0 +1,112 @@
+#!/bin/sh
+##########################################################################
+# If not stated otherwise in this file or this component's Licenses.txt
+# file the following copyright and licenses apply:
+#
+# Copyright 2016 RDK Management
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+##########################################################################
+#
+# Replays a bridge_mode toggle scenario against a running gw_prov_epon and
+# reports the outage window the daemon measured for every switch.
+#
+# usage: bridge_toggle_bench.sh [-n count] [-i interval_s] [-p pattern] [-b]
+#   -n  number of bridge_mode sets (default 10)
+#   -i  pause between sets once the previous switch settled (default 5)
+#   -p  0/1 sequence applied cyclically (default 10)
+#   -b  burst: issue all sets back to back, then wait for the switch to settle
+#
+# The bridge mode in effect before the run is restored at the end.
+
+COUNT=10
+INTERVAL=5
+PATTERN=10
+BURST=0
+TIMEOUT=60
+
+while getopts "n:i:p:b" opt; do
+    case $opt in
+        n) COUNT=$OPTARG ;;
+        i) INTERVAL=$OPTARG ;;
+        p) PATTERN=$OPTARG ;;
+        b) BURST=1 ;;
+        *) sed -n 's/^# usage: /usage: /p' "$0"; exit 1 ;;
+    esac
+done
+
+switch_count() {
+    c=$(sysevent get bridge_mode_switch_count)
+    echo "${c:-0}"
+}
+
+# wait until the switch counter moves past $1 and the transition is idle
+wait_settled() {
+    t=0
+    while [ $t -lt $((TIMEOUT * 10)) ]; do
+        if [ "$(switch_count)" -gt "$1" ] && [ "$(sysevent get bridge_mode_transition)" = "idle" ]; then
+            return 0
+        fi
+        sleep 0.1
+        t=$((t + 1))
+    done
+    return 1
+}
+
+mode_at() {
+    len=${#PATTERN}
+    pos=$(( ($1 - 1) % len ))
+    echo "$PATTERN" | cut -c$((pos + 1))
+}
+
+ORIG_MODE=$(sysevent get bridge_mode)
+RESULTS=/tmp/.bridge_toggle_bench.$$
+: > $RESULTS
+
+if [ $BURST -eq 1 ]; then
+    before=$(switch_count)
+    start=$(date +%s)
+    i=1
+    while [ $i -le $COUNT ]; do
+        sysevent set bridge_mode "$(mode_at $i)"
+        i=$((i + 1))
+    done
+    wait_settled "$before" || echo "timeout waiting for bridge mode switch"
+    after=$(switch_count)
+    echo "burst: $COUNT sets -> $((after - before)) switches in $(( $(date +%s) - start )) s"
+    echo "burst $(sysevent get bridge_mode_switch_ms)" >> $RESULTS
+else
+    i=1
+    while [ $i -le $COUNT ]; do
+        mode=$(mode_at $i)
+        before=$(switch_count)
+        sysevent set bridge_mode "$mode"
+        if wait_settled "$before"; then
+            ms=$(sysevent get bridge_mode_switch_ms)
+            echo "$i mode=$mode outage_ms=$ms"
+            echo "$i $ms" >> $RESULTS
+        else
+            echo "$i mode=$mode no switch (already applied or timeout)"
+        fi
+        i=$((i + 1))
+        sleep "$INTERVAL"
+    done
+fi
+
+awk '{ n++; s += $2; if (min == "" || $2 < min) min = $2; if ($2 > max) max = $2 }
+     END { if (n) printf "switches=%d min_ms=%d avg_ms=%d max_ms=%d\n", n, min, s / n, max }' $RESULTS
+rm -f $RESULTS
+
+if [ -n "$ORIG_MODE" ] && [ "$(sysevent get bridge_mode)" != "$ORIG_MODE" ]; then
+    sysevent set bridge_mode "$ORIG_MODE"
+fi
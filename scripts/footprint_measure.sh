@@ -0,0 +1,135 @@
+#!/bin/sh
+##########################################################################
+# If not stated otherwise in this file or this component's Licenses.txt
+# file the following copyright and licenses apply:
+#
+# Copyright 2016 RDK Management
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+##########################################################################
+#
+# Measures the memory and startup footprint of gw_prov_epon and compares
+# it with a tracked baseline.
+#
+# usage: footprint_measure.sh [-r] [-b binary] [-f baseline] [-p profile] [-t pct] [-s ms] [-u]
+#   -r  restart the service first and measure a fresh instance
+#   -b  daemon binary (default /usr/ccsp/gw_prov_epon)
+#   -f  baseline file (default footprint_baseline.txt next to this script)
+#   -p  baseline profile, "default" or "low_footprint" (default default)
+#   -t  tolerated growth over the baseline in percent (default 10)
+#   -s  tolerated ready_ms growth in ms, on top of -t (default 50)
+#   -u  record the measured values as the new baseline of the profile
+#
+# Reported values:
+#   rss_kb      resident set size (VmRSS)
+#   hwm_kb      peak resident set size (VmHWM)
+#   vsz_kb      virtual size (VmSize), dominated by the thread stacks
+#   threads     number of threads
+#   binary_b    size of the binary on disk
+#   ready_ms    process start to event loop running, as seen by the daemon
+#
+# Exits 1 when a value exceeds its baseline by more than the tolerance, or
+# has no baseline for the profile.
+
+BIN=/usr/ccsp/gw_prov_epon
+BASELINE=$(dirname "$0")/footprint_baseline.txt
+PROFILE=default
+TOLERANCE=10
+READY_SLACK=50
+RESTART=0
+UPDATE=0
+PIDFILE=/tmp/.gwprovepon.pid
+TIMEOUT=60
+
+while getopts "rb:f:p:t:s:u" opt; do
+    case $opt in
+        r) RESTART=1 ;;
+        b) BIN=$OPTARG ;;
+        f) BASELINE=$OPTARG ;;
+        p) PROFILE=$OPTARG ;;
+        t) TOLERANCE=$OPTARG ;;
+        s) READY_SLACK=$OPTARG ;;
+        u) UPDATE=1 ;;
+        *) sed -n 's/^# usage: /usage: /p' "$0"; exit 1 ;;
+    esac
+done
+
+# wait until the control socket of the primary context answers
+wait_ready() {
+    t=0
+    while [ $t -lt $((TIMEOUT * 10)) ]; do
+        if "$BIN" -c STATE 2>/dev/null | grep -q '^ready_ms=[1-9]'; then
+            return 0
+        fi
+        sleep 0.1
+        t=$((t + 1))
+    done
+    return 1
+}
+
+if [ $RESTART -eq 1 ]; then
+    systemctl restart gwprovepon.service
+fi
+if ! wait_ready; then
+    echo "gw_prov_epon is not ready"
+    exit 1
+fi
+
+PID=$(cat $PIDFILE 2>/dev/null)
+if [ -z "$PID" ] || [ ! -r /proc/$PID/status ]; then
+    echo "cannot find the gw_prov_epon process"
+    exit 1
+fi
+
+RESULTS=/tmp/.footprint_measure.$$
+status_kb() {
+    awk -v k="$1:" '$1 == k { print $2 }' /proc/$PID/status
+}
+{
+    echo "rss_kb $(status_kb VmRSS)"
+    echo "hwm_kb $(status_kb VmHWM)"
+    echo "vsz_kb $(status_kb VmSize)"
+    echo "threads $(status_kb Threads)"
+    echo "binary_b $(wc -c < "$BIN")"
+    echo "ready_ms $("$BIN" -c STATE | sed -n 's/^ready_ms=//p')"
+} > $RESULTS
+
+# baseline lines: <profile> <key> <value>
+status=0
+while read -r key value; do
+    base=$(awk -v p="$PROFILE" -v k="$key" '$1 == p && $2 == k { print $3 }' "$BASELINE" 2>/dev/null)
+    if [ -z "$base" ]; then
+        echo "$key=$value NO BASELINE"
+        status=1
+        continue
+    fi
+    # a few ms of startup jitter would otherwise exceed any percentage
+    limit=$((base + base * TOLERANCE / 100))
+    [ "$key" = ready_ms ] && limit=$((limit + READY_SLACK))
+    if [ "$value" -gt $limit ]; then
+        echo "$key=$value baseline=$base REGRESSION"
+        status=1
+    else
+        echo "$key=$value baseline=$base"
+    fi
+done < $RESULTS
+
+if [ $UPDATE -eq 1 ]; then
+    grep -v "^$PROFILE " "$BASELINE" 2>/dev/null > $RESULTS.new
+    sed "s/^/$PROFILE /" $RESULTS >> $RESULTS.new
+    mv $RESULTS.new "$BASELINE"
+    echo "baseline $PROFILE updated in $BASELINE"
+    status=0
+fi
+rm -f $RESULTS
+exit $status
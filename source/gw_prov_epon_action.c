@@ -0,0 +1,677 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*! \file gw_prov_epon_action.c
+    \brief provisioning action execution, failure detection and retry
+*/
+
+/**************************************************************************/
+/*      INCLUDES:                                                         */
+/**************************************************************************/
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include "gw_prov_epon.h"
+#include "gw_prov_epon_action.h"
+#include "gw_prov_epon_ctx.h"
+#include "gw_prov_epon_evloop.h"
+#include "gw_prov_epon_log.h"
+
+/**************************************************************************/
+/*      LOCAL DECLARATIONS:                                               */
+/**************************************************************************/
+typedef struct
+{
+    int in_use;
+    GWPEpon_RetryPolicy policy;         /* copied, a reload may reuse the override slot */
+    GWPEpon_ActionStats *stats;
+    char cmd[GWPEPON_ACTION_CMD_LEN];
+    unsigned int attempt;
+    unsigned int timer_id;
+    pid_t pid;
+    unsigned long long start_ms;
+} GWPEpon_PendingRetry;
+
+typedef struct
+{
+    int in_use;
+    const char *action;
+    GWPEpon_ActionStats *stats;
+    char cmd[GWPEPON_ACTION_CMD_LEN];
+    pid_t pid;
+    unsigned long long start_ms;
+    GWPEpon_ActionDoneCb cb;
+    void *arg;
+    int cancelled;
+} GWPEpon_InFlight;
+
+/*
+ * Supersession keys. Actions sharing a key drive one service towards
+ * alternative states: starting any of them cancels the runs of the others
+ * still in flight or waiting for a retry, their result no longer matters.
+ * Actions without a key only supersede their own retries of the same
+ * command. Only a run started with GWPEpon_ActionRunAsync can be killed,
+ * keyed actions are started that way; GWPEpon_ActionRun of a keyed action
+ * still cancels the others but cannot be cancelled itself.
+ */
+static const struct
+{
+    const char *action;
+    const char *key;
+} action_keys[] =
+{
+    { "udhcp_restart",          "udhcp" },
+    { "udhcp_stop",             "udhcp" },
+    { "dibbler_restart",        "dibbler" },
+    { "dibbler_stop",           "dibbler" },
+    { "lan_wan_connect_v4",     "lan_wan_v4" },
+    { "lan_wan_disconnect_v4",  "lan_wan_v4" },
+    { "lan_wan_connect_v6",     "lan_wan_v6" },
+    { "lan_wan_disconnect_v6",  "lan_wan_v6" },
+    { "eth_enable",             "eth" },
+    { "eth_disable",            "eth" },
+    { "moca_enable",            "moca" },
+    { "moca_disable",           "moca" },
+    { "wl_enable",              "wl" },
+    { "wl_disable",             "wl" },
+};
+
+/*
+ * Retry policies for actions that are safe to repeat. Actions not listed
+ * here still have their failures detected and surfaced, but are not retried.
+ */
+static const GWPEpon_RetryPolicy retry_policies[] =
+{
+    /* action                  retries  base_ms  cap_ms */
+    { "udhcp_restart",            5,     1000,   30000 },
+    { "udhcp_stop",               2,      500,    5000 },
+    { "dibbler_restart",          5,     1000,   30000 },
+    { "dibbler_stop",             2,      500,    5000 },
+    { "lan_wan_connect_v4",       5,     1000,   30000 },
+    { "lan_wan_connect_v6",       5,     1000,   30000 },
+    { "lan_wan_disconnect_v4",    3,     1000,   10000 },
+    { "lan_wan_disconnect_v6",    3,     1000,   10000 },
+    { "dhcp_restart",             4,     1000,   16000 },
+    { "firewall_restart",         4,     1000,   16000 },
+    { "forwarding_restart",       3,     1000,   10000 },
+    { "routed",                   4,     2000,   30000 },
+    { "bridge_mode_enable",       3,     2000,   20000 },
+    { "bridge_mode_disable",      3,     2000,   20000 },
+};
+
+static const GWPEpon_RetryPolicy default_policy = { NULL, 0, 0, 0 };
+
+#define GWPEPON_ACTION_MAX_POLICIES  32
+
+/**************************************************************************/
+/*      LOCAL VARIABLES:                                                  */
+/**************************************************************************/
+static GWPEPON_THREAD_LOCAL GWPEpon_ActionStats action_stats[GWPEPON_ACTION_MAX];
+static GWPEPON_THREAD_LOCAL GWPEpon_PendingRetry pending_retries[GWPEPON_ACTION_MAX_PENDING];
+static GWPEPON_THREAD_LOCAL GWPEpon_InFlight inflight_jobs[GWPEPON_ACTION_MAX_INFLIGHT];
+static GWPEPON_THREAD_LOCAL unsigned int action_failures = 0;
+static GWPEPON_THREAD_LOCAL unsigned int jitter_state = 0;
+
+/* Configured policies, looked up before the built-in ones */
+static GWPEPON_THREAD_LOCAL GWPEpon_RetryPolicy policy_overrides[GWPEPON_ACTION_MAX_POLICIES];
+static GWPEPON_THREAD_LOCAL int policy_override_count = 0;
+
+/**************************************************************************/
+/*      LOCAL FUNCTIONS:                                                  */
+/**************************************************************************/
+static void GWPEpon_ActionRetry(void *arg);
+static void GWPEpon_ActionStartRetry(const char *action, const char *cmd, GWPEpon_ActionStats *stats,
+                                     const GWPEpon_ActionResult *result);
+static GWPEpon_PendingRetry *GWPEpon_ActionFindPending(const char *action, const char *cmd);
+
+static const GWPEpon_RetryPolicy *GWPEpon_ActionPolicy(const char *action)
+{
+    unsigned int i;
+
+    for (i = 0; i < (unsigned int) policy_override_count; i++)
+    {
+        if (strcmp(policy_overrides[i].action, action) == 0)
+            return &policy_overrides[i];
+    }
+    for (i = 0; i < sizeof(retry_policies) / sizeof(retry_policies[0]); i++)
+    {
+        if (strcmp(retry_policies[i].action, action) == 0)
+            return &retry_policies[i];
+    }
+    return &default_policy;
+}
+
+static GWPEpon_ActionStats *GWPEpon_ActionFindStats(const char *action)
+{
+    int i;
+
+    for (i = 0; i < GWPEPON_ACTION_MAX; i++)
+    {
+        if (action_stats[i].action == NULL)
+        {
+            action_stats[i].action = action;
+            return &action_stats[i];
+        }
+        if (strcmp(action_stats[i].action, action) == 0)
+            return &action_stats[i];
+    }
+    return NULL;
+}
+
+static void GWPEpon_ActionDecode(int wstatus, unsigned long long start_ms, GWPEpon_ActionResult *result)
+{
+    result->cancelled = 0;
+    result->wstatus = wstatus;
+    result->exit_code = -1;
+    result->signo = 0;
+    result->runtime_ms = GWPEpon_NowMs() - start_ms;
+
+    if (wstatus == -1)
+        return;
+    if (WIFEXITED(wstatus))
+        result->exit_code = WEXITSTATUS(wstatus);
+    else if (WIFSIGNALED(wstatus))
+        result->signo = WTERMSIG(wstatus);
+}
+
+static int GWPEpon_ActionFailed(const GWPEpon_ActionResult *result)
+{
+    return (result->exit_code != 0);
+}
+
+static void GWPEpon_ActionRecord(GWPEpon_ActionStats *stats, const char *action, const GWPEpon_ActionResult *result)
+{
+    if (stats)
+    {
+        stats->runs++;
+        stats->last = *result;
+        if (GWPEpon_ActionFailed(result))
+            stats->failures++;
+    }
+
+    if (result->signo)
+        GWPROVEPONLOG(WARNING, "action %s killed by signal %d after %llu ms\n", action, result->signo, result->runtime_ms)
+    else if (result->exit_code != 0)
+        GWPROVEPONLOG(WARNING, "action %s failed with exit %d after %llu ms\n", action, result->exit_code, result->runtime_ms)
+    else
+        GWPROVEPONLOG(INFO, "action %s completed in %llu ms\n", action, result->runtime_ms)
+}
+
+/* Exponential backoff capped at cap_ms, jittered over the upper half of the window */
+static unsigned int GWPEpon_ActionBackoff(const GWPEpon_RetryPolicy *policy, unsigned int attempt)
+{
+    unsigned long long delay = policy->base_ms;
+
+    while (attempt-- > 0 && delay < policy->cap_ms)
+        delay <<= 1;
+    if (delay > policy->cap_ms)
+        delay = policy->cap_ms;
+
+    jitter_state = jitter_state * 1103515245 + 12345;
+    return (unsigned int) (delay / 2 + ((jitter_state >> 8) % (delay / 2 + 1)));
+}
+
+/* A fresh run supersedes any retry still pending for the same command */
+static void GWPEpon_ActionCancelRetry(const char *action, const char *cmd)
+{
+    GWPEpon_PendingRetry *retry = GWPEpon_ActionFindPending(action, cmd);
+
+    if (retry)
+    {
+        GWPEpon_TimerCancel(retry->timer_id);
+        retry->in_use = 0;
+    }
+}
+
+static const char *GWPEpon_ActionKey(const char *action)
+{
+    unsigned int i;
+
+    for (i = 0; i < sizeof(action_keys) / sizeof(action_keys[0]); i++)
+    {
+        if (strcmp(action_keys[i].action, action) == 0)
+            return action_keys[i].key;
+    }
+    return NULL;
+}
+
+static void GWPEpon_ActionCancelled(GWPEpon_ActionStats *stats, const char *action, pid_t pid,
+                                    unsigned long long since_ms, const char *by)
+{
+    unsigned long long typical = stats ? stats->last.runtime_ms : 0;
+    unsigned long long ran = (pid > 0) ? GWPEpon_NowMs() - since_ms : 0;
+
+    if (pid > 0)
+        GWPEpon_ChildKill(pid, SIGTERM);
+    if (stats)
+    {
+        stats->cancelled++;
+        stats->saved_ms += (typical > ran) ? typical - ran : 0;
+    }
+    GWPROVEPONLOG(WARNING, "action %s %s superseded by %s\n", action, (pid > 0) ? "run" : "retry", by)
+}
+
+/**************************************************************************/
+/*! \fn static void GWPEpon_ActionSupersede(const char *action, const char *cmd)
+ **************************************************************************
+ *  \brief Cancel the work a new run of action makes pointless: the runs
+ *    and retries of the actions sharing its key, or without a key the
+ *    retry of the same command
+ *  \return void
+ **************************************************************************/
+static void GWPEpon_ActionSupersede(const char *action, const char *cmd)
+{
+    const char *key = GWPEpon_ActionKey(action);
+    const char *other;
+    int i;
+
+    if (key == NULL)
+    {
+        GWPEpon_ActionCancelRetry(action, cmd);
+        return;
+    }
+
+    for (i = 0; i < GWPEPON_ACTION_MAX_PENDING; i++)
+    {
+        GWPEpon_PendingRetry *retry = &pending_retries[i];
+
+        other = retry->in_use ? GWPEpon_ActionKey(retry->policy.action) : NULL;
+        if (other == NULL || strcmp(other, key) != 0)
+            continue;
+        // In use cleared first, the exit of a killed retry child is then ignored
+        retry->in_use = 0;
+        if (retry->timer_id)
+            GWPEpon_TimerCancel(retry->timer_id);
+        GWPEpon_ActionCancelled(retry->stats, retry->policy.action, retry->pid, retry->start_ms, action);
+    }
+
+    for (i = 0; i < GWPEPON_ACTION_MAX_INFLIGHT; i++)
+    {
+        GWPEpon_InFlight *job = &inflight_jobs[i];
+
+        other = (job->in_use && !job->cancelled) ? GWPEpon_ActionKey(job->action) : NULL;
+        if (other == NULL || strcmp(other, key) != 0)
+            continue;
+        job->cancelled = 1;
+        GWPEpon_ActionCancelled(job->stats, job->action, job->pid, job->start_ms, action);
+    }
+}
+
+static GWPEpon_PendingRetry *GWPEpon_ActionFindPending(const char *action, const char *cmd)
+{
+    int i;
+
+    for (i = 0; i < GWPEPON_ACTION_MAX_PENDING; i++)
+    {
+        if (pending_retries[i].in_use && strcmp(pending_retries[i].policy.action, action) == 0 &&
+            strcmp(pending_retries[i].cmd, cmd) == 0)
+            return &pending_retries[i];
+    }
+    return NULL;
+}
+
+static void GWPEpon_ActionReportFailure(const char *action, const GWPEpon_ActionResult *result, unsigned int attempts)
+{
+    char value[96];
+
+    if (result->signo)
+        snprintf(value, sizeof(value), "%s:signal=%d:attempts=%u", action, result->signo, attempts);
+    else if (result->wstatus == -1)
+        snprintf(value, sizeof(value), "%s:spawn:attempts=%u", action, attempts);
+    else
+        snprintf(value, sizeof(value), "%s:exit=%d:attempts=%u", action, result->exit_code, attempts);
+
+    action_failures++;
+    GWPROVEPONLOG(ERROR, "action %s failed permanently (%s)\n", action, value)
+    GWPEpon_SyseventSetStr(GWPEPON_ACTION_FAILED_TUPLE, (unsigned char *) value, 0);
+    GWPEpon_SyseventSetInt(GWPEPON_ACTION_FAILURES_TUPLE, (int) action_failures);
+}
+
+static void GWPEpon_ActionSchedule(GWPEpon_PendingRetry *retry)
+{
+    unsigned int delay = GWPEpon_ActionBackoff(&retry->policy, retry->attempt);
+
+    retry->pid = -1;
+    retry->timer_id = GWPEpon_TimerAdd(delay, 0, GWPEpon_ActionRetry, retry);
+    GWPROVEPONLOG(WARNING, "action %s retry %u/%u in %u ms\n", retry->policy.action,
+                  retry->attempt + 1, retry->policy.max_retries, delay)
+}
+
+static void GWPEpon_ActionRetryDone(pid_t pid, int wstatus, void *arg)
+{
+    GWPEpon_PendingRetry *retry = (GWPEpon_PendingRetry *) arg;
+    GWPEpon_ActionResult result;
+
+    // Superseded by a newer run of the same action while this child ran
+    if (!retry->in_use || retry->pid != pid)
+        return;
+
+    GWPEpon_ActionDecode(wstatus, retry->start_ms, &result);
+    GWPEpon_ActionRecord(retry->stats, retry->policy.action, &result);
+    retry->attempt++;
+
+    if (!GWPEpon_ActionFailed(&result))
+    {
+        GWPROVEPONLOG(WARNING, "action %s recovered after %u retries\n", retry->policy.action, retry->attempt)
+        retry->in_use = 0;
+    }
+    else if (retry->attempt >= retry->policy.max_retries)
+    {
+        GWPEpon_ActionReportFailure(retry->policy.action, &result, retry->attempt + 1);
+        if (retry->stats)
+            retry->stats->persistent_failures++;
+        retry->in_use = 0;
+    }
+    else
+    {
+        GWPEpon_ActionSchedule(retry);
+    }
+}
+
+static void GWPEpon_ActionRetry(void *arg)
+{
+    GWPEpon_PendingRetry *retry = (GWPEpon_PendingRetry *) arg;
+
+    retry->timer_id = 0;
+    if (retry->stats)
+        retry->stats->retries++;
+    retry->start_ms = GWPEpon_NowMs();
+    retry->pid = GWPEpon_ChildSpawn(retry->cmd, GWPEpon_ActionRetryDone, retry);
+    if (retry->pid < 0)
+        GWPEpon_ActionRetryDone(-1, -1, retry);
+}
+
+/**************************************************************************/
+/*! \fn void GWPEpon_ActionInit(void)
+ **************************************************************************
+ *  \brief Reset action statistics and seed the backoff jitter
+ *  \return void
+ **************************************************************************/
+void GWPEpon_ActionInit(void)
+{
+    memset(action_stats, 0, sizeof(action_stats));
+    memset(pending_retries, 0, sizeof(pending_retries));
+    memset(inflight_jobs, 0, sizeof(inflight_jobs));
+    action_failures = 0;
+    jitter_state = (unsigned int) (GWPEpon_NowMs() ^ (unsigned long long) getpid());
+}
+
+/**************************************************************************/
+/*! \fn int GWPEpon_ActionSetPolicy(const GWPEpon_RetryPolicy *policy)
+ **************************************************************************
+ *  \brief Override the retry policy of policy->action, whose name must
+ *    stay valid. Retries already pending keep the policy they started with.
+ *  \return 0 on success, -1 when the table is full
+ **************************************************************************/
+int GWPEpon_ActionSetPolicy(const GWPEpon_RetryPolicy *policy)
+{
+    int i;
+
+    for (i = 0; i < policy_override_count; i++)
+    {
+        if (strcmp(policy_overrides[i].action, policy->action) == 0)
+            break;
+    }
+    if (i == GWPEPON_ACTION_MAX_POLICIES)
+        return -1;
+
+    policy_overrides[i] = *policy;
+    if (i == policy_override_count)
+        policy_override_count++;
+    return 0;
+}
+
+void GWPEpon_ActionResetPolicies(void)
+{
+    policy_override_count = 0;
+}
+
+/**************************************************************************/
+/*! \fn int GWPEpon_ActionRun(const char *action, const char *cmd)
+ **************************************************************************
+ *  \brief Run cmd synchronously and capture its result. A failure of an
+ *    action with a retry policy is retried in the background with
+ *    jittered exponential backoff.
+ *  \return 0 on success, -1 on failure
+ **************************************************************************/
+int GWPEpon_ActionRun(const char *action, const char *cmd)
+{
+    GWPEpon_ActionStats *stats = GWPEpon_ActionFindStats(action);
+    GWPEpon_ActionResult result;
+    unsigned long long start_ms;
+
+    GWPEpon_ActionSupersede(action, cmd);
+
+    start_ms = GWPEpon_NowMs();
+    GWPEpon_ActionDecode(GWPEpon_System(cmd), start_ms, &result);
+    GWPEpon_ActionRecord(stats, action, &result);
+
+    if (!GWPEpon_ActionFailed(&result))
+        return 0;
+
+    GWPEpon_ActionStartRetry(action, cmd, stats, &result);
+    return -1;
+}
+
+static void GWPEpon_ActionAsyncDone(pid_t pid, int wstatus, void *arg)
+{
+    GWPEpon_InFlight *job = (GWPEpon_InFlight *) arg;
+    GWPEpon_ActionResult result;
+
+    (void) pid;
+    GWPEpon_ActionDecode(wstatus, job->start_ms, &result);
+    job->in_use = 0;
+
+    // A superseded run is neither a failure nor retried
+    if (job->cancelled)
+    {
+        result.cancelled = 1;
+    }
+    else
+    {
+        GWPEpon_ActionRecord(job->stats, job->action, &result);
+        if (GWPEpon_ActionFailed(&result))
+            GWPEpon_ActionStartRetry(job->action, job->cmd, job->stats, &result);
+    }
+
+    if (job->cb)
+        job->cb(job->action, &result, job->arg);
+}
+
+/**************************************************************************/
+/*! \fn pid_t GWPEpon_ActionRunAsync
+ **************************************************************************
+ *  \brief Start cmd without blocking the event loop. cb is called from the
+ *    loop with the result of the first attempt; failures are retried
+ *    according to the action's policy like GWPEpon_ActionRun.
+ *  \return child pid, -1 if the action could not be started
+ **************************************************************************/
+pid_t GWPEpon_ActionRunAsync(const char *action, const char *cmd, GWPEpon_ActionDoneCb cb, void *arg)
+{
+    GWPEpon_InFlight *job = NULL;
+    int i;
+
+    for (i = 0; i < GWPEPON_ACTION_MAX_INFLIGHT; i++)
+    {
+        if (!inflight_jobs[i].in_use)
+        {
+            job = &inflight_jobs[i];
+            break;
+        }
+    }
+    if (job == NULL)
+    {
+        GWPROVEPONLOG(ERROR, "no in-flight slot left for action %s\n", action)
+        return -1;
+    }
+
+    GWPEpon_ActionSupersede(action, cmd);
+
+    job->action = action;
+    job->cancelled = 0;
+    job->stats = GWPEpon_ActionFindStats(action);
+    job->cb = cb;
+    job->arg = arg;
+    job->start_ms = GWPEpon_NowMs();
+    snprintf(job->cmd, sizeof(job->cmd), "%s", cmd);
+    job->in_use = 1;
+    job->pid = GWPEpon_ChildSpawn(job->cmd, GWPEpon_ActionAsyncDone, job);
+    if (job->pid < 0)
+    {
+        job->in_use = 0;
+        return -1;
+    }
+    return job->pid;
+}
+
+/**************************************************************************/
+/*! \fn void GWPEpon_ActionCancel(const char *action)
+ **************************************************************************
+ *  \brief Cancel what a run of the keyed action would supersede, for a
+ *    change made without running it (netlink, a signal)
+ *  \return void
+ **************************************************************************/
+void GWPEpon_ActionCancel(const char *action)
+{
+    if (GWPEpon_ActionKey(action) != NULL)
+        GWPEpon_ActionSupersede(action, "");
+}
+
+static void GWPEpon_ActionStartRetry(const char *action, const char *cmd, GWPEpon_ActionStats *stats,
+                                     const GWPEpon_ActionResult *result)
+{
+    const GWPEpon_RetryPolicy *policy = GWPEpon_ActionPolicy(action);
+    GWPEpon_PendingRetry *retry;
+    int i;
+
+    if (policy->max_retries == 0)
+    {
+        GWPEpon_ActionReportFailure(action, result, 1);
+        if (stats)
+            stats->persistent_failures++;
+        return;
+    }
+
+    for (i = 0; i < GWPEPON_ACTION_MAX_PENDING; i++)
+    {
+        if (!pending_retries[i].in_use)
+            break;
+    }
+    if (i == GWPEPON_ACTION_MAX_PENDING)
+    {
+        GWPROVEPONLOG(ERROR, "no retry slot left for action %s\n", action)
+        GWPEpon_ActionReportFailure(action, result, 1);
+        if (stats)
+            stats->persistent_failures++;
+        return;
+    }
+
+    retry = &pending_retries[i];
+    retry->in_use = 1;
+    retry->policy = *policy;
+    retry->stats = stats;
+    retry->attempt = 0;
+    retry->start_ms = GWPEpon_NowMs();
+    snprintf(retry->cmd, sizeof(retry->cmd), "%s", cmd);
+    GWPEpon_ActionSchedule(retry);
+}
+
+const GWPEpon_ActionStats *GWPEpon_ActionGetStats(int idx)
+{
+    if (idx < 0 || idx >= GWPEPON_ACTION_MAX || action_stats[idx].action == NULL)
+        return NULL;
+    return &action_stats[idx];
+}
+
+/**************************************************************************/
+/*! \fn void GWPEpon_ActionForEachJob(GWPEpon_ActionJobCb cb, void *arg)
+ **************************************************************************
+ *  \brief Report every asynchronous action still running and every retry
+ *    still pending. Synchronous actions block the loop and are never seen.
+ *  \return void
+ **************************************************************************/
+void GWPEpon_ActionForEachJob(GWPEpon_ActionJobCb cb, void *arg)
+{
+    GWPEpon_ActionJob job;
+    int i;
+
+    for (i = 0; i < GWPEPON_ACTION_MAX_INFLIGHT; i++)
+    {
+        if (!inflight_jobs[i].in_use)
+            continue;
+        job.action = inflight_jobs[i].action;
+        job.cmd = inflight_jobs[i].cmd;
+        job.pid = inflight_jobs[i].pid;
+        job.attempt = 0;
+        job.since_ms = inflight_jobs[i].start_ms;
+        cb(&job, arg);
+    }
+
+    for (i = 0; i < GWPEPON_ACTION_MAX_PENDING; i++)
+    {
+        if (!pending_retries[i].in_use)
+            continue;
+        job.action = pending_retries[i].policy.action;
+        job.cmd = pending_retries[i].cmd;
+        job.pid = pending_retries[i].pid;
+        job.attempt = pending_retries[i].attempt + 1;
+        job.since_ms = pending_retries[i].start_ms;
+        cb(&job, arg);
+    }
+}
+
+/**************************************************************************/
+/*! \fn pid_t GWPEpon_ActionPidOf(const char *pidfile, const char *comm)
+ **************************************************************************
+ *  \brief pid of a daemon started outside the action runner, from its pid
+ *    file, checked against /proc/<pid>/comm so a stale pid file naming a
+ *    recycled pid is not trusted
+ *  \return pid, 0 when the daemon is not running
+ **************************************************************************/
+pid_t GWPEpon_ActionPidOf(const char *pidfile, const char *comm)
+{
+    char path[64];
+    char name[32];
+    FILE *fp;
+    long pid = 0;
+
+    if ((fp = fopen(pidfile, "r")) == NULL)
+        return 0;
+    if (fscanf(fp, "%ld", &pid) != 1)
+        pid = 0;
+    fclose(fp);
+    if (pid <= 0)
+        return 0;
+
+    snprintf(path, sizeof(path), "/proc/%ld/comm", pid);
+    if ((fp = fopen(path, "r")) == NULL)
+        return 0;
+    if (fgets(name, sizeof(name), fp) == NULL)
+        name[0] = '\0';
+    fclose(fp);
+    name[strcspn(name, "\n")] = '\0';
+    // comm is truncated to 15 characters
+    if (strncmp(name, comm, 15) != 0)
+        return 0;
+    return (pid_t) pid;
+}
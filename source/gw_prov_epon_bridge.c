@@ -0,0 +1,351 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*! \file gw_prov_epon_bridge.c
+    \brief router <-> bridge mode transition planner
+
+    A switch is executed as a small plan of steps with dependencies. Steps
+    whose dependencies are done run in parallel. A step runs a script, or
+    calls in-process the module that already manages the service. Restart events raised
+    while a switch is in progress (firewall, forwarding, DHCP server) are
+    folded into the plan and run once after the LAN reconfiguration,
+    instead of each restarting its service on its own. The window from the
+    first step until the plan settles is reported as the outage window.
+*/
+
+/**************************************************************************/
+/*      INCLUDES:                                                         */
+/**************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include "gw_prov_epon.h"
+#include "gw_prov_epon_action.h"
+#include "gw_prov_epon_bridge.h"
+#include "gw_prov_epon_ctx.h"
+#include "gw_prov_epon_dhcpc.h"
+#include "gw_prov_epon_dhcps.h"
+#include "gw_prov_epon_evloop.h"
+#include "gw_prov_epon_fw.h"
+#include "gw_prov_epon_log.h"
+#include "gw_prov_epon_state.h"
+
+/**************************************************************************/
+/*      LOCAL DECLARATIONS:                                               */
+/**************************************************************************/
+#define STEP_PENDING   0
+#define STEP_RUNNING   1
+#define STEP_DONE      2
+
+#define STEP_LAN_HANDLER   0
+
+/* A step done in-process rather than by a script, its result is not waited for */
+typedef int (*GWPEpon_BridgeRunFn)(const char *action);
+
+typedef struct
+{
+    const char *action;
+    const char *cmd;
+    GWPEpon_BridgeRunFn run;    /* instead of cmd when set */
+    unsigned int deps;          /* bitmask of steps that must be done first */
+    int state;
+} GWPEpon_BridgeStep;
+
+typedef struct
+{
+    int active;
+    int target;
+    int failed;                 /* the lan_handler step did not exit 0 */
+    int next_target;            /* latest request received while active, -1 none */
+    int nsteps;
+    GWPEpon_BridgeStep steps[GWPEPON_BRIDGE_MAX_STEPS];
+    unsigned long long start_ms;
+    unsigned long long last_end_ms;
+    unsigned int settle_timer;
+} GWPEpon_BridgePlan;
+
+/* Restart events that a bridge mode switch is known to trigger */
+static const struct
+{
+    const char *event;
+    const char *action;
+    const char *cmd;
+    GWPEpon_BridgeRunFn run;
+} storm_steps[] =
+{
+    { "forwarding-restart",  "forwarding_restart", "sh /usr/ccsp/lan_handler.sh forwarding_restart", NULL },
+    // The firewall engine diffs against the kernel, its snapshot must see every restore
+    { "firewall-restart",    "firewall",           NULL, GWPEpon_FwRequest },
+    // Both reach dnsmasq through its controller, which reloads rather than restarts when it can
+    { "dhcp_server-restart", "dhcp_server",        NULL, GWPEpon_DhcpsRequest },
+    { "dhcpv6s_server",      "dhcp_server",        NULL, GWPEpon_DhcpsRequest },
+};
+
+/**************************************************************************/
+/*      LOCAL VARIABLES:                                                  */
+/**************************************************************************/
+static GWPEPON_THREAD_LOCAL GWPEpon_BridgePlan plan = { .next_target = -1 };
+static GWPEPON_THREAD_LOCAL GWPEpon_BridgeStats bridge_stats;
+
+/**************************************************************************/
+/*      LOCAL FUNCTIONS:                                                  */
+/**************************************************************************/
+static void GWPEpon_BridgePump(void);
+static void GWPEpon_BridgeStart(int target);
+
+static int GWPEpon_BridgeAddStep(const char *action, const char *cmd, GWPEpon_BridgeRunFn run, unsigned int deps)
+{
+    int i;
+
+    for (i = 0; i < plan.nsteps; i++)
+    {
+        if (strcmp(plan.steps[i].action, action) == 0)
+            return i;
+    }
+    if (plan.nsteps == GWPEPON_BRIDGE_MAX_STEPS)
+        return -1;
+
+    plan.steps[plan.nsteps].action = action;
+    plan.steps[plan.nsteps].cmd = cmd;
+    plan.steps[plan.nsteps].run = run;
+    plan.steps[plan.nsteps].deps = deps;
+    plan.steps[plan.nsteps].state = STEP_PENDING;
+    return plan.nsteps++;
+}
+
+static void GWPEpon_BridgeFinish(void *arg)
+{
+    GWPEpon_ProvState *state = GWPEpon_GetProvState();
+    unsigned long long outage;
+
+    (void) arg;
+    plan.settle_timer = 0;
+    plan.active = 0;
+
+    outage = plan.last_end_ms - plan.start_ms;
+    bridge_stats.switches++;
+    bridge_stats.last_outage_ms = outage;
+    bridge_stats.total_outage_ms += outage;
+    if (bridge_stats.min_outage_ms == 0 || outage < bridge_stats.min_outage_ms)
+        bridge_stats.min_outage_ms = outage;
+    if (outage > bridge_stats.max_outage_ms)
+        bridge_stats.max_outage_ms = outage;
+
+    // Only a mode lan_handler.sh applied is known, a failed one is requested again
+    if (plan.failed)
+    {
+        bridge_stats.failures++;
+        state->bridge_mode = -1;
+        GWPROVEPONLOG(ERROR, "bridge mode %d switch failed after %llu ms\n", plan.target, outage)
+    }
+    else
+    {
+        state->bridge_mode = plan.target;
+        GWPROVEPONLOG(WARNING, "bridge mode %d applied in %llu ms with %d steps\n", plan.target, outage, plan.nsteps)
+    }
+    GWPEpon_StateChanged();
+
+    GWPEpon_SyseventSetInt(GWPEPON_BRIDGE_SWITCH_MS_TUPLE, (int) outage);
+    GWPEpon_SyseventSetInt(GWPEPON_BRIDGE_SWITCH_CNT_TUPLE, (int) bridge_stats.switches);
+
+    if (plan.next_target >= 0 && plan.next_target != plan.target)
+    {
+        int target = plan.next_target;
+
+        plan.next_target = -1;
+        GWPEpon_BridgeStart(target);
+        return;
+    }
+
+    plan.next_target = -1;
+    GWPEpon_SyseventSetStr(GWPEPON_BRIDGE_TRANSITION_TUPLE, (unsigned char *) "idle", 0);
+}
+
+static void GWPEpon_BridgeStepDone(const char *action, const GWPEpon_ActionResult *result, void *arg)
+{
+    GWPEpon_BridgeStep *step = (GWPEpon_BridgeStep *) arg;
+
+    (void) action;
+    if (step == &plan.steps[STEP_LAN_HANDLER] && result->exit_code != 0)
+        plan.failed = 1;
+    step->state = STEP_DONE;
+    plan.last_end_ms = GWPEpon_NowMs();
+    GWPEpon_BridgePump();
+}
+
+static void GWPEpon_BridgePump(void)
+{
+    unsigned int done = 0;
+    int busy = 0;
+    int i;
+
+    for (i = 0; i < plan.nsteps; i++)
+    {
+        if (plan.steps[i].state == STEP_DONE)
+            done |= (1U << i);
+    }
+
+    for (i = 0; i < plan.nsteps; i++)
+    {
+        GWPEpon_BridgeStep *step = &plan.steps[i];
+
+        if (step->state == STEP_PENDING && (step->deps & done) == step->deps && step->run)
+        {
+            step->run(step->action);
+            step->state = STEP_DONE;
+            done |= (1U << i);
+            plan.last_end_ms = GWPEpon_NowMs();
+            continue;
+        }
+        if (step->state == STEP_PENDING && (step->deps & done) == step->deps)
+        {
+            step->state = STEP_RUNNING;
+            if (GWPEpon_ActionRunAsync(step->action, step->cmd, GWPEpon_BridgeStepDone, step) < 0)
+            {
+                if (i == STEP_LAN_HANDLER)
+                    plan.failed = 1;
+                step->state = STEP_DONE;
+                done |= (1U << i);
+                continue;
+            }
+        }
+        if (step->state != STEP_DONE)
+            busy = 1;
+    }
+
+    // Leave room for the restart events the switch raises before closing the plan
+    if (!busy && plan.settle_timer == 0)
+        plan.settle_timer = GWPEpon_TimerAdd(GWPEPON_BRIDGE_SETTLE_MS, 0, GWPEpon_BridgeFinish, NULL);
+}
+
+static int GWPEpon_BridgeDhcpv6Client(const char *action)
+{
+    (void) action;
+    // A running client keeps its lease and confirms it, only a dead one is restarted
+    GWPEpon_DhcpcStart(GWPEPON_DHCPC_V6);
+    return 0;
+}
+
+static void GWPEpon_BridgeStart(int target)
+{
+    GWPEpon_ProvState *state = GWPEpon_GetProvState();
+
+    memset(plan.steps, 0, sizeof(plan.steps));
+    plan.nsteps = 0;
+    plan.active = 1;
+    plan.target = target;
+    plan.failed = 0;
+    plan.start_ms = plan.last_end_ms = GWPEpon_NowMs();
+    plan.settle_timer = 0;
+
+    GWPEpon_BridgeAddStep(target ? "bridge_mode_enable" : "bridge_mode_disable",
+                          target ? "sh /usr/ccsp/lan_handler.sh bridge_mode_enable" :
+                                   "sh /usr/ccsp/lan_handler.sh bridge_mode_disable", NULL, 0);
+
+    // The DHCPv6 client only has to pick up the new LAN setup if it is in use at all
+    if (state->ipv6_service)
+        GWPEpon_BridgeAddStep("dhcpv6_client", NULL, GWPEpon_BridgeDhcpv6Client, 1U << STEP_LAN_HANDLER);
+
+    GWPROVEPONLOG(WARNING, "bridge mode switch to %d planned with %d steps\n", target, plan.nsteps)
+    GWPEpon_SyseventSetStr(GWPEPON_BRIDGE_TRANSITION_TUPLE, (unsigned char *) "running", 0);
+    GWPEpon_BridgePump();
+}
+
+/**************************************************************************/
+/*! \fn void GWPEpon_BridgeRequest(int enable)
+ **************************************************************************
+ *  \brief Request a switch to bridge (1) or router (0) mode. A request
+ *    arriving during a switch only replaces the next target, so repeated
+ *    toggles collapse to the last requested mode.
+ *  \return void
+ **************************************************************************/
+void GWPEpon_BridgeRequest(int enable)
+{
+    GWPROVEPONLOG(INFO, "Entering into %s\n",__FUNCTION__)
+
+    if (plan.active)
+    {
+        if (plan.next_target >= 0)
+            bridge_stats.collapsed++;
+        plan.next_target = (enable == plan.target) ? -1 : enable;
+        GWPROVEPONLOG(INFO, "bridge mode switch in progress, next target %d\n", plan.next_target)
+    }
+    else if (GWPEpon_GetProvState()->bridge_mode == enable)
+    {
+        bridge_stats.skipped++;
+        GWPROVEPONLOG(INFO, "bridge mode %d already applied\n", enable)
+    }
+    else
+    {
+        GWPEpon_BridgeStart(enable);
+    }
+
+    GWPROVEPONLOG(INFO, "Exiting from %s\n",__FUNCTION__)
+}
+
+/**************************************************************************/
+/*! \fn int GWPEpon_BridgeAbsorbEvent(const char *name, const char *val)
+ **************************************************************************
+ *  \brief Fold a restart event into the running switch
+ *  \return 1 if the event was absorbed, 0 if it must be dispatched
+ **************************************************************************/
+int GWPEpon_BridgeAbsorbEvent(const char *name, const char *val)
+{
+    unsigned int i;
+    int idx;
+
+    (void) val;
+    if (!plan.active)
+        return 0;
+
+    for (i = 0; i < sizeof(storm_steps) / sizeof(storm_steps[0]); i++)
+    {
+        if (strcmp(storm_steps[i].event, name) != 0)
+            continue;
+
+        idx = GWPEpon_BridgeAddStep(storm_steps[i].action, storm_steps[i].cmd, storm_steps[i].run,
+                                    1U << STEP_LAN_HANDLER);
+        if (idx < 0)
+            return 0;
+
+        // Raised after the step already ran: run it once more at the end of the plan
+        if (plan.steps[idx].state == STEP_DONE)
+            plan.steps[idx].state = STEP_PENDING;
+        if (plan.settle_timer)
+        {
+            GWPEpon_TimerCancel(plan.settle_timer);
+            plan.settle_timer = 0;
+        }
+
+        bridge_stats.suppressed++;
+        GWPROVEPONLOG(INFO, "%s folded into bridge mode switch\n", name)
+        GWPEpon_BridgePump();
+        return 1;
+    }
+    return 0;
+}
+
+int GWPEpon_BridgeInTransition(void)
+{
+    return plan.active;
+}
+
+const GWPEpon_BridgeStats *GWPEpon_BridgeGetStats(void)
+{
+    return &bridge_stats;
+}
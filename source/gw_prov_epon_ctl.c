@@ -0,0 +1,557 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*! \file gw_prov_epon_ctl.c
+    \brief unix domain control socket served from the event loop
+*/
+
+/**************************************************************************/
+/*      INCLUDES:                                                         */
+/**************************************************************************/
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "gw_prov_epon_action.h"
+#include "gw_prov_epon_bridge.h"
+#include "gw_prov_epon_ctl.h"
+#include "gw_prov_epon_ctx.h"
+#include "gw_prov_epon_damp.h"
+#include "gw_prov_epon_dhcpc.h"
+#include "gw_prov_epon_dhcps.h"
+#include "gw_prov_epon_events.h"
+#include "gw_prov_epon_evconf.h"
+#include "gw_prov_epon_evloop.h"
+#include "gw_prov_epon_fw.h"
+#include "gw_prov_epon_gate.h"
+#include "gw_prov_epon_gre.h"
+#include "gw_prov_epon_log.h"
+#include "gw_prov_epon_member.h"
+#include "gw_prov_epon_port.h"
+#include "gw_prov_epon_route.h"
+#include "gw_prov_epon_routed.h"
+#include "gw_prov_epon_seconn.h"
+#include "gw_prov_epon_state.h"
+#include "gw_prov_epon_tsip.h"
+#include "gw_prov_epon_wanmon.h"
+
+/**************************************************************************/
+/*      LOCAL DECLARATIONS:                                               */
+/**************************************************************************/
+typedef struct
+{
+    int fd;
+    int failed;         /* the client cannot take more, the rest is dropped */
+    char *buf;
+    int len;
+    int size;
+} GWPEpon_CtlResp;
+
+/**************************************************************************/
+/*      LOCAL VARIABLES:                                                  */
+/**************************************************************************/
+static GWPEPON_THREAD_LOCAL int ctl_listen_fd = -1;
+static GWPEPON_THREAD_LOCAL int ctl_clients[GWPEPON_CTL_MAX_CLIENTS] = { -1, -1, -1, -1 };
+static GWPEPON_THREAD_LOCAL GWPEpon_CtlInjectCb ctl_inject = NULL;
+static GWPEPON_THREAD_LOCAL char ctl_path[GWPEPON_CTL_PATH_LEN];
+
+/**************************************************************************/
+/*      LOCAL FUNCTIONS:                                                  */
+/**************************************************************************/
+/* Send the lines buffered so far as one message */
+static void GWPEpon_CtlFlush(GWPEpon_CtlResp *resp)
+{
+    if (resp->len > 0 && !resp->failed &&
+        send(resp->fd, resp->buf, resp->len, MSG_DONTWAIT | MSG_NOSIGNAL) < 0)
+        resp->failed = 1;
+    resp->len = 0;
+    resp->buf[0] = '\0';
+}
+
+static void GWPEpon_CtlPrintf(GWPEpon_CtlResp *resp, const char *fmt, ...)
+{
+    va_list ap;
+    int n;
+
+    va_start(ap, fmt);
+    n = vsnprintf(resp->buf + resp->len, resp->size - resp->len, fmt, ap);
+    va_end(ap);
+    if (n >= 0 && resp->len + n < resp->size)
+    {
+        resp->len += n;
+        return;
+    }
+
+    // Keep whole lines only, a reader would misparse a cut key=value
+    resp->buf[resp->len] = '\0';
+    GWPEpon_CtlFlush(resp);
+    va_start(ap, fmt);
+    n = vsnprintf(resp->buf, resp->size, fmt, ap);
+    va_end(ap);
+    if (n < 0 || n >= resp->size)
+        n = snprintf(resp->buf, resp->size, "%s", GWPEPON_CTL_TRUNCATED);
+    resp->len = n;
+}
+
+static void GWPEpon_CtlState(GWPEpon_CtlResp *resp)
+{
+    const GWPEpon_ProvState *state = GWPEpon_GetProvState();
+    const char *name;
+    int open;
+    int i;
+
+    GWPEpon_CtlPrintf(resp, "OK\n");
+    GWPEpon_CtlPrintf(resp, "wan_ifname=%s\n", GWPEpon_CtxCurrent()->ifname);
+    GWPEpon_CtlPrintf(resp, "ready_ms=%llu\n", GWPEpon_CtxCurrent()->ready_ms);
+    GWPEpon_CtlPrintf(resp, "epon_ifstatus=%s\n", state->epon_ifstatus);
+    GWPEpon_CtlPrintf(resp, "ipv4_status=%s\n", state->ipv4_status);
+    GWPEpon_CtlPrintf(resp, "ipv6_status=%s\n", state->ipv6_status);
+    GWPEpon_CtlPrintf(resp, "router_ip_mode=%d\n", (int) state->router_ip_mode);
+    GWPEpon_CtlPrintf(resp, "gw_prov_status=%d\n", state->gw_prov_status);
+    GWPEpon_CtlPrintf(resp, "ipv4_service=%d\n", state->ipv4_service);
+    GWPEpon_CtlPrintf(resp, "ipv6_service=%d\n", state->ipv6_service);
+    GWPEpon_CtlPrintf(resp, "lan_wan_v4=%d\n", (int) state->lan_wan_v4);
+    GWPEpon_CtlPrintf(resp, "lan_wan_v6=%d\n", (int) state->lan_wan_v6);
+    GWPEpon_CtlPrintf(resp, "bridge_mode=%d\n", state->bridge_mode);
+    GWPEpon_CtlPrintf(resp, "bridge_transition=%d\n", GWPEpon_BridgeInTransition());
+    GWPEpon_CtlPrintf(resp, "erouter_reset_count=%d\n", state->erouter_reset_count);
+    GWPEpon_CtlPrintf(resp, "xconf_call_time=%ld\n", (long) state->xconf_call_time);
+    GWPEpon_CtlPrintf(resp, "cur_gw_prov_mode=%s\n",
+                      GWPEpon_GateGetTuple("cur_gw_prov_mode") ? GWPEpon_GateGetTuple("cur_gw_prov_mode") : "");
+
+    for (i = 0; GWPEpon_GateGetInfo(i, &name, &open) == 0; i++)
+        GWPEpon_CtlPrintf(resp, "gate.%s=%s\n", name, open ? "open" : "closed");
+}
+
+static void GWPEpon_CtlListJob(const GWPEpon_ActionJob *job, void *arg)
+{
+    GWPEpon_CtlResp *resp = (GWPEpon_CtlResp *) arg;
+    unsigned long long now = GWPEpon_NowMs();
+
+    if (job->pid > 0)
+        GWPEpon_CtlPrintf(resp, "%s running pid=%d attempt=%u age_ms=%llu cmd=%s\n",
+                          job->action, (int) job->pid, job->attempt, now - job->since_ms, job->cmd);
+    else
+        GWPEpon_CtlPrintf(resp, "%s queued attempt=%u age_ms=%llu cmd=%s\n",
+                          job->action, job->attempt, now - job->since_ms, job->cmd);
+}
+
+static void GWPEpon_CtlActionStats(GWPEpon_CtlResp *resp)
+{
+    const GWPEpon_ActionStats *stats;
+    const GWPEpon_TsipStats *tsip;
+    const GWPEpon_RoutedStats *routed;
+    const GWPEpon_RouteStats *route;
+    const GWPEpon_DhcpcStats *dhcpc;
+    const GWPEpon_DhcpsStats *dhcps;
+    const GWPEpon_PortStats *port;
+    const GWPEpon_GreStats *gre;
+    const GWPEpon_FwStats *fw;
+    const GWPEpon_MemberStats *member;
+    const char *daemon;
+    unsigned long long inplace_avg;
+    unsigned long long restart_avg;
+    int i;
+
+    for (i = 0; (stats = GWPEpon_ActionGetStats(i)) != NULL; i++)
+        GWPEpon_CtlPrintf(resp, "%s stats runs=%u failures=%u retries=%u cancelled=%u saved_ms=%llu\n",
+                          stats->action, stats->runs, stats->failures, stats->retries,
+                          stats->cancelled, stats->saved_ms);
+
+    tsip = GWPEpon_TsipGetStats();
+    GWPEpon_CtlPrintf(resp, "tsip batching requests=%u batches=%u runs=%u avoided=%u collapsed=%u escalated=%u\n",
+                      tsip->requests, tsip->batches, tsip->runs, tsip->avoided, tsip->collapsed, tsip->escalated);
+
+    for (i = 0; (routed = GWPEpon_RoutedGetStats(i, &daemon)) != NULL; i++)
+        GWPEpon_CtlPrintf(resp, "%s vty updates=%u readbacks=%u unchanged=%u pushes=%u commands=%u restarts=%u "
+                          "failures=%u\n", daemon, routed->updates, routed->readbacks, routed->unchanged,
+                          routed->pushes, routed->commands, routed->restarts, routed->failures);
+
+    route = GWPEpon_RouteGetStats();
+    GWPEpon_CtlPrintf(resp, "staticroute netlink applies=%u added=%u deleted=%u unchanged=%u partial=%u failed=%u "
+                      "fallbacks=%u last_us=%llu max_us=%llu\n",
+                      route->applies, route->added, route->deleted, route->unchanged, route->partial, route->failed,
+                      route->fallbacks, route->last_us, route->max_us);
+
+    gre = GWPEpon_GreGetStats();
+    GWPEpon_CtlPrintf(resp, "hotspot tunnel requests=%u unchanged=%u updates=%u rebuilds=%u forced=%u failures=%u "
+                      "last_us=%llu update_us_max=%llu rebuild_us_max=%llu total_us=%llu\n",
+                      gre->requests, gre->unchanged, gre->updates, gre->rebuilds, gre->forced, gre->failures,
+                      gre->last_us, gre->update_us_max, gre->rebuild_us_max, gre->total_us);
+
+    for (i = 0; (fw = GWPEpon_FwGetStats(i, &daemon)) != NULL; i++)
+        GWPEpon_CtlPrintf(resp, "%s firewall requests=%u unchanged=%u deltas=%u full=%u fallbacks=%u rules=%u "
+                          "chains=%u rules_applied=%u chains_changed=%u last_us=%llu max_us=%llu\n",
+                          daemon, fw->requests, fw->unchanged, fw->deltas, fw->full, fw->fallbacks, fw->rules,
+                          fw->chains, fw->rules_applied, fw->chains_changed, fw->last_us, fw->max_us);
+
+    for (i = 0; (port = GWPEpon_PortGetStats(i, &daemon)) != NULL; i++)
+        GWPEpon_CtlPrintf(resp, "%s ports enables=%u disables=%u ports=%u fallbacks=%u last_us=%llu max_us=%llu\n",
+                          daemon, port->enables, port->disables, port->ports, port->fallbacks,
+                          port->last_us, port->max_us);
+
+    member = GWPEpon_MemberGetStats();
+    GWPEpon_CtlPrintf(resp, "%s membership requests=%u moves=%u unchanged=%u echoes=%u fallbacks=%u "
+                      "last_us=%llu max_us=%llu\n", GWPEPON_MEMBER_PORT, member->requests, member->moves,
+                      member->unchanged, member->echoes, member->fallbacks, member->last_us, member->max_us);
+
+    dhcps = GWPEpon_DhcpsGetStats();
+    GWPEpon_CtlPrintf(resp, "%s server requests=%u unchanged=%u reloads=%u restarts=%u avoided=%u resumed=%u\n",
+                      GWPEPON_DHCPS_COMM, dhcps->requests, dhcps->unchanged, dhcps->reloads,
+                      dhcps->restarts, dhcps->avoided, dhcps->resumed);
+
+    for (i = 0; (dhcpc = GWPEpon_DhcpcGetStats(i, &daemon)) != NULL; i++)
+    {
+        inplace_avg = dhcpc->inplace_samples ? dhcpc->inplace_ms_total / dhcpc->inplace_samples : 0;
+        restart_avg = dhcpc->restart_samples ? dhcpc->restart_ms_total / dhcpc->restart_samples : 0;
+        // Saved against acquiring every lease from scratch, as measured on the restarts
+        GWPEpon_CtlPrintf(resp, "%s lease renews=%u restarts=%u kept=%u releases=%u inplace_ms_avg=%llu "
+                          "inplace_ms_max=%llu restart_ms_avg=%llu restart_ms_max=%llu saved_ms=%llu\n",
+                          daemon, dhcpc->renews, dhcpc->restarts, dhcpc->kept, dhcpc->releases,
+                          inplace_avg, dhcpc->inplace_ms_max, restart_avg, dhcpc->restart_ms_max,
+                          restart_avg > inplace_avg ? (restart_avg - inplace_avg) * dhcpc->inplace_samples : 0);
+    }
+}
+
+static void GWPEpon_CtlEvents(GWPEpon_CtlResp *resp)
+{
+    const GWPEpon_SeconnStats *conn = GWPEpon_SeconnGetStats();
+    int cls;
+    int id;
+
+    GWPEpon_CtlPrintf(resp, "OK\n");
+    GWPEpon_CtlPrintf(resp, "sysevent up=%d errors=%u outages=%u attempts=%u reconnects=%u replayed=%u "
+                      "queued=%u dropped=%u republished=%u "
+                      "outage_ms_last=%llu outage_ms_max=%llu outage_ms_total=%llu\n",
+                      conn->up, conn->errors, conn->outages, conn->attempts, conn->reconnects, conn->replayed,
+                      conn->queued, conn->dropped, conn->republished,
+                      conn->outage_ms_last, conn->outage_ms_max, conn->outage_ms_total);
+    for (cls = 0; cls < GWPEPON_CLASS_COUNT; cls++)
+    {
+        const GWPEpon_ClassStats *cstats = GWPEpon_EventGetClassStats((GWPEpon_EventClass) cls);
+
+        GWPEpon_CtlPrintf(resp, "class=%s count=%u aged=%u wait_ms_max=%llu wait_ms_avg=%llu\n",
+                          GWPEpon_EventClassName((GWPEpon_EventClass) cls), cstats->count, cstats->aged,
+                          cstats->wait_ms_max, cstats->count ? cstats->wait_ms_total / cstats->count : 0ULL);
+    }
+    for (id = 0; id < GWPEPON_EV_COUNT; id++)
+    {
+        const GWPEpon_EventStats *stats = GWPEpon_EventGetStats((GWPEpon_EventId) id);
+        const GWPEpon_EventPolicy *policy = GWPEpon_EvConfPolicy((GWPEpon_EventId) id);
+
+        if (stats->count == 0 && stats->dropped == 0 && stats->superseded == 0)
+            continue;
+        GWPEpon_CtlPrintf(resp, "%s lane=%d priority=%d debounce_ms=%u count=%u dropped=%u deduped=%u debounced=%u "
+                          "superseded=%u saved_ms=%llu queue_ms_max=%llu run_ms_max=%llu run_ms_total=%llu\n",
+                          gwpepon_event_table[id].name, gwpepon_event_table[id].lane, policy->priority, policy->debounce_ms,
+                          stats->count, stats->dropped, stats->deduped, stats->debounced,
+                          stats->superseded, stats->saved_ms,
+                          stats->queue_ms_max, stats->run_ms_max, stats->run_ms_total);
+    }
+}
+
+static void GWPEpon_CtlDamping(GWPEpon_CtlResp *resp)
+{
+    int id;
+
+    GWPEpon_CtlPrintf(resp, "OK\n");
+    for (id = 0; id < GWPEPON_EV_COUNT; id++)
+    {
+        const GWPEpon_DampStats *stats = GWPEpon_DampGetStats((GWPEpon_EventId) id);
+        const GWPEpon_DampPolicy *policy = &GWPEpon_EvConfPolicy((GWPEpon_EventId) id)->damp;
+
+        if (policy->penalty == 0 && stats->flaps == 0)
+            continue;
+        GWPEpon_CtlPrintf(resp, "%s state=%s penalty=%u suppress=%u reuse=%u half_life_ms=%u flaps=%u "
+                          "suppressions=%u held=%u released=%u absorbed=%u suppressed_ms=%llu\n",
+                          gwpepon_event_table[id].name, stats->suppressed ? "suppressed" : "active",
+                          stats->penalty, policy->suppress, policy->reuse, policy->half_life_ms,
+                          stats->flaps, stats->suppressions, stats->held, stats->released,
+                          stats->absorbed, stats->suppressed_ms);
+    }
+}
+
+static void GWPEpon_CtlMonitor(GWPEpon_CtlResp *resp)
+{
+    static const char *observed[] = { "unknown", "down", "up" };
+    const GWPEpon_WanMonStats *stats;
+    const char *name;
+    const char *tuple;
+    int item;
+
+    GWPEpon_CtlPrintf(resp, "OK\n");
+    for (item = 0; (stats = GWPEpon_WanMonGetStats(item, &name, &tuple)) != NULL; item++)
+    {
+        GWPEpon_CtlPrintf(resp, "%s tuple=%s kernel=%s transitions=%u injected=%u confirmed=%u "
+                          "unconfirmed=%u disagreements=%u lead_ms_max=%llu lead_ms_total=%llu\n",
+                          name, tuple, observed[stats->observed + 1], stats->transitions,
+                          stats->injected, stats->confirmed, stats->unconfirmed,
+                          stats->disagreements, stats->lead_ms_max, stats->lead_ms_total);
+    }
+}
+
+static void GWPEpon_CtlHandle(char *req, GWPEpon_CtlResp *resp)
+{
+    char *arg;
+
+    req[strcspn(req, "\r\n")] = '\0';
+    arg = strchr(req, ' ');
+    if (arg)
+        *arg++ = '\0';
+
+    if (strcmp(req, "STATE") == 0)
+    {
+        GWPEpon_CtlState(resp);
+    }
+    else if (strcmp(req, "ACTIONS") == 0)
+    {
+        GWPEpon_CtlPrintf(resp, "OK\n");
+        GWPEpon_ActionForEachJob(GWPEpon_CtlListJob, resp);
+        GWPEpon_CtlActionStats(resp);
+    }
+    else if (strcmp(req, "EVENTS") == 0)
+    {
+        GWPEpon_CtlEvents(resp);
+    }
+    else if (strcmp(req, "DAMPING") == 0)
+    {
+        GWPEpon_CtlDamping(resp);
+    }
+    else if (strcmp(req, "MONITOR") == 0)
+    {
+        GWPEpon_CtlMonitor(resp);
+    }
+    else if (strcmp(req, "INJECT") == 0)
+    {
+        char *val;
+
+        if (arg == NULL || *arg == '\0')
+        {
+            GWPEpon_CtlPrintf(resp, "ERR missing event name\n");
+            return;
+        }
+        val = strchr(arg, ' ');
+        if (val)
+            *val++ = '\0';
+
+        GWPROVEPONLOG(WARNING, "control socket injected event %s\n", arg)
+        if (ctl_inject(arg, val ? val : "") < 0)
+            GWPEpon_CtlPrintf(resp, "ERR cannot dispatch %s\n", arg);
+        else
+            GWPEpon_CtlPrintf(resp, "OK\n");
+    }
+    else
+    {
+        GWPEpon_CtlPrintf(resp, "ERR unknown request %s\n", req);
+    }
+}
+
+static void GWPEpon_CtlDrop(int slot)
+{
+    GWPEpon_EvLoopDelFd(ctl_clients[slot]);
+    close(ctl_clients[slot]);
+    ctl_clients[slot] = -1;
+}
+
+static void GWPEpon_CtlClientReadable(int fd, unsigned int events, void *arg)
+{
+    int slot = (int) (long) arg;
+    char req[GWPEPON_CTL_REQ_LEN];
+    char buf[GWPEPON_CTL_RESP_LEN];
+    GWPEpon_CtlResp resp = { fd, 0, buf, 0, sizeof(buf) };
+    ssize_t n;
+
+    n = recv(fd, req, sizeof(req) - 1, MSG_DONTWAIT);
+    if (n < 0 && (errno == EAGAIN || errno == EINTR))
+        return;
+    if (n <= 0 || (events & (EPOLLHUP | EPOLLERR)))
+    {
+        GWPEpon_CtlDrop(slot);
+        return;
+    }
+
+    req[n] = '\0';
+    buf[0] = '\0';
+    GWPEpon_CtlHandle(req, &resp);
+    GWPEpon_CtlFlush(&resp);
+
+    if (resp.failed || send(fd, GWPEPON_CTL_END, strlen(GWPEPON_CTL_END), MSG_DONTWAIT | MSG_NOSIGNAL) < 0)
+        GWPEpon_CtlDrop(slot);
+}
+
+static void GWPEpon_CtlAccept(int fd, unsigned int events, void *arg)
+{
+    int client;
+    int slot;
+
+    client = accept(fd, NULL, NULL);
+    if (client < 0)
+        return;
+    // Not inherited by the action children; all I/O on it uses MSG_DONTWAIT
+    fcntl(client, F_SETFD, FD_CLOEXEC);
+
+    for (slot = 0; slot < GWPEPON_CTL_MAX_CLIENTS; slot++)
+    {
+        if (ctl_clients[slot] < 0)
+            break;
+    }
+    if (slot == GWPEPON_CTL_MAX_CLIENTS)
+    {
+        GWPROVEPONLOG(WARNING, "control socket busy, rejecting client\n")
+        close(client);
+        return;
+    }
+
+    if (GWPEpon_EvLoopAddFd(client, EPOLLIN, GWPEpon_CtlClientReadable, (void *) (long) slot) < 0)
+    {
+        close(client);
+        return;
+    }
+    ctl_clients[slot] = client;
+}
+
+/**************************************************************************/
+/*! \fn int GWPEpon_CtlInit(GWPEpon_CtlInjectCb inject)
+ **************************************************************************
+ *  \brief Create the control socket and serve it from the event loop.
+ *    inject is called from the loop for INJECT requests.
+ *  \return 0 on success, -1 on failure
+ **************************************************************************/
+int GWPEpon_CtlInit(GWPEpon_CtlInjectCb inject)
+{
+    struct sockaddr_un addr;
+
+    ctl_inject = inject;
+    snprintf(ctl_path, sizeof(ctl_path), "%s",
+             GWPEpon_CtxPath(GWPEPON_CTL_SOCKET, addr.sun_path, sizeof(addr.sun_path)));
+    ctl_listen_fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (ctl_listen_fd < 0)
+    {
+        GWPROVEPONLOG(ERROR, "control socket: %s\n", strerror(errno))
+        return -1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", ctl_path);
+    unlink(ctl_path);
+
+    if (bind(ctl_listen_fd, (struct sockaddr *) &addr, sizeof(addr)) < 0 ||
+        chmod(ctl_path, S_IRUSR | S_IWUSR) < 0 ||
+        listen(ctl_listen_fd, GWPEPON_CTL_MAX_CLIENTS) < 0 ||
+        GWPEpon_EvLoopAddFd(ctl_listen_fd, EPOLLIN, GWPEpon_CtlAccept, NULL) < 0)
+    {
+        GWPROVEPONLOG(ERROR, "cannot serve %s: %s\n", ctl_path, strerror(errno))
+        close(ctl_listen_fd);
+        ctl_listen_fd = -1;
+        unlink(ctl_path);
+        return -1;
+    }
+    return 0;
+}
+
+void GWPEpon_CtlClose(void)
+{
+    int slot;
+
+    for (slot = 0; slot < GWPEPON_CTL_MAX_CLIENTS; slot++)
+    {
+        if (ctl_clients[slot] >= 0)
+            GWPEpon_CtlDrop(slot);
+    }
+    if (ctl_listen_fd >= 0)
+    {
+        GWPEpon_EvLoopDelFd(ctl_listen_fd);
+        close(ctl_listen_fd);
+        ctl_listen_fd = -1;
+        unlink(ctl_path);
+    }
+}
+
+/**************************************************************************/
+/*! \fn int GWPEpon_CtlRequest(const char *path, const char *request,
+ *        char *resp, int resplen)
+ **************************************************************************
+ *  \brief Send one request to the control socket at path and wait for
+ *    the whole answer, cut at a line boundary and marked when it does not
+ *    fit resp
+ *  \return 0 when the daemon answered OK, -1 otherwise
+ **************************************************************************/
+int GWPEpon_CtlRequest(const char *path, const char *request, char *resp, int resplen)
+{
+    struct sockaddr_un addr;
+    char chunk[GWPEPON_CTL_RESP_LEN];
+    int room = resplen - (int) sizeof(GWPEPON_CTL_TRUNCATED);
+    int len = 0, done = 0, truncated = 0;
+    ssize_t n;
+    int fd;
+
+    resp[0] = '\0';
+    fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path);
+
+    if (connect(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0 ||
+        send(fd, request, strlen(request), MSG_NOSIGNAL) < 0)
+    {
+        snprintf(resp, resplen, "ERR %s\n", strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    while ((n = recv(fd, chunk, sizeof(chunk), 0)) > 0)
+    {
+        if (n == (ssize_t) strlen(GWPEPON_CTL_END) && memcmp(chunk, GWPEPON_CTL_END, n) == 0)
+        {
+            done = 1;
+            break;
+        }
+        if (truncated)
+            continue;
+        // Keep the whole lines that fit, nothing after them
+        if (len + n > room)
+        {
+            truncated = 1;
+            for (n = (room > len) ? room - len : 0; n > 0 && chunk[n - 1] != '\n'; n--)
+                ;
+        }
+        memcpy(resp + len, chunk, n);
+        len += n;
+    }
+    close(fd);
+    if (len == 0 && !done)
+    {
+        snprintf(resp, resplen, "ERR no answer\n");
+        return -1;
+    }
+    resp[len] = '\0';
+    if (truncated || !done)
+        strcat(resp, GWPEPON_CTL_TRUNCATED);
+    return (done && strncmp(resp, "OK", 2) == 0) ? 0 : -1;
+}
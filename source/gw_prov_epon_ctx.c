@@ -0,0 +1,270 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*! \file gw_prov_epon_ctx.c
+    \brief per WAN interface provisioning contexts
+
+    The context table is filled once by the main thread before the
+    handler threads are started and is read only afterwards. Each thread
+    binds its context to a thread local pointer, the sysevent wrappers,
+    file paths and service units are resolved through it.
+*/
+
+/**************************************************************************/
+/*      INCLUDES:                                                         */
+/**************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <syscfg/syscfg.h>
+#include "gw_prov_epon_ctx.h"
+#include "gw_prov_epon_events.h"
+#include "gw_prov_epon_log.h"
+
+/**************************************************************************/
+/*      LOCAL VARIABLES:                                                  */
+/**************************************************************************/
+static GWPEpon_WanCtx wan_ctx[GWPEPON_MAX_WAN];
+static int wan_ctx_count = 0;
+static GWPEPON_THREAD_LOCAL GWPEpon_WanCtx *ctx_current = NULL;
+
+/* Tuples published per interface on top of the WAN lane events */
+static const char *ctx_scoped_tuples[] =
+{
+    "gw_prov_status",
+    "gw_prov_status_str",
+    "cur_router_ip_mode",
+    "erouter_reset_count",
+    "wan-status",
+    NULL
+};
+
+/**************************************************************************/
+/*      LOCAL FUNCTIONS:                                                  */
+/**************************************************************************/
+static void GWPEpon_CtxAdd(const char *ifname)
+{
+    GWPEpon_WanCtx *ctx = &wan_ctx[wan_ctx_count];
+    int i;
+
+    for (i = 0; i < wan_ctx_count; i++)
+    {
+        if (strcmp(wan_ctx[i].ifname, ifname) == 0)
+            return;
+    }
+
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->index = wan_ctx_count;
+    snprintf(ctx->ifname, sizeof(ctx->ifname), "%s", ifname);
+    if (ctx->index > 0)
+        snprintf(ctx->prefix, sizeof(ctx->prefix), "%s_", ifname);
+    ctx->sysevent_fd = ctx->sysevent_fd_gs = -1;
+    ctx->wake_fd = -1;
+    wan_ctx_count++;
+}
+
+/**************************************************************************/
+/*! \fn int GWPEpon_CtxLoad(void)
+ **************************************************************************
+ *  \brief Create one context per interface of syscfg epon_wan_ifnames
+ *  \return number of contexts
+ **************************************************************************/
+int GWPEpon_CtxLoad(void)
+{
+    char ifnames[128];
+    char *ifname, *saveptr = NULL;
+
+    ifnames[0] = '\0';
+    if (syscfg_get(NULL, GWPEPON_WAN_IFNAMES, ifnames, sizeof(ifnames)) != 0)
+        ifnames[0] = '\0';
+
+    wan_ctx_count = 0;
+    for (ifname = strtok_r(ifnames, " ,", &saveptr); ifname != NULL && wan_ctx_count < GWPEPON_MAX_WAN;
+         ifname = strtok_r(NULL, " ,", &saveptr))
+    {
+        if (strlen(ifname) >= IFNAMSIZ)
+        {
+            GWPROVEPONLOG(ERROR, "ignoring invalid WAN interface %s\n", ifname)
+            continue;
+        }
+        GWPEpon_CtxAdd(ifname);
+    }
+    if (wan_ctx_count == 0)
+        GWPEpon_CtxAdd(GWPEPON_WAN_IFNAME_DEFAULT);
+
+    GWPROVEPONLOG(INFO, "%d WAN context(s), primary %s\n", wan_ctx_count, wan_ctx[0].ifname)
+    return wan_ctx_count;
+}
+
+int GWPEpon_CtxCount(void)
+{
+    return wan_ctx_count;
+}
+
+GWPEpon_WanCtx *GWPEpon_CtxGet(int index)
+{
+    if (index < 0 || index >= wan_ctx_count)
+        return NULL;
+    return &wan_ctx[index];
+}
+
+/**************************************************************************/
+/*! \fn void GWPEpon_CtxBind(GWPEpon_WanCtx *ctx)
+ **************************************************************************
+ *  \brief Make ctx the context of the calling thread
+ *  \return void
+ **************************************************************************/
+void GWPEpon_CtxBind(GWPEpon_WanCtx *ctx)
+{
+    ctx_current = ctx;
+}
+
+GWPEpon_WanCtx *GWPEpon_CtxCurrent(void)
+{
+    // Threads that never bound a context act for the primary
+    return ctx_current ? ctx_current : &wan_ctx[0];
+}
+
+int GWPEpon_CtxIsPrimary(void)
+{
+    return GWPEpon_CtxCurrent()->index == 0;
+}
+
+/**************************************************************************/
+/*! \fn int GWPEpon_CtxScoped(const char *tuple)
+ **************************************************************************
+ *  \brief Tell whether a tuple exists once per WAN interface
+ *  \return 1 for per interface tuples, 0 for gateway wide ones
+ **************************************************************************/
+int GWPEpon_CtxScoped(const char *tuple)
+{
+    int id;
+    int i;
+
+    for (i = 0; ctx_scoped_tuples[i] != NULL; i++)
+    {
+        if (strcmp(ctx_scoped_tuples[i], tuple) == 0)
+            return 1;
+    }
+
+    id = GWPEpon_EventLookup(tuple);
+    return (id >= 0) && (gwpepon_event_table[id].lane == GWPEPON_LANE_WAN);
+}
+
+/**************************************************************************/
+/*! \fn const char *GWPEpon_CtxTuple(const char *tuple, char *buf, int len)
+ **************************************************************************
+ *  \brief Name of a tuple as seen by sysevent for the current context
+ *  \return tuple itself when unscoped, else buf
+ **************************************************************************/
+const char *GWPEpon_CtxTuple(const char *tuple, char *buf, int len)
+{
+    GWPEpon_WanCtx *ctx = GWPEpon_CtxCurrent();
+
+    if (ctx->prefix[0] == '\0' || !GWPEpon_CtxScoped(tuple))
+        return tuple;
+    snprintf(buf, len, "%s%s", ctx->prefix, tuple);
+    return buf;
+}
+
+/**************************************************************************/
+/*! \fn const char *GWPEpon_CtxUnscope(const char *tuple)
+ **************************************************************************
+ *  \brief Inverse of GWPEpon_CtxTuple, used on received notifications
+ *  \return the interface independent tuple name
+ **************************************************************************/
+const char *GWPEpon_CtxUnscope(const char *tuple)
+{
+    GWPEpon_WanCtx *ctx = GWPEpon_CtxCurrent();
+    size_t len = strlen(ctx->prefix);
+
+    if (len > 0 && strncmp(tuple, ctx->prefix, len) == 0 && GWPEpon_CtxScoped(tuple + len))
+        return tuple + len;
+    return tuple;
+}
+
+/**************************************************************************/
+/*! \fn const char *GWPEpon_CtxPath(const char *path, char *buf, int len)
+ **************************************************************************
+ *  \brief Per interface variant of a marker, checkpoint or socket path
+ *  \return path itself for the primary, else buf
+ **************************************************************************/
+const char *GWPEpon_CtxPath(const char *path, char *buf, int len)
+{
+    GWPEpon_WanCtx *ctx = GWPEpon_CtxCurrent();
+
+    if (ctx->index == 0)
+        return path;
+    snprintf(buf, len, "%s.%s", path, ctx->ifname);
+    return buf;
+}
+
+/**************************************************************************/
+/*! \fn const char *GWPEpon_CtxUnit(const char *service, char *buf, int len)
+ **************************************************************************
+ *  \brief systemd unit running a WAN client for the current context: the
+ *    plain unit for the primary, the <service>@<ifname> template instance
+ *    for a secondary
+ *  \return buf
+ **************************************************************************/
+const char *GWPEpon_CtxUnit(const char *service, char *buf, int len)
+{
+    GWPEpon_WanCtx *ctx = GWPEpon_CtxCurrent();
+
+    if (ctx->index == 0)
+        snprintf(buf, len, "%s.service", service);
+    else
+        snprintf(buf, len, "%s@%s.service", service, ctx->ifname);
+    return buf;
+}
+
+/**************************************************************************/
+/*! \fn int GWPEpon_CtxRequest(GWPEpon_WanCtx *ctx, unsigned int req)
+ **************************************************************************
+ *  \brief Post requests to the handler thread of a secondary context and
+ *    wake its event loop, requests posted before it runs are merged
+ *  \return 0 on success, -1 if the context cannot be woken
+ **************************************************************************/
+int GWPEpon_CtxRequest(GWPEpon_WanCtx *ctx, unsigned int req)
+{
+    uint64_t one = 1;
+
+    if (!ctx->running || ctx->wake_fd < 0)
+        return -1;
+    __atomic_fetch_or(&ctx->requests, req, __ATOMIC_RELEASE);
+    if (write(ctx->wake_fd, &one, sizeof(one)) < 0)
+        return -1;
+    return 0;
+}
+
+/**************************************************************************/
+/*! \fn unsigned int GWPEpon_CtxTakeRequests(GWPEpon_WanCtx *ctx)
+ **************************************************************************
+ *  \brief Drain the wake eventfd and fetch the pending requests
+ *  \return GWPEPON_CTX_REQ_* flags
+ **************************************************************************/
+unsigned int GWPEpon_CtxTakeRequests(GWPEpon_WanCtx *ctx)
+{
+    uint64_t count;
+
+    if (read(ctx->wake_fd, &count, sizeof(count)) < 0)
+        count = 0;
+    return __atomic_exchange_n(&ctx->requests, 0, __ATOMIC_ACQUIRE);
+}
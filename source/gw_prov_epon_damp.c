@@ -0,0 +1,216 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*! \file gw_prov_epon_damp.c
+    \brief flap damping of the WAN status events
+*/
+
+/**************************************************************************/
+/*      INCLUDES:                                                         */
+/**************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include "gw_prov_epon_ctx.h"
+#include "gw_prov_epon_damp.h"
+#include "gw_prov_epon_evconf.h"
+#include "gw_prov_epon_evloop.h"
+#include "gw_prov_epon_log.h"
+
+/**************************************************************************/
+/*      LOCAL DECLARATIONS:                                               */
+/**************************************************************************/
+typedef struct
+{
+    int seen;
+    int up;                         /* state of the last value received */
+    int delivered_up;               /* state of the last value dispatched */
+    unsigned int penalty;
+    unsigned long long updated_ms;
+    unsigned long long suppressed_since;
+    int held_valid;
+    char held[GWPEPON_EVENT_VAL_LEN];
+} GWPEpon_DampState;
+
+/**************************************************************************/
+/*      LOCAL VARIABLES:                                                  */
+/**************************************************************************/
+static GWPEPON_THREAD_LOCAL GWPEpon_DampState damp_state[GWPEPON_EV_COUNT];
+static GWPEPON_THREAD_LOCAL GWPEpon_DampStats damp_stats[GWPEPON_EV_COUNT];
+static GWPEPON_THREAD_LOCAL unsigned int damp_timer = 0;
+static GWPEPON_THREAD_LOCAL GWPEpon_DampReleaseCb damp_release = NULL;
+
+/**************************************************************************/
+/*      LOCAL FUNCTIONS:                                                  */
+/**************************************************************************/
+/* penalty * 2^(-elapsed/half_life), linear within a half-life (error below 6%) */
+static void GWPEpon_DampDecay(GWPEpon_DampState *st, const GWPEpon_DampPolicy *policy, unsigned long long now)
+{
+    unsigned long long elapsed = now - st->updated_ms;
+    unsigned long long halves = elapsed / policy->half_life_ms;
+    unsigned long long rest = elapsed % policy->half_life_ms;
+
+    st->updated_ms = now;
+    if (halves >= 32)
+    {
+        st->penalty = 0;
+        return;
+    }
+    st->penalty >>= halves;
+    st->penalty -= (unsigned int) ((unsigned long long) st->penalty * rest / (2ULL * policy->half_life_ms));
+}
+
+/* Highest penalty that still decays to reuse within max_suppress_ms */
+static unsigned int GWPEpon_DampCeiling(const GWPEpon_DampPolicy *policy)
+{
+    unsigned int halves = policy->max_suppress_ms / policy->half_life_ms;
+
+    if (halves > 16)
+        halves = 16;
+    return policy->reuse << halves;
+}
+
+static void GWPEpon_DampCheck(void *arg)
+{
+    unsigned long long now = GWPEpon_NowMs();
+    int suppressed = 0;
+    int id;
+
+    (void) arg;
+    for (id = 0; id < GWPEPON_EV_COUNT; id++)
+    {
+        const GWPEpon_DampPolicy *policy = &GWPEpon_EvConfPolicy((GWPEpon_EventId) id)->damp;
+        GWPEpon_DampState *st = &damp_state[id];
+        GWPEpon_DampStats *stats = &damp_stats[id];
+
+        if (!stats->suppressed)
+            continue;
+        // Damping switched off by a config reload releases the event at once
+        if (policy->penalty > 0)
+        {
+            GWPEpon_DampDecay(st, policy, now);
+            stats->penalty = st->penalty;
+            if (st->penalty >= policy->reuse)
+            {
+                suppressed++;
+                continue;
+            }
+        }
+
+        stats->suppressed = 0;
+        stats->suppressed_ms += now - st->suppressed_since;
+        GWPROVEPONLOG(WARNING, "%s stable again after %llu ms of damping\n",
+                      gwpepon_event_table[id].name, now - st->suppressed_since)
+        if (!st->held_valid)
+            continue;
+        st->held_valid = 0;
+        if (st->up == st->delivered_up)
+        {
+            stats->absorbed++;
+            continue;
+        }
+        stats->released++;
+        if (damp_release)
+            damp_release((GWPEpon_EventId) id, st->held);
+    }
+
+    if (suppressed == 0 && damp_timer)
+    {
+        GWPEpon_TimerCancel(damp_timer);
+        damp_timer = 0;
+    }
+}
+
+/**************************************************************************/
+/*! \fn void GWPEpon_DampInit(GWPEpon_DampReleaseCb release)
+ **************************************************************************
+ *  \brief Reset the damping state of the current context. release is
+ *    called with the held value of an event that became stable again.
+ *  \return void
+ **************************************************************************/
+void GWPEpon_DampInit(GWPEpon_DampReleaseCb release)
+{
+    memset(damp_state, 0, sizeof(damp_state));
+    memset(damp_stats, 0, sizeof(damp_stats));
+    damp_timer = 0;
+    damp_release = release;
+}
+
+/**************************************************************************/
+/*! \fn int GWPEpon_DampFilter(GWPEpon_EventId id, const char *val)
+ **************************************************************************
+ *  \brief Account a value of event id and tell whether it must be held
+ *  \return 1 when the value is held, 0 when it is dispatched
+ **************************************************************************/
+int GWPEpon_DampFilter(GWPEpon_EventId id, const char *val)
+{
+    const GWPEpon_DampPolicy *policy = &GWPEpon_EvConfPolicy(id)->damp;
+    GWPEpon_DampState *st = &damp_state[id];
+    GWPEpon_DampStats *stats = &damp_stats[id];
+    unsigned long long now = GWPEpon_NowMs();
+    int up = (strcmp(val, "up") == 0);
+    unsigned int ceiling;
+
+    if (policy->penalty == 0 && !stats->suppressed)
+    {
+        st->seen = 1;
+        st->up = st->delivered_up = up;
+        return 0;
+    }
+
+    if (policy->penalty > 0)
+    {
+        GWPEpon_DampDecay(st, policy, now);
+        if (st->seen && up != st->up)
+        {
+            stats->flaps++;
+            ceiling = GWPEpon_DampCeiling(policy);
+            st->penalty = (st->penalty + policy->penalty > ceiling) ? ceiling : st->penalty + policy->penalty;
+        }
+        stats->penalty = st->penalty;
+    }
+    st->seen = 1;
+    st->up = up;
+
+    if (!stats->suppressed && st->penalty >= policy->suppress)
+    {
+        stats->suppressed = 1;
+        stats->suppressions++;
+        st->suppressed_since = now;
+        GWPROVEPONLOG(WARNING, "%s is flapping (penalty %u), holding it until stable\n",
+                      gwpepon_event_table[id].name, st->penalty)
+        if (damp_timer == 0)
+            damp_timer = GWPEpon_TimerAdd(GWPEPON_DAMP_CHECK_MS, GWPEPON_DAMP_CHECK_MS, GWPEpon_DampCheck, NULL);
+    }
+
+    if (!stats->suppressed)
+    {
+        st->delivered_up = up;
+        return 0;
+    }
+
+    stats->held++;
+    st->held_valid = 1;
+    snprintf(st->held, sizeof(st->held), "%s", val);
+    return 1;
+}
+
+const GWPEpon_DampStats *GWPEpon_DampGetStats(GWPEpon_EventId id)
+{
+    return &damp_stats[id];
+}
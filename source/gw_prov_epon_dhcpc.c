@@ -0,0 +1,194 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*! \file gw_prov_epon_dhcpc.c
+    \brief WAN DHCP clients renewed and released in place
+*/
+
+/**************************************************************************/
+/*      INCLUDES:                                                         */
+/**************************************************************************/
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include "gw_prov_epon_action.h"
+#include "gw_prov_epon_ctx.h"
+#include "gw_prov_epon_dhcpc.h"
+#include "gw_prov_epon_evloop.h"
+#include "gw_prov_epon_log.h"
+
+/**************************************************************************/
+/*      LOCAL DECLARATIONS:                                               */
+/**************************************************************************/
+typedef enum
+{
+    GWPEPON_DHCPC_IDLE = 0,
+    GWPEPON_DHCPC_INPLACE,
+    GWPEPON_DHCPC_RESTART
+} GWPEpon_DhcpcPending;
+
+typedef struct
+{
+    const char *unit;           /* systemd service, see GWPEpon_CtxUnit */
+    const char *comm;           /* /proc/<pid>/comm of a live client */
+    const char *pidfile;
+    int renew_sig;              /* 0: the client follows the link itself */
+    int release_sig;            /* 0: the client releases when it exits */
+} GWPEpon_DhcpcClient;
+
+/**************************************************************************/
+/*      LOCAL VARIABLES:                                                  */
+/**************************************************************************/
+static const GWPEpon_DhcpcClient dhcpc_clients[GWPEPON_DHCPC_COUNT] =
+{
+    { "udhcp",   "udhcpc",         GWPEPON_DHCPC_UDHCPC_PIDFILE,  SIGUSR1, SIGUSR2 },
+    { "dibbler", "dibbler-client", GWPEPON_DHCPC_DIBBLER_PIDFILE, 0,       0       },
+};
+
+static GWPEPON_THREAD_LOCAL GWPEpon_DhcpcStats dhcpc_stats[GWPEPON_DHCPC_COUNT];
+static GWPEPON_THREAD_LOCAL GWPEpon_DhcpcPending dhcpc_pending[GWPEPON_DHCPC_COUNT];
+static GWPEPON_THREAD_LOCAL unsigned long long dhcpc_since_ms[GWPEPON_DHCPC_COUNT];
+
+/**************************************************************************/
+/*      LOCAL FUNCTIONS:                                                  */
+/**************************************************************************/
+/* pid of the running client, 0 when it is not running */
+static pid_t GWPEpon_DhcpcPid(const GWPEpon_DhcpcClient *client)
+{
+    char path[64];
+
+    return GWPEpon_ActionPidOf(GWPEpon_CtxPath(client->pidfile, path, sizeof(path)), client->comm);
+}
+
+static void GWPEpon_DhcpcUnit(const GWPEpon_DhcpcClient *client, const char *verb, const char *action)
+{
+    char unit[64];
+    char cmd[128];
+
+    snprintf(cmd, sizeof(cmd), "systemctl %s %s", verb, GWPEpon_CtxUnit(client->unit, unit, sizeof(unit)));
+    // Async, a restart superseded by a stop (or the reverse) is killed
+    GWPEpon_ActionRunAsync(action, cmd, NULL, NULL);
+}
+
+/**************************************************************************/
+/*! \fn int GWPEpon_DhcpcStart(GWPEpon_DhcpcFamily family)
+ **************************************************************************
+ *  \brief Get a lease: a live client renews the one it holds, or solicits
+ *    again after a release, a dead one is restarted
+ *  \return 1 when the client was reused, 0 when it was restarted
+ **************************************************************************/
+int GWPEpon_DhcpcStart(GWPEpon_DhcpcFamily family)
+{
+    const GWPEpon_DhcpcClient *client = &dhcpc_clients[family];
+    pid_t pid = GWPEpon_DhcpcPid(client);
+
+    dhcpc_since_ms[family] = GWPEpon_NowMs();
+    if (pid > 0 && (client->renew_sig == 0 || kill(pid, client->renew_sig) == 0))
+    {
+        // A stop of the service still running would take the client away
+        GWPEpon_ActionCancel(family == GWPEPON_DHCPC_V4 ? "udhcp_restart" : "dibbler_restart");
+        GWPROVEPONLOG(INFO, "%s %d reused, %s\n", client->comm, (int) pid,
+                      client->renew_sig ? "renewing" : "it confirms its bindings itself")
+        dhcpc_stats[family].renews++;
+        dhcpc_pending[family] = GWPEPON_DHCPC_INPLACE;
+        return 1;
+    }
+
+    GWPROVEPONLOG(INFO, "%s not running, restarting it\n", client->comm)
+    GWPEpon_DhcpcUnit(client, "restart", family == GWPEPON_DHCPC_V4 ? "udhcp_restart" : "dibbler_restart");
+    dhcpc_stats[family].restarts++;
+    dhcpc_pending[family] = GWPEPON_DHCPC_RESTART;
+    return 0;
+}
+
+/**************************************************************************/
+/*! \fn void GWPEpon_DhcpcStop(GWPEpon_DhcpcFamily family, int release)
+ **************************************************************************
+ *  \brief Stop using the client. On a link down the lease is kept for the
+ *    renewal, release gives it back to the server for good.
+ *  \return void
+ **************************************************************************/
+void GWPEpon_DhcpcStop(GWPEpon_DhcpcFamily family, int release)
+{
+    const GWPEpon_DhcpcClient *client = &dhcpc_clients[family];
+    pid_t pid = GWPEpon_DhcpcPid(client);
+
+    dhcpc_pending[family] = GWPEPON_DHCPC_IDLE;
+    if (!release)
+    {
+        if (pid > 0)
+        {
+            GWPROVEPONLOG(INFO, "%s %d keeps its lease while the link is down\n", client->comm, (int) pid)
+            dhcpc_stats[family].kept++;
+        }
+        return;
+    }
+
+    dhcpc_stats[family].releases++;
+    if (pid > 0 && client->release_sig != 0 && kill(pid, client->release_sig) == 0)
+    {
+        GWPEpon_ActionCancel(family == GWPEPON_DHCPC_V4 ? "udhcp_stop" : "dibbler_stop");
+        GWPROVEPONLOG(INFO, "%s %d released its lease\n", client->comm, (int) pid)
+        return;
+    }
+    GWPEpon_DhcpcUnit(client, "stop", family == GWPEPON_DHCPC_V4 ? "udhcp_stop" : "dibbler_stop");
+}
+
+/**************************************************************************/
+/*! \fn void GWPEpon_DhcpcBound(GWPEpon_DhcpcFamily family)
+ **************************************************************************
+ *  \brief The status tuple of the family reported "up", close the
+ *    acquisition started by GWPEpon_DhcpcStart
+ *  \return void
+ **************************************************************************/
+void GWPEpon_DhcpcBound(GWPEpon_DhcpcFamily family)
+{
+    GWPEpon_DhcpcStats *stats = &dhcpc_stats[family];
+    unsigned long long ms;
+
+    if (dhcpc_pending[family] == GWPEPON_DHCPC_IDLE)
+        return;
+    ms = GWPEpon_NowMs() - dhcpc_since_ms[family];
+    if (dhcpc_pending[family] == GWPEPON_DHCPC_INPLACE)
+    {
+        stats->inplace_samples++;
+        stats->inplace_ms_total += ms;
+        if (ms > stats->inplace_ms_max)
+            stats->inplace_ms_max = ms;
+    }
+    else
+    {
+        stats->restart_samples++;
+        stats->restart_ms_total += ms;
+        if (ms > stats->restart_ms_max)
+            stats->restart_ms_max = ms;
+    }
+    GWPROVEPONLOG(INFO, "%s lease %s in %llu ms\n", dhcpc_clients[family].comm,
+                  dhcpc_pending[family] == GWPEPON_DHCPC_INPLACE ? "reacquired in place" : "acquired", ms)
+    dhcpc_pending[family] = GWPEPON_DHCPC_IDLE;
+}
+
+const GWPEpon_DhcpcStats *GWPEpon_DhcpcGetStats(int family, const char **client)
+{
+    if (family < 0 || family >= GWPEPON_DHCPC_COUNT)
+        return NULL;
+    *client = dhcpc_clients[family].comm;
+    return &dhcpc_stats[family];
+}
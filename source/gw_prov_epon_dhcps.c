@@ -0,0 +1,302 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*! \file gw_prov_epon_dhcps.c
+    \brief LAN DHCP/DNS server reloaded only when its configuration changed
+*/
+
+/**************************************************************************/
+/*      INCLUDES:                                                         */
+/**************************************************************************/
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <syscfg/syscfg.h>
+#include "gw_prov_epon.h"
+#include "gw_prov_epon_action.h"
+#include "gw_prov_epon_ctx.h"
+#include "gw_prov_epon_dhcps.h"
+#include "gw_prov_epon_log.h"
+#include "gw_prov_epon_state.h"
+
+/**************************************************************************/
+/*      LOCAL DECLARATIONS:                                               */
+/**************************************************************************/
+#define DHCPS_SYSCFG     0
+#define DHCPS_SYSEVENT   1
+
+typedef struct
+{
+    int source;
+    const char *name;
+    int reload;             /* applied by SIGHUP, dnsmasq rereads resolv.conf */
+} GWPEpon_DhcpsInput;
+
+/**************************************************************************/
+/*      LOCAL VARIABLES:                                                  */
+/**************************************************************************/
+/* What lan_handler.sh renders the server configuration from */
+static const GWPEpon_DhcpsInput dhcps_inputs[] =
+{
+    { DHCPS_SYSCFG,   "dhcp_server_enabled",     0 },
+    { DHCPS_SYSCFG,   "lan_ipaddr",              0 },
+    { DHCPS_SYSCFG,   "lan_netmask",             0 },
+    { DHCPS_SYSCFG,   "dhcp_start",              0 },
+    { DHCPS_SYSCFG,   "dhcp_end",                0 },
+    { DHCPS_SYSCFG,   "dhcp_lease_time",         0 },
+    { DHCPS_SYSCFG,   "dhcp_nameserver_enabled", 0 },
+    { DHCPS_SYSCFG,   "dhcp_nameserver_1",       0 },
+    { DHCPS_SYSCFG,   "dhcp_nameserver_2",       0 },
+    { DHCPS_SYSCFG,   "dhcp_nameserver_3",       0 },
+    { DHCPS_SYSEVENT, "dhcp_domain",             0 },
+    { DHCPS_SYSEVENT, "lan_ipaddr_v6",           0 },
+    { DHCPS_SYSEVENT, "ipv6_prefix",             0 },
+    { DHCPS_SYSEVENT, "wan_dhcp_dns",            1 },
+    { DHCPS_SYSEVENT, "ipv6_nameserver",         1 },
+};
+
+#define DHCPS_INPUTS     (sizeof(dhcps_inputs) / sizeof(dhcps_inputs[0]))
+
+static GWPEPON_THREAD_LOCAL int dhcps_valid = 0;
+static GWPEPON_THREAD_LOCAL int dhcps_seeded = 0;
+static GWPEPON_THREAD_LOCAL char dhcps_applied[DHCPS_INPUTS][GWPEPON_DHCPS_VAL_LEN];
+static GWPEPON_THREAD_LOCAL char dhcps_starting[DHCPS_INPUTS][GWPEPON_DHCPS_VAL_LEN];  /* rendered by the restart in flight */
+static GWPEPON_THREAD_LOCAL int dhcps_restarting = 0;
+static GWPEPON_THREAD_LOCAL int dhcps_again = 0;       /* a request came during the restart */
+static GWPEPON_THREAD_LOCAL GWPEpon_DhcpsStats dhcps_stats;
+
+/**************************************************************************/
+/*      LOCAL FUNCTIONS:                                                  */
+/**************************************************************************/
+static void GWPEpon_DhcpsRead(char values[][GWPEPON_DHCPS_VAL_LEN])
+{
+    unsigned int i;
+
+    for (i = 0; i < DHCPS_INPUTS; i++)
+    {
+        values[i][0] = '\0';
+        if (dhcps_inputs[i].source == DHCPS_SYSCFG)
+        {
+            if (syscfg_get(NULL, dhcps_inputs[i].name, values[i], GWPEPON_DHCPS_VAL_LEN) != 0)
+                values[i][0] = '\0';
+        }
+        else if (GWPEpon_SyseventGetStr(dhcps_inputs[i].name, (unsigned char *) values[i], GWPEPON_DHCPS_VAL_LEN) != 0)
+        {
+            values[i][0] = '\0';
+        }
+    }
+}
+
+/* Record what the running server was started or reloaded with, for the
+   next instance of the daemon */
+static void GWPEpon_DhcpsSave(pid_t pid)
+{
+    char path[GWPEPON_CKPT_PATH_LEN];
+    char tmp_path[GWPEPON_CKPT_PATH_LEN + 4];
+    const char *file = GWPEpon_CtxPath(GWPEPON_DHCPS_CKPT_FILE, path, sizeof(path));
+    unsigned int i;
+    FILE *fp;
+    int ret;
+
+    if (pid <= 0)
+    {
+        unlink(file);
+        return;
+    }
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", file);
+    if ((fp = fopen(tmp_path, "w")) == NULL)
+    {
+        GWPROVEPONLOG(ERROR, "cannot create %s: %s\n", tmp_path, strerror(errno))
+        return;
+    }
+    fprintf(fp, "pid=%d\n", (int) pid);
+    for (i = 0; i < DHCPS_INPUTS; i++)
+        fprintf(fp, "%s=%s\n", dhcps_inputs[i].name, dhcps_applied[i]);
+    ret = fflush(fp);
+    if (fclose(fp) != 0 || ret != 0 || rename(tmp_path, file) < 0)
+    {
+        GWPROVEPONLOG(ERROR, "cannot write %s\n", file)
+        unlink(tmp_path);
+        unlink(file);
+    }
+}
+
+/* After a warm restart, take over the configuration the previous instance
+   applied to the server still running, instead of restarting it */
+static void GWPEpon_DhcpsSeed(pid_t pid)
+{
+    char path[GWPEPON_CKPT_PATH_LEN];
+    char line[GWPEPON_DHCPS_VAL_LEN + 64];
+    char values[DHCPS_INPUTS][GWPEPON_DHCPS_VAL_LEN];
+    unsigned int found = 0, i;
+    int saved_pid = 0;
+    FILE *fp;
+
+    dhcps_seeded = 1;
+    if (!GWPEpon_CtxCurrent()->warm_restart || pid <= 0)
+        return;
+    if ((fp = fopen(GWPEpon_CtxPath(GWPEPON_DHCPS_CKPT_FILE, path, sizeof(path)), "r")) == NULL)
+        return;
+    while (fgets(line, sizeof(line), fp) != NULL)
+    {
+        char *val = strchr(line, '=');
+
+        if (val == NULL)
+            continue;
+        *val++ = '\0';
+        val[strcspn(val, "\n")] = '\0';
+        if (strcmp(line, "pid") == 0)
+        {
+            saved_pid = atoi(val);
+            continue;
+        }
+        for (i = 0; i < DHCPS_INPUTS; i++)
+        {
+            if (strcmp(line, dhcps_inputs[i].name) == 0)
+            {
+                snprintf(values[i], sizeof(values[i]), "%s", val);
+                found |= 1u << i;
+            }
+        }
+    }
+    fclose(fp);
+
+    // Another server than the one recorded, or a partial record: unknown
+    if (saved_pid != (int) pid || found != (1u << DHCPS_INPUTS) - 1)
+    {
+        GWPROVEPONLOG(WARNING, "%s %d not started by the previous instance, restarting it on the first request\n",
+                      GWPEPON_DHCPS_COMM, (int) pid)
+        return;
+    }
+    memcpy(dhcps_applied, values, sizeof(dhcps_applied));
+    dhcps_valid = 1;
+    dhcps_stats.resumed++;
+    GWPROVEPONLOG(INFO, "%s %d resumed with the configuration of the previous instance\n", GWPEPON_DHCPS_COMM, (int) pid)
+}
+
+static void GWPEpon_DhcpsRestarted(const char *action, const GWPEpon_ActionResult *result, void *arg)
+{
+    dhcps_restarting = 0;
+    if (result->exit_code != 0)
+    {
+        // Whatever it runs now is unknown, the next request restarts it again
+        dhcps_valid = 0;
+        GWPEpon_DhcpsSave(0);
+    }
+    else
+    {
+        memcpy(dhcps_applied, dhcps_starting, sizeof(dhcps_applied));
+        dhcps_valid = 1;
+        GWPEpon_DhcpsSave(GWPEpon_ActionPidOf(GWPEPON_DHCPS_PIDFILE, GWPEPON_DHCPS_COMM));
+    }
+    if (dhcps_again)
+    {
+        dhcps_again = 0;
+        GWPEpon_DhcpsRequest("request held during the restart");
+    }
+}
+
+/**************************************************************************/
+/*! \fn int GWPEpon_DhcpsRequest(const char *name)
+ **************************************************************************
+ *  \brief Bring the LAN DHCP server up to date with its inputs, at the
+ *    lowest cost for the LAN clients. A restart runs in the background, a
+ *    request coming meanwhile is compared with its result once it is over.
+ *  \return 0 on success or once the restart started, -1 if it could not start
+ **************************************************************************/
+int GWPEpon_DhcpsRequest(const char *name)
+{
+    char values[DHCPS_INPUTS][GWPEPON_DHCPS_VAL_LEN];
+    const char *changed = NULL;
+    int restart = 0;
+    pid_t pid;
+    unsigned int i;
+
+    dhcps_stats.requests++;
+    if (dhcps_restarting)
+    {
+        GWPROVEPONLOG(INFO, "%s: LAN DHCP server restarting, checked once it is up\n", name)
+        dhcps_again = 1;
+        return 0;
+    }
+    GWPEpon_DhcpsRead(values);
+    pid = GWPEpon_ActionPidOf(GWPEPON_DHCPS_PIDFILE, GWPEPON_DHCPS_COMM);
+    if (!dhcps_seeded)
+        GWPEpon_DhcpsSeed(pid);
+
+    if (!dhcps_valid || pid <= 0)
+    {
+        restart = 1;
+    }
+    else
+    {
+        for (i = 0; i < DHCPS_INPUTS; i++)
+        {
+            if (strcmp(values[i], dhcps_applied[i]) == 0)
+                continue;
+            changed = dhcps_inputs[i].name;
+            if (!dhcps_inputs[i].reload)
+            {
+                restart = 1;
+                break;
+            }
+        }
+    }
+
+    if (!restart && changed == NULL)
+    {
+        GWPROVEPONLOG(INFO, "%s: LAN DHCP server configuration unchanged\n", name)
+        dhcps_stats.unchanged++;
+        dhcps_stats.avoided++;
+        GWPEpon_SyseventSetInt(GWPEPON_DHCPS_AVOIDED_TUPLE, (int) dhcps_stats.avoided);
+        return 0;
+    }
+    if (!restart && kill(pid, SIGHUP) == 0)
+    {
+        GWPROVEPONLOG(INFO, "%s: %s changed, reloading %s %d\n", name, changed, GWPEPON_DHCPS_COMM, (int) pid)
+        memcpy(dhcps_applied, values, sizeof(dhcps_applied));
+        GWPEpon_DhcpsSave(pid);
+        dhcps_stats.reloads++;
+        dhcps_stats.avoided++;
+        GWPEpon_SyseventSetInt(GWPEPON_DHCPS_AVOIDED_TUPLE, (int) dhcps_stats.avoided);
+        return 0;
+    }
+
+    GWPROVEPONLOG(INFO, "%s: restarting the LAN DHCP server, %s%s\n", name,
+                  pid <= 0 ? "no live " GWPEPON_DHCPS_PIDFILE : (!dhcps_valid ? "configuration not applied yet" : changed),
+                  (pid > 0 && dhcps_valid) ? " changed" : "")
+    dhcps_stats.restarts++;
+    memcpy(dhcps_starting, values, sizeof(dhcps_starting));
+    if (GWPEpon_ActionRunAsync("dhcp_restart", GWPEPON_DHCPS_SCRIPT, GWPEpon_DhcpsRestarted, NULL) < 0)
+    {
+        dhcps_valid = 0;
+        GWPEpon_DhcpsSave(0);
+        return -1;
+    }
+    dhcps_restarting = 1;
+    return 0;
+}
+
+const GWPEpon_DhcpsStats *GWPEpon_DhcpsGetStats(void)
+{
+    return &dhcps_stats;
+}
@@ -0,0 +1,441 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*! \file gw_prov_epon_evconf.c
+    \brief config driven event -> action rules
+
+    The built-in rules and the config file are compiled into one of two
+    tables, and the active table is switched only once compilation
+    succeeded. Compilation and dispatch both run on the context's loop
+    thread, so a reload lands between two events: queued events are kept
+    (they are queued by event id) and a bad file leaves the previous
+    table in place.
+*/
+
+/**************************************************************************/
+/*      INCLUDES:                                                         */
+/**************************************************************************/
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "gw_prov_epon_action.h"
+#include "gw_prov_epon_ctx.h"
+#include "gw_prov_epon_evconf.h"
+#include "gw_prov_epon_log.h"
+
+/**************************************************************************/
+/*      LOCAL DECLARATIONS:                                               */
+/**************************************************************************/
+typedef struct
+{
+    GWPEpon_EventId id;
+    int any_value;
+    char match[GWPEPON_EVCONF_MATCH_LEN];
+    const char *action;                 /* interned, outlives reloads */
+    char cmd[GWPEPON_EVCONF_CMD_LEN];
+    int from_file;
+} GWPEpon_EvRule;
+
+typedef struct
+{
+    int nrules;
+    GWPEpon_EvRule rules[GWPEPON_EVCONF_MAX_RULES];
+    unsigned char order[GWPEPON_EVCONF_MAX_RULES];  /* rules grouped by event */
+    unsigned char start[GWPEPON_EV_COUNT];
+    unsigned char count[GWPEPON_EV_COUNT];
+    unsigned char in_file[GWPEPON_EV_COUNT];
+    GWPEpon_EventPolicy policy[GWPEPON_EV_COUNT];
+    int nretry;
+    GWPEpon_RetryPolicy retry[GWPEPON_EVCONF_MAX_RULES];
+} GWPEpon_EvConf;
+
+/* Mappings of events that only start a script */
+static const char *evconf_builtin[] =
+{
+    "lan-restart=1            lan_restart       : sh /usr/ccsp/lan_handler.sh lan_restart",
+    "lan-stop                 lan_stop          : sh /usr/ccsp/lan_handler.sh lan_stop",
+    "forwarding-restart       forwarding_restart : sh /usr/ccsp/lan_handler.sh forwarding_restart",
+    // Level triggered tuples: only their latest value matters. A flapping
+    // link or address status is held once it flapped 3 times in quick
+    // succession, at most 5 minutes after its last flap
+    "epon_ifstatus            -                 supersede=1 damp=1000/2500/750/30000/300000",
+    "ipv4-status              -                 supersede=1 damp=1000/2500/750/30000/300000",
+    "ipv6-status              -                 supersede=1 damp=1000/2500/750/30000/300000",
+    "cur_gw_prov_mode         -                 supersede=1",
+    "lan-status               -                 supersede=1",
+    "eth_enabled              -                 supersede=1",
+    "moca_enabled             -                 supersede=1",
+    "wl_enabled               -                 supersede=1",
+    // A bridge mode switch is user initiated, keep it ahead of LAN housekeeping
+    "bridge_mode              -                 priority=4 supersede=1",
+    NULL
+};
+
+/* Default priority of the events of each built-in lane */
+static const int evconf_lane_priority[GWPEPON_LANE_COUNT] = { 1, 7, 7, 4 };
+
+/**************************************************************************/
+/*      LOCAL VARIABLES:                                                  */
+/**************************************************************************/
+static GWPEPON_THREAD_LOCAL GWPEpon_EvConf evconf_tables[2];
+static GWPEPON_THREAD_LOCAL GWPEpon_EvConf *evconf_active = NULL;
+static GWPEPON_THREAD_LOCAL char evconf_names[GWPEPON_EVCONF_NAMES_LEN];
+static GWPEPON_THREAD_LOCAL int evconf_names_len = 0;
+
+/**************************************************************************/
+/*      LOCAL FUNCTIONS:                                                  */
+/**************************************************************************/
+static const char *GWPEpon_EvConfIntern(const char *name)
+{
+    int off = 0;
+    int len = strlen(name);
+
+    // Action names are referenced by the action statistics, so they are never freed
+    while (off < evconf_names_len)
+    {
+        if (strcmp(&evconf_names[off], name) == 0)
+            return &evconf_names[off];
+        off += strlen(&evconf_names[off]) + 1;
+    }
+    if (evconf_names_len + len + 1 > GWPEPON_EVCONF_NAMES_LEN)
+        return NULL;
+
+    memcpy(&evconf_names[evconf_names_len], name, len + 1);
+    evconf_names_len += len + 1;
+    return &evconf_names[off];
+}
+
+static int GWPEpon_EvConfOption(GWPEpon_EvConf *conf, GWPEpon_EventId id, const char *action, char *opt)
+{
+    GWPEpon_EventPolicy *policy = &conf->policy[id];
+    char *val = strchr(opt, '=');
+
+    if (val == NULL)
+        return -1;
+    *val++ = '\0';
+
+    if (strcmp(opt, "priority") == 0)
+    {
+        policy->priority = atoi(val);
+        if (policy->priority < 0 || policy->priority > 9)
+            return -1;
+    }
+    else if (strcmp(opt, "debounce") == 0)
+    {
+        policy->debounce_ms = (unsigned int) strtoul(val, NULL, 10);
+    }
+    else if (strcmp(opt, "dedupe") == 0)
+    {
+        policy->dedupe = (atoi(val) != 0);
+    }
+    else if (strcmp(opt, "supersede") == 0)
+    {
+        policy->supersede = (atoi(val) != 0);
+    }
+    else if (strcmp(opt, "damp") == 0)
+    {
+        GWPEpon_DampPolicy *damp = &policy->damp;
+
+        if (sscanf(val, "%u/%u/%u/%u/%u", &damp->penalty, &damp->suppress, &damp->reuse,
+                   &damp->half_life_ms, &damp->max_suppress_ms) != 5)
+            return -1;
+        if (damp->penalty > 0 &&
+            (damp->half_life_ms == 0 || damp->reuse == 0 || damp->reuse >= damp->suppress))
+            return -1;
+    }
+    else if (strcmp(opt, "retry") == 0)
+    {
+        GWPEpon_RetryPolicy *retry = &conf->retry[conf->nretry];
+
+        if (action == NULL || conf->nretry == GWPEPON_EVCONF_MAX_RULES ||
+            sscanf(val, "%u/%u/%u", &retry->max_retries, &retry->base_ms, &retry->cap_ms) != 3)
+            return -1;
+        retry->action = action;
+        conf->nretry++;
+    }
+    else
+    {
+        return -1;
+    }
+    return 0;
+}
+
+static int GWPEpon_EvConfParseLine(GWPEpon_EvConf *conf, char *line, int from_file)
+{
+    GWPEpon_EvRule *rule = NULL;
+    const char *action = NULL;
+    char *cmd, *event, *match, *tok, *saveptr = NULL;
+    int id;
+
+    line[strcspn(line, "#\r\n")] = '\0';
+    cmd = strchr(line, ':');
+    if (cmd)
+    {
+        *cmd++ = '\0';
+        cmd += strspn(cmd, " \t");
+    }
+
+    event = strtok_r(line, " \t", &saveptr);
+    if (event == NULL)
+        return cmd ? -1 : 0;
+
+    match = strchr(event, '=');
+    if (match)
+        *match++ = '\0';
+    id = GWPEpon_EventLookup(event);
+    if (id < 0)
+        return -1;
+
+    tok = strtok_r(NULL, " \t", &saveptr);
+    if (tok == NULL)
+        return -1;
+    if (strcmp(tok, "-") != 0)
+    {
+        if (cmd == NULL || *cmd == '\0' || conf->nrules == GWPEPON_EVCONF_MAX_RULES ||
+            (action = GWPEpon_EvConfIntern(tok)) == NULL)
+            return -1;
+
+        rule = &conf->rules[conf->nrules++];
+        rule->id = (GWPEpon_EventId) id;
+        rule->any_value = (match == NULL);
+        snprintf(rule->match, sizeof(rule->match), "%s", match ? match : "");
+        rule->action = action;
+        snprintf(rule->cmd, sizeof(rule->cmd), "%s", cmd);
+        rule->from_file = from_file;
+        if (from_file)
+            conf->in_file[id] = 1;
+    }
+    else if (cmd != NULL || match != NULL)
+    {
+        return -1;
+    }
+
+    while ((tok = strtok_r(NULL, " \t", &saveptr)) != NULL)
+    {
+        if (GWPEpon_EvConfOption(conf, (GWPEpon_EventId) id, action, tok) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+static int GWPEpon_EvConfApplyRetries(const GWPEpon_EvConf *conf)
+{
+    int i;
+
+    GWPEpon_ActionResetPolicies();
+    for (i = 0; i < conf->nretry; i++)
+    {
+        if (GWPEpon_ActionSetPolicy(&conf->retry[i]) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+static void GWPEpon_EvConfIndex(GWPEpon_EvConf *conf)
+{
+    int n = 0;
+    int id, i;
+
+    // An event named in the file takes its rules from the file only
+    for (id = 0; id < GWPEPON_EV_COUNT; id++)
+    {
+        conf->start[id] = (unsigned char) n;
+        for (i = 0; i < conf->nrules; i++)
+        {
+            if (conf->rules[i].id == id && conf->rules[i].from_file == conf->in_file[id])
+                conf->order[n++] = (unsigned char) i;
+        }
+        conf->count[id] = (unsigned char) (n - conf->start[id]);
+    }
+}
+
+/* val single-quoted for sh -c, a quote in it closed, escaped and reopened */
+static int GWPEpon_EvConfQuote(const char *val, char *out, int outlen)
+{
+    int len = 0;
+
+    if (outlen < 3)
+        return -1;
+    out[len++] = '\'';
+    for (; *val; val++)
+    {
+        if (*val == '\'')
+        {
+            if (len + 4 >= outlen - 1)
+                return -1;
+            memcpy(out + len, "'\\''", 4);
+            len += 4;
+        }
+        else
+        {
+            if (len + 1 >= outlen - 1)
+                return -1;
+            out[len++] = *val;
+        }
+    }
+    out[len++] = '\'';
+    out[len] = '\0';
+    return 0;
+}
+
+/* -1 when a substitution does not fit, the command is not run truncated */
+static int GWPEpon_EvConfExpand(const GWPEpon_EvRule *rule, const char *val, char *out, int outlen)
+{
+    char quoted[GWPEPON_ACTION_CMD_LEN];
+    const char *p;
+    int len = 0, n;
+
+    for (p = rule->cmd; *p && len < outlen - 1; p++)
+    {
+        const char *sub = NULL;
+
+        if (*p == '%' && p[1])
+        {
+            p++;
+            if (*p == 'n')
+                sub = gwpepon_event_table[rule->id].name;
+            else if (*p == 'v')
+            {
+                if (GWPEpon_EvConfQuote(val, quoted, sizeof(quoted)) < 0)
+                    return -1;
+                sub = quoted;
+            }
+            else if (*p == 'i')
+                sub = GWPEpon_CtxCurrent()->ifname;
+            else
+                out[len++] = *p;
+        }
+        else
+        {
+            out[len++] = *p;
+        }
+        if (sub)
+        {
+            n = snprintf(out + len, outlen - len, "%s", sub);
+            if (n >= outlen - len)
+                return -1;
+            len += n;
+        }
+    }
+    out[len] = '\0';
+    return 0;
+}
+
+/**************************************************************************/
+/*! \fn int GWPEpon_EvConfLoad(const char *path)
+ **************************************************************************
+ *  \brief Compile the built-in rules and the file at path (optional) and
+ *    make them the active rules of the calling context
+ *  \return 0 on success, -1 when the file is invalid (the previous rules
+ *    stay active)
+ **************************************************************************/
+int GWPEpon_EvConfLoad(const char *path)
+{
+    GWPEpon_EvConf *conf = (evconf_active == &evconf_tables[0]) ? &evconf_tables[1] : &evconf_tables[0];
+    char line[GWPEPON_EVCONF_CMD_LEN + 64];
+    int lineno = 0;
+    FILE *fp;
+    int id, i;
+
+    GWPROVEPONLOG(INFO, "Entering into %s\n",__FUNCTION__)
+
+    memset(conf, 0, sizeof(*conf));
+    for (id = 0; id < GWPEPON_EV_COUNT; id++)
+    {
+        conf->policy[id].priority = evconf_lane_priority[gwpepon_event_table[id].lane];
+    }
+
+    for (i = 0; evconf_builtin[i] != NULL; i++)
+    {
+        snprintf(line, sizeof(line), "%s", evconf_builtin[i]);
+        if (GWPEpon_EvConfParseLine(conf, line, 0) < 0)
+            GWPROVEPONLOG(ERROR, "invalid built-in rule: %s\n", evconf_builtin[i])
+    }
+
+    fp = fopen(path, "r");
+    if (fp == NULL && errno != ENOENT)
+        GWPROVEPONLOG(ERROR, "cannot read %s: %s\n", path, strerror(errno))
+    while (fp && fgets(line, sizeof(line), fp) != NULL)
+    {
+        lineno++;
+        if (GWPEpon_EvConfParseLine(conf, line, 1) < 0)
+        {
+            GWPROVEPONLOG(ERROR, "%s:%d: invalid rule, keeping the previous rules\n", path, lineno)
+            fclose(fp);
+            return -1;
+        }
+    }
+    if (fp)
+        fclose(fp);
+
+    if (GWPEpon_EvConfApplyRetries(conf) < 0)
+    {
+        GWPROVEPONLOG(ERROR, "%s: too many retry policies, keeping the previous rules\n", path)
+        if (evconf_active)
+            GWPEpon_EvConfApplyRetries(evconf_active);
+        return -1;
+    }
+
+    GWPEpon_EvConfIndex(conf);
+    evconf_active = conf;
+
+    GWPROVEPONLOG(INFO, "%d event rules active, %d lines read from %s\n", conf->nrules, lineno, path)
+    GWPROVEPONLOG(INFO, "Exiting from %s\n",__FUNCTION__)
+    return 0;
+}
+
+const GWPEpon_EventPolicy *GWPEpon_EvConfPolicy(GWPEpon_EventId id)
+{
+    static const GWPEpon_EventPolicy no_policy = { 0, 0, 0, 0, { 0, 0, 0, 0, 0 } };
+
+    return evconf_active ? &evconf_active->policy[id] : &no_policy;
+}
+
+/**************************************************************************/
+/*! \fn int GWPEpon_EvConfRun(GWPEpon_EventId id, const char *val)
+ **************************************************************************
+ *  \brief Run the first rule of event id matching val
+ *  \return 1 when the event has rules (matched or not), 0 when it is left
+ *    to its built-in handler
+ **************************************************************************/
+int GWPEpon_EvConfRun(GWPEpon_EventId id, const char *val)
+{
+    char cmd[GWPEPON_ACTION_CMD_LEN];
+    int i;
+
+    if (evconf_active == NULL || evconf_active->count[id] == 0)
+        return 0;
+
+    for (i = evconf_active->start[id]; i < evconf_active->start[id] + evconf_active->count[id]; i++)
+    {
+        const GWPEpon_EvRule *rule = &evconf_active->rules[evconf_active->order[i]];
+
+        if (rule->any_value || strcmp(rule->match, val) == 0)
+        {
+            if (GWPEpon_EvConfExpand(rule, val, cmd, sizeof(cmd)) < 0)
+                GWPROVEPONLOG(ERROR, "%s: value too long for the command of action %s\n",
+                              gwpepon_event_table[id].name, rule->action)
+            else
+                GWPEpon_ActionRun(rule->action, cmd);
+            break;
+        }
+    }
+    return 1;
+}
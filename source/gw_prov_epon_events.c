@@ -0,0 +1,330 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*! \file gw_prov_epon_events.c
+    \brief sysevent registration and table driven dispatch
+
+    Notifications carry the tuple name, so the name is mapped to its event
+    id once, through a hash index built at start up, when the event is
+    queued. Everything after that (dispatch, parsing, statistics) is an
+    array access by id.
+
+    The index is built by the main thread before the WAN context threads
+    start and is shared read only; registrations and statistics belong to
+    each context's thread.
+*/
+
+/**************************************************************************/
+/*      INCLUDES:                                                         */
+/**************************************************************************/
+#include <stdlib.h>
+#include <string.h>
+#include "gw_prov_epon_evconf.h"
+#include "gw_prov_epon_events.h"
+#include "gw_prov_epon_ctx.h"
+#include "gw_prov_epon_evloop.h"
+#include "gw_prov_epon_log.h"
+
+/**************************************************************************/
+/*      LOCAL DECLARATIONS:                                               */
+/**************************************************************************/
+/* Power of two, at least twice the number of events */
+#define GWPEPON_EVENT_INDEX_SIZE   128
+
+/**************************************************************************/
+/*      LOCAL VARIABLES:                                                  */
+/**************************************************************************/
+static signed char event_index[GWPEPON_EVENT_INDEX_SIZE];
+static GWPEPON_THREAD_LOCAL async_id_t event_async_ids[GWPEPON_EV_COUNT];
+static GWPEPON_THREAD_LOCAL GWPEpon_EventStats event_stats[GWPEPON_EV_COUNT];
+
+/* Last value dispatched, for dedupe, and the value held back by a debounce */
+static GWPEPON_THREAD_LOCAL char event_last_val[GWPEPON_EV_COUNT][GWPEPON_EVENT_VAL_LEN];
+static GWPEPON_THREAD_LOCAL char event_held_val[GWPEPON_EV_COUNT][GWPEPON_EVENT_VAL_LEN];
+static GWPEPON_THREAD_LOCAL unsigned long long event_held_ms[GWPEPON_EV_COUNT];
+static GWPEPON_THREAD_LOCAL unsigned int event_debounce_timer[GWPEPON_EV_COUNT];
+static GWPEPON_THREAD_LOCAL GWPEpon_ClassStats class_stats[GWPEPON_CLASS_COUNT];
+
+static const char *class_names[GWPEPON_CLASS_COUNT] = { "wan", "normal", "bulk" };
+
+/**************************************************************************/
+/*      LOCAL FUNCTIONS:                                                  */
+/**************************************************************************/
+static unsigned int GWPEpon_EventHash(const char *name)
+{
+    unsigned int h = 2166136261U;
+
+    while (*name)
+    {
+        h ^= (unsigned char) *name++;
+        h *= 16777619U;
+    }
+    return h;
+}
+
+static int GWPEpon_EventParse(int parser, const char *val)
+{
+    switch (parser)
+    {
+        case GWPEPON_PARSE_BOOL:
+            if (strcmp(val, "1") == 0)
+                return 1;
+            if (strcmp(val, "0") == 0)
+                return 0;
+            return -1;
+
+        case GWPEPON_PARSE_UPDOWN:
+            if (strcmp(val, "up") == 0)
+                return 1;
+            if (strcmp(val, "down") == 0)
+                return 0;
+            return -1;
+
+        case GWPEPON_PARSE_INT:
+            return atoi(val);
+
+        default:
+            return 0;
+    }
+}
+
+/**************************************************************************/
+/*! \fn void GWPEpon_EventRegistryInit(void)
+ **************************************************************************
+ *  \brief Build the name -> id index and reset the statistics
+ *  \return void
+ **************************************************************************/
+void GWPEpon_EventRegistryInit(void)
+{
+    unsigned int slot;
+    int id;
+
+    memset(event_index, -1, sizeof(event_index));
+    memset(event_stats, 0, sizeof(event_stats));
+
+    for (id = 0; id < GWPEPON_EV_COUNT; id++)
+    {
+        slot = GWPEpon_EventHash(gwpepon_event_table[id].name) & (GWPEPON_EVENT_INDEX_SIZE - 1);
+        while (event_index[slot] >= 0)
+            slot = (slot + 1) & (GWPEPON_EVENT_INDEX_SIZE - 1);
+        event_index[slot] = (signed char) id;
+    }
+}
+
+/**************************************************************************/
+/*! \fn int GWPEpon_EventRegister(int fd, token_t token)
+ **************************************************************************
+ *  \brief Ask sysevent to notify the events of the current WAN context on
+ *    fd: every event for the primary, the WAN lane under the interface's
+ *    tuple names for the others
+ *  \return number of events that failed to register
+ **************************************************************************/
+int GWPEpon_EventRegister(int fd, token_t token)
+{
+    char buf[GWPEPON_CTX_TUPLE_LEN];
+    int primary = GWPEpon_CtxIsPrimary();
+    int failed = 0;
+    int id;
+
+    for (id = 0; id < GWPEPON_EV_COUNT; id++)
+    {
+        const GWPEpon_EventDesc *desc = &gwpepon_event_table[id];
+        const char *name;
+
+        if (!primary && desc->lane != GWPEPON_LANE_WAN)
+            continue;
+
+        name = GWPEpon_CtxTuple(desc->name, buf, sizeof(buf));
+        if (desc->flags & GWPEPON_EVF_EVENT)
+            sysevent_set_options(fd, token, (char *) name, TUPLE_FLAG_EVENT);
+        if (sysevent_setnotification(fd, token, (char *) name, &event_async_ids[id]) != 0)
+        {
+            GWPROVEPONLOG(ERROR, "cannot register for %s\n", name)
+            failed++;
+        }
+    }
+    return failed;
+}
+
+/**************************************************************************/
+/*! \fn int GWPEpon_EventLookup(const char *name)
+ **************************************************************************
+ *  \brief Map a tuple name to its event id
+ *  \return event id, -1 if the name is not in the registry
+ **************************************************************************/
+int GWPEpon_EventLookup(const char *name)
+{
+    unsigned int slot = GWPEpon_EventHash(name) & (GWPEPON_EVENT_INDEX_SIZE - 1);
+
+    while (event_index[slot] >= 0)
+    {
+        if (strcmp(gwpepon_event_table[(int) event_index[slot]].name, name) == 0)
+            return event_index[slot];
+        slot = (slot + 1) & (GWPEPON_EVENT_INDEX_SIZE - 1);
+    }
+    return -1;
+}
+
+/**************************************************************************/
+/*! \fn void GWPEpon_EventInvoke(GWPEpon_EventId id, const char *val,
+ *        unsigned long long enqueue_ms)
+ **************************************************************************
+ *  \brief Parse the value and run the event's handler, accounting the
+ *    time spent queued and in the handler
+ *  \return void
+ **************************************************************************/
+void GWPEpon_EventInvoke(GWPEpon_EventId id, const char *val, unsigned long long enqueue_ms)
+{
+    const GWPEpon_EventDesc *desc = &gwpepon_event_table[id];
+    GWPEpon_EventStats *stats = &event_stats[id];
+    GWPEpon_EventArg ev;
+    unsigned long long start_ms = GWPEpon_NowMs();
+    unsigned long long elapsed;
+
+    stats->count++;
+    stats->last_ms = start_ms;
+    elapsed = start_ms - enqueue_ms;
+    stats->queue_ms_total += elapsed;
+    if (elapsed > stats->queue_ms_max)
+        stats->queue_ms_max = elapsed;
+
+    // Rules of the event config replace the built-in handler
+    if (GWPEpon_EvConfRun(id, val) || desc->handler == NULL)
+        return;
+
+    ev.id = id;
+    ev.name = desc->name;
+    ev.val = val;
+    ev.ival = GWPEpon_EventParse(desc->parser, val);
+    desc->handler(&ev);
+
+    elapsed = GWPEpon_NowMs() - start_ms;
+    stats->run_ms_total += elapsed;
+    if (elapsed > stats->run_ms_max)
+        stats->run_ms_max = elapsed;
+}
+
+static void GWPEpon_EventDebounced(void *arg)
+{
+    GWPEpon_EventId id = (GWPEpon_EventId) (long) arg;
+
+    event_debounce_timer[id] = 0;
+    GWPEpon_EventInvoke(id, event_held_val[id], event_held_ms[id]);
+}
+
+/**************************************************************************/
+/*! \fn void GWPEpon_EventDispatch(GWPEpon_EventId id, const char *val,
+ *        unsigned long long enqueue_ms)
+ **************************************************************************
+ *  \brief Apply the event's dedupe and debounce policy, then invoke it
+ *  \return void
+ **************************************************************************/
+void GWPEpon_EventDispatch(GWPEpon_EventId id, const char *val, unsigned long long enqueue_ms)
+{
+    const GWPEpon_EventPolicy *policy = GWPEpon_EvConfPolicy(id);
+
+    if (policy->dedupe && event_stats[id].count > 0 && strcmp(event_last_val[id], val) == 0)
+    {
+        event_stats[id].deduped++;
+        return;
+    }
+    snprintf(event_last_val[id], sizeof(event_last_val[id]), "%s", val);
+
+    if (policy->debounce_ms == 0)
+    {
+        GWPEpon_EventInvoke(id, val, enqueue_ms);
+        return;
+    }
+
+    // Trailing edge: every new value restarts the quiet period
+    if (event_debounce_timer[id])
+    {
+        GWPEpon_TimerCancel(event_debounce_timer[id]);
+        event_stats[id].debounced++;
+    }
+    else
+    {
+        event_held_ms[id] = enqueue_ms;
+    }
+    snprintf(event_held_val[id], sizeof(event_held_val[id]), "%s", val);
+    event_debounce_timer[id] = GWPEpon_TimerAdd(policy->debounce_ms, 0, GWPEpon_EventDebounced, (void *) (long) id);
+    if (event_debounce_timer[id] == 0)
+        GWPEpon_EventInvoke(id, val, enqueue_ms);
+}
+
+void GWPEpon_EventDropped(GWPEpon_EventId id)
+{
+    event_stats[id].dropped++;
+}
+
+void GWPEpon_EventSuperseded(GWPEpon_EventId id)
+{
+    GWPEpon_EventStats *stats = &event_stats[id];
+
+    // Estimated from the average run of the handler so far
+    stats->superseded++;
+    if (stats->count > 0)
+        stats->saved_ms += stats->run_ms_total / stats->count;
+}
+
+const GWPEpon_EventStats *GWPEpon_EventGetStats(GWPEpon_EventId id)
+{
+    if ((int) id < 0 || id >= GWPEPON_EV_COUNT)
+        return NULL;
+    return &event_stats[id];
+}
+
+GWPEpon_EventClass GWPEpon_EventClassOf(GWPEpon_EventId id)
+{
+    int priority = GWPEpon_EvConfPolicy(id)->priority;
+
+    if (priority <= 2)
+        return GWPEPON_CLASS_WAN;
+    if (priority <= 6)
+        return GWPEPON_CLASS_NORMAL;
+    return GWPEPON_CLASS_BULK;
+}
+
+const char *GWPEpon_EventClassName(GWPEpon_EventClass cls)
+{
+    return class_names[cls];
+}
+
+/**************************************************************************/
+/*! \fn void GWPEpon_EventClassWait(GWPEpon_EventClass cls,
+ *        unsigned long long wait_ms, int aged)
+ **************************************************************************
+ *  \brief Account the time an event of class cls waited in the queue
+ *  \return void
+ **************************************************************************/
+void GWPEpon_EventClassWait(GWPEpon_EventClass cls, unsigned long long wait_ms, int aged)
+{
+    GWPEpon_ClassStats *stats = &class_stats[cls];
+
+    stats->count++;
+    stats->aged += (aged != 0);
+    stats->wait_ms_total += wait_ms;
+    if (wait_ms > stats->wait_ms_max)
+        stats->wait_ms_max = wait_ms;
+}
+
+const GWPEpon_ClassStats *GWPEpon_EventGetClassStats(GWPEpon_EventClass cls)
+{
+    return &class_stats[cls];
+}
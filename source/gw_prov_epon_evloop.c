@@ -0,0 +1,785 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*! \file gw_prov_epon_evloop.c
+    \brief epoll based event loop (fds, timer wheel, signals, children)
+*/
+
+/**************************************************************************/
+/*      INCLUDES:                                                         */
+/**************************************************************************/
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/syscall.h>
+#include <sys/timerfd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include "gw_prov_epon_ctx.h"
+#include "gw_prov_epon_evloop.h"
+#include "gw_prov_epon_log.h"
+
+/**************************************************************************/
+/*      LOCAL DECLARATIONS:                                               */
+/**************************************************************************/
+#define GWPEPON_EVLOOP_MAX_SIGNALS  8
+#define GWPEPON_EVLOOP_MAX_EVENTS   16
+#define GWPEPON_CHILD_REAP_MS       200
+
+#define TIMER_STATE_FREE   0
+#define TIMER_STATE_WHEEL  1
+#define TIMER_STATE_DUE    2
+
+typedef struct
+{
+    int in_use;
+    int fd;
+    unsigned int gen;
+    GWPEpon_FdCb cb;
+    void *arg;
+} GWPEpon_FdWatch;
+
+typedef struct
+{
+    int state;
+    unsigned int gen;
+    unsigned long long expiry_ms;
+    unsigned int period_ms;
+    GWPEpon_TimerCb cb;
+    void *arg;
+    int prev;
+    int next;
+} GWPEpon_Timer;
+
+typedef struct
+{
+    int in_use;
+    pid_t pid;
+    int pidfd;
+    GWPEpon_ChildCb cb;
+    void *arg;
+} GWPEpon_Child;
+
+typedef struct
+{
+    int signo;
+    GWPEpon_SignalCb cb;
+    void *arg;
+} GWPEpon_SignalWatch;
+
+/**************************************************************************/
+/*      LOCAL VARIABLES:                                                  */
+/**************************************************************************/
+extern char **environ;
+
+static sigset_t evloop_sigset;
+static int evloop_sigset_blocked = 0;
+
+/* One loop per provisioning context, each on its own thread */
+static GWPEPON_THREAD_LOCAL int epoll_fd = -1;
+static GWPEPON_THREAD_LOCAL int timer_fd = -1;
+static GWPEPON_THREAD_LOCAL int signal_fd = -1;
+static GWPEPON_THREAD_LOCAL sigset_t signal_mask;
+static GWPEPON_THREAD_LOCAL volatile int evloop_running = 0;
+
+static GWPEPON_THREAD_LOCAL GWPEpon_FdWatch fd_watches[GWPEPON_EVLOOP_MAX_FDS];
+static GWPEPON_THREAD_LOCAL GWPEpon_SignalWatch signal_watches[GWPEPON_EVLOOP_MAX_SIGNALS];
+static GWPEPON_THREAD_LOCAL GWPEpon_Child children[GWPEPON_EVLOOP_MAX_CHILDREN];
+static GWPEPON_THREAD_LOCAL unsigned int child_reap_timer = 0;
+
+static GWPEPON_THREAD_LOCAL GWPEpon_Timer timers[GWPEPON_EVLOOP_MAX_TIMERS];
+static GWPEPON_THREAD_LOCAL int timer_wheel[GWPEPON_TIMER_WHEEL_SLOTS];
+static GWPEPON_THREAD_LOCAL unsigned long long timer_last_tick = 0;
+static GWPEPON_THREAD_LOCAL int timers_dirty = 0;
+
+/**************************************************************************/
+/*      LOCAL FUNCTIONS:                                                  */
+/**************************************************************************/
+unsigned long long GWPEpon_NowMs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((unsigned long long) ts.tv_sec * 1000ULL) + (ts.tv_nsec / 1000000);
+}
+
+/* For latencies well under a millisecond, such as a netlink batch */
+unsigned long long GWPEpon_NowUs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((unsigned long long) ts.tv_sec * 1000000ULL) + (ts.tv_nsec / 1000);
+}
+
+/**************************************************************************/
+/*! \fn unsigned long long GWPEpon_ProcessAgeMs(void)
+ **************************************************************************
+ *  \brief Time since the process was started, at clock tick resolution
+ *  \return age in ms, 0 if /proc is unavailable
+ **************************************************************************/
+unsigned long long GWPEpon_ProcessAgeMs(void)
+{
+    unsigned long long start_ticks = 0;
+    struct timespec ts;
+    char buf[512];
+    char *p;
+    FILE *fp;
+    size_t n;
+    int field;
+
+    fp = fopen("/proc/self/stat", "r");
+    if (fp == NULL)
+        return 0;
+    n = fread(buf, 1, sizeof(buf) - 1, fp);
+    fclose(fp);
+    buf[n] = '\0';
+
+    // The command name may contain spaces, fields are counted from its closing ')'
+    p = strrchr(buf, ')');
+    for (field = 2; p != NULL && field < 22; field++)
+        p = strchr(p + 1, ' ');
+    if (p == NULL || sscanf(p + 1, "%llu", &start_ticks) != 1)
+        return 0;
+
+    clock_gettime(CLOCK_BOOTTIME, &ts);
+    return ((unsigned long long) ts.tv_sec * 1000ULL) + (ts.tv_nsec / 1000000) -
+           (start_ticks * 1000ULL / (unsigned long long) sysconf(_SC_CLK_TCK));
+}
+
+/**************************************************************************/
+/*! \fn static pid_t GWPEpon_ChildStart(const char *cmd)
+ **************************************************************************
+ *  \brief Start "sh -c cmd" with posix_spawn. Unlike fork() it does not
+ *    duplicate the page tables of this multi-threaded daemon, and the
+ *    child starts with a clean signal mask.
+ *  \return pid of the child, -1 on failure
+ **************************************************************************/
+static pid_t GWPEpon_ChildStart(const char *cmd)
+{
+    char *argv[] = { "sh", "-c", (char *) cmd, NULL };
+    posix_spawnattr_t attr;
+    sigset_t empty;
+    pid_t pid;
+    int err;
+
+    // Signals blocked for signalfd must not leak into the scripts we start
+    sigemptyset(&empty);
+    posix_spawnattr_init(&attr);
+    posix_spawnattr_setsigmask(&attr, &empty);
+    // Own process group, so a cancelled child is stopped with everything it started
+    posix_spawnattr_setpgroup(&attr, 0);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETPGROUP);
+
+    err = posix_spawn(&pid, "/bin/sh", NULL, &attr, argv, environ);
+    posix_spawnattr_destroy(&attr);
+    if (err != 0)
+    {
+        GWPROVEPONLOG(ERROR, "spawn failed for %s: %s\n", cmd, strerror(err))
+        return -1;
+    }
+    return pid;
+}
+
+/**************************************************************************/
+/*! \fn int GWPEpon_EvLoopBlockSignals(void)
+ **************************************************************************
+ *  \brief Block the signals serviced through signalfd
+ *  \return 0
+ **************************************************************************/
+int GWPEpon_EvLoopBlockSignals(void)
+{
+    sigemptyset(&evloop_sigset);
+    sigaddset(&evloop_sigset, SIGCHLD);
+    sigaddset(&evloop_sigset, SIGHUP);
+    sigaddset(&evloop_sigset, SIGTERM);
+    sigaddset(&evloop_sigset, SIGINT);
+
+    if (pthread_sigmask(SIG_BLOCK, &evloop_sigset, NULL) != 0)
+    {
+        GWPROVEPONLOG(ERROR, "pthread_sigmask failed\n")
+        return -1;
+    }
+    evloop_sigset_blocked = 1;
+    return 0;
+}
+
+/**************************************************************************/
+/*      FD WATCHES:                                                       */
+/**************************************************************************/
+int GWPEpon_EvLoopAddFd(int fd, unsigned int events, GWPEpon_FdCb cb, void *arg)
+{
+    struct epoll_event ev;
+    int i;
+
+    for (i = 0; i < GWPEPON_EVLOOP_MAX_FDS; i++)
+    {
+        if (!fd_watches[i].in_use)
+            break;
+    }
+    if (i == GWPEPON_EVLOOP_MAX_FDS)
+    {
+        GWPROVEPONLOG(ERROR, "no free fd watch for fd %d\n", fd)
+        return -1;
+    }
+
+    fd_watches[i].gen++;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = events;
+    ev.data.u64 = ((unsigned long long) fd_watches[i].gen << 32) | (unsigned int) i;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0)
+    {
+        GWPROVEPONLOG(ERROR, "epoll_ctl add fd %d failed: %s\n", fd, strerror(errno))
+        return -1;
+    }
+
+    fd_watches[i].in_use = 1;
+    fd_watches[i].fd = fd;
+    fd_watches[i].cb = cb;
+    fd_watches[i].arg = arg;
+    return 0;
+}
+
+int GWPEpon_EvLoopDelFd(int fd)
+{
+    int i;
+
+    for (i = 0; i < GWPEPON_EVLOOP_MAX_FDS; i++)
+    {
+        if (fd_watches[i].in_use && fd_watches[i].fd == fd)
+        {
+            epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+            fd_watches[i].in_use = 0;
+            fd_watches[i].gen++;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/**************************************************************************/
+/*      TIMER WHEEL:                                                      */
+/**************************************************************************/
+static void GWPEpon_TimerLink(int idx)
+{
+    int slot = (int) ((timers[idx].expiry_ms / GWPEPON_TIMER_TICK_MS) % GWPEPON_TIMER_WHEEL_SLOTS);
+
+    timers[idx].state = TIMER_STATE_WHEEL;
+    timers[idx].prev = -1;
+    timers[idx].next = timer_wheel[slot];
+    if (timer_wheel[slot] >= 0)
+        timers[timer_wheel[slot]].prev = idx;
+    timer_wheel[slot] = idx;
+    timers_dirty = 1;
+}
+
+static void GWPEpon_TimerUnlink(int idx)
+{
+    int slot = (int) ((timers[idx].expiry_ms / GWPEPON_TIMER_TICK_MS) % GWPEPON_TIMER_WHEEL_SLOTS);
+
+    if (timers[idx].prev >= 0)
+        timers[timers[idx].prev].next = timers[idx].next;
+    else
+        timer_wheel[slot] = timers[idx].next;
+    if (timers[idx].next >= 0)
+        timers[timers[idx].next].prev = timers[idx].prev;
+    timers[idx].prev = timers[idx].next = -1;
+    timers_dirty = 1;
+}
+
+/**************************************************************************/
+/*! \fn unsigned int GWPEpon_TimerAdd
+ **************************************************************************
+ *  \brief Schedule cb after delay_ms, then every period_ms (0 = one shot)
+ *  \return timer id, 0 on failure
+ **************************************************************************/
+unsigned int GWPEpon_TimerAdd(unsigned int delay_ms, unsigned int period_ms, GWPEpon_TimerCb cb, void *arg)
+{
+    int i;
+
+    for (i = 0; i < GWPEPON_EVLOOP_MAX_TIMERS; i++)
+    {
+        if (timers[i].state == TIMER_STATE_FREE)
+            break;
+    }
+    if (i == GWPEPON_EVLOOP_MAX_TIMERS)
+    {
+        GWPROVEPONLOG(ERROR, "no free timer\n")
+        return 0;
+    }
+
+    timers[i].gen = (timers[i].gen + 1) & 0xFFFFFF;
+    timers[i].expiry_ms = GWPEpon_NowMs() + delay_ms;
+    timers[i].period_ms = period_ms;
+    timers[i].cb = cb;
+    timers[i].arg = arg;
+    GWPEpon_TimerLink(i);
+
+    return (timers[i].gen << 8) | (unsigned int) (i + 1);
+}
+
+void GWPEpon_TimerCancel(unsigned int id)
+{
+    int idx = (int) (id & 0xFF) - 1;
+
+    if (id == 0 || idx < 0 || idx >= GWPEPON_EVLOOP_MAX_TIMERS)
+        return;
+    if (timers[idx].state == TIMER_STATE_FREE || timers[idx].gen != (id >> 8))
+        return;
+
+    if (timers[idx].state == TIMER_STATE_WHEEL)
+        GWPEpon_TimerUnlink(idx);
+    timers[idx].state = TIMER_STATE_FREE;
+}
+
+static void GWPEpon_TimerRearm(void)
+{
+    struct itimerspec its;
+    unsigned long long next = 0;
+    int i;
+
+    timers_dirty = 0;
+    for (i = 0; i < GWPEPON_EVLOOP_MAX_TIMERS; i++)
+    {
+        if (timers[i].state == TIMER_STATE_WHEEL && (next == 0 || timers[i].expiry_ms < next))
+            next = timers[i].expiry_ms;
+    }
+
+    memset(&its, 0, sizeof(its));
+    if (next != 0)
+    {
+        its.it_value.tv_sec = next / 1000;
+        its.it_value.tv_nsec = (long) ((next % 1000) * 1000000);
+    }
+    if (timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &its, NULL) < 0)
+        GWPROVEPONLOG(ERROR, "timerfd_settime failed: %s\n", strerror(errno))
+}
+
+static void GWPEpon_TimerProcess(int fd, unsigned int events, void *arg)
+{
+    struct { int idx; unsigned int gen; } due[GWPEPON_EVLOOP_MAX_TIMERS];
+    unsigned long long now, now_tick, ticks, t;
+    unsigned long long expirations;
+    int ndue = 0;
+    int i, idx, next;
+
+    (void) events;
+    (void) arg;
+    if (read(fd, &expirations, sizeof(expirations)) < 0 && errno != EAGAIN)
+        GWPROVEPONLOG(ERROR, "timerfd read failed: %s\n", strerror(errno))
+
+    now = GWPEpon_NowMs();
+    now_tick = now / GWPEPON_TIMER_TICK_MS;
+    ticks = now_tick - timer_last_tick + 1;
+    if (ticks > GWPEPON_TIMER_WHEEL_SLOTS)
+        ticks = GWPEPON_TIMER_WHEEL_SLOTS;
+
+    // Walk every slot passed since the last run, collecting expired timers
+    for (t = 0; t < ticks; t++)
+    {
+        idx = timer_wheel[(timer_last_tick + t) % GWPEPON_TIMER_WHEEL_SLOTS];
+        while (idx >= 0)
+        {
+            next = timers[idx].next;
+            if (timers[idx].expiry_ms <= now)
+            {
+                GWPEpon_TimerUnlink(idx);
+                timers[idx].state = TIMER_STATE_DUE;
+                due[ndue].idx = idx;
+                due[ndue].gen = timers[idx].gen;
+                ndue++;
+            }
+            idx = next;
+        }
+    }
+    timer_last_tick = now_tick;
+
+    for (i = 0; i < ndue; i++)
+    {
+        GWPEpon_TimerCb cb;
+        void *cb_arg;
+
+        idx = due[i].idx;
+        // Cancelled (and possibly reused) by an earlier callback of this batch
+        if (timers[idx].state != TIMER_STATE_DUE || timers[idx].gen != due[i].gen)
+            continue;
+
+        cb = timers[idx].cb;
+        cb_arg = timers[idx].arg;
+        if (timers[idx].period_ms)
+        {
+            timers[idx].expiry_ms = now + timers[idx].period_ms;
+            GWPEpon_TimerLink(idx);
+        }
+        else
+        {
+            timers[idx].state = TIMER_STATE_FREE;
+        }
+        cb(cb_arg);
+    }
+    timers_dirty = 1;
+}
+
+/**************************************************************************/
+/*      CHILDREN:                                                         */
+/**************************************************************************/
+static int GWPEpon_PidfdOpen(pid_t pid)
+{
+#ifdef SYS_pidfd_open
+    return (int) syscall(SYS_pidfd_open, pid, 0);
+#else
+    (void) pid;
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+static void GWPEpon_ChildComplete(GWPEpon_Child *child, int wstatus)
+{
+    GWPEpon_ChildCb cb = child->cb;
+    void *arg = child->arg;
+    pid_t pid = child->pid;
+
+    if (child->pidfd >= 0)
+    {
+        GWPEpon_EvLoopDelFd(child->pidfd);
+        close(child->pidfd);
+    }
+    child->in_use = 0;
+    child->pidfd = -1;
+
+    if (cb)
+        cb(pid, wstatus, arg);
+}
+
+static void GWPEpon_ChildReap(GWPEpon_Child *child)
+{
+    int wstatus = 0;
+    pid_t ret;
+
+    do
+    {
+        ret = waitpid(child->pid, &wstatus, WNOHANG);
+    } while (ret < 0 && errno == EINTR);
+
+    if (ret == child->pid)
+    {
+        GWPEpon_ChildComplete(child, wstatus);
+    }
+    else if (ret < 0)
+    {
+        GWPROVEPONLOG(ERROR, "waitpid %d failed: %s\n", child->pid, strerror(errno))
+        GWPEpon_ChildComplete(child, -1);
+    }
+}
+
+static void GWPEpon_ChildPidfdCb(int fd, unsigned int events, void *arg)
+{
+    (void) fd;
+    (void) events;
+    GWPEpon_ChildReap((GWPEpon_Child *) arg);
+}
+
+static int GWPEpon_ChildReapAll(void)
+{
+    int waiting = 0;
+    int i;
+
+    // Only our own children are waited for, so blocking system() callers keep theirs
+    for (i = 0; i < GWPEPON_EVLOOP_MAX_CHILDREN; i++)
+    {
+        if (children[i].in_use && children[i].pidfd < 0)
+        {
+            GWPEpon_ChildReap(&children[i]);
+            if (children[i].in_use)
+                waiting++;
+        }
+    }
+    return waiting;
+}
+
+static void GWPEpon_ChildReapTimer(void *arg)
+{
+    (void) arg;
+    if (GWPEpon_ChildReapAll() == 0)
+    {
+        GWPEpon_TimerCancel(child_reap_timer);
+        child_reap_timer = 0;
+    }
+}
+
+/**************************************************************************/
+/*! \fn pid_t GWPEpon_ChildSpawn
+ **************************************************************************
+ *  \brief Start "sh -c cmd" and call cb from the loop once it exits,
+ *    never before this returns, even when the child is already gone
+ *  \return child pid, -1 on failure
+ **************************************************************************/
+pid_t GWPEpon_ChildSpawn(const char *cmd, GWPEpon_ChildCb cb, void *arg)
+{
+    GWPEpon_Child *child = NULL;
+    pid_t pid;
+    int i;
+
+    for (i = 0; i < GWPEPON_EVLOOP_MAX_CHILDREN; i++)
+    {
+        if (!children[i].in_use)
+        {
+            child = &children[i];
+            break;
+        }
+    }
+    if (child == NULL)
+    {
+        GWPROVEPONLOG(ERROR, "no free child slot for %s\n", cmd)
+        return -1;
+    }
+
+    pid = GWPEpon_ChildStart(cmd);
+    if (pid < 0)
+        return -1;
+
+    child->in_use = 1;
+    child->pid = pid;
+    child->cb = cb;
+    child->arg = arg;
+    child->pidfd = GWPEpon_PidfdOpen(pid);
+    if (child->pidfd >= 0 && GWPEpon_EvLoopAddFd(child->pidfd, EPOLLIN, GWPEpon_ChildPidfdCb, child) < 0)
+    {
+        close(child->pidfd);
+        child->pidfd = -1;
+    }
+    // Without a pidfd the child is reaped on SIGCHLD. SIGCHLD is taken by
+    // whichever loop reads it first, poll for ours meanwhile. Never reaped
+    // here: the caller only learns the pid when this returns, cb must not
+    // run before that.
+    if (child->pidfd < 0 && child_reap_timer == 0)
+        child_reap_timer = GWPEpon_TimerAdd(GWPEPON_CHILD_REAP_MS, GWPEPON_CHILD_REAP_MS,
+                                            GWPEpon_ChildReapTimer, NULL);
+
+    return pid;
+}
+
+/**************************************************************************/
+/*! \fn int GWPEpon_ChildKill(pid_t pid, int signo)
+ **************************************************************************
+ *  \brief Signal the process group of a child started by this loop. Its
+ *    callback still runs when it exits.
+ *  \return 0 on success, -1 if pid is not a running child of this loop
+ **************************************************************************/
+int GWPEpon_ChildKill(pid_t pid, int signo)
+{
+    int i;
+
+    for (i = 0; i < GWPEPON_EVLOOP_MAX_CHILDREN; i++)
+    {
+        if (children[i].in_use && children[i].pid == pid)
+            return kill(-pid, signo);
+    }
+    return -1;
+}
+
+/**************************************************************************/
+/*! \fn int GWPEpon_System(const char *cmd)
+ **************************************************************************
+ *  \brief Blocking replacement for system() with a clean signal mask
+ *  \return wait status as returned by system(), -1 on failure
+ **************************************************************************/
+int GWPEpon_System(const char *cmd)
+{
+    int wstatus = 0;
+    pid_t pid, ret;
+
+    pid = GWPEpon_ChildStart(cmd);
+    if (pid < 0)
+        return -1;
+
+    do
+    {
+        ret = waitpid(pid, &wstatus, 0);
+    } while (ret < 0 && errno == EINTR);
+
+    return (ret == pid) ? wstatus : -1;
+}
+
+/**************************************************************************/
+/*      SIGNALS:                                                          */
+/**************************************************************************/
+int GWPEpon_EvLoopAddSignal(int signo, GWPEpon_SignalCb cb, void *arg)
+{
+    int i;
+
+    if (!sigismember(&evloop_sigset, signo))
+    {
+        GWPROVEPONLOG(ERROR, "signal %d is not serviced by the event loop\n", signo)
+        return -1;
+    }
+
+    for (i = 0; i < GWPEPON_EVLOOP_MAX_SIGNALS; i++)
+    {
+        if (signal_watches[i].cb == NULL)
+        {
+            // Only the loop watching a signal reads it, the other loops leave it pending
+            sigaddset(&signal_mask, signo);
+            if (signalfd(signal_fd, &signal_mask, 0) < 0)
+            {
+                GWPROVEPONLOG(ERROR, "signalfd update for %d failed: %s\n", signo, strerror(errno))
+                sigdelset(&signal_mask, signo);
+                return -1;
+            }
+            signal_watches[i].signo = signo;
+            signal_watches[i].cb = cb;
+            signal_watches[i].arg = arg;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static void GWPEpon_SignalProcess(int fd, unsigned int events, void *arg)
+{
+    struct signalfd_siginfo si;
+    int i;
+
+    (void) events;
+    (void) arg;
+    while (read(fd, &si, sizeof(si)) == sizeof(si))
+    {
+        if (si.ssi_signo == SIGCHLD)
+            GWPEpon_ChildReapAll();
+
+        for (i = 0; i < GWPEPON_EVLOOP_MAX_SIGNALS; i++)
+        {
+            if (signal_watches[i].cb && signal_watches[i].signo == (int) si.ssi_signo)
+                signal_watches[i].cb((int) si.ssi_signo, signal_watches[i].arg);
+        }
+    }
+}
+
+/**************************************************************************/
+/*      LOOP:                                                             */
+/**************************************************************************/
+/**************************************************************************/
+/*! \fn int GWPEpon_EvLoopInit(void)
+ **************************************************************************
+ *  \brief Create the epoll, timerfd and signalfd descriptors
+ *  \return 0 on success, -1 on failure
+ **************************************************************************/
+int GWPEpon_EvLoopInit(void)
+{
+    int i;
+
+    GWPROVEPONLOG(INFO, "Entering into %s\n",__FUNCTION__)
+
+    if (!evloop_sigset_blocked && GWPEpon_EvLoopBlockSignals() < 0)
+        return -1;
+
+    for (i = 0; i < GWPEPON_TIMER_WHEEL_SLOTS; i++)
+        timer_wheel[i] = -1;
+    for (i = 0; i < GWPEPON_EVLOOP_MAX_CHILDREN; i++)
+        children[i].pidfd = -1;
+    timer_last_tick = GWPEpon_NowMs() / GWPEPON_TIMER_TICK_MS;
+
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    sigemptyset(&signal_mask);
+    sigaddset(&signal_mask, SIGCHLD);
+    signal_fd = signalfd(-1, &signal_mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (epoll_fd < 0 || timer_fd < 0 || signal_fd < 0)
+    {
+        GWPROVEPONLOG(ERROR, "event loop fd creation failed: %s\n", strerror(errno))
+        GWPEpon_EvLoopClose();
+        return -1;
+    }
+
+    if (GWPEpon_EvLoopAddFd(timer_fd, EPOLLIN, GWPEpon_TimerProcess, NULL) < 0 ||
+        GWPEpon_EvLoopAddFd(signal_fd, EPOLLIN, GWPEpon_SignalProcess, NULL) < 0)
+    {
+        GWPEpon_EvLoopClose();
+        return -1;
+    }
+
+    GWPROVEPONLOG(INFO, "Exiting from %s\n",__FUNCTION__)
+    return 0;
+}
+
+/**************************************************************************/
+/*! \fn int GWPEpon_EvLoopRun(void)
+ **************************************************************************
+ *  \brief Dispatch fd, timer, signal and child events until stopped
+ *  \return 0 when stopped, -1 on epoll failure
+ **************************************************************************/
+int GWPEpon_EvLoopRun(void)
+{
+    struct epoll_event evs[GWPEPON_EVLOOP_MAX_EVENTS];
+    int n, i;
+
+    evloop_running = 1;
+    timers_dirty = 1;
+    while (evloop_running)
+    {
+        if (timers_dirty)
+            GWPEpon_TimerRearm();
+
+        n = epoll_wait(epoll_fd, evs, GWPEPON_EVLOOP_MAX_EVENTS, -1);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            GWPROVEPONLOG(ERROR, "epoll_wait failed: %s\n", strerror(errno))
+            return -1;
+        }
+
+        for (i = 0; i < n; i++)
+        {
+            unsigned int idx = (unsigned int) (evs[i].data.u64 & 0xFFFFFFFF);
+            unsigned int gen = (unsigned int) (evs[i].data.u64 >> 32);
+
+            // The watch may have been removed by an earlier callback of this batch
+            if (idx >= GWPEPON_EVLOOP_MAX_FDS || !fd_watches[idx].in_use || fd_watches[idx].gen != gen)
+                continue;
+            fd_watches[idx].cb(fd_watches[idx].fd, evs[i].events, fd_watches[idx].arg);
+        }
+    }
+    return 0;
+}
+
+void GWPEpon_EvLoopStop(void)
+{
+    evloop_running = 0;
+}
+
+void GWPEpon_EvLoopClose(void)
+{
+    if (signal_fd >= 0)
+        close(signal_fd);
+    if (timer_fd >= 0)
+        close(timer_fd);
+    if (epoll_fd >= 0)
+        close(epoll_fd);
+    signal_fd = timer_fd = epoll_fd = -1;
+}
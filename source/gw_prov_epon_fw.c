@@ -0,0 +1,522 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*! \file gw_prov_epon_fw.c
+    \brief firewall rulesets diffed by chain and restored as a delta
+
+    With --noflush, iptables-restore leaves every chain it is not told
+    about in place. Declaring an existing user-defined chain flushes it,
+    a built-in chain is flushed with -F, so a changed chain is always
+    written whole and the rules of a chain are never edited one by one.
+*/
+
+/**************************************************************************/
+/*      INCLUDES:                                                         */
+/**************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "gw_prov_epon_action.h"
+#include "gw_prov_epon_ctx.h"
+#include "gw_prov_epon_evloop.h"
+#include "gw_prov_epon_fw.h"
+#include "gw_prov_epon_log.h"
+
+/**************************************************************************/
+/*      LOCAL DECLARATIONS:                                               */
+/**************************************************************************/
+typedef struct
+{
+    const char *name;
+    const char *policy;         /* "-" for a user-defined chain */
+    int table;
+    int first;                  /* rules of the chain, in order */
+    int count;
+} GWPEpon_FwChain;
+
+typedef struct
+{
+    const char *line;
+    int chain;
+    int seq;
+} GWPEpon_FwRule;
+
+typedef struct
+{
+    char *text;                 /* the rules file, every name points into it */
+    int ntables;
+    const char *tables[GWPEPON_FW_MAX_TABLES];
+    int nchains;
+    GWPEpon_FwChain chains[GWPEPON_FW_MAX_CHAINS];
+    int nrules;
+    int rules_cap;
+    GWPEpon_FwRule *rules;
+} GWPEpon_FwRuleset;
+
+typedef struct
+{
+    const char *name;
+    const char *rules;
+    const char *delta;
+    const char *live;
+    const char *action;
+    const char *restore;
+    const char *save_action;
+    const char *save;
+} GWPEpon_FwFamily;
+
+/**************************************************************************/
+/*      LOCAL VARIABLES:                                                  */
+/**************************************************************************/
+static const GWPEpon_FwFamily fw_families[] =
+{
+    { "ipv4", GWPEPON_FW_RULES_V4, GWPEPON_FW_DELTA_V4, GWPEPON_FW_LIVE_V4,
+      "iptables_restore",  "iptables-restore",  "iptables_save",  "iptables-save"  },
+    { "ipv6", GWPEPON_FW_RULES_V6, GWPEPON_FW_DELTA_V6, GWPEPON_FW_LIVE_V6,
+      "ip6tables_restore", "ip6tables-restore", "ip6tables_save", "ip6tables-save" },
+};
+
+#define FW_FAMILIES      (int) (sizeof(fw_families) / sizeof(fw_families[0]))
+
+static GWPEPON_THREAD_LOCAL GWPEpon_FwStats fw_stats[FW_FAMILIES];
+static GWPEPON_THREAD_LOCAL GWPEpon_FwRuleset *fw_applied[FW_FAMILIES];   /* generated, last applied */
+static GWPEPON_THREAD_LOCAL GWPEpon_FwRuleset *fw_saved[FW_FAMILIES];     /* kernel right after it */
+
+/**************************************************************************/
+/*      LOCAL FUNCTIONS:                                                  */
+/**************************************************************************/
+static void GWPEpon_FwFree(GWPEpon_FwRuleset *rs)
+{
+    if (rs == NULL)
+        return;
+    free(rs->rules);
+    free(rs->text);
+    free(rs);
+}
+
+static int GWPEpon_FwRuleCmp(const void *a, const void *b)
+{
+    const GWPEpon_FwRule *ra = (const GWPEpon_FwRule *) a;
+    const GWPEpon_FwRule *rb = (const GWPEpon_FwRule *) b;
+
+    if (ra->chain != rb->chain)
+        return ra->chain - rb->chain;
+    return ra->seq - rb->seq;
+}
+
+static int GWPEpon_FwFindChain(const GWPEpon_FwRuleset *rs, const char *table, const char *name, size_t len)
+{
+    int i;
+
+    for (i = 0; i < rs->nchains; i++)
+    {
+        if (strncmp(rs->chains[i].name, name, len) == 0 && rs->chains[i].name[len] == '\0' &&
+            strcmp(rs->tables[rs->chains[i].table], table) == 0)
+            return i;
+    }
+    return -1;
+}
+
+static int GWPEpon_FwAddRule(GWPEpon_FwRuleset *rs, const char *line, int chain)
+{
+    GWPEpon_FwRule *rules;
+
+    if (rs->nrules == rs->rules_cap)
+    {
+        rules = (GWPEpon_FwRule *) realloc(rs->rules, (rs->rules_cap ? rs->rules_cap * 2 : 256) * sizeof(*rules));
+        if (rules == NULL)
+            return -1;
+        rs->rules = rules;
+        rs->rules_cap = rs->rules_cap ? rs->rules_cap * 2 : 256;
+    }
+    rs->rules[rs->nrules].line = line;
+    rs->rules[rs->nrules].chain = chain;
+    rs->rules[rs->nrules].seq = rs->nrules;
+    rs->nrules++;
+    return 0;
+}
+
+/* Index the tables, chains and rules of the text, -1 on anything a diff cannot represent */
+static int GWPEpon_FwParse(GWPEpon_FwRuleset *rs)
+{
+    char *line, *save, *end, *name;
+    size_t len;
+    int table = -1;
+    int chain, i;
+
+    for (line = strtok_r(rs->text, "\n", &save); line != NULL; line = strtok_r(NULL, "\n", &save))
+    {
+        for (end = line + strlen(line); end > line && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r'); end--)
+            end[-1] = '\0';
+        // Packet counters of iptables-save -c are not part of a rule
+        if (line[0] == '[' && (end = strchr(line, ']')) != NULL)
+            line = end + 1 + strspn(end + 1, " ");
+        if (line[0] == '\0' || line[0] == '#')
+            continue;
+
+        if (line[0] == '*')
+        {
+            if (table >= 0 || rs->ntables == GWPEPON_FW_MAX_TABLES)
+                return -1;
+            rs->tables[rs->ntables] = line + 1;
+            table = rs->ntables++;
+        }
+        else if (strcmp(line, "COMMIT") == 0)
+        {
+            if (table < 0)
+                return -1;
+            table = -1;
+        }
+        else if (line[0] == ':')
+        {
+            name = line + 1;
+            if (table < 0 || rs->nchains == GWPEPON_FW_MAX_CHAINS || (end = strchr(name, ' ')) == NULL)
+                return -1;
+            *end++ = '\0';
+            if (GWPEpon_FwFindChain(rs, rs->tables[table], name, strlen(name)) >= 0)
+                return -1;
+            rs->chains[rs->nchains].name = name;
+            rs->chains[rs->nchains].policy = end;
+            rs->chains[rs->nchains].table = table;
+            if ((end = strchr(end, ' ')) != NULL)
+                *end = '\0';
+            rs->nchains++;
+        }
+        else if (strncmp(line, "-A ", 3) == 0)
+        {
+            name = line + 3;
+            len = strcspn(name, " ");
+            if (table < 0 || (chain = GWPEpon_FwFindChain(rs, rs->tables[table], name, len)) < 0 ||
+                GWPEpon_FwAddRule(rs, line, chain) < 0)
+                return -1;
+        }
+        else
+        {
+            // -I, -D, -N, -P... depend on what is already in the kernel
+            return -1;
+        }
+    }
+    if (table >= 0)
+        return -1;
+
+    // Rules keep their order inside their chain, chains become contiguous
+    if (rs->nrules > 0)
+        qsort(rs->rules, rs->nrules, sizeof(rs->rules[0]), GWPEpon_FwRuleCmp);
+    for (i = rs->nrules - 1; i >= 0; i--)
+    {
+        rs->chains[rs->rules[i].chain].first = i;
+        rs->chains[rs->rules[i].chain].count++;
+    }
+    return 0;
+}
+
+/* NULL when the file cannot be read, *parsed set when it can be diffed */
+static GWPEpon_FwRuleset *GWPEpon_FwLoad(const char *path, int *parsed)
+{
+    GWPEpon_FwRuleset *rs;
+    FILE *fp;
+    long size;
+
+    *parsed = 0;
+    if ((fp = fopen(path, "r")) == NULL)
+        return NULL;
+    if ((rs = (GWPEpon_FwRuleset *) calloc(1, sizeof(*rs))) == NULL ||
+        fseek(fp, 0, SEEK_END) != 0 || (size = ftell(fp)) < 0 || fseek(fp, 0, SEEK_SET) != 0 ||
+        (rs->text = (char *) malloc(size + 1)) == NULL)
+    {
+        fclose(fp);
+        GWPEpon_FwFree(rs);
+        return NULL;
+    }
+    rs->text[fread(rs->text, 1, size, fp)] = '\0';
+    fclose(fp);
+
+    *parsed = (GWPEpon_FwParse(rs) == 0);
+    return rs;
+}
+
+static int GWPEpon_FwChainEqual(const GWPEpon_FwRuleset *a, int ca, const GWPEpon_FwRuleset *b, int cb)
+{
+    const GWPEpon_FwChain *x = &a->chains[ca];
+    const GWPEpon_FwChain *y = &b->chains[cb];
+    int i;
+
+    if (strcmp(x->policy, y->policy) != 0 || x->count != y->count)
+        return 0;
+    for (i = 0; i < x->count; i++)
+    {
+        if (strcmp(a->rules[x->first + i].line, b->rules[y->first + i].line) != 0)
+            return 0;
+    }
+    return 1;
+}
+
+/* 1 when the kernel chain is no longer what it was right after our last
+   restore, someone else changed it */
+static int GWPEpon_FwChainTouched(const GWPEpon_FwRuleset *saved, const GWPEpon_FwRuleset *live,
+                                  const char *table, const char *name)
+{
+    int before = GWPEpon_FwFindChain(saved, table, name, strlen(name));
+    int now = GWPEpon_FwFindChain(live, table, name, strlen(name));
+
+    if (before < 0 || now < 0)
+        return before != now;
+    return !GWPEpon_FwChainEqual(saved, before, live, now);
+}
+
+/* Write the restore transaction turning the kernel ruleset into desired,
+   0 when nothing changed. A chain is rewritten when the generator changed
+   it since the last restore, or when the kernel copy changed since. */
+static int GWPEpon_FwWriteDelta(FILE *fp, const GWPEpon_FwRuleset *applied, const GWPEpon_FwRuleset *saved,
+                                const GWPEpon_FwRuleset *live, const GWPEpon_FwRuleset *desired,
+                                unsigned int *rules)
+{
+    char changed[GWPEPON_FW_MAX_CHAINS];
+    char existed[GWPEPON_FW_MAX_CHAINS];
+    char removed[GWPEPON_FW_MAX_CHAINS];
+    const GWPEpon_FwChain *c;
+    int chains = 0;
+    int dirty, t, i, j, old;
+
+    *rules = 0;
+    memset(removed, 0, sizeof(removed));
+    for (t = 0; t < desired->ntables; t++)
+    {
+        dirty = 0;
+        for (i = 0; i < desired->nchains; i++)
+        {
+            changed[i] = existed[i] = 0;
+            c = &desired->chains[i];
+            if (c->table != t)
+                continue;
+            old = GWPEpon_FwFindChain(applied, desired->tables[t], c->name, strlen(c->name));
+            existed[i] = (GWPEpon_FwFindChain(live, desired->tables[t], c->name, strlen(c->name)) >= 0);
+            changed[i] = (old < 0 || !existed[i] || !GWPEpon_FwChainEqual(desired, i, applied, old) ||
+                          GWPEpon_FwChainTouched(saved, live, desired->tables[t], c->name));
+            dirty |= changed[i];
+        }
+        // Built-in chains cannot be deleted, they stay as they are
+        for (j = 0; j < applied->nchains; j++)
+        {
+            c = &applied->chains[j];
+            removed[j] = (strcmp(applied->tables[c->table], desired->tables[t]) == 0 &&
+                          strcmp(c->policy, "-") == 0 &&
+                          GWPEpon_FwFindChain(desired, desired->tables[t], c->name, strlen(c->name)) < 0 &&
+                          GWPEpon_FwFindChain(live, desired->tables[t], c->name, strlen(c->name)) >= 0);
+            dirty |= removed[j];
+        }
+        if (!dirty)
+            continue;
+
+        fprintf(fp, "*%s\n", desired->tables[t]);
+        for (i = 0; i < desired->nchains; i++)
+        {
+            if (changed[i])
+                fprintf(fp, ":%s %s [0:0]\n", desired->chains[i].name, desired->chains[i].policy);
+        }
+        for (i = 0; i < desired->nchains; i++)
+        {
+            if (changed[i] && existed[i])
+                fprintf(fp, "-F %s\n", desired->chains[i].name);
+        }
+        // Rules jumping to a deleted chain go away with the chains refilled above
+        for (j = 0; j < applied->nchains; j++)
+        {
+            if (removed[j])
+                fprintf(fp, "-F %s\n", applied->chains[j].name);
+        }
+        for (i = 0; i < desired->nchains; i++)
+        {
+            if (!changed[i])
+                continue;
+            chains++;
+            c = &desired->chains[i];
+            for (j = 0; j < c->count; j++)
+                fprintf(fp, "%s\n", desired->rules[c->first + j].line);
+            *rules += c->count;
+        }
+        for (j = 0; j < applied->nchains; j++)
+        {
+            if (!removed[j])
+                continue;
+            chains++;
+            fprintf(fp, "-X %s\n", applied->chains[j].name);
+        }
+        fprintf(fp, "COMMIT\n");
+    }
+    return chains;
+}
+
+static void GWPEpon_FwForget(int f)
+{
+    GWPEpon_FwFree(fw_applied[f]);
+    GWPEpon_FwFree(fw_saved[f]);
+    fw_applied[f] = fw_saved[f] = NULL;
+}
+
+/* The ruleset of the kernel, NULL when it cannot be read or diffed */
+static GWPEpon_FwRuleset *GWPEpon_FwSave(int f)
+{
+    const GWPEpon_FwFamily *fam = &fw_families[f];
+    GWPEpon_FwRuleset *rs;
+    char cmd[128];
+    int parsed;
+
+    snprintf(cmd, sizeof(cmd), "%s > %s", fam->save, fam->live);
+    if (GWPEpon_ActionRun(fam->save_action, cmd) != 0 || (rs = GWPEpon_FwLoad(fam->live, &parsed)) == NULL)
+        return NULL;
+    if (!parsed)
+    {
+        GWPROVEPONLOG(WARNING, "%s firewall: %s output cannot be diffed\n", fam->name, fam->save)
+        GWPEpon_FwFree(rs);
+        return NULL;
+    }
+    return rs;
+}
+
+static int GWPEpon_FwFallback(const char *why)
+{
+    int f, ret;
+
+    GWPROVEPONLOG(WARNING, "firewall: %s, running lan_handler.sh firewall_restart\n", why)
+    // What the script applied is not known, the next request restores everything
+    for (f = 0; f < FW_FAMILIES; f++)
+    {
+        fw_stats[f].fallbacks++;
+        GWPEpon_FwForget(f);
+    }
+    ret = GWPEpon_ActionRun("firewall_restart", GWPEPON_FW_SCRIPT);
+    return ret;
+}
+
+static int GWPEpon_FwApply(int f)
+{
+    const GWPEpon_FwFamily *fam = &fw_families[f];
+    GWPEpon_FwStats *stats = &fw_stats[f];
+    GWPEpon_FwRuleset *desired;
+    GWPEpon_FwRuleset *live = NULL;
+    unsigned long long start;
+    unsigned int rules = 0;
+    char cmd[128];
+    FILE *fp;
+    int parsed, chains;
+    int delta = 0;
+
+    stats->requests++;
+    if ((desired = GWPEpon_FwLoad(fam->rules, &parsed)) == NULL)
+        return -1;
+    stats->rules = parsed ? desired->nrules : 0;
+    stats->chains = parsed ? desired->nchains : 0;
+    if (!parsed)
+        GWPROVEPONLOG(WARNING, "%s firewall: %s cannot be diffed, restoring it whole\n", fam->name, fam->rules)
+
+    // The delta is taken against the kernel, other components restore and
+    // edit the firewall too
+    if (parsed && fw_applied[f] != NULL && (live = GWPEpon_FwSave(f)) == NULL)
+        GWPEpon_FwForget(f);
+    if (live != NULL)
+    {
+        if ((fp = fopen(fam->delta, "w")) == NULL)
+        {
+            GWPEpon_FwFree(live);
+            GWPEpon_FwFree(desired);
+            return -1;
+        }
+        chains = GWPEpon_FwWriteDelta(fp, fw_applied[f], fw_saved[f], live, desired, &rules);
+        if (fclose(fp) != 0)
+        {
+            GWPEpon_FwFree(live);
+            GWPEpon_FwFree(desired);
+            return -1;
+        }
+        if (chains == 0)
+        {
+            GWPROVEPONLOG(INFO, "%s firewall unchanged, %u rules\n", fam->name, stats->rules)
+            stats->unchanged++;
+            GWPEpon_FwFree(fw_saved[f]);
+            fw_saved[f] = live;
+            GWPEpon_FwFree(desired);
+            return 0;
+        }
+        GWPEpon_FwFree(live);
+        delta = 1;
+        stats->deltas++;
+        snprintf(cmd, sizeof(cmd), "%s --noflush %s", fam->restore, fam->delta);
+    }
+    else
+    {
+        stats->full++;
+        chains = stats->chains;
+        rules = stats->rules;
+        snprintf(cmd, sizeof(cmd), "%s %s", fam->restore, fam->rules);
+    }
+    stats->rules_applied = rules;
+    stats->chains_changed = chains;
+
+    start = GWPEpon_NowUs();
+    if (GWPEpon_ActionRun(fam->action, cmd) != 0)
+    {
+        GWPEpon_FwForget(f);
+        GWPEpon_FwFree(desired);
+        return -1;
+    }
+    stats->last_us = GWPEpon_NowUs() - start;
+    if (stats->last_us > stats->max_us)
+        stats->max_us = stats->last_us;
+    GWPROVEPONLOG(INFO, "%s firewall %s: %u of %u rules in %d chains applied in %llu us\n", fam->name,
+                  delta ? "delta" : "restored", rules, stats->rules, chains, stats->last_us)
+
+    GWPEpon_FwForget(f);
+    if (parsed && (fw_saved[f] = GWPEpon_FwSave(f)) != NULL)
+        fw_applied[f] = desired;
+    else
+        GWPEpon_FwFree(desired);
+    return 0;
+}
+
+/**************************************************************************/
+/*! \fn int GWPEpon_FwRequest(const char *why)
+ **************************************************************************
+ *  \brief Bring the firewall in line with the generated ruleset, applying
+ *    only the chains that changed since the last request
+ *  \return 0 on success, -1 on failure
+ **************************************************************************/
+int GWPEpon_FwRequest(const char *why)
+{
+    int f;
+
+    GWPROVEPONLOG(INFO, "firewall update: %s\n", why)
+
+    if (GWPEpon_ActionRun("firewall_generate", GWPEPON_FW_GENERATE) != 0)
+        return GWPEpon_FwFallback("ruleset generation failed");
+    for (f = 0; f < FW_FAMILIES; f++)
+    {
+        if (GWPEpon_FwApply(f) < 0)
+            return GWPEpon_FwFallback("restore failed");
+    }
+    return 0;
+}
+
+const GWPEpon_FwStats *GWPEpon_FwGetStats(int idx, const char **family)
+{
+    if (idx < 0 || idx >= FW_FAMILIES)
+        return NULL;
+    *family = fw_families[idx].name;
+    return &fw_stats[idx];
+}
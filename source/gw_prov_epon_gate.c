@@ -0,0 +1,367 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*! \file gw_prov_epon_gate.c
+    \brief readiness-condition gates over tracked sysevent tuples
+
+    Only the tuples referenced by a gate are tracked. Each one is read
+    from sysevent once when the first gate referencing it is added, after
+    that it follows the notifications and the daemon's own sets. A gate
+    opens (its action fires) when its expression becomes true and closes
+    again when it becomes false, so the action runs exactly once per
+    readiness transition no matter how often the tuples are re-announced.
+*/
+
+/**************************************************************************/
+/*      INCLUDES:                                                         */
+/**************************************************************************/
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include "gw_prov_epon.h"
+#include "gw_prov_epon_ctx.h"
+#include "gw_prov_epon_gate.h"
+#include "gw_prov_epon_log.h"
+
+/**************************************************************************/
+/*      LOCAL DECLARATIONS:                                               */
+/**************************************************************************/
+typedef struct
+{
+    char name[GWPEPON_GATE_NAME_LEN];
+    char val[GWPEPON_GATE_VAL_LEN];
+} GWPEpon_GateTuple;
+
+typedef struct
+{
+    int tuple;                  /* index in gate_tuples */
+    int negate;                 /* != instead of == */
+    int clause;                 /* terms of one || alternative share a clause */
+    char val[GWPEPON_GATE_VAL_LEN];
+} GWPEpon_GateTerm;
+
+typedef struct
+{
+    const char *name;
+    int open;
+    int nterms;
+    GWPEpon_GateTerm terms[GWPEPON_GATE_MAX_TERMS];
+    GWPEpon_GateOpenCb on_open;
+    GWPEpon_GateCloseCb on_close;
+    void *arg;
+    unsigned int opened;
+} GWPEpon_Gate;
+
+/**************************************************************************/
+/*      LOCAL VARIABLES:                                                  */
+/**************************************************************************/
+static GWPEPON_THREAD_LOCAL GWPEpon_GateTuple gate_tuples[GWPEPON_GATE_MAX_TUPLES];
+static GWPEPON_THREAD_LOCAL int gate_ntuples = 0;
+static GWPEPON_THREAD_LOCAL GWPEpon_Gate gates[GWPEPON_GATE_MAX];
+static GWPEPON_THREAD_LOCAL int gate_count = 0;
+static GWPEPON_THREAD_LOCAL int gate_evaluating = 0;
+static GWPEPON_THREAD_LOCAL int gate_pending = 0;
+static GWPEPON_THREAD_LOCAL pthread_t gate_owner;
+
+/**************************************************************************/
+/*      LOCAL FUNCTIONS:                                                  */
+/**************************************************************************/
+static int GWPEpon_GateFindTuple(const char *name)
+{
+    int i;
+
+    for (i = 0; i < gate_ntuples; i++)
+    {
+        if (strcmp(gate_tuples[i].name, name) == 0)
+            return i;
+    }
+    return -1;
+}
+
+static int GWPEpon_GateTrackTuple(const char *name)
+{
+    unsigned char val[GWPEPON_GATE_VAL_LEN];
+    int idx = GWPEpon_GateFindTuple(name);
+
+    if (idx >= 0)
+        return idx;
+    if (gate_ntuples == GWPEPON_GATE_MAX_TUPLES)
+        return -1;
+
+    // The only query of this tuple, from here on it is followed through updates
+    val[0] = '\0';
+    GWPEpon_SyseventGetStr(name, val, sizeof(val));
+
+    idx = gate_ntuples++;
+    snprintf(gate_tuples[idx].name, sizeof(gate_tuples[idx].name), "%s", name);
+    snprintf(gate_tuples[idx].val, sizeof(gate_tuples[idx].val), "%s", (char *) val);
+    return idx;
+}
+
+static char *GWPEpon_GateTrim(char *s)
+{
+    char *end;
+
+    while (*s == ' ' || *s == '\t')
+        s++;
+    end = s + strlen(s);
+    while (end > s && (end[-1] == ' ' || end[-1] == '\t'))
+        *--end = '\0';
+    return s;
+}
+
+static int GWPEpon_GateParseTerm(GWPEpon_Gate *gate, char *text, int clause)
+{
+    GWPEpon_GateTerm *term;
+    char *op;
+    int negate;
+
+    if (gate->nterms == GWPEPON_GATE_MAX_TERMS)
+        return -1;
+
+    if ((op = strstr(text, "!=")) != NULL)
+        negate = 1;
+    else if ((op = strstr(text, "==")) != NULL)
+        negate = 0;
+    else
+        return -1;
+
+    op[0] = '\0';
+    term = &gate->terms[gate->nterms];
+    term->tuple = GWPEpon_GateTrackTuple(GWPEpon_GateTrim(text));
+    if (term->tuple < 0)
+        return -1;
+    term->negate = negate;
+    term->clause = clause;
+    snprintf(term->val, sizeof(term->val), "%s", GWPEpon_GateTrim(op + 2));
+    gate->nterms++;
+    return 0;
+}
+
+static int GWPEpon_GateParse(GWPEpon_Gate *gate, const char *expr)
+{
+    char buf[256];
+    char *clause_text, *next_clause;
+    int clause = 0;
+
+    snprintf(buf, sizeof(buf), "%s", expr);
+    for (clause_text = buf; clause_text != NULL; clause_text = next_clause, clause++)
+    {
+        char *term_text, *next_term;
+
+        next_clause = strstr(clause_text, "||");
+        if (next_clause)
+        {
+            *next_clause = '\0';
+            next_clause += 2;
+        }
+
+        for (term_text = clause_text; term_text != NULL; term_text = next_term)
+        {
+            next_term = strstr(term_text, "&&");
+            if (next_term)
+            {
+                *next_term = '\0';
+                next_term += 2;
+            }
+            if (GWPEpon_GateParseTerm(gate, term_text, clause) < 0)
+                return -1;
+        }
+    }
+    return 0;
+}
+
+static int GWPEpon_GateHolds(const GWPEpon_Gate *gate)
+{
+    int clause_ok = 1;
+    int i;
+
+    for (i = 0; i < gate->nterms; i++)
+    {
+        const GWPEpon_GateTerm *term = &gate->terms[i];
+        int match = (strcmp(gate_tuples[term->tuple].val, term->val) == 0);
+
+        // End of an alternative: it either held completely or the next one is tried
+        if (i > 0 && term->clause != gate->terms[i - 1].clause)
+        {
+            if (clause_ok)
+                return 1;
+            clause_ok = 1;
+        }
+        if (match == term->negate)
+            clause_ok = 0;
+    }
+    return clause_ok && gate->nterms > 0;
+}
+
+static void GWPEpon_GateEvaluate(void)
+{
+    int i;
+
+    if (gate_evaluating)
+    {
+        // A gate action set a tracked tuple, evaluate again once it returns
+        gate_pending = 1;
+        return;
+    }
+
+    gate_evaluating = 1;
+    do
+    {
+        gate_pending = 0;
+        for (i = 0; i < gate_count; i++)
+        {
+            GWPEpon_Gate *gate = &gates[i];
+            int holds = GWPEpon_GateHolds(gate);
+
+            if (holds && !gate->open)
+            {
+                GWPROVEPONLOG(INFO, "gate %s ready\n", gate->name)
+                if (gate->on_open(gate->name, gate->arg) == 0)
+                {
+                    gate->open = 1;
+                    gate->opened++;
+                }
+            }
+            else if (!holds && gate->open)
+            {
+                GWPROVEPONLOG(INFO, "gate %s no longer ready\n", gate->name)
+                gate->open = 0;
+                if (gate->on_close)
+                    gate->on_close(gate->name, gate->arg);
+            }
+        }
+    } while (gate_pending);
+    gate_evaluating = 0;
+}
+
+/**************************************************************************/
+/*! \fn void GWPEpon_GateInit(void)
+ **************************************************************************
+ *  \brief Bind the gates to the calling (event loop) thread. Tuple sets
+ *    made by other threads reach the gates through their notification.
+ *  \return void
+ **************************************************************************/
+void GWPEpon_GateInit(void)
+{
+    gate_owner = pthread_self();
+}
+
+/**************************************************************************/
+/*! \fn int GWPEpon_GateAdd(const char *name, const char *expr,
+ *        GWPEpon_GateOpenCb on_open, GWPEpon_GateCloseCb on_close, void *arg)
+ **************************************************************************
+ *  \brief Declare a gate. name must be a string literal. on_close may be
+ *    NULL when the action has no inverse.
+ *  \return 0 on success, -1 on a bad expression or a full table
+ **************************************************************************/
+int GWPEpon_GateAdd(const char *name, const char *expr,
+                    GWPEpon_GateOpenCb on_open, GWPEpon_GateCloseCb on_close, void *arg)
+{
+    GWPEpon_Gate *gate;
+
+    if (gate_count == GWPEPON_GATE_MAX)
+    {
+        GWPROVEPONLOG(ERROR, "gate table full, cannot add %s\n", name)
+        return -1;
+    }
+
+    gate = &gates[gate_count];
+    memset(gate, 0, sizeof(*gate));
+    if (GWPEpon_GateParse(gate, expr) < 0)
+    {
+        GWPROVEPONLOG(ERROR, "invalid gate %s: %s\n", name, expr)
+        return -1;
+    }
+    gate->name = name;
+    gate->on_open = on_open;
+    gate->on_close = on_close;
+    gate->arg = arg;
+    gate_count++;
+    return 0;
+}
+
+/**************************************************************************/
+/*! \fn void GWPEpon_GateUpdate(const char *tuple, const char *val)
+ **************************************************************************
+ *  \brief Record a tuple value and re-evaluate the gates. Tuples no gate
+ *    refers to are ignored.
+ *  \return void
+ **************************************************************************/
+void GWPEpon_GateUpdate(const char *tuple, const char *val)
+{
+    int idx;
+
+    if (gate_count == 0 || !pthread_equal(pthread_self(), gate_owner))
+        return;
+
+    idx = GWPEpon_GateFindTuple(tuple);
+    if (idx < 0)
+        return;
+
+    snprintf(gate_tuples[idx].val, sizeof(gate_tuples[idx].val), "%s", val ? val : "");
+    GWPEpon_GateEvaluate();
+}
+
+/**************************************************************************/
+/*! \fn void GWPEpon_GateRecheck(void)
+ **************************************************************************
+ *  \brief Re-evaluate the gates after state outside the tracked tuples
+ *    changed, e.g. a refusing action may now accept
+ *  \return void
+ **************************************************************************/
+void GWPEpon_GateRecheck(void)
+{
+    GWPEpon_GateEvaluate();
+}
+
+/**************************************************************************/
+/*! \fn void GWPEpon_GateLatch(void)
+ **************************************************************************
+ *  \brief Mark the gates that already hold as open without running their
+ *    action, used when a resumed instance finds the work already done
+ *  \return void
+ **************************************************************************/
+void GWPEpon_GateLatch(void)
+{
+    int i;
+
+    for (i = 0; i < gate_count; i++)
+    {
+        gates[i].open = GWPEpon_GateHolds(&gates[i]);
+        if (gates[i].open)
+            GWPROVEPONLOG(INFO, "gate %s already open\n", gates[i].name)
+    }
+}
+
+const char *GWPEpon_GateGetTuple(const char *tuple)
+{
+    int idx = GWPEpon_GateFindTuple(tuple);
+
+    return (idx < 0) ? NULL : gate_tuples[idx].val;
+}
+
+int GWPEpon_GateGetInfo(int idx, const char **name, int *open)
+{
+    if (idx < 0 || idx >= gate_count)
+        return -1;
+    *name = gates[idx].name;
+    *open = gates[idx].open;
+    return 0;
+}
@@ -0,0 +1,260 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*! \file gw_prov_epon_gre.c
+    \brief hotspot GRE tunnel updates over netlink
+
+    The kernel resets every tunnel parameter missing from a changelink
+    request, so an update sends back all the IFLA_INFO_DATA attributes of
+    the tunnel with only the endpoint and the underlying device replaced.
+*/
+
+/**************************************************************************/
+/*      INCLUDES:                                                         */
+/**************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <linux/if_link.h>
+#include <linux/if_tunnel.h>
+#include "gw_prov_epon.h"
+#include "gw_prov_epon_action.h"
+#include "gw_prov_epon_ctx.h"
+#include "gw_prov_epon_evloop.h"
+#include "gw_prov_epon_gre.h"
+#include "gw_prov_epon_log.h"
+#include "gw_prov_epon_netlink.h"
+
+/**************************************************************************/
+/*      LOCAL DECLARATIONS:                                               */
+/**************************************************************************/
+typedef struct
+{
+    int index;                  /* 0 when the tunnel does not exist */
+    struct in_addr remote;
+    int link;
+    int data_len;
+    char data[GWPEPON_GRE_DATA_LEN] __attribute__((aligned(RTA_ALIGNTO)));
+} GWPEpon_GreTunnel;
+
+/**************************************************************************/
+/*      LOCAL VARIABLES:                                                  */
+/**************************************************************************/
+static GWPEPON_THREAD_LOCAL GWPEpon_GreStats gre_stats;
+static GWPEPON_THREAD_LOCAL GWPEpon_NlBatch gre_batch;
+static GWPEPON_THREAD_LOCAL int gre_rebuilding = 0;
+static GWPEPON_THREAD_LOCAL int gre_pending = -1;   /* force flag of a request held during a rebuild */
+
+/**************************************************************************/
+/*      LOCAL FUNCTIONS:                                                  */
+/**************************************************************************/
+static int GWPEpon_GreApply(int force);
+
+static void GWPEpon_GreRecord(unsigned long long us, unsigned long long *max)
+{
+    gre_stats.last_us = us;
+    gre_stats.total_us += us;
+    if (max && us > *max)
+        *max = us;
+}
+
+static int GWPEpon_GreLinkCb(const struct nlmsghdr *nlh, void *arg)
+{
+    GWPEpon_GreTunnel *tunnel = (GWPEpon_GreTunnel *) arg;
+    const struct ifinfomsg *ifi = (const struct ifinfomsg *) NLMSG_DATA(nlh);
+    struct rtattr *tb[IFLA_MAX + 1];
+    struct rtattr *info[IFLA_INFO_MAX + 1];
+    struct rtattr *gre[IFLA_GRE_MAX + 1];
+
+    if (nlh->nlmsg_type != RTM_NEWLINK)
+        return 0;
+    GWPEpon_NlParseAttrs(tb, IFLA_MAX, IFLA_RTA(ifi), IFLA_PAYLOAD(nlh));
+    if (!tb[IFLA_IFNAME] || strcmp((const char *) RTA_DATA(tb[IFLA_IFNAME]), GWPEPON_GRE_IFNAME) != 0)
+        return 0;
+    if (!tb[IFLA_LINKINFO])
+        return 1;
+    GWPEpon_NlParseAttrs(info, IFLA_INFO_MAX, (struct rtattr *) RTA_DATA(tb[IFLA_LINKINFO]),
+                         RTA_PAYLOAD(tb[IFLA_LINKINFO]));
+    if (!info[IFLA_INFO_KIND] || strcmp((const char *) RTA_DATA(info[IFLA_INFO_KIND]), "gretap") != 0 ||
+        !info[IFLA_INFO_DATA] || RTA_PAYLOAD(info[IFLA_INFO_DATA]) > sizeof(tunnel->data))
+        return 1;
+
+    tunnel->index = ifi->ifi_index;
+    tunnel->data_len = RTA_PAYLOAD(info[IFLA_INFO_DATA]);
+    memcpy(tunnel->data, RTA_DATA(info[IFLA_INFO_DATA]), tunnel->data_len);
+    GWPEpon_NlParseAttrs(gre, IFLA_GRE_MAX, (struct rtattr *) tunnel->data, tunnel->data_len);
+    if (gre[IFLA_GRE_REMOTE])
+        memcpy(&tunnel->remote, RTA_DATA(gre[IFLA_GRE_REMOTE]), sizeof(tunnel->remote));
+    if (gre[IFLA_GRE_LINK])
+        tunnel->link = *(int *) RTA_DATA(gre[IFLA_GRE_LINK]);
+    return 1;
+}
+
+/* Change the endpoint and device of the tunnel, keeping its other parameters */
+static int GWPEpon_GreUpdate(int fd, const GWPEpon_GreTunnel *tunnel, struct in_addr remote, int link)
+{
+    struct ifinfomsg ifi;
+    struct nlmsghdr *nlh;
+    struct rtattr *linkinfo, *data, *rta;
+    int len = tunnel->data_len;
+
+    memset(&ifi, 0, sizeof(ifi));
+    ifi.ifi_family = AF_UNSPEC;
+    ifi.ifi_index = tunnel->index;
+
+    GWPEpon_NlBatchInit(&gre_batch);
+    if ((nlh = GWPEpon_NlBatchAdd(&gre_batch, RTM_NEWLINK, 0, &ifi, sizeof(ifi))) == NULL ||
+        (linkinfo = GWPEpon_NlNestStart(&gre_batch, nlh, IFLA_LINKINFO)) == NULL ||
+        GWPEpon_NlAddAttr(&gre_batch, nlh, IFLA_INFO_KIND, "gretap", sizeof("gretap")) < 0 ||
+        (data = GWPEpon_NlNestStart(&gre_batch, nlh, IFLA_INFO_DATA)) == NULL)
+        return -1;
+    for (rta = (struct rtattr *) tunnel->data; RTA_OK(rta, len); rta = RTA_NEXT(rta, len))
+    {
+        if (rta->rta_type == IFLA_GRE_REMOTE || rta->rta_type == IFLA_GRE_LINK)
+            continue;
+        if (GWPEpon_NlAddAttr(&gre_batch, nlh, rta->rta_type, RTA_DATA(rta), RTA_PAYLOAD(rta)) < 0)
+            return -1;
+    }
+    if (GWPEpon_NlAddAttr(&gre_batch, nlh, IFLA_GRE_REMOTE, &remote, sizeof(remote)) < 0 ||
+        GWPEpon_NlAddAttr(&gre_batch, nlh, IFLA_GRE_LINK, &link, sizeof(link)) < 0)
+        return -1;
+    GWPEpon_NlNestEnd(nlh, data);
+    GWPEpon_NlNestEnd(nlh, linkinfo);
+    return GWPEpon_NlBatchSend(fd, &gre_batch) == 0 ? 0 : -1;
+}
+
+static void GWPEpon_GreRebuilt(const char *action, const GWPEpon_ActionResult *result, void *arg)
+{
+    int force = gre_pending;
+
+    (void) action;
+    (void) arg;
+    gre_rebuilding = 0;
+    GWPEpon_GreRecord(result->runtime_ms * 1000ULL, &gre_stats.rebuild_us_max);
+    if (result->exit_code != 0)
+    {
+        gre_stats.failures++;
+        GWPROVEPONLOG(ERROR, "hotspot rebuild failed: exit %d signal %d\n", result->exit_code, result->signo)
+    }
+    else
+    {
+        GWPROVEPONLOG(INFO, "hotspot rebuilt, tunnel down for %llu ms\n", result->runtime_ms)
+    }
+
+    gre_pending = -1;
+    if (force >= 0)
+        GWPEpon_GreApply(force);
+}
+
+static int GWPEpon_GreRebuild(const char *why)
+{
+    GWPROVEPONLOG(INFO, "rebuilding the hotspot: %s\n", why)
+    gre_stats.rebuilds++;
+    gre_rebuilding = 1;
+    if (GWPEpon_ActionRunAsync("hotspot_restart", GWPEPON_GRE_SCRIPT, GWPEpon_GreRebuilt, NULL) < 0)
+    {
+        gre_rebuilding = 0;
+        gre_stats.failures++;
+        return -1;
+    }
+    return 0;
+}
+
+static int GWPEpon_GreApply(int force)
+{
+    GWPEpon_GreTunnel tunnel;
+    char endpoint[64];
+    struct in_addr remote;
+    struct ifinfomsg ifi;
+    unsigned long long start;
+    int link;
+    int fd, ret;
+
+    if (force)
+    {
+        gre_stats.forced++;
+        return GWPEpon_GreRebuild("forced");
+    }
+
+    endpoint[0] = '\0';
+    GWPEpon_SyseventGetStr(GWPEPON_GRE_ENDPOINT, (unsigned char *) endpoint, sizeof(endpoint));
+    if (inet_pton(AF_INET, endpoint, &remote) != 1)
+        return GWPEpon_GreRebuild("endpoint is not an IPv4 address");
+    link = (int) if_nametoindex(GWPEpon_CtxCurrent()->ifname);
+
+    memset(&tunnel, 0, sizeof(tunnel));
+    memset(&ifi, 0, sizeof(ifi));
+    ifi.ifi_family = AF_UNSPEC;
+    if ((fd = GWPEpon_NlOpen(0)) < 0)
+        return GWPEpon_GreRebuild("netlink unavailable");
+    if (GWPEpon_NlDump(fd, RTM_GETLINK, &ifi, sizeof(ifi), GWPEpon_GreLinkCb, &tunnel) < 0 || tunnel.index == 0)
+    {
+        close(fd);
+        return GWPEpon_GreRebuild("no " GWPEPON_GRE_IFNAME " tunnel");
+    }
+
+    if (tunnel.remote.s_addr == remote.s_addr && tunnel.link == link)
+    {
+        close(fd);
+        gre_stats.unchanged++;
+        GWPEpon_GreRecord(0, NULL);
+        GWPROVEPONLOG(INFO, "hotspot tunnel to %s unchanged\n", endpoint)
+        return 0;
+    }
+
+    // Traffic to the old endpoint is lost until the kernel applied the change
+    start = GWPEpon_NowUs();
+    ret = GWPEpon_GreUpdate(fd, &tunnel, remote, link);
+    close(fd);
+    if (ret < 0)
+        return GWPEpon_GreRebuild("tunnel update refused");
+
+    gre_stats.updates++;
+    GWPEpon_GreRecord(GWPEpon_NowUs() - start, &gre_stats.update_us_max);
+    GWPROVEPONLOG(INFO, "hotspot tunnel moved to %s in %llu us\n", endpoint, gre_stats.last_us)
+    return 0;
+}
+
+/**************************************************************************/
+/*! \fn int GWPEpon_GreRequest(int force)
+ **************************************************************************
+ *  \brief Bring the hotspot tunnel in line with its endpoint, rebuilding
+ *    the whole hotspot only when forced or when it cannot be updated
+ *  \return 0 on success, -1 on failure
+ **************************************************************************/
+int GWPEpon_GreRequest(int force)
+{
+    gre_stats.requests++;
+    if (gre_rebuilding)
+    {
+        // Held until the rebuild is over, then checked against its result
+        if (force > gre_pending)
+            gre_pending = force;
+        return 0;
+    }
+    return GWPEpon_GreApply(force);
+}
+
+const GWPEpon_GreStats *GWPEpon_GreGetStats(void)
+{
+    return &gre_stats;
+}
@@ -0,0 +1,178 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*! \file gw_prov_epon_member.c
+    \brief XHS port moved between the LAN bridges over netlink
+*/
+
+/**************************************************************************/
+/*      INCLUDES:                                                         */
+/**************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <net/if.h>
+#include <syscfg/syscfg.h>
+#include "gw_prov_epon.h"
+#include "gw_prov_epon_action.h"
+#include "gw_prov_epon_ctx.h"
+#include "gw_prov_epon_evloop.h"
+#include "gw_prov_epon_log.h"
+#include "gw_prov_epon_member.h"
+#include "gw_prov_epon_netlink.h"
+
+/**************************************************************************/
+/*      LOCAL VARIABLES:                                                  */
+/**************************************************************************/
+static GWPEPON_THREAD_LOCAL GWPEpon_MemberStats member_stats;
+static GWPEPON_THREAD_LOCAL GWPEpon_NlBatch member_batch;
+static GWPEPON_THREAD_LOCAL int member_echo = -1;      /* instance we published, until notified */
+static GWPEPON_THREAD_LOCAL unsigned long long member_echo_until = 0;
+
+/**************************************************************************/
+/*      LOCAL FUNCTIONS:                                                  */
+/**************************************************************************/
+static int GWPEpon_MemberFallback(int xhs, const char *why)
+{
+    const char *action = xhs ? "eth3_to_xhs" : "eth3_to_local";
+    char cmd[64];
+
+    GWPROVEPONLOG(WARNING, "%s membership: %s, running lan_handler.sh %s\n", GWPEPON_MEMBER_PORT, why, action)
+    member_stats.fallbacks++;
+    snprintf(cmd, sizeof(cmd), "sh /usr/ccsp/lan_handler.sh %s", action);
+    return GWPEpon_ActionRun(action, cmd);
+}
+
+static void GWPEpon_MemberBridge(int xhs, char *bridge, int len)
+{
+    bridge[0] = '\0';
+    if (xhs)
+    {
+        if (GWPEpon_SyseventGetStr("multinet_2-name", (unsigned char *) bridge, len) != 0 || bridge[0] == '\0')
+            snprintf(bridge, len, "brlan1");
+    }
+    else if (syscfg_get(NULL, "lan_ifname", bridge, len) != 0 || bridge[0] == '\0')
+    {
+        snprintf(bridge, len, "brlan0");
+    }
+}
+
+/* 1 when the port is already enslaved to bridge */
+static int GWPEpon_MemberIsIn(const char *bridge)
+{
+    char link[64];
+    char target[64];
+    const char *name;
+    ssize_t len;
+
+    snprintf(link, sizeof(link), "/sys/class/net/%s/master", GWPEPON_MEMBER_PORT);
+    if ((len = readlink(link, target, sizeof(target) - 1)) < 0)
+        return 0;
+    target[len] = '\0';
+    name = strrchr(target, '/');
+    return strcmp(name ? name + 1 : target, bridge) == 0;
+}
+
+/**************************************************************************/
+/*! \fn int GWPEpon_MemberRequest(int instance)
+ **************************************************************************
+ *  \brief Move the port to the bridge of the multinet instance, unless
+ *    the request is the echo of our own multinet-syncMembers set
+ *  \return 0 on success, -1 on failure
+ **************************************************************************/
+int GWPEpon_MemberRequest(int instance)
+{
+    char bridge[IF_NAMESIZE];
+    struct ifinfomsg ifi;
+    struct nlmsghdr *nlh;
+    unsigned long long start;
+    int xhs = (instance == GWPEPON_MEMBER_XHS);
+    int master, port, fd, ret;
+
+    if (member_echo >= 0)
+    {
+        ret = (member_echo == instance && GWPEpon_NowMs() <= member_echo_until);
+        member_echo = -1;
+        if (ret)
+        {
+            member_stats.echoes++;
+            GWPROVEPONLOG(INFO, "%s=%d is our own, already applied\n", GWPEPON_MEMBER_TUPLE, instance)
+            return 0;
+        }
+    }
+
+    member_stats.requests++;
+    GWPEpon_MemberBridge(xhs, bridge, sizeof(bridge));
+    if (GWPEpon_MemberIsIn(bridge))
+    {
+        member_stats.unchanged++;
+        GWPROVEPONLOG(INFO, "%s already in %s\n", GWPEPON_MEMBER_PORT, bridge)
+        return 0;
+    }
+    if ((port = (int) if_nametoindex(GWPEPON_MEMBER_PORT)) <= 0)
+        return GWPEpon_MemberFallback(xhs, "no port");
+    if ((master = (int) if_nametoindex(bridge)) <= 0)
+        return GWPEpon_MemberFallback(xhs, "no bridge");
+
+    start = GWPEpon_NowUs();
+    memset(&ifi, 0, sizeof(ifi));
+    ifi.ifi_family = AF_UNSPEC;
+    ifi.ifi_index = port;
+    GWPEpon_NlBatchInit(&member_batch);
+    if ((nlh = GWPEpon_NlBatchAdd(&member_batch, RTM_NEWLINK, 0, &ifi, sizeof(ifi))) == NULL ||
+        GWPEpon_NlAddAttr(&member_batch, nlh, IFLA_MASTER, &master, sizeof(master)) < 0)
+        return GWPEpon_MemberFallback(xhs, "netlink batch overflow");
+    if ((fd = GWPEpon_NlOpen(0)) < 0)
+        return GWPEpon_MemberFallback(xhs, "netlink unavailable");
+    ret = GWPEpon_NlBatchSend(fd, &member_batch);
+    close(fd);
+    if (ret != 0)
+        return GWPEpon_MemberFallback(xhs, "netlink refused the move");
+
+    member_stats.moves++;
+    member_stats.last_us = GWPEpon_NowUs() - start;
+    if (member_stats.last_us > member_stats.max_us)
+        member_stats.max_us = member_stats.last_us;
+    GWPROVEPONLOG(INFO, "%s moved to %s in %llu us\n", GWPEPON_MEMBER_PORT, bridge, member_stats.last_us)
+    return 0;
+}
+
+/**************************************************************************/
+/*! \fn int GWPEpon_MemberSync(int instance)
+ **************************************************************************
+ *  \brief Apply a membership decided by the daemon, then publish it in
+ *    multinet-syncMembers without handling its notification again
+ *  \return 0 on success, -1 on failure
+ **************************************************************************/
+int GWPEpon_MemberSync(int instance)
+{
+    char val[16];
+    int ret = GWPEpon_MemberRequest(instance);
+
+    member_echo = instance;
+    member_echo_until = GWPEpon_NowMs() + GWPEPON_MEMBER_ECHO_MS;
+    snprintf(val, sizeof(val), "%d", instance);
+    GWPEpon_SyseventSetStr(GWPEPON_MEMBER_TUPLE, (unsigned char *) val, 0);
+    return ret;
+}
+
+const GWPEpon_MemberStats *GWPEpon_MemberGetStats(void)
+{
+    return &member_stats;
+}
@@ -0,0 +1,304 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*! \file gw_prov_epon_netlink.c
+    \brief rtnetlink requests, batches and dumps
+*/
+
+/**************************************************************************/
+/*      INCLUDES:                                                         */
+/**************************************************************************/
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include "gw_prov_epon_ctx.h"
+#include "gw_prov_epon_log.h"
+#include "gw_prov_epon_netlink.h"
+
+/**************************************************************************/
+/*      LOCAL VARIABLES:                                                  */
+/**************************************************************************/
+static GWPEPON_THREAD_LOCAL unsigned int nl_seq = 0;
+
+/**************************************************************************/
+/*      LOCAL FUNCTIONS:                                                  */
+/**************************************************************************/
+static int GWPEpon_NlSend(int fd, const void *buf, int len)
+{
+    struct sockaddr_nl kernel;
+    ssize_t n;
+
+    memset(&kernel, 0, sizeof(kernel));
+    kernel.nl_family = AF_NETLINK;
+    do
+    {
+        n = sendto(fd, buf, len, 0, (struct sockaddr *) &kernel, sizeof(kernel));
+    } while (n < 0 && errno == EINTR);
+    return (n == len) ? 0 : -1;
+}
+
+static int GWPEpon_NlRecv(int fd, char *buf, int len)
+{
+    ssize_t n;
+
+    do
+    {
+        n = recv(fd, buf, len, 0);
+    } while (n < 0 && errno == EINTR);
+    return (int) n;
+}
+
+/**************************************************************************/
+/*! \fn int GWPEpon_NlOpen(unsigned int groups)
+ **************************************************************************
+ *  \brief Open a NETLINK_ROUTE socket subscribed to the RTMGRP_* groups
+ *  \return socket, -1 on failure
+ **************************************************************************/
+int GWPEpon_NlOpen(unsigned int groups)
+{
+    struct sockaddr_nl local;
+    struct timeval tv;
+    int fd;
+
+    fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (fd < 0)
+    {
+        GWPROVEPONLOG(ERROR, "netlink socket: %s\n", strerror(errno))
+        return -1;
+    }
+
+    memset(&local, 0, sizeof(local));
+    local.nl_family = AF_NETLINK;
+    local.nl_groups = groups;
+    if (bind(fd, (struct sockaddr *) &local, sizeof(local)) < 0)
+    {
+        GWPROVEPONLOG(ERROR, "netlink bind: %s\n", strerror(errno))
+        close(fd);
+        return -1;
+    }
+
+    // Replies of a request come right away, a lost one must not hang the loop
+    tv.tv_sec = GWPEPON_NL_TIMEOUT_MS / 1000;
+    tv.tv_usec = (GWPEPON_NL_TIMEOUT_MS % 1000) * 1000;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    return fd;
+}
+
+void GWPEpon_NlBatchInit(GWPEpon_NlBatch *batch)
+{
+    batch->len = 0;
+    batch->count = 0;
+    batch->first_seq = 0;
+}
+
+/**************************************************************************/
+/*! \fn struct nlmsghdr *GWPEpon_NlBatchAdd(GWPEpon_NlBatch *batch, int type,
+ *        int flags, const void *body, int len)
+ **************************************************************************
+ *  \brief Append a request with its fixed header (rtmsg, ifinfomsg...)
+ *  \return the request, to add attributes to, NULL when the batch is full
+ **************************************************************************/
+struct nlmsghdr *GWPEpon_NlBatchAdd(GWPEpon_NlBatch *batch, int type, int flags, const void *body, int len)
+{
+    struct nlmsghdr *nlh;
+    int size = NLMSG_SPACE(len);
+
+    if (batch->len + size > (int) sizeof(batch->buf))
+        return NULL;
+
+    nlh = (struct nlmsghdr *) (batch->buf + batch->len);
+    memset(nlh, 0, size);
+    nlh->nlmsg_len = NLMSG_LENGTH(len);
+    nlh->nlmsg_type = type;
+    nlh->nlmsg_flags = NLM_F_REQUEST | NLM_F_ACK | flags;
+    nlh->nlmsg_seq = ++nl_seq;
+    memcpy(NLMSG_DATA(nlh), body, len);
+
+    if (batch->count == 0)
+        batch->first_seq = nlh->nlmsg_seq;
+    batch->len += size;
+    batch->count++;
+    return nlh;
+}
+
+/**************************************************************************/
+/*! \fn int GWPEpon_NlAddAttr(GWPEpon_NlBatch *batch, struct nlmsghdr *nlh,
+ *        int type, const void *data, int len)
+ **************************************************************************
+ *  \brief Append an attribute to nlh, the last request of the batch
+ *  \return 0 on success, -1 when the batch is full
+ **************************************************************************/
+int GWPEpon_NlAddAttr(GWPEpon_NlBatch *batch, struct nlmsghdr *nlh, int type, const void *data, int len)
+{
+    struct rtattr *rta;
+    int size = RTA_SPACE(len);
+
+    if (batch->len + size > (int) sizeof(batch->buf))
+        return -1;
+
+    rta = (struct rtattr *) ((char *) nlh + NLMSG_ALIGN(nlh->nlmsg_len));
+    memset(rta, 0, size);
+    rta->rta_type = type;
+    rta->rta_len = RTA_LENGTH(len);
+    if (len > 0)
+        memcpy(RTA_DATA(rta), data, len);
+
+    nlh->nlmsg_len = NLMSG_ALIGN(nlh->nlmsg_len) + size;
+    batch->len += size;
+    return 0;
+}
+
+/**************************************************************************/
+/*! \fn struct rtattr *GWPEpon_NlNestStart(GWPEpon_NlBatch *batch,
+ *        struct nlmsghdr *nlh, int type)
+ **************************************************************************
+ *  \brief Open a nested attribute, the attributes added to nlh until
+ *    GWPEpon_NlNestEnd are its payload
+ *  \return the nest, NULL when the batch is full
+ **************************************************************************/
+struct rtattr *GWPEpon_NlNestStart(GWPEpon_NlBatch *batch, struct nlmsghdr *nlh, int type)
+{
+    struct rtattr *nest = (struct rtattr *) ((char *) nlh + NLMSG_ALIGN(nlh->nlmsg_len));
+
+    if (GWPEpon_NlAddAttr(batch, nlh, type, NULL, 0) < 0)
+        return NULL;
+    return nest;
+}
+
+void GWPEpon_NlNestEnd(struct nlmsghdr *nlh, struct rtattr *nest)
+{
+    nest->rta_len = (unsigned short) ((char *) nlh + nlh->nlmsg_len - (char *) nest);
+}
+
+/**************************************************************************/
+/*! \fn int GWPEpon_NlBatchSend(int fd, GWPEpon_NlBatch *batch)
+ **************************************************************************
+ *  \brief Send every request of the batch at once and collect their
+ *    acknowledgements. The batch is empty again afterwards.
+ *  \return number of requests the kernel refused, -1 on a socket error
+ **************************************************************************/
+int GWPEpon_NlBatchSend(int fd, GWPEpon_NlBatch *batch)
+{
+    char buf[GWPEPON_NL_RECV_LEN] __attribute__((aligned(NLMSG_ALIGNTO)));
+    unsigned int first = batch->first_seq;
+    int count = batch->count;
+    int pending = count;
+    int failed = 0;
+    int n;
+
+    if (pending == 0)
+        return 0;
+    if (GWPEpon_NlSend(fd, batch->buf, batch->len) < 0)
+    {
+        GWPROVEPONLOG(ERROR, "netlink send: %s\n", strerror(errno))
+        GWPEpon_NlBatchInit(batch);
+        return -1;
+    }
+    GWPEpon_NlBatchInit(batch);
+
+    while (pending > 0)
+    {
+        struct nlmsghdr *nlh;
+
+        n = GWPEpon_NlRecv(fd, buf, sizeof(buf));
+        if (n <= 0)
+        {
+            GWPROVEPONLOG(ERROR, "netlink ack: %s, %d requests unacknowledged\n", strerror(errno), pending)
+            return -1;
+        }
+        for (nlh = (struct nlmsghdr *) buf; NLMSG_OK(nlh, (unsigned int) n); nlh = NLMSG_NEXT(nlh, n))
+        {
+            const struct nlmsgerr *err = (const struct nlmsgerr *) NLMSG_DATA(nlh);
+
+            // Notifications of a subscribed socket are not ours to consume here
+            if (nlh->nlmsg_type != NLMSG_ERROR || nlh->nlmsg_seq - first >= (unsigned int) count)
+                continue;
+            pending--;
+            if (err->error != 0)
+            {
+                GWPROVEPONLOG(WARNING, "netlink request %u refused: %s\n", nlh->nlmsg_seq - first, strerror(-err->error))
+                failed++;
+            }
+        }
+    }
+    return failed;
+}
+
+/**************************************************************************/
+/*! \fn int GWPEpon_NlDump(int fd, int type, const void *body, int len,
+ *        GWPEpon_NlCb cb, void *arg)
+ **************************************************************************
+ *  \brief Dump the objects of a RTM_GET* request and call cb on each
+ *  \return 0 on success, -1 on failure
+ **************************************************************************/
+int GWPEpon_NlDump(int fd, int type, const void *body, int len, GWPEpon_NlCb cb, void *arg)
+{
+    char buf[GWPEPON_NL_RECV_LEN] __attribute__((aligned(NLMSG_ALIGNTO)));
+    struct
+    {
+        struct nlmsghdr nlh;
+        char body[64];
+    } req;
+    struct nlmsghdr *nlh;
+    int stop = 0;
+    int n;
+
+    if (NLMSG_ALIGN(len) > (int) sizeof(req.body))
+        return -1;
+    memset(&req, 0, sizeof(req));
+    req.nlh.nlmsg_len = NLMSG_LENGTH(len);
+    req.nlh.nlmsg_type = type;
+    req.nlh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    req.nlh.nlmsg_seq = ++nl_seq;
+    memcpy(NLMSG_DATA(&req.nlh), body, len);
+    if (GWPEpon_NlSend(fd, &req, req.nlh.nlmsg_len) < 0)
+        return -1;
+
+    for (;;)
+    {
+        n = GWPEpon_NlRecv(fd, buf, sizeof(buf));
+        if (n <= 0)
+            return -1;
+        for (nlh = (struct nlmsghdr *) buf; NLMSG_OK(nlh, (unsigned int) n); nlh = NLMSG_NEXT(nlh, n))
+        {
+            if (nlh->nlmsg_seq != req.nlh.nlmsg_seq)
+                continue;
+            if (nlh->nlmsg_type == NLMSG_DONE)
+                return 0;
+            if (nlh->nlmsg_type == NLMSG_ERROR)
+                return -1;
+            // Keep reading after a stop, the rest of the dump must be drained
+            if (!stop)
+                stop = cb(nlh, arg);
+        }
+    }
+}
+
+void GWPEpon_NlParseAttrs(struct rtattr **tb, int max, struct rtattr *rta, int len)
+{
+    memset(tb, 0, sizeof(struct rtattr *) * (max + 1));
+    for (; RTA_OK(rta, len); rta = RTA_NEXT(rta, len))
+    {
+        if (rta->rta_type <= max)
+            tb[rta->rta_type] = rta;
+    }
+}
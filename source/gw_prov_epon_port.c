@@ -0,0 +1,199 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*! \file gw_prov_epon_port.c
+    \brief LAN port enable/disable and bridge membership over netlink
+*/
+
+/**************************************************************************/
+/*      INCLUDES:                                                         */
+/**************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <net/if.h>
+#include <syscfg/syscfg.h>
+#include "gw_prov_epon_action.h"
+#include "gw_prov_epon_ctx.h"
+#include "gw_prov_epon_evloop.h"
+#include "gw_prov_epon_log.h"
+#include "gw_prov_epon_member.h"
+#include "gw_prov_epon_netlink.h"
+#include "gw_prov_epon_port.h"
+
+/**************************************************************************/
+/*      LOCAL DECLARATIONS:                                               */
+/**************************************************************************/
+typedef struct
+{
+    const char *name;
+    const char *event;
+    const char *ifnames_key;
+    const char *ifnames_default;
+    const char *enable_action;      /* lan_handler.sh fallbacks */
+    const char *disable_action;
+} GWPEpon_PortClass;
+
+/**************************************************************************/
+/*      LOCAL VARIABLES:                                                  */
+/**************************************************************************/
+static const GWPEpon_PortClass port_classes[] =
+{
+    { "eth",  "eth_enabled",  "lan_ethernet_physical_ifnames", "eth1 eth2 eth3", "eth_enable",  "eth_disable"  },
+    { "moca", "moca_enabled", "lan_moca_physical_ifnames",     "moca0",          "moca_enable", "moca_disable" },
+    { "wl",   "wl_enabled",   "lan_wl_physical_ifnames",       "wl0 wl1",        "wl_enable",   "wl_disable"   },
+};
+
+#define PORT_CLASSES     (int) (sizeof(port_classes) / sizeof(port_classes[0]))
+
+static GWPEPON_THREAD_LOCAL GWPEpon_PortStats port_stats[PORT_CLASSES];
+static GWPEPON_THREAD_LOCAL GWPEpon_NlBatch port_batch;
+
+/**************************************************************************/
+/*      LOCAL FUNCTIONS:                                                  */
+/**************************************************************************/
+static int GWPEpon_PortFallback(int cls, int enable, const char *why)
+{
+    const char *action = enable ? port_classes[cls].enable_action : port_classes[cls].disable_action;
+    char cmd[64];
+
+    GWPROVEPONLOG(WARNING, "%s ports: %s, running lan_handler.sh %s\n", port_classes[cls].name, why, action)
+    port_stats[cls].fallbacks++;
+    snprintf(cmd, sizeof(cmd), "sh /usr/ccsp/lan_handler.sh %s", action);
+    return (GWPEpon_ActionRunAsync(action, cmd, NULL, NULL) < 0) ? -1 : 0;
+}
+
+/* 1 when the port is enslaved to a bridge, whichever */
+static int GWPEpon_PortEnslaved(const char *ifname)
+{
+    char link[64];
+
+    snprintf(link, sizeof(link), "/sys/class/net/%s/master", ifname);
+    return access(link, F_OK) == 0;
+}
+
+/* Queue the change of one port, 1 when the port does not exist */
+static int GWPEpon_PortQueue(const char *ifname, int master, int enable)
+{
+    struct ifinfomsg ifi;
+    struct nlmsghdr *nlh;
+    int index = (int) if_nametoindex(ifname);
+
+    if (index <= 0)
+        return 1;
+    // The XHS port is moved between bridges by the member module, and a
+    // port already in a bridge stays there: only its link state changes
+    if (!enable || strcmp(ifname, GWPEPON_MEMBER_PORT) == 0 || GWPEpon_PortEnslaved(ifname))
+        master = 0;
+
+    memset(&ifi, 0, sizeof(ifi));
+    ifi.ifi_family = AF_UNSPEC;
+    ifi.ifi_index = index;
+    ifi.ifi_change = IFF_UP;
+    ifi.ifi_flags = enable ? IFF_UP : 0;
+    // One request sets the link state, and the bridge membership if needed
+    if ((nlh = GWPEpon_NlBatchAdd(&port_batch, RTM_NEWLINK, 0, &ifi, sizeof(ifi))) == NULL ||
+        (master > 0 && GWPEpon_NlAddAttr(&port_batch, nlh, IFLA_MASTER, &master, sizeof(master)) < 0))
+        return -1;
+    return 0;
+}
+
+/**************************************************************************/
+/*! \fn int GWPEpon_PortSet(const char *event, int enable)
+ **************************************************************************
+ *  \brief Enable or disable the LAN ports of the class of event
+ *  \return 0 on success, -1 on failure
+ **************************************************************************/
+int GWPEpon_PortSet(const char *event, int enable)
+{
+    char list[GWPEPON_PORT_LIST_LEN];
+    char bridge[IF_NAMESIZE];
+    char *ifname, *save;
+    unsigned long long start;
+    int master = 0;
+    int missing = 0;
+    int ports = 0;
+    int cls, fd, ret;
+
+    for (cls = 0; cls < PORT_CLASSES; cls++)
+    {
+        if (strcmp(port_classes[cls].event, event) == 0)
+            break;
+    }
+    if (cls == PORT_CLASSES || (enable != 0 && enable != 1))
+        return -1;
+
+    if (enable)
+        port_stats[cls].enables++;
+    else
+        port_stats[cls].disables++;
+    // A fallback of the opposite request still running would undo this one
+    GWPEpon_ActionCancel(enable ? port_classes[cls].enable_action : port_classes[cls].disable_action);
+
+    if (syscfg_get(NULL, port_classes[cls].ifnames_key, list, sizeof(list)) != 0 || list[0] == '\0')
+        snprintf(list, sizeof(list), "%s", port_classes[cls].ifnames_default);
+    if (syscfg_get(NULL, "lan_ifname", bridge, sizeof(bridge)) != 0 || bridge[0] == '\0')
+        snprintf(bridge, sizeof(bridge), "brlan0");
+    if (enable && (master = (int) if_nametoindex(bridge)) <= 0)
+        return GWPEpon_PortFallback(cls, enable, "no LAN bridge yet");
+
+    start = GWPEpon_NowUs();
+    GWPEpon_NlBatchInit(&port_batch);
+    for (ifname = strtok_r(list, " ,", &save); ifname != NULL && ports < GWPEPON_PORT_MAX;
+         ifname = strtok_r(NULL, " ,", &save))
+    {
+        ret = GWPEpon_PortQueue(ifname, master, enable);
+        if (ret < 0)
+            return GWPEpon_PortFallback(cls, enable, "netlink batch overflow");
+        if (ret > 0)
+            missing++;
+        else
+            ports++;
+    }
+
+    if (ports > 0)
+    {
+        if ((fd = GWPEpon_NlOpen(0)) < 0)
+            return GWPEpon_PortFallback(cls, enable, "netlink unavailable");
+        ret = GWPEpon_NlBatchSend(fd, &port_batch);
+        close(fd);
+        if (ret != 0)
+            return GWPEpon_PortFallback(cls, enable, "netlink refused a port change");
+
+        port_stats[cls].ports += ports;
+        port_stats[cls].last_us = GWPEpon_NowUs() - start;
+        if (port_stats[cls].last_us > port_stats[cls].max_us)
+            port_stats[cls].max_us = port_stats[cls].last_us;
+        GWPROVEPONLOG(INFO, "%s ports %s: %d changed in %llu us\n", port_classes[cls].name,
+                      enable ? "enabled" : "disabled", ports, port_stats[cls].last_us)
+    }
+
+    // The driver creates the interface, bringing it up is a vendor step
+    if (missing > 0 && enable)
+        return GWPEpon_PortFallback(cls, enable, "port not created yet");
+    return 0;
+}
+
+const GWPEpon_PortStats *GWPEpon_PortGetStats(int idx, const char **cls)
+{
+    if (idx < 0 || idx >= PORT_CLASSES)
+        return NULL;
+    *cls = port_classes[idx].name;
+    return &port_stats[idx];
+}
@@ -0,0 +1,324 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*! \file gw_prov_epon_route.c
+    \brief static route programming over netlink
+*/
+
+/**************************************************************************/
+/*      INCLUDES:                                                         */
+/**************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <syscfg/syscfg.h>
+#include "gw_prov_epon_action.h"
+#include "gw_prov_epon_ctx.h"
+#include "gw_prov_epon_evloop.h"
+#include "gw_prov_epon_log.h"
+#include "gw_prov_epon_netlink.h"
+#include "gw_prov_epon_route.h"
+
+/**************************************************************************/
+/*      LOCAL DECLARATIONS:                                               */
+/**************************************************************************/
+typedef struct
+{
+    struct in_addr dst;
+    struct in_addr gw;          /* INADDR_ANY for a route on the link */
+    unsigned char dst_len;
+    int oif;
+    unsigned int metric;
+} GWPEpon_Route;
+
+typedef struct
+{
+    int count;
+    GWPEpon_Route routes[GWPEPON_ROUTE_MAX];
+} GWPEpon_RouteSet;
+
+/**************************************************************************/
+/*      LOCAL VARIABLES:                                                  */
+/**************************************************************************/
+static GWPEPON_THREAD_LOCAL GWPEpon_RouteStats route_stats;
+static GWPEPON_THREAD_LOCAL GWPEpon_NlBatch route_batch;
+
+/**************************************************************************/
+/*      LOCAL FUNCTIONS:                                                  */
+/**************************************************************************/
+static int GWPEpon_RouteSame(const GWPEpon_Route *a, const GWPEpon_Route *b)
+{
+    return a->dst.s_addr == b->dst.s_addr && a->dst_len == b->dst_len && a->gw.s_addr == b->gw.s_addr &&
+           a->oif == b->oif && a->metric == b->metric;
+}
+
+static int GWPEpon_RouteFind(const GWPEpon_RouteSet *set, const GWPEpon_Route *route)
+{
+    int i;
+
+    for (i = 0; i < set->count; i++)
+    {
+        if (GWPEpon_RouteSame(&set->routes[i], route))
+            return i;
+    }
+    return -1;
+}
+
+static void GWPEpon_RouteLanIfname(char *out, int outlen)
+{
+    if (syscfg_get(NULL, "lan_ifname", out, outlen) != 0 || out[0] == '\0')
+        snprintf(out, outlen, "brlan0");
+}
+
+/* The WAN interface and the LAN bridges, where the static routes live */
+static int GWPEpon_RouteManaged(int oif)
+{
+    char ifname[IF_NAMESIZE];
+
+    if (if_indextoname(oif, ifname) == NULL)
+        return 0;
+    return strcmp(ifname, GWPEpon_CtxCurrent()->ifname) == 0 ||
+           strncmp(ifname, GWPEPON_ROUTE_LAN_BRIDGES, strlen(GWPEPON_ROUTE_LAN_BRIDGES)) == 0;
+}
+
+static void GWPEpon_RouteReadConfig(GWPEpon_RouteSet *set)
+{
+    char ns[32], key[32], iface[IF_NAMESIZE], buf[32];
+    struct in_addr mask;
+    GWPEpon_Route *route;
+    int count, i;
+
+    set->count = 0;
+    if (syscfg_get(NULL, GWPEPON_ROUTE_COUNT_KEY, buf, sizeof(buf)) != 0)
+        return;
+    count = atoi(buf);
+
+    for (i = 1; i <= count && set->count < GWPEPON_ROUTE_MAX; i++)
+    {
+        route = &set->routes[set->count];
+        memset(route, 0, sizeof(*route));
+
+        snprintf(key, sizeof(key), "sr_%d", i);
+        if (syscfg_get(NULL, key, ns, sizeof(ns)) != 0 || ns[0] == '\0')
+            continue;
+        if (syscfg_get(ns, "dest", buf, sizeof(buf)) != 0 || inet_pton(AF_INET, buf, &route->dst) != 1 ||
+            syscfg_get(ns, "netmask", buf, sizeof(buf)) != 0 || inet_pton(AF_INET, buf, &mask) != 1)
+        {
+            GWPROVEPONLOG(WARNING, "static route %s: invalid destination\n", ns)
+            continue;
+        }
+        route->dst_len = (unsigned char) __builtin_popcount(mask.s_addr);
+        route->dst.s_addr &= mask.s_addr;
+        if (syscfg_get(ns, "gw", buf, sizeof(buf)) == 0 && buf[0] != '\0' &&
+            inet_pton(AF_INET, buf, &route->gw) != 1)
+        {
+            GWPROVEPONLOG(WARNING, "static route %s: invalid gateway %s\n", ns, buf)
+            continue;
+        }
+
+        if (syscfg_get(ns, "interface", iface, sizeof(iface)) != 0 || strcmp(iface, "wan") == 0)
+            snprintf(iface, sizeof(iface), "%s", GWPEpon_CtxCurrent()->ifname);
+        else if (strcmp(iface, "lan") == 0)
+            GWPEpon_RouteLanIfname(iface, sizeof(iface));
+        route->oif = (int) if_nametoindex(iface);
+        if (route->oif == 0)
+        {
+            // Installed by the next restart event once the interface exists
+            GWPROVEPONLOG(INFO, "static route %s: no interface %s yet\n", ns, iface)
+            continue;
+        }
+        set->count++;
+    }
+}
+
+static int GWPEpon_RouteDumpCb(const struct nlmsghdr *nlh, void *arg)
+{
+    GWPEpon_RouteSet *set = (GWPEpon_RouteSet *) arg;
+    const struct rtmsg *rtm = (const struct rtmsg *) NLMSG_DATA(nlh);
+    struct rtattr *tb[RTA_MAX + 1];
+    GWPEpon_Route *route;
+    unsigned int table;
+
+    if (nlh->nlmsg_type != RTM_NEWROUTE || rtm->rtm_family != AF_INET ||
+        rtm->rtm_protocol != GWPEPON_ROUTE_PROTO || rtm->rtm_type != RTN_UNICAST)
+        return 0;
+    GWPEpon_NlParseAttrs(tb, RTA_MAX, RTM_RTA(rtm), RTM_PAYLOAD(nlh));
+    table = tb[RTA_TABLE] ? *(unsigned int *) RTA_DATA(tb[RTA_TABLE]) : rtm->rtm_table;
+    if (table != RT_TABLE_MAIN || tb[RTA_OIF] == NULL || !GWPEpon_RouteManaged(*(int *) RTA_DATA(tb[RTA_OIF])))
+        return 0;
+    if (set->count == GWPEPON_ROUTE_MAX)
+        return 1;
+
+    route = &set->routes[set->count++];
+    memset(route, 0, sizeof(*route));
+    route->dst_len = rtm->rtm_dst_len;
+    route->oif = *(int *) RTA_DATA(tb[RTA_OIF]);
+    if (tb[RTA_DST])
+        memcpy(&route->dst, RTA_DATA(tb[RTA_DST]), sizeof(route->dst));
+    if (tb[RTA_GATEWAY])
+        memcpy(&route->gw, RTA_DATA(tb[RTA_GATEWAY]), sizeof(route->gw));
+    if (tb[RTA_PRIORITY])
+        route->metric = *(unsigned int *) RTA_DATA(tb[RTA_PRIORITY]);
+    return 0;
+}
+
+/* Our routes currently in the main table */
+static int GWPEpon_RouteDump(int fd, GWPEpon_RouteSet *set)
+{
+    struct rtmsg rtm;
+
+    memset(&rtm, 0, sizeof(rtm));
+    rtm.rtm_family = AF_INET;
+    set->count = 0;
+    return GWPEpon_NlDump(fd, RTM_GETROUTE, &rtm, sizeof(rtm), GWPEpon_RouteDumpCb, set);
+}
+
+static int GWPEpon_RouteQueue(GWPEpon_NlBatch *batch, int type, const GWPEpon_Route *route)
+{
+    struct rtmsg rtm;
+    struct nlmsghdr *nlh;
+    int failed = 0;
+
+    memset(&rtm, 0, sizeof(rtm));
+    rtm.rtm_family = AF_INET;
+    rtm.rtm_dst_len = route->dst_len;
+    rtm.rtm_table = RT_TABLE_MAIN;
+    rtm.rtm_protocol = GWPEPON_ROUTE_PROTO;
+    rtm.rtm_scope = route->gw.s_addr ? RT_SCOPE_UNIVERSE : RT_SCOPE_LINK;
+    rtm.rtm_type = RTN_UNICAST;
+    if (type == RTM_DELROUTE)
+        rtm.rtm_scope = RT_SCOPE_NOWHERE;
+
+    nlh = GWPEpon_NlBatchAdd(batch, type, (type == RTM_NEWROUTE) ? NLM_F_CREATE | NLM_F_REPLACE : 0,
+                             &rtm, sizeof(rtm));
+    if (nlh == NULL)
+        return -1;
+    failed |= GWPEpon_NlAddAttr(batch, nlh, RTA_DST, &route->dst, sizeof(route->dst));
+    failed |= GWPEpon_NlAddAttr(batch, nlh, RTA_OIF, &route->oif, sizeof(route->oif));
+    if (route->gw.s_addr)
+        failed |= GWPEpon_NlAddAttr(batch, nlh, RTA_GATEWAY, &route->gw, sizeof(route->gw));
+    if (route->metric)
+        failed |= GWPEpon_NlAddAttr(batch, nlh, RTA_PRIORITY, &route->metric, sizeof(route->metric));
+    return failed;
+}
+
+/**************************************************************************/
+/*! \fn int GWPEpon_RouteApplyStatic(void)
+ **************************************************************************
+ *  \brief Bring the kernel static routes in line with syscfg. Falls back
+ *    to service_routed.sh when netlink cannot be used.
+ *  \return 0 on success, -1 when a route could not be programmed
+ **************************************************************************/
+int GWPEpon_RouteApplyStatic(void)
+{
+    unsigned long long start = GWPEpon_NowUs();
+    GWPEpon_RouteSet wanted, installed, now;
+    int added = 0, deleted = 0;
+    int failed = 0;
+    int fd, i;
+
+    route_stats.applies++;
+    fd = GWPEpon_NlOpen(0);
+    if (fd < 0 || GWPEpon_RouteDump(fd, &installed) < 0)
+    {
+        GWPROVEPONLOG(ERROR, "cannot read the routing table, falling back to service_routed.sh\n")
+        if (fd >= 0)
+            close(fd);
+        route_stats.fallbacks++;
+        return GWPEpon_ActionRun("routed", "sh /etc/utopia/service.d/service_routed.sh staticroute-restart");
+    }
+    GWPEpon_RouteReadConfig(&wanted);
+
+    GWPEpon_NlBatchInit(&route_batch);
+    for (i = 0; i < installed.count && failed == 0; i++)
+    {
+        if (GWPEpon_RouteFind(&wanted, &installed.routes[i]) >= 0)
+            continue;
+        failed = GWPEpon_RouteQueue(&route_batch, RTM_DELROUTE, &installed.routes[i]);
+        deleted++;
+    }
+    for (i = 0; i < wanted.count && failed == 0; i++)
+    {
+        if (GWPEpon_RouteFind(&installed, &wanted.routes[i]) >= 0)
+            continue;
+        failed = GWPEpon_RouteQueue(&route_batch, RTM_NEWROUTE, &wanted.routes[i]);
+        added++;
+    }
+    if (failed == 0)
+        failed = GWPEpon_NlBatchSend(fd, &route_batch);
+    else
+        GWPROVEPONLOG(ERROR, "static route batch overflow\n")
+    close(fd);
+
+    // The kernel applies the requests one by one, a refused one leaves the
+    // others applied: count what the table holds now, the next apply starts
+    // from there
+    if (failed != 0)
+    {
+        route_stats.partial++;
+        if ((fd = GWPEpon_NlOpen(0)) >= 0 && GWPEpon_RouteDump(fd, &now) == 0)
+        {
+            added = deleted = failed = 0;
+            for (i = 0; i < wanted.count; i++)
+            {
+                if (GWPEpon_RouteFind(&now, &wanted.routes[i]) < 0)
+                    failed++;
+                else if (GWPEpon_RouteFind(&installed, &wanted.routes[i]) < 0)
+                    added++;
+            }
+            for (i = 0; i < installed.count; i++)
+            {
+                if (GWPEpon_RouteFind(&now, &installed.routes[i]) < 0)
+                    deleted++;
+                else if (GWPEpon_RouteFind(&wanted, &installed.routes[i]) < 0)
+                    failed++;
+            }
+        }
+        else
+        {
+            GWPROVEPONLOG(ERROR, "cannot read the routing table back, static routes in an unknown state\n")
+            failed = added + deleted;
+            added = deleted = 0;
+        }
+        if (fd >= 0)
+            close(fd);
+    }
+
+    route_stats.last_us = GWPEpon_NowUs() - start;
+    if (route_stats.last_us > route_stats.max_us)
+        route_stats.max_us = route_stats.last_us;
+    route_stats.added += added;
+    route_stats.deleted += deleted;
+    route_stats.failed += failed;
+    if (added == 0 && deleted == 0 && failed == 0)
+        route_stats.unchanged++;
+
+    GWPROVEPONLOG(INFO, "static routes: %d configured, %d added, %d deleted, %d failed in %llu us\n",
+                  wanted.count, added, deleted, failed, route_stats.last_us)
+    return failed ? -1 : 0;
+}
+
+const GWPEpon_RouteStats *GWPEpon_RouteGetStats(void)
+{
+    return &route_stats;
+}
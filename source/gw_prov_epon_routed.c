@@ -0,0 +1,541 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*! \file gw_prov_epon_routed.c
+    \brief zebra/ripd configuration over their vty sockets
+
+    A vtysh client writes each command NUL terminated and the daemon
+    answers with the command output followed by three NUL bytes and the
+    command status, 0 for success. Sessions are short and synchronous,
+    bounded by GWPEPON_ROUTED_TIMEOUT_MS per exchange.
+*/
+
+/**************************************************************************/
+/*      INCLUDES:                                                         */
+/**************************************************************************/
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <net/if.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <syscfg/syscfg.h>
+#include "gw_prov_epon.h"
+#include "gw_prov_epon_action.h"
+#include "gw_prov_epon_ctx.h"
+#include "gw_prov_epon_log.h"
+#include "gw_prov_epon_routed.h"
+
+/**************************************************************************/
+/*      LOCAL DECLARATIONS:                                               */
+/**************************************************************************/
+typedef struct
+{
+    char section[GWPEPON_ROUTED_SECTION_LEN];
+    char cmd[GWPEPON_ROUTED_LINE_LEN];
+} GWPEpon_RoutedLine;
+
+typedef struct
+{
+    int count;
+    GWPEpon_RoutedLine lines[GWPEPON_ROUTED_MAX_LINES];
+} GWPEpon_RoutedConf;
+
+typedef struct
+{
+    const char *name;
+    const char *vty;
+    const char *restart_event;
+    void (*build)(GWPEpon_RoutedConf *conf);
+    int (*owns)(const char *section, const char *cmd);  /* lines build may render */
+} GWPEpon_RoutedDaemon;
+
+typedef struct
+{
+    int valid;                  /* applied is what the daemon runs */
+    GWPEpon_RoutedConf applied;
+    GWPEpon_RoutedStats stats;
+} GWPEpon_RoutedState;
+
+static void GWPEpon_RoutedBuildZebra(GWPEpon_RoutedConf *conf);
+static void GWPEpon_RoutedBuildRipd(GWPEpon_RoutedConf *conf);
+static int  GWPEpon_RoutedOwnsZebra(const char *section, const char *cmd);
+static int  GWPEpon_RoutedOwnsRipd(const char *section, const char *cmd);
+
+/**************************************************************************/
+/*      LOCAL VARIABLES:                                                  */
+/**************************************************************************/
+static const GWPEpon_RoutedDaemon routed_daemons[] =
+{
+    { "zebra", GWPEPON_ROUTED_ZEBRA_VTY, "zebra-restart", GWPEpon_RoutedBuildZebra, GWPEpon_RoutedOwnsZebra },
+    { "ripd",  GWPEPON_ROUTED_RIPD_VTY,  "ripd-restart",  GWPEpon_RoutedBuildRipd,  GWPEpon_RoutedOwnsRipd },
+};
+
+/* Interface commands of zebra rendered by GWPEpon_RoutedBuildZebra, a
+   trailing space takes any argument */
+static const char *routed_zebra_cmds[] =
+{
+    "ipv6 nd suppress-ra",
+    "no ipv6 nd suppress-ra",
+    "ipv6 nd prefix ",
+    "ipv6 nd rdnss ",
+    NULL
+};
+
+#define ROUTED_DAEMONS   ((int) (sizeof(routed_daemons) / sizeof(routed_daemons[0])))
+
+static GWPEPON_THREAD_LOCAL GWPEpon_RoutedState routed_state[ROUTED_DAEMONS];
+static GWPEPON_THREAD_LOCAL char routed_show[GWPEPON_ROUTED_SHOW_LEN];
+
+/**************************************************************************/
+/*      LOCAL FUNCTIONS:                                                  */
+/**************************************************************************/
+static void GWPEpon_RoutedAdd(GWPEpon_RoutedConf *conf, const char *section, const char *cmd)
+{
+    GWPEpon_RoutedLine *line;
+
+    if (conf->count == GWPEPON_ROUTED_MAX_LINES)
+        return;
+    line = &conf->lines[conf->count++];
+    snprintf(line->section, sizeof(line->section), "%s", section);
+    snprintf(line->cmd, sizeof(line->cmd), "%s", cmd);
+}
+
+static int GWPEpon_RoutedHas(const GWPEpon_RoutedConf *conf, const char *section, const char *cmd)
+{
+    int i;
+
+    for (i = 0; i < conf->count; i++)
+    {
+        if (strcmp(conf->lines[i].section, section) == 0 && strcmp(conf->lines[i].cmd, cmd) == 0)
+            return 1;
+    }
+    return 0;
+}
+
+static void GWPEpon_RoutedNegate(const char *cmd, char *out, int outlen)
+{
+    if (strncmp(cmd, "no ", 3) == 0)
+        snprintf(out, outlen, "%s", cmd + 3);
+    else
+        snprintf(out, outlen, "no %s", cmd);
+}
+
+static int GWPEpon_RoutedTupleIs(const char *name, const char *val)
+{
+    unsigned char buf[32] = "";
+
+    return GWPEpon_SyseventGetStr(name, buf, sizeof(buf)) == 0 && strcmp((char *) buf, val) == 0;
+}
+
+static void GWPEpon_RoutedLanSection(char *section, int len)
+{
+    char lan_if[IFNAMSIZ] = "";
+
+    if (syscfg_get(NULL, "lan_ifname", lan_if, sizeof(lan_if)) != 0 || lan_if[0] == '\0')
+        snprintf(lan_if, sizeof(lan_if), "brlan0");
+    snprintf(section, len, "interface %s", lan_if);
+}
+
+static void GWPEpon_RoutedBuildZebra(GWPEpon_RoutedConf *conf)
+{
+    unsigned char prefix[64] = "";
+    unsigned char dns[256] = "";
+    char section[GWPEPON_ROUTED_SECTION_LEN];
+    char cmd[GWPEPON_ROUTED_LINE_LEN];
+    char *server, *saveptr = NULL;
+
+    GWPEpon_RoutedLanSection(section, sizeof(section));
+
+    GWPEpon_SyseventGetStr("ipv6_prefix", prefix, sizeof(prefix));
+    if (!GWPEpon_RoutedTupleIs("lan-status", "started") || prefix[0] == '\0')
+    {
+        GWPEpon_RoutedAdd(conf, section, "ipv6 nd suppress-ra");
+        return;
+    }
+
+    GWPEpon_RoutedAdd(conf, section, "no ipv6 nd suppress-ra");
+    snprintf(cmd, sizeof(cmd), "ipv6 nd prefix %s", (char *) prefix);
+    GWPEpon_RoutedAdd(conf, section, cmd);
+
+    GWPEpon_SyseventGetStr("ipv6_nameserver", dns, sizeof(dns));
+    for (server = strtok_r((char *) dns, " ,", &saveptr); server; server = strtok_r(NULL, " ,", &saveptr))
+    {
+        snprintf(cmd, sizeof(cmd), "ipv6 nd rdnss %s", server);
+        GWPEpon_RoutedAdd(conf, section, cmd);
+    }
+}
+
+static void GWPEpon_RoutedBuildRipd(GWPEpon_RoutedConf *conf)
+{
+    char enabled[8] = "";
+    char cmd[GWPEPON_ROUTED_LINE_LEN];
+
+    if (syscfg_get(NULL, "rip_enabled", enabled, sizeof(enabled)) != 0 || strcmp(enabled, "1") != 0 ||
+        !GWPEpon_RoutedTupleIs("wan-status", "started"))
+        return;
+
+    snprintf(cmd, sizeof(cmd), "network %s", GWPEpon_CtxCurrent()->ifname);
+    GWPEpon_RoutedAdd(conf, "router rip", cmd);
+    GWPEpon_RoutedAdd(conf, "router rip", "redistribute connected");
+}
+
+static int GWPEpon_RoutedOwnsZebra(const char *section, const char *cmd)
+{
+    char lan[GWPEPON_ROUTED_SECTION_LEN];
+    size_t len;
+    int i;
+
+    GWPEpon_RoutedLanSection(lan, sizeof(lan));
+    if (strcmp(section, lan) != 0)
+        return 0;
+    for (i = 0; routed_zebra_cmds[i] != NULL; i++)
+    {
+        len = strlen(routed_zebra_cmds[i]);
+        if (strncmp(cmd, routed_zebra_cmds[i], len) == 0 && (routed_zebra_cmds[i][len - 1] == ' ' || cmd[len] == '\0'))
+            return 1;
+    }
+    return 0;
+}
+
+static int GWPEpon_RoutedOwnsRipd(const char *section, const char *cmd)
+{
+    char network[GWPEPON_ROUTED_LINE_LEN];
+
+    if (strcmp(section, "router rip") != 0)
+        return 0;
+    snprintf(network, sizeof(network), "network %s", GWPEpon_CtxCurrent()->ifname);
+    return strcmp(cmd, network) == 0 || strcmp(cmd, "redistribute connected") == 0;
+}
+
+/* Commands that turn applied into wanted, grouped by section */
+static void GWPEpon_RoutedDiff(const GWPEpon_RoutedConf *applied, const GWPEpon_RoutedConf *wanted,
+                               GWPEpon_RoutedConf *delta)
+{
+    char negated[GWPEPON_ROUTED_LINE_LEN];
+    const GWPEpon_RoutedLine *line;
+    GWPEpon_RoutedConf changes;
+    int i, j;
+
+    changes.count = 0;
+    for (i = 0; i < applied->count; i++)
+    {
+        line = &applied->lines[i];
+        if (GWPEpon_RoutedHas(wanted, line->section, line->cmd))
+            continue;
+        GWPEpon_RoutedNegate(line->cmd, negated, sizeof(negated));
+        // "suppress-ra" replacing "no suppress-ra" is sent once, as an addition
+        if (!GWPEpon_RoutedHas(wanted, line->section, negated))
+            GWPEpon_RoutedAdd(&changes, line->section, negated);
+    }
+    for (i = 0; i < wanted->count; i++)
+    {
+        line = &wanted->lines[i];
+        if (!GWPEpon_RoutedHas(applied, line->section, line->cmd))
+            GWPEpon_RoutedAdd(&changes, line->section, line->cmd);
+    }
+
+    delta->count = 0;
+    for (i = 0; i < changes.count; i++)
+    {
+        for (j = 0; j < i && strcmp(changes.lines[j].section, changes.lines[i].section) != 0; j++)
+            ;
+        if (j < i)
+            continue;
+        for (j = i; j < changes.count; j++)
+        {
+            if (strcmp(changes.lines[j].section, changes.lines[i].section) == 0)
+                delta->lines[delta->count++] = changes.lines[j];
+        }
+    }
+}
+
+static int GWPEpon_RoutedVtyOpen(const char *path)
+{
+    struct sockaddr_un addr;
+    struct timeval tv;
+    int fd;
+
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+
+    tv.tv_sec = GWPEPON_ROUTED_TIMEOUT_MS / 1000;
+    tv.tv_usec = (GWPEPON_ROUTED_TIMEOUT_MS % 1000) * 1000;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path);
+    if (connect(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0)
+    {
+        int err = errno;
+
+        close(fd);
+        errno = err;
+        return -1;
+    }
+    return fd;
+}
+
+/**************************************************************************/
+/*! \fn static int GWPEpon_RoutedVtyExec(int fd, const char *cmd, char *out, int outlen)
+ **************************************************************************
+ *  \brief Send one command and consume its answer, copied to out unless
+ *    out is NULL
+ *  \return command status (0 success), -1 when the session broke or the
+ *    answer did not fit out
+ **************************************************************************/
+static int GWPEpon_RoutedVtyExec(int fd, const char *cmd, char *out, int outlen)
+{
+    unsigned char buf[512];
+    unsigned char tail[4] = { 1, 1, 1, 0 };
+    size_t len = strlen(cmd) + 1;
+    size_t off = 0;
+    size_t total = 0;
+    ssize_t n;
+    int i;
+
+    while (off < len)
+    {
+        n = write(fd, cmd + off, len - off);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+        off += n;
+    }
+
+    for (;;)
+    {
+        n = read(fd, buf, sizeof(buf));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+        // The trailer may be split across reads, keep the last 4 bytes
+        for (i = 0; i < n; i++)
+        {
+            memmove(tail, tail + 1, 3);
+            tail[3] = buf[i];
+            if (out != NULL && total < (size_t) outlen)
+                out[total] = (char) buf[i];
+            total++;
+        }
+        if (tail[0] == 0 && tail[1] == 0 && tail[2] == 0)
+        {
+            if (out == NULL)
+                return tail[3];
+            if (total - 4 >= (size_t) outlen)
+                return -1;
+            out[total - 4] = '\0';
+            return tail[3];
+        }
+    }
+}
+
+/**************************************************************************/
+/*! \fn static int GWPEpon_RoutedPush(const GWPEpon_RoutedDaemon *daemon,
+ *        const GWPEpon_RoutedConf *delta)
+ **************************************************************************
+ *  \brief Apply delta to the running daemon in a configure terminal session
+ *  \return 0 on success, -1 when the daemon is down or refused a command
+ **************************************************************************/
+static int GWPEpon_RoutedPush(const GWPEpon_RoutedDaemon *daemon, const GWPEpon_RoutedConf *delta)
+{
+    const char *section = NULL;
+    const char *failed = NULL;
+    int fd;
+    int i;
+
+    fd = GWPEpon_RoutedVtyOpen(daemon->vty);
+    if (fd < 0)
+    {
+        GWPROVEPONLOG(WARNING, "%s vty %s unavailable: %s\n", daemon->name, daemon->vty, strerror(errno))
+        return -1;
+    }
+
+    // "enable" fails on a session that starts enabled, only the transport matters
+    if (GWPEpon_RoutedVtyExec(fd, "enable", NULL, 0) < 0 || GWPEpon_RoutedVtyExec(fd, "configure terminal", NULL, 0) != 0)
+        failed = "configure terminal";
+    for (i = 0; failed == NULL && i < delta->count; i++)
+    {
+        const GWPEpon_RoutedLine *line = &delta->lines[i];
+
+        if (section == NULL || strcmp(section, line->section) != 0)
+        {
+            if (section != NULL && GWPEpon_RoutedVtyExec(fd, "exit", NULL, 0) != 0)
+                failed = "exit";
+            else if (GWPEpon_RoutedVtyExec(fd, line->section, NULL, 0) != 0)
+                failed = line->section;
+            section = line->section;
+        }
+        if (failed == NULL && GWPEpon_RoutedVtyExec(fd, line->cmd, NULL, 0) != 0)
+            failed = line->cmd;
+    }
+    if (failed == NULL && GWPEpon_RoutedVtyExec(fd, "end", NULL, 0) != 0)
+        failed = "end";
+    close(fd);
+
+    if (failed)
+    {
+        GWPROVEPONLOG(ERROR, "%s refused \"%s\"\n", daemon->name, failed)
+        return -1;
+    }
+    return 0;
+}
+
+/* Lines of a configuration in the daemon format that the adapter renders */
+static void GWPEpon_RoutedParse(const GWPEpon_RoutedDaemon *daemon, char *text, GWPEpon_RoutedConf *conf)
+{
+    char section[GWPEPON_ROUTED_SECTION_LEN] = "";
+    char *line, *saveptr = NULL;
+
+    conf->count = 0;
+    for (line = strtok_r(text, "\r\n", &saveptr); line; line = strtok_r(NULL, "\r\n", &saveptr))
+    {
+        if (line[0] == '!')
+            section[0] = '\0';
+        else if (line[0] != ' ')
+            snprintf(section, sizeof(section), "%s", line);
+        else if (section[0] != '\0' && daemon->owns(section, line + strspn(line, " ")))
+            GWPEpon_RoutedAdd(conf, section, line + strspn(line, " "));
+    }
+}
+
+/**************************************************************************/
+/*! \fn static int GWPEpon_RoutedReadBack(const GWPEpon_RoutedDaemon *daemon,
+ *        GWPEpon_RoutedConf *conf)
+ **************************************************************************
+ *  \brief Running configuration of the daemon, reduced to the lines the
+ *    adapter renders. Lines of the same sections that the adapter does
+ *    not render are left to whoever configured them.
+ *  \return 0 on success, -1 when the daemon did not answer
+ **************************************************************************/
+static int GWPEpon_RoutedReadBack(const GWPEpon_RoutedDaemon *daemon, GWPEpon_RoutedConf *conf)
+{
+    int fd, ret;
+
+    fd = GWPEpon_RoutedVtyOpen(daemon->vty);
+    if (fd < 0)
+        return -1;
+    GWPEpon_RoutedVtyExec(fd, "enable", NULL, 0);
+    ret = GWPEpon_RoutedVtyExec(fd, "show running-config", routed_show, sizeof(routed_show));
+    close(fd);
+    if (ret != 0)
+        return -1;
+    GWPEpon_RoutedParse(daemon, routed_show, conf);
+    return 0;
+}
+
+static int GWPEpon_RoutedRestartTarget(const char *name)
+{
+    int i;
+
+    for (i = 0; i < ROUTED_DAEMONS; i++)
+    {
+        if (strcmp(name, routed_daemons[i].restart_event) == 0)
+            return i;
+    }
+    return -1;
+}
+
+static void GWPEpon_RoutedRestart(const GWPEpon_RoutedDaemon *daemon, GWPEpon_RoutedState *st,
+                                  const char *name, const char *val)
+{
+    char cmd[GWPEPON_ACTION_CMD_LEN];
+
+    snprintf(cmd, sizeof(cmd), "%s %s %s", GWPEPON_ROUTED_SCRIPT, name, val);
+    GWPEpon_ActionRun("routed", cmd);
+    st->stats.restarts++;
+
+    // Whatever the script configured, or on the next update if the daemon is not listening yet
+    st->valid = (GWPEpon_RoutedReadBack(daemon, &st->applied) == 0);
+}
+
+/**************************************************************************/
+/*! \fn int GWPEpon_RoutedUpdate(const char *name, const char *val)
+ **************************************************************************
+ *  \brief Bring zebra and ripd in line with a routing event, in place when
+ *    possible
+ *  \return number of daemons restarted
+ **************************************************************************/
+int GWPEpon_RoutedUpdate(const char *name, const char *val)
+{
+    GWPEpon_RoutedConf wanted;
+    GWPEpon_RoutedConf delta;
+    int target = GWPEpon_RoutedRestartTarget(name);
+    int restarts = 0;
+    int i;
+
+    for (i = 0; i < ROUTED_DAEMONS; i++)
+    {
+        const GWPEpon_RoutedDaemon *daemon = &routed_daemons[i];
+        GWPEpon_RoutedState *st = &routed_state[i];
+
+        // The restart request of another daemon does not concern this one
+        if (target >= 0 && target != i)
+            continue;
+        st->stats.updates++;
+        if (target != i && !st->valid && GWPEpon_RoutedReadBack(daemon, &st->applied) == 0)
+        {
+            st->stats.readbacks++;
+            st->valid = 1;
+        }
+        if (target == i || !st->valid)
+        {
+            GWPEpon_RoutedRestart(daemon, st, daemon->restart_event, target == i ? val : "");
+            restarts++;
+            continue;
+        }
+
+        wanted.count = 0;
+        daemon->build(&wanted);
+        GWPEpon_RoutedDiff(&st->applied, &wanted, &delta);
+        if (delta.count == 0)
+        {
+            st->stats.unchanged++;
+            continue;
+        }
+
+        if (GWPEpon_RoutedPush(daemon, &delta) < 0)
+        {
+            st->stats.failures++;
+            GWPEpon_RoutedRestart(daemon, st, daemon->restart_event, "");
+            restarts++;
+            continue;
+        }
+        GWPROVEPONLOG(INFO, "%s reconfigured in place for %s %s with %d commands\n", daemon->name, name, val, delta.count)
+        st->stats.pushes++;
+        st->stats.commands += delta.count;
+        st->applied = wanted;
+    }
+    return restarts;
+}
+
+const GWPEpon_RoutedStats *GWPEpon_RoutedGetStats(int idx, const char **daemon)
+{
+    if (idx < 0 || idx >= ROUTED_DAEMONS)
+        return NULL;
+    *daemon = routed_daemons[idx].name;
+    return &routed_state[idx].stats;
+}
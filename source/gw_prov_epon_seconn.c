@@ -0,0 +1,356 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*! \file gw_prov_epon_seconn.c
+    \brief sysevent connections reopened when syseventd goes away
+*/
+
+/**************************************************************************/
+/*      INCLUDES:                                                         */
+/**************************************************************************/
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sysevent/sysevent.h>
+#include "gw_prov_epon.h"
+#include "gw_prov_epon_ctx.h"
+#include "gw_prov_epon_evloop.h"
+#include "gw_prov_epon_log.h"
+#include "gw_prov_epon_seconn.h"
+
+/**************************************************************************/
+/*      LOCAL DECLARATIONS:                                               */
+/**************************************************************************/
+typedef struct
+{
+    char name[GWPEPON_SECONN_NAME_LEN];
+    char value[GWPEPON_SECONN_VAL_LEN];
+    int set;                    /* owned: value holds the last one set */
+} GWPEpon_SeconnTuple;
+
+/**************************************************************************/
+/*      LOCAL VARIABLES:                                                  */
+/**************************************************************************/
+static GWPEPON_THREAD_LOCAL GWPEpon_SeconnStats seconn_stats;
+static GWPEPON_THREAD_LOCAL GWPEpon_SeconnTuple seconn_owned[GWPEPON_SECONN_MAX_OWNED];
+static GWPEPON_THREAD_LOCAL int seconn_nowned = 0;
+static GWPEPON_THREAD_LOCAL GWPEpon_SeconnTuple seconn_queue[GWPEPON_SECONN_QUEUE_LEN];
+static GWPEPON_THREAD_LOCAL int seconn_nqueued = 0;
+static GWPEPON_THREAD_LOCAL GWPEpon_SeconnSubscribeCb seconn_subscribe = NULL;
+static GWPEPON_THREAD_LOCAL unsigned int seconn_timer = 0;
+static GWPEPON_THREAD_LOCAL unsigned int seconn_backoff = 0;     /* failed attempts of this outage */
+static GWPEPON_THREAD_LOCAL unsigned int seconn_failures = 0;    /* consecutive, while up */
+static GWPEPON_THREAD_LOCAL unsigned long long seconn_down_ms = 0;
+
+/**************************************************************************/
+/*      LOCAL FUNCTIONS:                                                  */
+/**************************************************************************/
+static void GWPEpon_SeconnRetry(void *arg);
+
+/* 1 when the peer closed the connection or the socket is in error */
+static int GWPEpon_SeconnDead(int fd)
+{
+    struct pollfd pfd;
+    char c;
+
+    if (fd < 0)
+        return 1;
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    if (poll(&pfd, 1, 0) < 0 || (pfd.revents & (POLLERR | POLLHUP | POLLNVAL)))
+        return 1;
+    return (pfd.revents & POLLIN) && recv(fd, &c, 1, MSG_PEEK | MSG_DONTWAIT) == 0;
+}
+
+static GWPEpon_SeconnTuple *GWPEpon_SeconnOwned(const char *name)
+{
+    int i;
+
+    for (i = 0; i < seconn_nowned; i++)
+    {
+        if (strcmp(seconn_owned[i].name, name) == 0)
+            return &seconn_owned[i];
+    }
+    return NULL;
+}
+
+/* Make the sets of the outage, then restore the owned tuples that are not
+   what we set last: their count */
+static int GWPEpon_SeconnReplay(void)
+{
+    GWPEpon_SeconnTuple queue[GWPEPON_SECONN_QUEUE_LEN];
+    char live[GWPEPON_SECONN_VAL_LEN];
+    int count = seconn_nqueued;
+    int replayed = 0;
+    int i, q;
+
+    memcpy(queue, seconn_queue, count * sizeof(queue[0]));
+    seconn_nqueued = 0;
+    for (q = 0; q < count && seconn_stats.up; q++)
+    {
+        GWPEpon_SyseventSetStr(queue[q].name, (unsigned char *) queue[q].value, 0);
+        replayed++;
+    }
+    // A set failing again queued itself anew, the rest of the replay waits
+    // for the next reconnection behind it
+    for (i = q; i < count; i++)
+        GWPEpon_SeconnQueue(queue[i].name, queue[i].value);
+
+    for (i = 0; i < seconn_nowned && seconn_stats.up; i++)
+    {
+        if (!seconn_owned[i].set ||
+            (GWPEpon_SyseventGetStr(seconn_owned[i].name, (unsigned char *) live, sizeof(live)) == 0 &&
+             strcmp(live, seconn_owned[i].value) == 0))
+            continue;
+        GWPEpon_SyseventSetStr(seconn_owned[i].name, (unsigned char *) seconn_owned[i].value, 0);
+        replayed++;
+    }
+    return replayed;
+}
+
+static void GWPEpon_SeconnDisconnect(void)
+{
+    GWPEpon_WanCtx *ctx = GWPEpon_CtxCurrent();
+
+    if (ctx->sysevent_fd >= 0)
+    {
+        GWPEpon_EvLoopDelFd(ctx->sysevent_fd);
+        sysevent_close(ctx->sysevent_fd, ctx->sysevent_token);
+        ctx->sysevent_fd = -1;
+    }
+    if (ctx->sysevent_fd_gs >= 0)
+    {
+        sysevent_close(ctx->sysevent_fd_gs, ctx->sysevent_token_gs);
+        ctx->sysevent_fd_gs = -1;
+    }
+}
+
+static void GWPEpon_SeconnSchedule(void)
+{
+    unsigned int delay = GWPEPON_SECONN_CAP_MS;
+
+    if (seconn_backoff < 16 && (GWPEPON_SECONN_BASE_MS << seconn_backoff) < GWPEPON_SECONN_CAP_MS)
+        delay = GWPEPON_SECONN_BASE_MS << seconn_backoff;
+    seconn_backoff++;
+    seconn_timer = GWPEpon_TimerAdd(delay, 0, GWPEpon_SeconnRetry, NULL);
+}
+
+static void GWPEpon_SeconnRetry(void *arg)
+{
+    GWPEpon_WanCtx *ctx = GWPEpon_CtxCurrent();
+    char name[40], name_gs[48];
+    unsigned long long outage;
+    int replayed, republished;
+
+    (void) arg;
+    seconn_timer = 0;
+    seconn_stats.attempts++;
+    GWPEpon_SeconnName(ctx, 0, name, sizeof(name));
+    GWPEpon_SeconnName(ctx, 1, name_gs, sizeof(name_gs));
+
+    ctx->sysevent_fd = sysevent_open("127.0.0.1", SE_SERVER_WELL_KNOWN_PORT, SE_VERSION, name, &ctx->sysevent_token);
+    if (ctx->sysevent_fd >= 0)
+        ctx->sysevent_fd_gs = sysevent_open("127.0.0.1", SE_SERVER_WELL_KNOWN_PORT, SE_VERSION, name_gs,
+                                            &ctx->sysevent_token_gs);
+    // Marked up first, the events dispatched by the subscription may get and set tuples
+    seconn_stats.up = 1;
+    seconn_failures = 0;
+    if (ctx->sysevent_fd < 0 || ctx->sysevent_fd_gs < 0 || (replayed = seconn_subscribe()) < 0)
+    {
+        seconn_stats.up = 0;
+        GWPEpon_SeconnDisconnect();
+        if (seconn_timer == 0)
+            GWPEpon_SeconnSchedule();
+        return;
+    }
+    if (!seconn_stats.up)
+        return;     // lost again while the replayed tuples were dispatched
+    republished = GWPEpon_SeconnReplay();
+    seconn_stats.republished += republished;
+    if (!seconn_stats.up)
+        return;
+
+    outage = GWPEpon_NowMs() - seconn_down_ms;
+    seconn_stats.reconnects++;
+    seconn_stats.replayed += replayed;
+    seconn_stats.outage_ms_last = outage;
+    seconn_stats.outage_ms_total += outage;
+    if (outage > seconn_stats.outage_ms_max)
+        seconn_stats.outage_ms_max = outage;
+    GWPROVEPONLOG(WARNING, "sysevent reconnected after %llu ms and %u attempts, %d tuples changed meanwhile, "
+                  "%d set again\n", outage, seconn_backoff, replayed, republished)
+    seconn_backoff = 0;
+}
+
+/**************************************************************************/
+/*! \fn void GWPEpon_SeconnName(const GWPEpon_WanCtx *ctx, int gs, char *buf, int len)
+ **************************************************************************
+ *  \brief Client name of the notification (gs 0) or get/set (gs 1)
+ *    connection of ctx
+ *  \return void
+ **************************************************************************/
+void GWPEpon_SeconnName(const GWPEpon_WanCtx *ctx, int gs, char *buf, int len)
+{
+    if (ctx->index == 0)
+        snprintf(buf, len, "gw_prov_epon%s", gs ? "-gs" : "");
+    else
+        snprintf(buf, len, "gw_prov_epon-%s%s", ctx->ifname, gs ? "-gs" : "");
+}
+
+/**************************************************************************/
+/*! \fn void GWPEpon_SeconnInit(GWPEpon_SeconnSubscribeCb subscribe,
+ *        const char *const *owned)
+ **************************************************************************
+ *  \brief Supervise the connections of the current context. owned is the
+ *    NULL terminated list of the tuples the daemon publishes again after
+ *    a reconnection.
+ *  \return void
+ **************************************************************************/
+void GWPEpon_SeconnInit(GWPEpon_SeconnSubscribeCb subscribe, const char *const *owned)
+{
+    seconn_subscribe = subscribe;
+    seconn_stats.up = 1;
+    for (seconn_nowned = 0; owned != NULL && owned[seconn_nowned] != NULL; seconn_nowned++)
+    {
+        if (seconn_nowned == GWPEPON_SECONN_MAX_OWNED)
+        {
+            GWPROVEPONLOG(ERROR, "%s and the next tuples are not published again after a reconnection\n",
+                          owned[seconn_nowned])
+            break;
+        }
+        snprintf(seconn_owned[seconn_nowned].name, GWPEPON_SECONN_NAME_LEN, "%s", owned[seconn_nowned]);
+        seconn_owned[seconn_nowned].set = 0;
+    }
+}
+
+void GWPEpon_SeconnClose(void)
+{
+    if (seconn_timer)
+        GWPEpon_TimerCancel(seconn_timer);
+    seconn_timer = 0;
+}
+
+/* A notification was read, the connection works */
+void GWPEpon_SeconnOk(void)
+{
+    seconn_failures = 0;
+}
+
+/**************************************************************************/
+/*! \fn void GWPEpon_SeconnFailed(int fd, int err)
+ **************************************************************************
+ *  \brief Account a failed request on fd, taking the connections down
+ *    when fd is dead or keeps failing
+ *  \return void
+ **************************************************************************/
+void GWPEpon_SeconnFailed(int fd, int err)
+{
+    if (!seconn_stats.up)
+        return;
+    seconn_stats.errors++;
+    if (GWPEpon_SeconnDead(fd))
+    {
+        GWPEpon_SeconnLost("connection closed");
+        return;
+    }
+    if (++seconn_failures >= GWPEPON_SECONN_MAX_ERRORS)
+    {
+        GWPEpon_SeconnLost("too many errors");
+        return;
+    }
+    GWPROVEPONLOG(ERROR, "sysevent request failed with error %d\n", err)
+}
+
+/**************************************************************************/
+/*! \fn void GWPEpon_SeconnLost(const char *why)
+ **************************************************************************
+ *  \brief Close both connections and reopen them in the background
+ *  \return void
+ **************************************************************************/
+void GWPEpon_SeconnLost(const char *why)
+{
+    if (!seconn_stats.up || seconn_subscribe == NULL)
+        return;
+    GWPROVEPONLOG(ERROR, "sysevent connection lost: %s, reconnecting\n", why)
+    seconn_stats.up = 0;
+    seconn_stats.outages++;
+    seconn_down_ms = GWPEpon_NowMs();
+    seconn_backoff = 0;
+    GWPEpon_SeconnDisconnect();
+    GWPEpon_SeconnSchedule();
+}
+
+/* Remember the value just set, when the tuple is one of ours */
+void GWPEpon_SeconnRecord(const char *name, const char *value)
+{
+    GWPEpon_SeconnTuple *tuple = GWPEpon_SeconnOwned(name);
+
+    if (tuple == NULL)
+        return;
+    snprintf(tuple->value, sizeof(tuple->value), "%s", value);
+    tuple->set = 1;
+}
+
+/**************************************************************************/
+/*! \fn int GWPEpon_SeconnQueue(const char *name, const char *value)
+ **************************************************************************
+ *  \brief Keep a set that could not be made while the connections are
+ *    down, to make it once they are back. Only the last set of a tuple is
+ *    kept.
+ *  \return -1, the set is not made yet
+ **************************************************************************/
+int GWPEpon_SeconnQueue(const char *name, const char *value)
+{
+    int i;
+
+    seconn_stats.queued++;
+    if (GWPEpon_SeconnOwned(name) != NULL)
+    {
+        GWPEpon_SeconnRecord(name, value);
+        return -1;
+    }
+    for (i = 0; i < seconn_nqueued; i++)
+    {
+        if (strcmp(seconn_queue[i].name, name) == 0)
+            break;
+    }
+    if (i == GWPEPON_SECONN_QUEUE_LEN)
+    {
+        GWPROVEPONLOG(ERROR, "sysevent set queue full, %s=%s dropped\n", seconn_queue[0].name, seconn_queue[0].value)
+        seconn_stats.dropped++;
+        i = 0;
+    }
+    // The new set goes last, after the sets made before it
+    if (i < seconn_nqueued)
+    {
+        memmove(&seconn_queue[i], &seconn_queue[i + 1], (seconn_nqueued - i - 1) * sizeof(seconn_queue[0]));
+        seconn_nqueued--;
+    }
+    snprintf(seconn_queue[seconn_nqueued].name, GWPEPON_SECONN_NAME_LEN, "%s", name);
+    snprintf(seconn_queue[seconn_nqueued].value, GWPEPON_SECONN_VAL_LEN, "%s", value);
+    seconn_nqueued++;
+    return -1;
+}
+
+const GWPEpon_SeconnStats *GWPEpon_SeconnGetStats(void)
+{
+    return &seconn_stats;
+}
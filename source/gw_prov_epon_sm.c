@@ -42,13 +42,19 @@
 /**************************************************************************/
 /*      INCLUDES:                                                         */
 /**************************************************************************/
+#define _GNU_SOURCE             /* dl_iterate_phdr */
 #include <arpa/inet.h>
 #include <errno.h>
+#include <link.h>
 #include <net/if.h>
 #include <netinet/in.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/file.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
@@ -59,31 +65,66 @@
 #include <sysevent/sysevent.h>
 #include <syscfg/syscfg.h>
 #include <pthread.h>
+#include <stdint.h>
 #include "stdbool.h"
 #include "gw_prov_epon.h"
+#include "gw_prov_epon_log.h"
+#include "gw_prov_epon_evloop.h"
+#include "gw_prov_epon_events.h"
+#include "gw_prov_epon_evconf.h"
+#include "gw_prov_epon_fw.h"
+#include "gw_prov_epon_gate.h"
+#include "gw_prov_epon_gre.h"
+#include "gw_prov_epon_member.h"
+#include "gw_prov_epon_port.h"
+#include "gw_prov_epon_action.h"
+#include "gw_prov_epon_state.h"
+#include "gw_prov_epon_route.h"
+#include "gw_prov_epon_routed.h"
+#include "gw_prov_epon_status.h"
+#include "gw_prov_epon_tsip.h"
+#include "gw_prov_epon_bridge.h"
+#include "gw_prov_epon_ctl.h"
+#include "gw_prov_epon_ctx.h"
+#include "gw_prov_epon_damp.h"
+#include "gw_prov_epon_dhcpc.h"
+#include "gw_prov_epon_dhcps.h"
+#include "gw_prov_epon_seconn.h"
+#include "gw_prov_epon_wanmon.h"
 
 /**************************************************************************/
 /*      LOCAL VARIABLES:                                                  */
 /**************************************************************************/
-static int sysevent_fd;
-static token_t sysevent_token;
-static int sysevent_fd_gs;
-static token_t sysevent_token_gs;
-static pthread_t sysevent_tid;
-static int erouter_reset_count;
-static time_t xconfGetSettings_call_time = 0;
-
-#define INFO  0
-#define WARNING  1
-#define ERROR 2
+#define GWPEPON_EVENT_QUEUE_LEN  32      /* per dispatch class */
+
+typedef struct
+{
+    GWPEpon_EventId id;
+    char val[GWPEPON_EVENT_VAL_LEN];
+    unsigned long long enqueue_ms;
+} GWPEpon_Event;
+
+typedef struct
+{
+    GWPEpon_Event events[GWPEPON_EVENT_QUEUE_LEN];
+    int head;
+    int count;
+} GWPEpon_EventQueue;
+
+/* Each WAN context queues and dispatches its own events, one queue per class */
+static GWPEPON_THREAD_LOCAL GWPEpon_EventQueue event_queues[GWPEPON_CLASS_COUNT];
+static GWPEPON_THREAD_LOCAL int event_last_aged = 0;
+/* Last value of each state tuple, to find the transitions missed while sysevent was down */
+static GWPEPON_THREAD_LOCAL char event_state_vals[GWPEPON_EV_COUNT][GWPEPON_EVENT_VAL_LEN];
+
+static const unsigned long long event_class_age_ms[GWPEPON_CLASS_COUNT] =
+{
+    0, GWPEPON_CLASS_NORMAL_AGE_MS, GWPEPON_CLASS_BULK_AGE_MS
+};
 
 #ifdef FEATURE_SUPPORT_RDKLOG
-#include "ccsp_trace.h"
 const char compName[25]="LOG.RDK.GWPEPON";
 #define DEBUG_INI_NAME  "/etc/debug.ini"
-#define GWPROVEPONLOG(x, ...) { if((x)==(INFO)){CcspTraceInfo((__VA_ARGS__));}else if((x)==(WARNING)){CcspTraceWarning((__VA_ARGS__));}else if((x)==(ERROR)){CcspTraceError((__VA_ARGS__));} }
-#else
-#define GWPROVEPONLOG(x, ...) {fprintf(stderr, "GwProvEponLog<%s:%d> ", __FUNCTION__, __LINE__);fprintf(stderr, __VA_ARGS__);}
 #endif
 
 //Note: By Moving this headerfile inclusion to "INCLUDES:" block, may run into build issues
@@ -103,7 +144,6 @@ static void GWPEpon_StartIPProvisioning();
 static void GWPEpon_StopIPProvisioning();
 static void GWPEpon_ProcessIPProvisioning(EPON_IpProvMode routerIpModeOverride, int update_db);
 static void GWPEpon_ProcessXconfGwProvMode();
-static void GWPEpon_ProcessLanWanReconnect();
 static int GWPEpon_ProcessLanWanConnect(EPON_IpProvStatus status);
 static int GWPEpon_ProcessIpv4Down(void);
 static int GWPEpon_ProcessIpv6Down(void);
@@ -115,6 +155,9 @@ static int GWPEpon_SysCfgSetInt(const char *name, int int_value);
 static int GWPEpon_SysCfgGetInt(const char *name);
 static int GWPEpon_SysCfgGetStr(const char *name, unsigned char *out_value, int outbufsz);
 static int GWPEpon_SysCfgSetStr(const char *name, unsigned char *str_value);
+static int GWPEpon_WarmRestart();
+static void notifySysEvents();
+static void GWPEpon_SyseventTrack(const char *name, const char *val);
 
 /**************************************************************************/
 /*! \fn int SetProvisioningStatus();
@@ -130,12 +173,9 @@ static void SetProvisioningStatus(EPON_IpProvStatus status)
     unsigned  char value[20];
     value[0] = '\0' ;
 
-    int gw_prov_status = 0;
-    gw_prov_status = GWPEpon_SyseventGetInt("gw_prov_status");
+    // This context owns gw_prov_status, the sysevent tuple is only a mirror
+    int gw_prov_status = GWPEpon_GetProvState()->gw_prov_status;
 
-    if (gw_prov_status < 0)
-		gw_prov_status = 0;
-	
     switch(status)
     {
         case EPON_OPER_IPV6_UP:
@@ -181,10 +221,14 @@ static void SetProvisioningStatus(EPON_IpProvStatus status)
     }
 
     GWPEpon_SyseventSetInt("gw_prov_status",gw_prov_status);
+    GWPEpon_GetProvState()->gw_prov_status = gw_prov_status;
+    GWPEpon_StateChanged();
     GWPROVEPONLOG(INFO, "gw_prov_status_str=%s\n",value)
     //TODO:To be added in EPON gateway provisiong data model
     GWPEpon_SyseventSetStr("gw_prov_status_str", value, sizeof(value));
-    GWPEpon_SyseventSetStr("dhcp_server-restart", "1", sizeof("1"));
+    // The LAN DHCP server hands out the primary WAN's settings
+    if (GWPEpon_CtxIsPrimary())
+        GWPEpon_SyseventSetStr("dhcp_server-restart", "1", sizeof("1"));
 
     GWPROVEPONLOG(INFO, "Exiting from %s\n",__FUNCTION__)
 }
@@ -193,11 +237,16 @@ static void GWPEpon_StartIPv4Service()
 {
     GWPROVEPONLOG(INFO, "Entering into %s\n",__FUNCTION__);
     FILE *fp = NULL;
+    char buf[GWPEPON_CKPT_PATH_LEN];
+    const char *marker = GWPEpon_CtxPath(GWPEPON_IPV4_MARKER, buf, sizeof(buf));
 
-    if ((fp = fopen("/tmp/.start_ipv4", "r")) == NULL)
+    if ((fp = fopen(marker, "r")) == NULL)
     {
-        system("touch /tmp/.start_ipv4");
-        system("systemctl restart udhcp.service");
+        if ((fp = fopen(marker, "w")) != NULL)
+            fclose(fp);
+        GWPEpon_DhcpcStart(GWPEPON_DHCPC_V4);
+        GWPEpon_GetProvState()->ipv4_service = 1;
+        GWPEpon_StateChanged();
     }
     else
        fclose(fp);	
@@ -205,18 +254,22 @@ static void GWPEpon_StartIPv4Service()
     GWPROVEPONLOG(INFO, "Exiting from %s\n",__FUNCTION__);
 }
 
-static void GWPEpon_StopIPv4Service()
+static void GWPEpon_StopIPv4Service(int release)
 {
     GWPROVEPONLOG(INFO, "Entering into %s\n",__FUNCTION__);
     FILE *fp = NULL;
+    char buf[GWPEPON_CKPT_PATH_LEN];
+    const char *marker = GWPEpon_CtxPath(GWPEPON_IPV4_MARKER, buf, sizeof(buf));
 
-    if ((fp = fopen("/tmp/.start_ipv4", "r")) != NULL)
+    if ((fp = fopen(marker, "r")) != NULL)
     {
         if(fp)
            fclose(fp);
 		
-        system("rm /tmp/.start_ipv4"); 
-        system("systemctl stop udhcp.service");
+        unlink(marker);
+        GWPEpon_DhcpcStop(GWPEPON_DHCPC_V4, release);
+        GWPEpon_GetProvState()->ipv4_service = 0;
+        GWPEpon_StateChanged();
         GWPEpon_ProcessIpv4Down();
     }
 		
@@ -227,11 +280,16 @@ static void GWPEpon_StartIPv6Service()
 {
     GWPROVEPONLOG(INFO, "Entering into %s\n",__FUNCTION__);
     FILE *fp = NULL;
+    char buf[GWPEPON_CKPT_PATH_LEN];
+    const char *marker = GWPEpon_CtxPath(GWPEPON_IPV6_MARKER, buf, sizeof(buf));
 
-    if ((fp = fopen("/tmp/.start_ipv6", "r")) == NULL)
+    if ((fp = fopen(marker, "r")) == NULL)
     {
-        system("touch /tmp/.start_ipv6");
-        system("systemctl restart dibbler.service");
+        if ((fp = fopen(marker, "w")) != NULL)
+            fclose(fp);
+        GWPEpon_DhcpcStart(GWPEPON_DHCPC_V6);
+        GWPEpon_GetProvState()->ipv6_service = 1;
+        GWPEpon_StateChanged();
     }
     else
        fclose(fp);	
@@ -239,18 +297,22 @@ static void GWPEpon_StartIPv6Service()
     GWPROVEPONLOG(INFO, "Exiting from %s\n",__FUNCTION__);
 }
 
-static void GWPEpon_StopIPv6Service()
+static void GWPEpon_StopIPv6Service(int release)
 {
     GWPROVEPONLOG(INFO, "Entering into %s\n",__FUNCTION__);
     FILE *fp = NULL;
+    char buf[GWPEPON_CKPT_PATH_LEN];
+    const char *marker = GWPEpon_CtxPath(GWPEPON_IPV6_MARKER, buf, sizeof(buf));
 
-    if ((fp = fopen("/tmp/.start_ipv6", "r")) != NULL)
+    if ((fp = fopen(marker, "r")) != NULL)
     {
         if(fp)
            fclose(fp);
 		
-        system("rm /tmp/.start_ipv6"); 
-        system("systemctl stop dibbler.service");
+        unlink(marker);
+        GWPEpon_DhcpcStop(GWPEPON_DHCPC_V6, release);
+        GWPEpon_GetProvState()->ipv6_service = 0;
+        GWPEpon_StateChanged();
         GWPEpon_ProcessIpv6Down();
     }
 		
@@ -289,13 +351,14 @@ static int GWPEpon_XconfGetSettings(void)
 {
     GWPROVEPONLOG(INFO, "Entering into %s\n",__FUNCTION__);
 
+    GWPEpon_ProvState *state = GWPEpon_GetProvState();
     unsigned char out_value[20];
     int outbufsz = sizeof(out_value);
     out_value[0] = '\0';
 
     // Make sure we don't call /usr/ccsp/xf3_xconfGetSettings.sh back to back which can cause some
     // synchronization issues
-    if (xconfGetSettings_call_time != 0 && time(NULL) < (xconfGetSettings_call_time + 10))
+    if (state->xconf_call_time != 0 && time(NULL) < (state->xconf_call_time + 10))
     {
         GWPROVEPONLOG(INFO, "%s Not getting xconf configuration parameter due to another running\n",__FUNCTION__);
     }
@@ -305,8 +368,10 @@ static int GWPEpon_XconfGetSettings(void)
         if(retval < 0)
         {
             GWPROVEPONLOG(INFO, "%s Getting xconf configuration parameter\n",__FUNCTION__);
-            system("sh /usr/ccsp/xf3_xconfGetSettings.sh &");
-            xconfGetSettings_call_time = time(NULL);
+            if (GWPEpon_ActionRunAsync("xconf_get_settings", "sh /usr/ccsp/xf3_xconfGetSettings.sh", NULL, NULL) < 0)
+                GWPROVEPONLOG(ERROR, "%s could not start xf3_xconfGetSettings.sh\n",__FUNCTION__);
+            state->xconf_call_time = time(NULL);
+            GWPEpon_StateChanged();
         }
         else
         {
@@ -361,7 +426,6 @@ static int GWPEpon_ProcessIpv4Down(void)
     GWPROVEPONLOG(INFO, "Entering into %s\n",__FUNCTION__);
 
     SetProvisioningStatus(EPON_OPER_IPV4_DOWN);
-    GWPEpon_ProcessLanWanConnect(EPON_OPER_IPV4_DOWN);	
     GWPROVEPONLOG(INFO, "Exiting from %s\n",__FUNCTION__);
     return 0;
 }
@@ -377,8 +441,6 @@ static int GWPEpon_ProcessIpv4Up(void)
     GWPROVEPONLOG(INFO, "Entering into %s\n",__FUNCTION__);
 
     SetProvisioningStatus(EPON_OPER_IPV4_UP);
-    GWPEpon_ProcessLanWanConnect(EPON_OPER_IPV4_UP);	
-    GWPEpon_XconfGetSettings();
     GWPROVEPONLOG(INFO, "Exiting from %s\n",__FUNCTION__);
     return 0;
 }
@@ -394,7 +456,6 @@ static int GWPEpon_ProcessIpv6Down(void)
     GWPROVEPONLOG(INFO, "Entering into %s\n",__FUNCTION__);
 
     SetProvisioningStatus(EPON_OPER_IPV6_DOWN);
-    GWPEpon_ProcessLanWanConnect(EPON_OPER_IPV6_DOWN);	
     GWPROVEPONLOG(INFO, "Exiting from %s\n",__FUNCTION__);
     return 0;
 }
@@ -410,8 +471,6 @@ static int GWPEpon_ProcessIpv6Up(void)
     GWPROVEPONLOG(INFO, "Entering into %s\n",__FUNCTION__);
 
     SetProvisioningStatus(EPON_OPER_IPV6_UP);
-    GWPEpon_ProcessLanWanConnect(EPON_OPER_IPV6_UP);		
-    GWPEpon_XconfGetSettings();
     GWPROVEPONLOG(INFO, "Exiting from %s\n",__FUNCTION__);
     return 0;
 }
@@ -475,129 +534,69 @@ static int GWPEpon_ProcessWANIpPref()
     return 0;
 }
 
+/**************************************************************************/
+/*! \fn static int GWPEpon_ProcessLanWanConnect(EPON_IpProvStatus status)
+ **************************************************************************
+ *  \brief Grant or revoke LAN access to the WAN for one address family.
+ *    Runs from the lan_wan_v4/lan_wan_v6 gates, which only open once the
+ *    family is up and the gateway is provisioned.
+ *  \return 0 when applied, -1 when refused
+**************************************************************************/
 static int GWPEpon_ProcessLanWanConnect(EPON_IpProvStatus status)
 {
     GWPROVEPONLOG(INFO, "Entering into %s\n",__FUNCTION__);
 
-    unsigned char out_val[20];
-    int outbufsz = sizeof(out_val);		
     int factory_mode = GWPEpon_SysCfgGetInt("factory_mode");
 
-    if(factory_mode)
-        GWPEpon_SysCfgGetStr("gw_prov_mode", out_val, outbufsz);
-    else
-        GWPEpon_SyseventGetStr("cur_gw_prov_mode", out_val, outbufsz);
-	
-    if (!factory_mode && (strcmp(out_val, "provisioned") == 0))
-    {       
-        int ipv6_lan_wan_connect = GWPEpon_SyseventGetInt("ipv6_lan_wan_connect");
-        if (ipv6_lan_wan_connect < 0)
-            ipv6_lan_wan_connect=0;
-     
-        int ipv4_lan_wan_connect = GWPEpon_SyseventGetInt("ipv4_lan_wan_connect");
-        if (ipv4_lan_wan_connect < 0)
-            ipv4_lan_wan_connect=0;
-     
-        switch(status)
-        {
-            case EPON_OPER_IPV6_UP:
-            GWPROVEPONLOG(INFO, "processing IPv6 LanWanConnect\n");	
-                //if(!ipv6_lan_wan_connect)
-                    system("sh /usr/ccsp/lan_handler.sh ipv6_lan_wan_connect");
-     			
-            break;
-         
-            case EPON_OPER_IPV6_DOWN:        			
-
-                GWPROVEPONLOG(INFO, "processing IPv6 LanWanDisconnect\n");	
-                //if(ipv6_lan_wan_connect)
-                    system("sh /usr/ccsp/lan_handler.sh ipv6_lan_wan_disconnect");
-     			
-            break;
-         
-            case EPON_OPER_IPV4_UP:
-     
-     	      GWPROVEPONLOG(INFO, "processing IPv4 LanWanConnect\n");	
-                //if(!ipv4_lan_wan_connect)
-                    system("sh /usr/ccsp/lan_handler.sh ipv4_lan_wan_connect");
-     
-            break;
-     
-            case EPON_OPER_IPV4_DOWN:
-     
-     	      GWPROVEPONLOG(INFO, "processing IPv4 LanWanDisconnect\n");	
-                //if(ipv4_lan_wan_connect)
-                    system("sh /usr/ccsp/lan_handler.sh ipv4_lan_wan_disconnect");
-     
-            break;
-         
-            default:
-            break;
-         }
-    }
-    else
+    if (factory_mode && ((status == EPON_OPER_IPV6_UP) || (status == EPON_OPER_IPV4_UP)))
     {
-       GWPROVEPONLOG(WARNING,"Refusing to allow LAN ACCESS to WAN on gw_prov_mode:%s factory_mode:%d\n",out_val,factory_mode);
+        GWPROVEPONLOG(WARNING,"Refusing to allow LAN ACCESS to WAN on factory_mode:%d\n",factory_mode);
+        GWPROVEPONLOG(INFO, "Exiting from %s\n",__FUNCTION__);
+        return -1;
     }
-	
-    GWPROVEPONLOG(INFO, "Exiting from %s\n",__FUNCTION__);
-    return 0;
-}
 
-static int GWPEpon_ProcessDHCPStart()
-{
-    GWPROVEPONLOG(INFO, "Entering into %s\n",__FUNCTION__);
-		
-    system("sh /usr/ccsp/lan_handler.sh dhcp_restart"); 
-	
-    GWPROVEPONLOG(INFO, "Exiting from %s\n",__FUNCTION__);
-    return 0;
-}
+    switch(status)
+    {
+        case EPON_OPER_IPV6_UP:
+            GWPROVEPONLOG(INFO, "processing IPv6 LanWanConnect\n");
+            GWPEpon_ActionRunAsync("lan_wan_connect_v6", "sh /usr/ccsp/lan_handler.sh ipv6_lan_wan_connect", NULL, NULL);
+        break;
 
-static int GWPEpon_ProcessEthEnable()
-{
-    GWPROVEPONLOG(INFO, "Entering into %s\n",__FUNCTION__);
-		
-    system("sh /usr/ccsp/lan_handler.sh eth_enable");
-	
-    GWPROVEPONLOG(INFO, "Exiting from %s\n",__FUNCTION__);
-    return 0;
-}
+        case EPON_OPER_IPV6_DOWN:
+            GWPROVEPONLOG(INFO, "processing IPv6 LanWanDisconnect\n");
+            GWPEpon_ActionRunAsync("lan_wan_disconnect_v6", "sh /usr/ccsp/lan_handler.sh ipv6_lan_wan_disconnect", NULL, NULL);
+        break;
 
-static int GWPEpon_ProcessEthDisable()
-{
-    GWPROVEPONLOG(INFO, "Entering into %s\n",__FUNCTION__);
-		
-    system("sh /usr/ccsp/lan_handler.sh eth_disable");
-	
-    GWPROVEPONLOG(INFO, "Exiting from %s\n",__FUNCTION__);
-    return 0;
-}
+        case EPON_OPER_IPV4_UP:
+            GWPROVEPONLOG(INFO, "processing IPv4 LanWanConnect\n");
+            GWPEpon_ActionRunAsync("lan_wan_connect_v4", "sh /usr/ccsp/lan_handler.sh ipv4_lan_wan_connect", NULL, NULL);
+        break;
 
-static int GWPEpon_ProcessLanEth0ToXHS()
-{
+        case EPON_OPER_IPV4_DOWN:
+            GWPROVEPONLOG(INFO, "processing IPv4 LanWanDisconnect\n");
+            GWPEpon_ActionRunAsync("lan_wan_disconnect_v4", "sh /usr/ccsp/lan_handler.sh ipv4_lan_wan_disconnect", NULL, NULL);
+        break;
 
-	GWPROVEPONLOG(INFO, "Entering into %s\n",__FUNCTION__);
-    system("sh /usr/ccsp/lan_handler.sh eth3_to_xhs");
-	GWPROVEPONLOG(INFO, "Exiting from %s\n",__FUNCTION__);
-	return 0;
-}
-static int GWPEpon_ProcessLanEth0ToLocalNetwork()
-{
+        default:
+        break;
+    }
 
-	GWPROVEPONLOG(INFO, "Entering into %s\n",__FUNCTION__);
-    system("sh /usr/ccsp/lan_handler.sh eth3_to_local");
-	GWPROVEPONLOG(INFO, "Exiting from %s\n",__FUNCTION__);
-	return 0;
+    if ((status == EPON_OPER_IPV6_UP) || (status == EPON_OPER_IPV6_DOWN))
+        GWPEpon_GetProvState()->lan_wan_v6 = status;
+    else if ((status == EPON_OPER_IPV4_UP) || (status == EPON_OPER_IPV4_DOWN))
+        GWPEpon_GetProvState()->lan_wan_v4 = status;
+    GWPEpon_StateChanged();
+
+    GWPROVEPONLOG(INFO, "Exiting from %s\n",__FUNCTION__);
+    return 0;
 }
-static int GWPEpon_ProcessPNM_Status()
+
+static void GWPEpon_PNMXhsPortRead(pid_t pid, int wstatus, void *arg)
 {
 	FILE *fp;
 	char buffer[512]={0};
 	char *str = NULL;
-	GWPROVEPONLOG(INFO, "Entering into %s\n",__FUNCTION__);
-    system("sh /usr/ccsp/lan_handler.sh init");
-    system("dmcli eRT getv Device.Bridging.Bridge.2.Port.2.Enable >> /tmp/XHSport.txt");//XHS port true or false?
+
 	fp = fopen("/tmp/XHSport.txt","r");
     if (fp != NULL)
     {
@@ -608,52 +607,28 @@ static int GWPEpon_ProcessPNM_Status()
        {
     	   if( str[7] == 't') // true
     	   {
-    		   GWPEpon_SyseventSetStr("multinet-syncMembers","2", 0);
+    		   GWPEpon_MemberSync(GWPEPON_MEMBER_XHS);
     	   }
        }
     }
-	GWPROVEPONLOG(INFO, "Exiting from %s\n",__FUNCTION__);
-	return 0;
-}
-
-static int GWPEpon_ProcessMoCAEnable()
-{
-    GWPROVEPONLOG(INFO, "Entering into %s\n",__FUNCTION__);
-		
-    system("sh /usr/ccsp/lan_handler.sh moca_enable");
-	
-    GWPROVEPONLOG(INFO, "Exiting from %s\n",__FUNCTION__);
-    return 0;
-}
-
-static int GWPEpon_ProcessMoCADisable()
-{
-    GWPROVEPONLOG(INFO, "Entering into %s\n",__FUNCTION__);
-		
-    system("sh /usr/ccsp/lan_handler.sh moca_disable");
-	
-    GWPROVEPONLOG(INFO, "Exiting from %s\n",__FUNCTION__);
-    return 0;
 }
 
-static int GWPEpon_ProcessWlEnable()
+static void GWPEpon_PNMLanInitDone(const char *action, const GWPEpon_ActionResult *result, void *arg)
 {
-    GWPROVEPONLOG(INFO, "Entering into %s\n",__FUNCTION__);
-		
-    system("sh /usr/ccsp/lan_handler.sh wl_enable");
-	
-    GWPROVEPONLOG(INFO, "Exiting from %s\n",__FUNCTION__);
-    return 0;
+    // dmcli takes seconds, read its answer when it exits rather than holding up the WAN events
+    if (GWPEpon_ChildSpawn("dmcli eRT getv Device.Bridging.Bridge.2.Port.2.Enable >> /tmp/XHSport.txt",//XHS port true or false?
+                           GWPEpon_PNMXhsPortRead, NULL) < 0)
+        GWPROVEPONLOG(ERROR, "cannot query the XHS port state\n")
 }
 
-static int GWPEpon_ProcessWlDisable()
+static int GWPEpon_ProcessPNM_Status()
 {
-    GWPROVEPONLOG(INFO, "Entering into %s\n",__FUNCTION__);
-		
-    system("sh /usr/ccsp/lan_handler.sh wl_disable");
-	
-    GWPROVEPONLOG(INFO, "Exiting from %s\n",__FUNCTION__);
-    return 0;
+	GWPROVEPONLOG(INFO, "Entering into %s\n",__FUNCTION__);
+    // The XHS port is queried once the LAN is initialised
+    if (GWPEpon_ActionRunAsync("lan_init", "sh /usr/ccsp/lan_handler.sh init", GWPEpon_PNMLanInitDone, NULL) < 0)
+        GWPEpon_PNMLanInitDone("lan_init", NULL, NULL);
+	GWPROVEPONLOG(INFO, "Exiting from %s\n",__FUNCTION__);
+	return 0;
 }
 
 
@@ -670,7 +645,8 @@ static int GWPEpon_ProcessXconfRouterIpMode()
             GWPEpon_ProcessIPProvisioning(routerIpModeOverride, 1);
         }
         GWPEpon_SysCfgSetInt("factory_mode", 0);
-        GWPEpon_ProcessLanWanReconnect();
+        // Leaving factory mode lifts the refusal of the LAN/WAN connect gates
+        GWPEpon_GateRecheck();
     }
     GWPROVEPONLOG(INFO, "Exiting from %s\n",__FUNCTION__);
     return 0;
@@ -686,7 +662,8 @@ static int GWPEpon_ProcessXconfPoDSeed()
     {
         GWPEpon_SysCfgSetStr("pod_seed","");
     }
-    xconfGetSettings_call_time = 0;
+    GWPEpon_GetProvState()->xconf_call_time = 0;
+    GWPEpon_StateChanged();
     GWPROVEPONLOG(INFO, "Exiting from %s\n",__FUNCTION__);
     return 0;
 }
@@ -700,26 +677,6 @@ static int GWPEpon_ProcessXconfDstAdj()
     return 0;
 }
 
-static void GWPEpon_ProcessLanWanReconnect()
-{
-    GWPROVEPONLOG(INFO, "Entering into %s\n",__FUNCTION__);
-	
-    int gw_prov_status = 0;
-    gw_prov_status = GWPEpon_SyseventGetInt("gw_prov_status");
-	
-    if (gw_prov_status & 0x00000001)
-        GWPEpon_ProcessLanWanConnect(EPON_OPER_IPV6_UP);
-    else
-        GWPEpon_ProcessLanWanConnect(EPON_OPER_IPV6_DOWN);
-
-    if (gw_prov_status & 0x00000002)
-        GWPEpon_ProcessLanWanConnect(EPON_OPER_IPV4_UP);
-    else
-        GWPEpon_ProcessLanWanConnect(EPON_OPER_IPV4_DOWN);
-	
-    GWPROVEPONLOG(INFO, "Exiting from %s\n",__FUNCTION__);
-}
-
 static void GWPEpon_ProcessXconfGwProvMode()
 {
     GWPROVEPONLOG(INFO, "Entering into %s\n",__FUNCTION__);
@@ -736,60 +693,13 @@ static void GWPEpon_ProcessXconfGwProvMode()
     GWPROVEPONLOG(INFO, "Exiting from %s\n",__FUNCTION__);
 }
 
-static void GWPEpon_ProcessBridgeModeEnable()
-{
-    GWPROVEPONLOG(INFO, "Entering into %s\n",__FUNCTION__);
-    system("sh /usr/ccsp/lan_handler.sh bridge_mode_enable");
-    system("systemctl restart dibbler.service");
-    GWPROVEPONLOG(INFO, "Exiting from %s\n",__FUNCTION__);
-}
-
-static void GWPEpon_ProcessBridgeModeDisable()
-{
-    GWPROVEPONLOG(INFO, "Entering into %s\n",__FUNCTION__);
-    system("sh /usr/ccsp/lan_handler.sh bridge_mode_disable");
-    system("systemctl restart dibbler.service");
-    GWPROVEPONLOG(INFO, "Exiting from %s\n",__FUNCTION__);
-}
-
 static void GWPEpon_ProcessFirewallRestart()
 {
 GWPROVEPONLOG(INFO, "Entering into %s\n",__FUNCTION__);
-   system("sh /usr/ccsp/lan_handler.sh firewall_restart");
-GWPROVEPONLOG(INFO, "Exiting from %s\n",__FUNCTION__);
-}
-
-static void GWPEpon_ProcessGreRestart(char * val)
-{
-   char cmd[512];
-GWPROVEPONLOG(INFO, "Entering into %s\n",__FUNCTION__);
-   sprintf(cmd, "sh /etc/utopia/service.d/service_xfinity_hotspot.sh xfinity-hotspot-restart");
-   system(cmd);
+   GWPEpon_FwRequest("lan and wan started");
 GWPROVEPONLOG(INFO, "Exiting from %s\n",__FUNCTION__);
 }
 
-static void GWPEpon_ProcessTSIP(char *name, char *val)
-{
-    char cmd[512];
-    GWPROVEPONLOG(INFO, "Entering into %s\n",__FUNCTION__);
-
-    sprintf(cmd, "sh /etc/utopia/service.d/service_ipv4.sh %s %s", name, val);
-    system(cmd);
-
-    GWPROVEPONLOG(INFO, "Exiting from %s\n",__FUNCTION__);
-}
-
-static void GWPEpon_ProcessRIPD(char *name, char *val)
-{
-    char cmd[512];
-    GWPROVEPONLOG(INFO, "Entering into %s\n",__FUNCTION__);
-
-    sprintf(cmd, "sh /etc/utopia/service.d/service_routed.sh %s %s", name, val);
-    system(cmd);
-
-    GWPROVEPONLOG(INFO, "Exiting from %s\n",__FUNCTION__);
-}
-
 static void GWPEpon_ProcessIpv6Timezone()
 {
     GWPROVEPONLOG(INFO, "Entering into %s\n",__FUNCTION__);
@@ -821,7 +731,7 @@ static void GWPEpon_ProcessIpv4Timezone()
        }
        unsigned char cmdLine[50];
        sprintf(cmdLine, "timedatectl set-timezone UTC");    /* no offset */
-       system(cmdLine);
+       GWPEpon_ActionRunAsync("set_timezone", cmdLine, NULL, NULL);
     }
     else
     {
@@ -834,7 +744,7 @@ static void GWPEpon_ProcessIpv4Timezone()
     {
        unsigned char cmdLine[256];
        sprintf(cmdLine, "dmcli eRT setv Device.Time.LocalTimeZone string %s", timezone_hex);
-       system(cmdLine);
+       GWPEpon_ActionRunAsync("set_local_timezone", cmdLine, NULL, NULL);
     }
     GWPROVEPONLOG(INFO, "Exiting from %s\n",__FUNCTION__);
 }
@@ -911,31 +821,10 @@ static void GWPEpon_ProcessIpv6Timeoffset()
 }
 
 
-static void GWPEpon_ProcessLanRestart()
-{
-    GWPROVEPONLOG(INFO, "Entering into %s\n",__FUNCTION__);
-    system("sh /usr/ccsp/lan_handler.sh lan_restart");
-    GWPROVEPONLOG(INFO, "Exiting from %s\n",__FUNCTION__);
-}
-
-static void GWPEpon_ProcessLanStop()
-{
-    GWPROVEPONLOG(INFO, "Entering into %s\n",__FUNCTION__);
-    system("sh /usr/ccsp/lan_handler.sh lan_stop");
-    GWPROVEPONLOG(INFO, "Exiting from %s\n",__FUNCTION__);
-}
-
 static void GWPEpon_ProcessLanStatus()
 {
     GWPROVEPONLOG(INFO, "Entering into %s\n",__FUNCTION__);
-    system("sh /usr/ccsp/lan_handler.sh lan_status");
-    GWPROVEPONLOG(INFO, "Exiting from %s\n",__FUNCTION__);
-}
-
-static void GWPEpon_ProcessForwardingRestart()
-{
-    GWPROVEPONLOG(INFO, "Entering into %s\n",__FUNCTION__);
-    system("sh /usr/ccsp/lan_handler.sh forwarding_restart");
+    GWPEpon_ActionRunAsync("lan_status", "sh /usr/ccsp/lan_handler.sh lan_status", NULL, NULL);
     GWPROVEPONLOG(INFO, "Exiting from %s\n",__FUNCTION__);
 }
 
@@ -1001,9 +890,9 @@ static void GWPEpon_SetWanTimeoffset(int time_offset)
     GWPEpon_SyseventSetStr("ipv4_timezone", timezone, 0);
     unsigned char cmdLine[256];
     sprintf(cmdLine, "dmcli eRT setv Device.Time.LocalTimeZone string %s", timezone);
-    system(cmdLine);
+    GWPEpon_ActionRunAsync("set_local_timezone", cmdLine, NULL, NULL);
     sprintf(cmdLine, "timedatectl set-timezone UTC");    /* no offset */
-    system(cmdLine);
+    GWPEpon_ActionRunAsync("set_timezone", cmdLine, NULL, NULL);
     GWPROVEPONLOG(INFO, "Exiting from %s\n",__FUNCTION__);
 }
 
@@ -1049,10 +938,19 @@ static int GWPEpon_hexToInt(char s[])
  **************************************************************************/
 int GWPEpon_SyseventGetInt(const char *name)
 {
+   GWPEpon_WanCtx *ctx = GWPEpon_CtxCurrent();
+   char scoped[GWPEPON_CTX_TUPLE_LEN];
    unsigned char out_value[20];
    int outbufsz = sizeof(out_value);
+   int ret;
 
-   sysevent_get(sysevent_fd_gs, sysevent_token_gs, name, out_value,outbufsz);
+   ret = sysevent_get(ctx->sysevent_fd_gs, ctx->sysevent_token_gs, GWPEpon_CtxTuple(name, scoped, sizeof(scoped)),
+                      out_value, outbufsz);
+   if (ret != 0)
+   {
+      out_value[0] = '\0';
+      GWPEpon_SeconnFailed(ctx->sysevent_fd_gs, ret);
+   }
    if(out_value[0] != '\0')
    {
       return atoi(out_value);
@@ -1075,12 +973,21 @@ int GWPEpon_SyseventSetInt(const char *name, int int_value)
    unsigned char value[20];
    sprintf(value, "%d", int_value);
 
-   return sysevent_set(sysevent_fd_gs, sysevent_token_gs, name, value, sizeof(value));
+   return GWPEpon_SyseventSetStr(name, value, sizeof(value));
 }
 
 int GWPEpon_SyseventGetStr(const char *name, unsigned char *out_value, int outbufsz)
 {
-    sysevent_get(sysevent_fd_gs, sysevent_token_gs, name, out_value, outbufsz);
+    GWPEpon_WanCtx *ctx = GWPEpon_CtxCurrent();
+    char scoped[GWPEPON_CTX_TUPLE_LEN];
+    int ret = sysevent_get(ctx->sysevent_fd_gs, ctx->sysevent_token_gs, GWPEpon_CtxTuple(name, scoped, sizeof(scoped)),
+                           out_value, outbufsz);
+
+    if (ret != 0)
+    {
+        out_value[0] = '\0';
+        GWPEpon_SeconnFailed(ctx->sysevent_fd_gs, ret);
+    }
     if(out_value[0] != '\0')
         return 0;		
     else
@@ -1089,7 +996,27 @@ int GWPEpon_SyseventGetStr(const char *name, unsigned char *out_value, int outbu
 
 int GWPEpon_SyseventSetStr(const char *name, unsigned char *value, int bufsz)
 {
-    return sysevent_set(sysevent_fd_gs, sysevent_token_gs, name, value, bufsz);
+    GWPEpon_WanCtx *ctx = GWPEpon_CtxCurrent();
+    char scoped[GWPEPON_CTX_TUPLE_LEN];
+    int ret;
+
+    // Made once the connections are back
+    if (!GWPEpon_SeconnGetStats()->up)
+        return GWPEpon_SeconnQueue(name, (char *) value);
+    ret = sysevent_set(ctx->sysevent_fd_gs, ctx->sysevent_token_gs, GWPEpon_CtxTuple(name, scoped, sizeof(scoped)),
+                       value, bufsz);
+    if (ret != 0)
+    {
+        GWPEpon_SeconnFailed(ctx->sysevent_fd_gs, ret);
+        if (!GWPEpon_SeconnGetStats()->up)
+            GWPEpon_SeconnQueue(name, (char *) value);
+        return ret;
+    }
+    GWPEpon_SeconnRecord(name, (char *) value);
+    // The notification of our own set only comes back through the loop, keep the gates' view current until then
+    GWPEpon_SyseventTrack(name, (char *) value);
+    GWPEpon_GateUpdate(name, (char *) value);
+    return ret;
 }
 
 
@@ -1152,8 +1079,9 @@ static void GWPEpon_StopIPProvisioning()
 {
     GWPROVEPONLOG(INFO, "Entering into %s\n",__FUNCTION__);
 	
-    GWPEpon_StopIPv4Service();
-    GWPEpon_StopIPv6Service();
+    // The clients keep their leases and renew them once the link is back
+    GWPEpon_StopIPv4Service(0);
+    GWPEpon_StopIPv6Service(0);
 
     GWPROVEPONLOG(INFO, "Exiting from %s\n",__FUNCTION__);
 }
@@ -1196,14 +1124,18 @@ static void GWPEpon_ProcessIPProvisioning(EPON_IpProvMode routerIpMode, int upda
     GWPROVEPONLOG(INFO, "Entering into %s\n",__FUNCTION__);
 
     if(update_db)	
+    {
         GWPEpon_SyseventSetInt("cur_router_ip_mode", (int) routerIpMode);	
+        GWPEpon_GetProvState()->router_ip_mode = routerIpMode;
+        GWPEpon_StateChanged();
+    }
 	
     GWPROVEPONLOG(INFO, "routerIpMode=%d\n", routerIpMode);
 
     if (routerIpMode == IpProvModeIpv6Only)
     {
         GWPEpon_StartIPv6Service();
-        GWPEpon_StopIPv4Service();		
+        GWPEpon_StopIPv4Service(1);
     }
     else if( (routerIpMode == IpProvModeDualStack) || (routerIpMode == IpProvModeIpv4DualStack) || (routerIpMode == IpProvModeIpv6DualStack))
     {
@@ -1219,470 +1151,702 @@ static void GWPEpon_ProcessIPProvisioning(EPON_IpProvMode routerIpMode, int upda
     GWPROVEPONLOG(INFO, "Exiting from %s\n",__FUNCTION__)
 }
 
+static void GWPEpon_RecordStatus(char *status, const char *val)
+{
+    snprintf(status, GWPEPON_STATUS_LEN, "%.*s", GWPEPON_STATUS_LEN - 1, val);
+    GWPEpon_StateChanged();
+}
+
 /**************************************************************************/
-/*! \fn void *GWPEpon_sysevent_handler(void *data)
- **************************************************************************
- *  \brief Function to process sysevent event
- *  \return 0
-**************************************************************************/
-static void *GWPEpon_sysevent_handler(void *data)
+/*      EVENT HANDLERS:                                                   */
+/**************************************************************************/
+static void GWPEpon_HandleIfStatus(const GWPEpon_EventArg *ev)
 {
-    GWPROVEPONLOG(INFO, "Entering into %s\n",__FUNCTION__)
+    GWPEpon_ProvState *state = GWPEpon_GetProvState();
 
-    async_id_t epon_ifstatus_asyncid;
-    async_id_t ipv4_status_asyncid;
-    async_id_t ipv6_status_asyncid;
-    async_id_t wan4_ippref_asyncid;
-    async_id_t wan6_ippref_asyncid;
-    async_id_t ipv6_ippref_asyncid;
-    async_id_t ipv4_timeoffset_asyncid;
-    async_id_t ipv6_timeoffset_asyncid;	
-    async_id_t lan_restart_connect_asyncid;
-    async_id_t dhcp_server_status_asyncid;
-    async_id_t eth_status_asyncid;
-    async_id_t moca_status_asyncid;
-    async_id_t wl_status_asyncid;
-    async_id_t xconf_router_ip_mode_asyncid;
-    async_id_t xconf_pod_seed_asyncid;
-    async_id_t xconf_dst_adj_asyncid;
-    async_id_t xconf_gw_prov_mode_asyncid;
-    async_id_t bridge_mode_asyncid;
-    async_id_t firewall_restart_asyncid;
-    async_id_t ipv4_timezone_asyncid;
-    async_id_t ipv6_timezone_asyncid;
-    async_id_t lan_restart_asyncid;
-    async_id_t lan_stop_asyncid;
-    async_id_t lan_status_asyncid;
-    async_id_t forwarding_restart_asyncid;
-    async_id_t dhcpv6_server_asyncid;
-    async_id_t pnm_status_asyncid;
-    async_id_t multinet_syncMembers_asyncid;
-    async_id_t gre_restart_asyncid;
-    async_id_t gre_forceRestart_asyncid;
-
-    /* TSIP event ids */
-    async_id_t tsip_sync_asyncid;
-    async_id_t tsip_stop_asyncid;
-    async_id_t tsip_resync_asyncid;
-    async_id_t tsip_resync_asn_asyncid;
-
-    /* RIPD/Zebra event ids */
-    async_id_t wan_status_asyncid;
-    async_id_t dhcpv6_option_changed_asyncid;
-    async_id_t ripd_restart_asyncid;
-    async_id_t zebra_restart_asyncid;
-    async_id_t staticroute_restart_asyncid;
-
-    static unsigned char firstBoot=1;
-
-    sysevent_set_options(sysevent_fd, sysevent_token, "epon_ifstatus", TUPLE_FLAG_EVENT);
-    sysevent_setnotification(sysevent_fd, sysevent_token, "epon_ifstatus", &epon_ifstatus_asyncid);
-
-    sysevent_set_options(sysevent_fd, sysevent_token, "ipv4-status", TUPLE_FLAG_EVENT);
-    sysevent_setnotification(sysevent_fd, sysevent_token, "ipv4-status",  &ipv4_status_asyncid);
-
-    sysevent_set_options(sysevent_fd, sysevent_token, "wan4_ippref", TUPLE_FLAG_EVENT);
-    sysevent_setnotification(sysevent_fd, sysevent_token, "wan4_ippref",  &wan4_ippref_asyncid);
-
-    sysevent_set_options(sysevent_fd, sysevent_token, "ipv4-timeoffset", TUPLE_FLAG_EVENT);
-    sysevent_setnotification(sysevent_fd, sysevent_token, "ipv4-timeoffset",  &ipv4_timeoffset_asyncid);
-
-    sysevent_set_options(sysevent_fd, sysevent_token, "ipv6-status", TUPLE_FLAG_EVENT);
-    sysevent_setnotification(sysevent_fd, sysevent_token, "ipv6-status",  &ipv6_status_asyncid);
-
-    sysevent_set_options(sysevent_fd, sysevent_token, "wan6_ippref", TUPLE_FLAG_EVENT);
-    sysevent_setnotification(sysevent_fd, sysevent_token, "wan6_ippref",  &wan6_ippref_asyncid);
-
-    sysevent_set_options(sysevent_fd, sysevent_token, "ipv6-timeoffset", TUPLE_FLAG_EVENT);
-    sysevent_setnotification(sysevent_fd, sysevent_token, "ipv6-timeoffset",  &ipv6_timeoffset_asyncid);
-
-    sysevent_set_options(sysevent_fd, sysevent_token, "dhcp_server-restart", TUPLE_FLAG_EVENT);
-    sysevent_setnotification(sysevent_fd, sysevent_token, "dhcp_server-restart",  &dhcp_server_status_asyncid);
-
-    sysevent_set_options(sysevent_fd, sysevent_token, "eth_enabled", TUPLE_FLAG_EVENT);
-    sysevent_setnotification(sysevent_fd, sysevent_token, "eth_enabled",  &eth_status_asyncid);
-
-    sysevent_set_options(sysevent_fd, sysevent_token, "moca_enabled", TUPLE_FLAG_EVENT);
-    sysevent_setnotification(sysevent_fd, sysevent_token, "moca_enabled",  &moca_status_asyncid);
-
-    sysevent_set_options(sysevent_fd, sysevent_token, "wl_enabled", TUPLE_FLAG_EVENT);
-    sysevent_setnotification(sysevent_fd, sysevent_token, "wl_enabled",  &wl_status_asyncid);
-
-    sysevent_set_options(sysevent_fd, sysevent_token, "xconf_router_ip_mode", TUPLE_FLAG_EVENT);
-    sysevent_setnotification(sysevent_fd, sysevent_token, "xconf_router_ip_mode",  &xconf_router_ip_mode_asyncid);
-
-    sysevent_set_options(sysevent_fd, sysevent_token, "xconf_pod_seed", TUPLE_FLAG_EVENT);
-    sysevent_setnotification(sysevent_fd, sysevent_token, "xconf_pod_seed",  &xconf_pod_seed_asyncid);
-
-    sysevent_set_options(sysevent_fd, sysevent_token, "xconf_dst_adj", TUPLE_FLAG_EVENT);
-    sysevent_setnotification(sysevent_fd, sysevent_token, "xconf_dst_adj",  &xconf_dst_adj_asyncid);
-
-    sysevent_set_options(sysevent_fd, sysevent_token, "xconf_gw_prov_mode", TUPLE_FLAG_EVENT);
-    sysevent_setnotification(sysevent_fd, sysevent_token, "xconf_gw_prov_mode",  &xconf_gw_prov_mode_asyncid);
-
-    sysevent_set_options(sysevent_fd, sysevent_token, "bridge_mode", TUPLE_FLAG_EVENT);
-    sysevent_setnotification(sysevent_fd, sysevent_token, "bridge_mode",  &bridge_mode_asyncid);
-
-    sysevent_set_options(sysevent_fd_gs, sysevent_token, "gw_prov_status", TUPLE_FLAG_EVENT);
-    sysevent_set_options(sysevent_fd_gs, sysevent_token, "gw_prov_status_str", TUPLE_FLAG_EVENT);
-    sysevent_set_options(sysevent_fd_gs, sysevent_token, "cur_gw_prov_mode", TUPLE_FLAG_EVENT);
-    sysevent_set_options(sysevent_fd_gs, sysevent_token, "cur_router_ip_mode", TUPLE_FLAG_EVENT);
-	
-    sysevent_set_options(sysevent_fd, sysevent_token, "firewall-restart", TUPLE_FLAG_EVENT);
-    sysevent_setnotification(sysevent_fd, sysevent_token, "firewall-restart",  &firewall_restart_asyncid);
+    GWPEpon_RecordStatus(state->epon_ifstatus, ev->val);
+    if (ev->ival == 1)
+    {
+        GWPEpon_ProcessIfUp();
 
-    sysevent_set_options(sysevent_fd, sysevent_token, "ipv4_timezone", TUPLE_FLAG_EVENT);
-    sysevent_setnotification(sysevent_fd, sysevent_token, "ipv4_timezone",  &ipv4_timezone_asyncid);
+        state->erouter_reset_count += 1;
+        GWPEpon_StateChanged();
+        GWPEpon_SyseventSetInt("erouter_reset_count", state->erouter_reset_count);
+        GWPROVEPONLOG(INFO, "erouter_reset_count=%d\n",state->erouter_reset_count)
+    }
+    else if (ev->ival == 0)
+    {
+        GWPEpon_ProcessIfDown();
+        GWPEpon_SyseventSetStr("wan-status", "stopped", sizeof("stopped"));      //XF3-5230
+    }
+}
 
-    sysevent_set_options(sysevent_fd, sysevent_token, "ipv6_timezone", TUPLE_FLAG_EVENT);
-    sysevent_setnotification(sysevent_fd, sysevent_token, "ipv6_timezone",  &ipv6_timezone_asyncid);
+static void GWPEpon_HandleIpv4Status(const GWPEpon_EventArg *ev)
+{
+    GWPEpon_RecordStatus(GWPEpon_GetProvState()->ipv4_status, ev->val);
+    if (ev->ival == 1)
+    {
+        GWPEpon_DhcpcBound(GWPEPON_DHCPC_V4);
+        GWPEpon_ProcessIpv4Up();
+    }
+    else if (ev->ival == 0)
+        GWPEpon_ProcessIpv4Down();
+}
 
-    sysevent_set_options(sysevent_fd, sysevent_token, "lan-restart", TUPLE_FLAG_EVENT);
-    sysevent_setnotification(sysevent_fd, sysevent_token, "lan-restart",  &lan_restart_asyncid);
+static void GWPEpon_HandleIpv6Status(const GWPEpon_EventArg *ev)
+{
+    GWPEpon_RecordStatus(GWPEpon_GetProvState()->ipv6_status, ev->val);
+    if (ev->ival == 1)
+    {
+        GWPEpon_DhcpcBound(GWPEPON_DHCPC_V6);
+        GWPEpon_ProcessIpv6Up();
+    }
+    else
+        GWPEpon_ProcessIpv6Down();
+}
 
-    sysevent_set_options(sysevent_fd, sysevent_token, "lan-stop", TUPLE_FLAG_EVENT);
-    sysevent_setnotification(sysevent_fd, sysevent_token, "lan-stop",  &lan_stop_asyncid);
+static void GWPEpon_HandleWANIpPref(const GWPEpon_EventArg *ev)
+{
+    GWPEpon_ProcessWANIpPref();
+}
 
-    sysevent_set_options(sysevent_fd, sysevent_token, "lan-status", TUPLE_FLAG_EVENT);
-    sysevent_setnotification(sysevent_fd, sysevent_token, "lan-status",  &lan_status_asyncid);
+static void GWPEpon_HandleIpv4Timeoffset(const GWPEpon_EventArg *ev)
+{
+    GWPEpon_ProcessIpv4Timeoffset();
+}
 
-    sysevent_set_options(sysevent_fd, sysevent_token, "forwarding-restart", TUPLE_FLAG_EVENT);
-    sysevent_setnotification(sysevent_fd, sysevent_token, "forwarding-restart",  &forwarding_restart_asyncid);
+static void GWPEpon_HandleIpv6Timeoffset(const GWPEpon_EventArg *ev)
+{
+    GWPEpon_ProcessIpv6Timeoffset();
+}
 
-    sysevent_set_options(sysevent_fd, sysevent_token, "dhcpv6s_server", TUPLE_FLAG_EVENT);
-    sysevent_setnotification(sysevent_fd, sysevent_token, "dhcpv6s_server",  &dhcpv6_server_asyncid);
+static void GWPEpon_HandleXconfRouterIpMode(const GWPEpon_EventArg *ev)
+{
+    if (ev->ival == 1)
+        GWPEpon_ProcessXconfRouterIpMode();
+}
 
-    //sysevent_set_options(sysevent_fd, sysevent_token, "pnm-status", TUPLE_FLAG_EVENT);
-    sysevent_setnotification(sysevent_fd, sysevent_token, "pnm-status",&pnm_status_asyncid);
+static void GWPEpon_HandleXconfPoDSeed(const GWPEpon_EventArg *ev)
+{
+    if (ev->ival == 1)
+        GWPEpon_ProcessXconfPoDSeed();
+}
 
-    sysevent_set_options(sysevent_fd, sysevent_token, "multinet-syncMembers", TUPLE_FLAG_EVENT);
-    sysevent_setnotification(sysevent_fd, sysevent_token, "multinet-syncMembers",  &multinet_syncMembers_asyncid);
-    
-    sysevent_set_options(sysevent_fd, sysevent_token, "gre-restart", TUPLE_FLAG_EVENT);
-    sysevent_setnotification(sysevent_fd, sysevent_token, "gre-restart",  &gre_restart_asyncid);
-    
-    sysevent_set_options(sysevent_fd, sysevent_token, "gre-forceRestart", TUPLE_FLAG_EVENT);
-    sysevent_setnotification(sysevent_fd, sysevent_token, "gre-forceRestart",  &gre_forceRestart_asyncid);
-
-    /* True Static IP events */
-    sysevent_set_options    (sysevent_fd, sysevent_token, "ipv4-sync_tsip_all", TUPLE_FLAG_EVENT);
-    sysevent_setnotification(sysevent_fd, sysevent_token, "ipv4-sync_tsip_all",  &tsip_sync_asyncid);
-    sysevent_set_options    (sysevent_fd, sysevent_token, "ipv4-stop_tsip_all", TUPLE_FLAG_EVENT);
-    sysevent_setnotification(sysevent_fd, sysevent_token, "ipv4-stop_tsip_all",  &tsip_stop_asyncid);
-    sysevent_set_options    (sysevent_fd, sysevent_token, "ipv4-resync_tsip", TUPLE_FLAG_EVENT);
-    sysevent_setnotification(sysevent_fd, sysevent_token, "ipv4-resync_tsip",  &tsip_resync_asyncid);
-    sysevent_set_options    (sysevent_fd, sysevent_token, "ipv4-resync_tsip_asn", TUPLE_FLAG_EVENT);
-    sysevent_setnotification(sysevent_fd, sysevent_token, "ipv4-resync_tsip_asn",  &tsip_resync_asn_asyncid);
-
-    /* Route events to start ripd and zebra */
-    sysevent_set_options    (sysevent_fd, sysevent_token, "lan-status", TUPLE_FLAG_EVENT);
-    sysevent_setnotification(sysevent_fd, sysevent_token, "lan-status",  &lan_status_asyncid);
-    sysevent_set_options    (sysevent_fd, sysevent_token, "wan-status", TUPLE_FLAG_EVENT);
-    sysevent_setnotification(sysevent_fd, sysevent_token, "wan-status",  &wan_status_asyncid);
-    sysevent_set_options    (sysevent_fd, sysevent_token, "dhcpv6_option_changed", TUPLE_FLAG_EVENT);
-    sysevent_setnotification(sysevent_fd, sysevent_token, "dhcpv6_option_changed",  &dhcpv6_option_changed_asyncid);
-    sysevent_set_options    (sysevent_fd, sysevent_token, "ripd-restart", TUPLE_FLAG_EVENT);
-    sysevent_setnotification(sysevent_fd, sysevent_token, "ripd-restart",  &ripd_restart_asyncid);
-    sysevent_set_options    (sysevent_fd, sysevent_token, "zebra-restart", TUPLE_FLAG_EVENT);
-    sysevent_setnotification(sysevent_fd, sysevent_token, "zebra-restart",  &zebra_restart_asyncid);
-    sysevent_set_options    (sysevent_fd, sysevent_token, "staticroute-restart", TUPLE_FLAG_EVENT);
-    sysevent_setnotification(sysevent_fd, sysevent_token, "staticroute-restart",  &staticroute_restart_asyncid);
-
-   for (;;)
-   {
-        unsigned char name[25], val[42];
-        int namelen = sizeof(name);
-        int vallen  = sizeof(val);
-        int err;
-        async_id_t getnotification_asyncid;
+static void GWPEpon_HandleXconfDstAdj(const GWPEpon_EventArg *ev)
+{
+    if (ev->ival == 1)
+        GWPEpon_ProcessXconfDstAdj();
+}
 
-        if (firstBoot)
-        {
-           /* In case we missed an event notification before the thread starts */
-           strcpy(name,"epon_ifstatus");
-           err = GWPEpon_SyseventGetStr(name, val, vallen);
-           firstBoot = 0;
+static void GWPEpon_HandleXconfGwProvMode(const GWPEpon_EventArg *ev)
+{
+    if (ev->ival == 1)
+        GWPEpon_ProcessXconfGwProvMode();
+}
 
-           if (strcmp(val, "down")==0)
-	 	continue;
-        }
-        else
-           err = sysevent_getnotification(sysevent_fd, sysevent_token, name, &namelen,  val, &vallen, &getnotification_asyncid);
+static void GWPEpon_HandleBridgeMode(const GWPEpon_EventArg *ev)
+{
+    GWPEpon_BridgeRequest(ev->ival != 0);
+}
 
-        if (err)
-        {
-           GWPROVEPONLOG(ERROR, "sysevent_getnotification failed with error: %d\n", err)
-        }
-        else
-        {
-            GWPROVEPONLOG(WARNING, "received notification event %s\n", name)
+static void GWPEpon_HandleIpv4Timezone(const GWPEpon_EventArg *ev)
+{
+    GWPEpon_ProcessIpv4Timezone();
+}
 
-            if (strcmp(name, "epon_ifstatus")==0)
-            {
-                if (strcmp(val, "up")==0)
-                {
-                    GWPEpon_ProcessIfUp();
+static void GWPEpon_HandleIpv6Timezone(const GWPEpon_EventArg *ev)
+{
+    GWPEpon_ProcessIpv6Timezone();
+}
 
-                    erouter_reset_count += 1;
-                    GWPEpon_SyseventSetInt("erouter_reset_count", erouter_reset_count);
-                    GWPROVEPONLOG(INFO, "erouter_reset_count=%d\n",erouter_reset_count)
-                }
-                else if (strcmp(val, "down")==0)
-                {
-                    GWPEpon_ProcessIfDown();
-		    GWPEpon_SyseventSetStr("wan-status", "stopped", sizeof("stopped"));      //XF3-5230
-                }
-            }
-            else if (strcmp(name, "ipv4-status")==0)
-            {
-                if (strcmp(val, "up")==0)
-                {
-                    GWPEpon_ProcessIpv4Up();
-                }
-                else if (strcmp(val, "down")==0)
-                {
-                    GWPEpon_ProcessIpv4Down();
-                }
-            }
-            else if (strcmp(name, "ipv6-status")==0)
-            {
-                if (strcmp(val, "up")==0)
-                {
-                    GWPEpon_ProcessIpv6Up();
-                }
-                else
-                {
-                    GWPEpon_ProcessIpv6Down();
-                }
-            }
-            else if (strcmp(name, "wan4_ippref")==0)
-            {
-                GWPEpon_ProcessWANIpPref();            
-            }
-            else if (strcmp(name, "wan6_ippref")==0)
-            {
-                GWPEpon_ProcessWANIpPref();           
-            }		
-            else if (strcmp(name, "ipv4-timeoffset")==0)
-            {
-                GWPEpon_ProcessIpv4Timeoffset();
-            }
-            else if (strcmp(name, "ipv6-timeoffset")==0)
-            {
-                GWPEpon_ProcessIpv6Timeoffset();
-            }
-            else if ( (strcmp(name, "dhcp_server-restart")==0) || (strcmp(name, "dhcpv6s_server")==0) )
-            {
-                GWPEpon_ProcessDHCPStart();
-            }
-           else if (strcmp(name, "eth_enabled")==0)
-            {
-                if (strcmp(val, "1")==0)
-                {
-                    GWPEpon_ProcessEthEnable();
-                }
-                else if (strcmp(val, "0")==0)
-                {
-                    GWPEpon_ProcessEthDisable();
-                }
-            }
-            else if (strcmp(name, "moca_enabled")==0)
-            {
-                if (strcmp(val, "1")==0)
-                {
-                    GWPEpon_ProcessMoCAEnable();
-                }
-                else if (strcmp(val, "0")==0)
-                {
-                    GWPEpon_ProcessMoCADisable();
-                }
-            }
-            else if (strcmp(name, "wl_enabled")==0)
-            {
-                if (strcmp(val, "1")==0)
-                {
-                    GWPEpon_ProcessWlEnable();
-                }
-                else if (strcmp(val, "0")==0)
-                {
-                    GWPEpon_ProcessWlDisable();
-                }
-            }
-            else if (strcmp(name, "xconf_router_ip_mode")==0)
-            {
-                if (strcmp(val, "1")==0)
-                {
-                    GWPEpon_ProcessXconfRouterIpMode();
-                }
-            }
-            else if (strcmp(name, "xconf_pod_seed")==0)
-            {
-                if (strcmp(val, "1")==0)
-                {
-                    GWPEpon_ProcessXconfPoDSeed();
-                }
-            }
-            else if (strcmp(name, "xconf_dst_adj")==0)
-            {
-                if (strcmp(val, "1")==0)
-                {
-                    GWPEpon_ProcessXconfDstAdj();
-                }
-            }
-            else if (strcmp(name, "xconf_gw_prov_mode")==0)
-            {
-                if (strcmp(val, "1")==0)
-                {
-                    GWPEpon_ProcessXconfGwProvMode();
-                }
-            }
-            else if (strcmp(name, "bridge_mode")==0)
-            {
-                if (strcmp(val, "0")==0)
-                {
-                    GWPEpon_ProcessBridgeModeDisable();
-                }
-                else
-                {
-                    GWPEpon_ProcessBridgeModeEnable();
-                }
-            }
-            else if (strcmp(name, "firewall-restart")==0)
-            {
-                GWPEpon_ProcessFirewallRestart();
-            }
-            else if (strcmp(name, "gre-restart")==0 || strcmp(name, "gre-forceRestart")==0)
-            {
-                GWPEpon_ProcessGreRestart(val);
-            }
-            else if (strcmp(name, "ipv4_timezone") == 0)
-            {
-                GWPEpon_ProcessIpv4Timezone();
-            }
-            else if (strcmp(name, "ipv6_timezone") == 0)
-            {
-                GWPEpon_ProcessIpv6Timezone();
-            }
-            else if ((strcmp(name, "lan-status") == 0 ||
-                     strcmp(name, "wan-status") == 0) &&
-                     strcmp(val, "started") == 0)
-            {
-                int restartFirewall = 0;
-                // When lan-status and wan-status started, only call functions when both are started
-                // or bad things will happen
-                do
-                {
-                    unsigned char lan_status[20];
-                    unsigned char wan_status[20];
-                    
-                    // Make sure lan-status is started first...
-                    lan_status[0] = '\0';
-                    if (GWPEpon_SyseventGetStr("lan-status", lan_status, sizeof(lan_status)) < 0)
-                    {
-                        break;
-                    }
-                    
-                    if (strcmp(lan_status, "started") != 0)
-                    {
-                        break;
-                    }
-                    
-                    // Make sure wan-status is started second...
-                    wan_status[0] = '\0';
-                    if (GWPEpon_SyseventGetStr("wan-status", wan_status, sizeof(wan_status)) < 0)
-                    {
-                        break;
-                    }
-                    
-                    if (strcmp(wan_status, "started") != 0)
-                    {
-                        break;
-                    }
-
-                    GWPEpon_ProcessRIPD("wan-status", "started");
-                    restartFirewall = 1;
-                } while (0);
-
-                if (strcmp(name, "lan-status") == 0)
-                {
-                     GWPEpon_ProcessLanStatus();
-                }
-                
-                if (restartFirewall == 1)
-                {
-                    GWPEpon_ProcessFirewallRestart();
-                }
-            }
-            else if (strcmp(name, "lan-restart") == 0)
-            {
-                if (strcmp(val, "1")==0)
-                {
-                    GWPEpon_ProcessLanRestart();
-                }
-            }
-            else if (strcmp(name, "lan-stop") == 0)
-            {
-	        GWPEpon_ProcessLanStop();
-            }
-            else if (strcmp(name, "forwarding-restart") == 0)
-            {
-	        GWPEpon_ProcessForwardingRestart();
-            }
-            else if (strcmp(name, "pnm-status") == 0)
-            {
-             	if (strcmp(val, "up")==0)
-                 {
-                     GWPEpon_ProcessPNM_Status();
-                 }
-            }
-             else if (strcmp(name, "multinet-syncMembers") == 0)
-            {
-             	if (strcmp(val, "2")==0) //So we can switch the port instantly from UI request
-             	{
-             	   GWPEpon_ProcessLanEth0ToXHS();
-             	}
-             	else
-             	{
-                    GWPEpon_ProcessLanEth0ToLocalNetwork();
-             	}
-            }
-            /* Process tsip events */
-            else if (strcmp(name, "ipv4-sync_tsip_all") == 0 ||
-                     strcmp(name, "ipv4-stop_tsip_all") == 0 ||
-                     strcmp(name, "ipv4-resync_tsip") == 0 ||
-                     strcmp(name, "ipv4-resync_tsip_asn") == 0)
-            {
-                 GWPEpon_ProcessTSIP(name, val);
-            }
-            /* Process RIPD/Zebra events */
-            else if (strcmp(name, "lan-status") == 0 ||
-                     strcmp(name, "wan-status") == 0 ||
-                     strcmp(name, "dhcpv6_option_changed") == 0 ||
-                     strcmp(name, "ripd-restart") == 0 ||
-                     strcmp(name, "zebra-restart") == 0 ||
-                     strcmp(name, "staticroute-restart") == 0)
+static void GWPEpon_HandleLanStatus(const GWPEpon_EventArg *ev)
+{
+    // "started" is handled by the routing gate once wan-status is started too
+    if (strcmp(ev->val, "started") != 0)
+        GWPEpon_RoutedUpdate(ev->name, ev->val);
+    GWPEpon_ProcessLanStatus();
+}
+
+static void GWPEpon_HandleWanStatus(const GWPEpon_EventArg *ev)
+{
+    if (strcmp(ev->val, "started") != 0)
+        GWPEpon_RoutedUpdate(ev->name, ev->val);
+}
+
+static void GWPEpon_HandleRouted(const GWPEpon_EventArg *ev)
+{
+    GWPEpon_RoutedUpdate(ev->name, ev->val);
+}
+
+static void GWPEpon_HandleStaticRoute(const GWPEpon_EventArg *ev)
+{
+    GWPEpon_RouteApplyStatic();
+}
+
+static void GWPEpon_HandlePortEnable(const GWPEpon_EventArg *ev)
+{
+    GWPEpon_PortSet(ev->name, ev->ival);
+}
+
+static void GWPEpon_HandleDHCPServer(const GWPEpon_EventArg *ev)
+{
+    GWPEpon_DhcpsRequest(ev->name);
+}
+
+static void GWPEpon_HandleSyncMembers(const GWPEpon_EventArg *ev)
+{
+    GWPEpon_MemberRequest(ev->ival);
+}
+
+static void GWPEpon_HandleFirewall(const GWPEpon_EventArg *ev)
+{
+    GWPEpon_FwRequest(ev->name);
+}
+
+static void GWPEpon_HandleGre(const GWPEpon_EventArg *ev)
+{
+    GWPEpon_GreRequest(strcmp(ev->name, "gre-forceRestart") == 0);
+}
+
+static void GWPEpon_HandleTSIP(const GWPEpon_EventArg *ev)
+{
+    GWPEpon_TsipRequest(ev->name, ev->val);
+}
+
+static void GWPEpon_HandlePNMStatus(const GWPEpon_EventArg *ev)
+{
+    if (ev->ival == 1)
+        GWPEpon_ProcessPNM_Status();
+}
+
+const GWPEpon_EventDesc gwpepon_event_table[GWPEPON_EV_COUNT] =
+{
+    GWPEPON_EVENT_LIST(GWPEPON_EVENT_DESC)
+};
+
+static int GWPEpon_EventQueueFull(void)
+{
+    int cls;
+
+    for (cls = 0; cls < GWPEPON_CLASS_COUNT; cls++)
+    {
+        if (event_queues[cls].count == GWPEPON_EVENT_QUEUE_LEN)
+            return 1;
+    }
+    return 0;
+}
+
+/**************************************************************************/
+/*! \fn static void GWPEpon_EventSupersede(GWPEpon_EventId id)
+ **************************************************************************
+ *  \brief Drop the queued values of event id, a newer one replaces them
+ *  \return void
+**************************************************************************/
+static void GWPEpon_EventSupersede(GWPEpon_EventId id)
+{
+    GWPEpon_EventQueue *queue;
+    int cls, i, kept;
+
+    for (cls = 0; cls < GWPEPON_CLASS_COUNT; cls++)
+    {
+        queue = &event_queues[cls];
+        for (i = 0, kept = 0; i < queue->count; i++)
+        {
+            GWPEpon_Event *ev = &queue->events[(queue->head + i) % GWPEPON_EVENT_QUEUE_LEN];
+
+            if (ev->id == id)
             {
-                GWPEpon_ProcessRIPD(name, val);
-                if (strcmp(name, "lan-status") == 0)
-                {
-                     GWPEpon_ProcessLanStatus();
-                }
+                GWPROVEPONLOG(INFO, "%s=%s superseded\n", gwpepon_event_table[id].name, ev->val)
+                GWPEpon_EventSuperseded(id);
+                continue;
             }
-            else
-            {
-               GWPROVEPONLOG(WARNING, "undefined event %s \n",name)
-            }			
+            if (kept != i)
+                queue->events[(queue->head + kept) % GWPEPON_EVENT_QUEUE_LEN] = *ev;
+            kept++;
+        }
+        queue->count = kept;
+    }
+}
+
+static int GWPEpon_EventEnqueue(const char *name, const char *val)
+{
+    GWPEpon_EventQueue *queue;
+    GWPEpon_Event *ev;
+    int id = GWPEpon_EventLookup(GWPEpon_CtxUnscope(name));
+
+    if (id < 0)
+    {
+        GWPROVEPONLOG(WARNING, "undefined event %s \n",name)
+        return -1;
+    }
+    if (GWPEpon_EvConfPolicy((GWPEpon_EventId) id)->supersede)
+        GWPEpon_EventSupersede((GWPEpon_EventId) id);
+
+    queue = &event_queues[GWPEpon_EventClassOf((GWPEpon_EventId) id)];
+    if (queue->count == GWPEPON_EVENT_QUEUE_LEN)
+    {
+        GWPROVEPONLOG(ERROR, "event queue full, dropping %s\n", name)
+        GWPEpon_EventDropped((GWPEpon_EventId) id);
+        return -1;
+    }
+
+    ev = &queue->events[(queue->head + queue->count) % GWPEPON_EVENT_QUEUE_LEN];
+    ev->id = (GWPEpon_EventId) id;
+    snprintf(ev->val, sizeof(ev->val), "%s", val);
+    ev->enqueue_ms = GWPEpon_NowMs();
+    queue->count++;
+    return 0;
+}
+
+static void GWPEpon_SyseventTrack(const char *name, const char *val)
+{
+    int id = GWPEpon_EventLookup(GWPEpon_CtxUnscope(name));
+
+    if (id >= 0 && (gwpepon_event_table[id].flags & GWPEPON_EVF_STATE))
+        snprintf(event_state_vals[id], sizeof(event_state_vals[id]), "%s", val);
+}
+
+/**************************************************************************/
+/*! \fn static void GWPEpon_SyseventDrain(void)
+ **************************************************************************
+ *  \brief Queue every notification already waiting on the socket
+ *  \return void
+**************************************************************************/
+static void GWPEpon_SyseventDrain(void)
+{
+    GWPEpon_WanCtx *ctx = GWPEpon_CtxCurrent();
+    struct pollfd pfd;
+
+    pfd.fd = ctx->sysevent_fd;
+    pfd.events = POLLIN;
+    while (!GWPEpon_EventQueueFull() && (poll(&pfd, 1, 0) > 0))
+    {
+        char name[GWPEPON_EVENT_NAME_LEN], val[GWPEPON_EVENT_VAL_LEN];
+        int namelen = sizeof(name);
+        int vallen  = sizeof(val);
+        int err;
+        async_id_t getnotification_asyncid;
+
+        err = sysevent_getnotification(ctx->sysevent_fd, ctx->sysevent_token, name, &namelen,  val, &vallen, &getnotification_asyncid);
+        if (err)
+        {
+           // A closed connection is reopened in the background, never read in a loop
+           GWPEpon_SeconnFailed(ctx->sysevent_fd, err);
+           break;
         }
+        GWPEpon_SeconnOk();
+
+        GWPROVEPONLOG(WARNING, "received notification event %s\n", name)
+        GWPEpon_SyseventTrack(name, val);
+        GWPEpon_EventEnqueue(name, val);
+        // Leave the rest in the socket once a queue is full, epoll reports it again
+    }
+}
+
+/**************************************************************************/
+/*! \fn static int GWPEpon_EventDequeue(GWPEpon_Event *ev)
+ **************************************************************************
+ *  \brief Take the next event: the oldest of the most urgent class, unless
+ *    a less urgent one waited past its age limit. Aged events alternate
+ *    with urgent ones so neither side can starve the other.
+ *  \return 1 when an event was taken, 0 when the queues are empty
+**************************************************************************/
+static int GWPEpon_EventDequeue(GWPEpon_Event *ev)
+{
+    unsigned long long now = GWPEpon_NowMs();
+    GWPEpon_EventQueue *queue;
+    int pick = -1;
+    int aged = 0;
+    int cls;
+
+    for (cls = 0; cls < GWPEPON_CLASS_COUNT; cls++)
+    {
+        queue = &event_queues[cls];
+        if (queue->count == 0)
+            continue;
+        if (pick < 0)
+        {
+            pick = cls;
+            if (event_last_aged)
+                break;
+        }
+        else if (now - queue->events[queue->head].enqueue_ms >= event_class_age_ms[cls])
+        {
+            pick = cls;
+            aged = 1;
+            break;
+        }
+    }
+    if (pick < 0)
+        return 0;
+
+    queue = &event_queues[pick];
+    *ev = queue->events[queue->head];
+    queue->head = (queue->head + 1) % GWPEPON_EVENT_QUEUE_LEN;
+    queue->count--;
+    event_last_aged = aged;
+
+    GWPEpon_EventClassWait((GWPEpon_EventClass) pick, now - ev->enqueue_ms, aged);
+    return 1;
+}
+
+static void GWPEpon_EventDispatchAll(void)
+{
+    GWPEpon_Event ev;
+    const char *name;
+
+    while (GWPEpon_EventDequeue(&ev))
+    {
+        name = gwpepon_event_table[ev.id].name;
+
+        // A status already fed from the kernel is only a confirmation now
+        if (GWPEpon_WanMonAbsorb(name, ev.val))
+            continue;
+        // A flapping status is held, neither its handler nor the gates see it
+        if (GWPEpon_DampFilter(ev.id, ev.val))
+            continue;
+        // Restart events raised by a bridge mode switch run once at the end of the switch
+        if (!GWPEpon_BridgeAbsorbEvent(name, ev.val))
+            GWPEpon_EventDispatch(ev.id, ev.val, ev.enqueue_ms);
+        // Gates see the event after its own handler ran
+        GWPEpon_GateUpdate(name, ev.val);
+        // Let WAN events that arrived meanwhile overtake the queued housekeeping
+        GWPEpon_SyseventDrain();
     }
+}
+
+/**************************************************************************/
+/*! \fn static void GWPEpon_SyseventReadable
+ **************************************************************************
+ *  \brief Drain every pending notification, then dispatch them in order
+ *  \return void
+**************************************************************************/
+static void GWPEpon_SyseventReadable(int fd, unsigned int events, void *arg)
+{
+    GWPEpon_SyseventDrain();
+    if (events & (EPOLLERR | EPOLLHUP))
+        GWPEpon_SeconnLost("connection closed");
+    GWPEpon_EventDispatchAll();
+}
+
+static void GWPEpon_DampRelease(GWPEpon_EventId id, const char *val)
+{
+    GWPROVEPONLOG(INFO, "releasing damped %s=%s\n", gwpepon_event_table[id].name, val)
+    GWPEpon_EventEnqueue(gwpepon_event_table[id].name, val);
+    GWPEpon_EventDispatchAll();
+}
+
+static int GWPEpon_EventInject(const char *name, const char *val)
+{
+    int ret = GWPEpon_EventEnqueue(name, val);
+
+    GWPEpon_EventDispatchAll();
+    return ret;
+}
+
+static void GWPEpon_PostRequest(unsigned int req)
+{
+    GWPEpon_WanCtx *ctx;
+    int i;
+
+    // Signals are only read by the primary context, it forwards them to the others
+    for (i = 1; (ctx = GWPEpon_CtxGet(i)) != NULL; i++)
+    {
+        if (ctx->running && GWPEpon_CtxRequest(ctx, req) < 0)
+            GWPROVEPONLOG(ERROR, "cannot post request 0x%x to WAN context %s: %s\n", req, ctx->ifname, strerror(errno))
+    }
+}
+
+static void GWPEpon_ProcessTerminate(int signo, void *arg)
+{
+    GWPROVEPONLOG(WARNING, "received signal %d, stopping\n", signo)
+    GWPEpon_PostRequest(GWPEPON_CTX_REQ_STOP);
+    GWPEpon_CkptFlush();
+    GWPEpon_EvLoopStop();
+}
+
+/**************************************************************************/
+/*! \fn static void GWPEpon_ProcessReload(int signo, void *arg)
+ **************************************************************************
+ *  \brief SIGHUP: recompile the event config of every context. Queued
+ *    events and pending debounces are kept, they run against the new
+ *    table the next time they are dispatched.
+ *  \return void
+**************************************************************************/
+static void GWPEpon_ProcessReload(int signo, void *arg)
+{
+    GWPROVEPONLOG(INFO, "received signal %d, reloading %s\n", signo, GWPEPON_EVCONF_FILE)
+    GWPEpon_PostRequest(GWPEPON_CTX_REQ_RELOAD);
+    GWPEpon_EvConfLoad(GWPEPON_EVCONF_FILE);
+}
+
+static void GWPEpon_ProcessContextRequests(int fd, unsigned int events, void *arg)
+{
+    GWPEpon_WanCtx *ctx = GWPEpon_CtxCurrent();
+    unsigned int req = GWPEpon_CtxTakeRequests(ctx);
+
+    if (req & GWPEPON_CTX_REQ_STOP)
+    {
+        GWPROVEPONLOG(WARNING, "stopping WAN context %s\n", ctx->ifname)
+        GWPEpon_CkptFlush();
+        GWPEpon_EvLoopStop();
+        return;
+    }
+    if (req & GWPEPON_CTX_REQ_RELOAD)
+        GWPEpon_EvConfLoad(GWPEPON_EVCONF_FILE);
+}
+
+static int GWPEpon_GateRouting(const char *gate, void *arg)
+{
+    GWPEpon_RoutedUpdate("wan-status", "started");
+    GWPEpon_ProcessFirewallRestart();
+    return 0;
+}
+
+static int GWPEpon_GateXconf(const char *gate, void *arg)
+{
+    return GWPEpon_XconfGetSettings();
+}
+
+static int GWPEpon_GateLanWanConnect(const char *gate, void *arg)
+{
+    return GWPEpon_ProcessLanWanConnect((arg != NULL) ? EPON_OPER_IPV6_UP : EPON_OPER_IPV4_UP);
+}
+
+static void GWPEpon_GateLanWanDisconnect(const char *gate, void *arg)
+{
+    GWPEpon_ProcessLanWanConnect((arg != NULL) ? EPON_OPER_IPV6_DOWN : EPON_OPER_IPV4_DOWN);
+}
+
+/**************************************************************************/
+/*! \fn static void GWPEpon_RegisterGates()
+ **************************************************************************
+ *  \brief Declare the actions that wait for several tuples to be ready
+ *  \return void
+**************************************************************************/
+static void GWPEpon_RegisterGates()
+{
+    static int ipv6_family = 1;
+
+    GWPEpon_GateInit();
+
+    // ripd/zebra and the firewall need both sides of the router up, or bad things will happen
+    GWPEpon_GateAdd("routing", "lan-status==started && wan-status==started",
+                    GWPEpon_GateRouting, NULL, NULL);
+    // One per family, xconf settings are fetched again when each of them comes up
+    GWPEpon_GateAdd("xconf_v4", "ipv4-status==up", GWPEpon_GateXconf, NULL, NULL);
+    GWPEpon_GateAdd("xconf_v6", "ipv6-status==up", GWPEpon_GateXconf, NULL, NULL);
+    GWPEpon_GateAdd("lan_wan_v4", "ipv4-status==up && cur_gw_prov_mode==provisioned",
+                    GWPEpon_GateLanWanConnect, GWPEpon_GateLanWanDisconnect, NULL);
+    GWPEpon_GateAdd("lan_wan_v6", "ipv6-status==up && cur_gw_prov_mode==provisioned",
+                    GWPEpon_GateLanWanConnect, GWPEpon_GateLanWanDisconnect, &ipv6_family);
+
+    // A resumed instance already ran the actions of the gates that are ready
+    if (GWPEpon_CtxCurrent()->warm_restart)
+        GWPEpon_GateLatch();
+}
+
+/* Tuples only the daemon sets, published again when a restarted syseventd lost them */
+static const char *const sysevent_owned[] =
+{
+    "gw_prov_status",
+    "gw_prov_status_str",
+    "cur_gw_prov_mode",
+    "cur_router_ip_mode",
+    "erouter_reset_count",
+    GWPEPON_BRIDGE_TRANSITION_TUPLE,
+    GWPEPON_BRIDGE_SWITCH_MS_TUPLE,
+    GWPEPON_BRIDGE_SWITCH_CNT_TUPLE,
+    GWPEPON_ACTION_FAILED_TUPLE,
+    GWPEPON_ACTION_FAILURES_TUPLE,
+    GWPEPON_DHCPS_AVOIDED_TUPLE,
+    GWPEPON_TSIP_AVOIDED_TUPLE,
+    NULL
+};
+
+static void GWPEpon_SyseventMarkEvent(const char *name)
+{
+    GWPEpon_WanCtx *ctx = GWPEpon_CtxCurrent();
+    char scoped[GWPEPON_CTX_TUPLE_LEN];
+
+    sysevent_set_options(ctx->sysevent_fd_gs, ctx->sysevent_token_gs,
+                         (char *) GWPEpon_CtxTuple(name, scoped, sizeof(scoped)), TUPLE_FLAG_EVENT);
+}
+
+static void GWPEpon_SyseventMarkEvents(void)
+{
+    GWPEpon_SyseventMarkEvent("gw_prov_status");
+    GWPEpon_SyseventMarkEvent("gw_prov_status_str");
+    GWPEpon_SyseventMarkEvent("cur_gw_prov_mode");
+    GWPEpon_SyseventMarkEvent("cur_router_ip_mode");
+}
+
+/**************************************************************************/
+/*! \fn static int GWPEpon_SyseventResubscribe(void)
+ **************************************************************************
+ *  \brief Subscribe the reopened sysevent connections, then dispatch the
+ *    state tuples that changed while they were down
+ *  \return number of tuples dispatched, -1 on failure
+**************************************************************************/
+static int GWPEpon_SyseventResubscribe(void)
+{
+    GWPEpon_WanCtx *ctx = GWPEpon_CtxCurrent();
+    int primary = GWPEpon_CtxIsPrimary();
+    char val[GWPEPON_EVENT_VAL_LEN];
+    int replayed = 0;
+    int id;
+
+    if (GWPEpon_EventRegister(ctx->sysevent_fd, ctx->sysevent_token) > 0 ||
+        GWPEpon_EvLoopAddFd(ctx->sysevent_fd, EPOLLIN, GWPEpon_SyseventReadable, NULL) < 0)
+        return -1;
+    GWPEpon_SyseventMarkEvents();
+
+    for (id = 0; id < GWPEPON_EV_COUNT; id++)
+    {
+        const GWPEpon_EventDesc *desc = &gwpepon_event_table[id];
+
+        if (!(desc->flags & GWPEPON_EVF_STATE) || (!primary && desc->lane != GWPEPON_LANE_WAN))
+            continue;
+        // A restarted syseventd lost its tuples, an empty one is not a transition
+        if (GWPEpon_SyseventGetStr(desc->name, val, sizeof(val)) != 0 || strcmp(val, event_state_vals[id]) == 0)
+            continue;
+        GWPROVEPONLOG(WARNING, "%s changed to %s while sysevent was down\n", desc->name, val)
+        GWPEpon_SyseventTrack(desc->name, val);
+        GWPEpon_EventEnqueue(desc->name, val);
+        replayed++;
+    }
+    GWPEpon_EventDispatchAll();
+    return replayed;
+}
+
+/**************************************************************************/
+/*! \fn void *GWPEpon_sysevent_handler(void *data)
+ **************************************************************************
+ *  \brief Function to process the sysevent events of one WAN context.
+ *    The primary context also owns the LAN/routing/config events, the
+ *    gates and the process signals.
+ *  \return 0
+**************************************************************************/
+static void *GWPEpon_sysevent_handler(void *data)
+{
+    GWPEpon_WanCtx *ctx = (GWPEpon_WanCtx *) data;
+    int primary = (ctx->index == 0);
+    char val[GWPEPON_EVENT_VAL_LEN];
+
+    GWPEpon_CtxBind(ctx);
+    GWPROVEPONLOG(INFO, "Entering into %s\n",__FUNCTION__)
+    GWPROVEPONLOG(INFO, "WAN context %s, primary=%d\n", ctx->ifname, primary)
+
+    ctx->warm_restart = GWPEpon_WarmRestart();
+    if (!ctx->warm_restart && (GWPEpon_SyseventGetInt("gw_prov_status") > 0))
+        GWPEpon_GetProvState()->gw_prov_status = GWPEpon_SyseventGetInt("gw_prov_status");
+    GWPEpon_StatusInit();
+    GWPEpon_EventRegister(ctx->sysevent_fd, ctx->sysevent_token);
+    GWPEpon_SyseventMarkEvents();
+
+    if (GWPEpon_EvLoopInit() < 0)
+    {
+        GWPROVEPONLOG(ERROR, "GWPEpon_EvLoopInit failed\n")
+        return NULL;
+    }
+    GWPEpon_ActionInit();
+    // Without a config file the built-in rules apply
+    GWPEpon_EvConfLoad(GWPEPON_EVCONF_FILE);
+    GWPEpon_DampInit(GWPEpon_DampRelease);
+
+    if (primary)
+    {
+        GWPEpon_RegisterGates();
+
+        GWPEpon_EvLoopAddSignal(SIGTERM, GWPEpon_ProcessTerminate, NULL);
+        GWPEpon_EvLoopAddSignal(SIGINT, GWPEpon_ProcessTerminate, NULL);
+        GWPEpon_EvLoopAddSignal(SIGHUP, GWPEpon_ProcessReload, NULL);
+    }
+    else if (GWPEpon_EvLoopAddFd(ctx->wake_fd, EPOLLIN, GWPEpon_ProcessContextRequests, NULL) < 0)
+    {
+        GWPEpon_EvLoopClose();
+        return NULL;
+    }
+
+    if (GWPEpon_EvLoopAddFd(ctx->sysevent_fd, EPOLLIN, GWPEpon_SyseventReadable, NULL) < 0)
+    {
+        GWPEpon_EvLoopClose();
+        return NULL;
+    }
+    GWPEpon_SeconnInit(GWPEpon_SyseventResubscribe, sysevent_owned);
+
+    // Diagnostics still work without it, only the provisioning path is essential
+    GWPEpon_CtlInit(GWPEpon_EventInject);
+    // Only shortens the DHCP path, sysevent still reports every status
+    GWPEpon_WanMonInit(GWPEpon_EventInject);
+
+    if (primary)
+        notifySysEvents();
+
+    /* In case we missed an event notification before the thread starts. Not needed
+       when a previous instance's state was resumed, its services are still running */
+    val[0] = '\0';
+    if (!ctx->warm_restart &&
+        (GWPEpon_SyseventGetStr("epon_ifstatus", val, sizeof(val)) == 0) && (strcmp(val, "down") != 0))
+    {
+        GWPEpon_EventEnqueue("epon_ifstatus", val);
+        GWPEpon_EventDispatchAll();
+    }
+    GWPEpon_CkptInit();
+
+    ctx->ready_ms = GWPEpon_ProcessAgeMs();
+    GWPEpon_StatusPublish();
+    GWPROVEPONLOG(WARNING, "WAN context %s ready %llu ms after start\n", ctx->ifname, ctx->ready_ms)
+    GWPEpon_EvLoopRun();
+    GWPEpon_SeconnClose();
+    GWPEpon_WanMonClose();
+    GWPEpon_CtlClose();
+    GWPEpon_EvLoopClose();
 
     GWPROVEPONLOG(INFO, "Exiting from %s\n",__FUNCTION__)
+    return NULL;
 }
 
 
+/**************************************************************************/
+/*! \fn static int GWPEpon_WarmRestart()
+ **************************************************************************
+ *  \brief Resume the provisioning state checkpointed by a previous
+ *    instance when it still matches the live tuples, instead of
+ *    restarting the WAN services
+ *  \return 1 if the state was resumed, 0 otherwise
+**************************************************************************/
+static int GWPEpon_WarmRestart()
+{
+    GWPEpon_ProvState saved = *GWPEpon_GetProvState();
+
+    GWPROVEPONLOG(INFO, "Entering into %s\n",__FUNCTION__)
+
+    if ((GWPEpon_CkptLoad(&saved) != 0) || !GWPEpon_CkptValidate(&saved))
+    {
+        GWPROVEPONLOG(INFO, "No usable checkpoint, cold start\n")
+        return 0;
+    }
+
+    *GWPEpon_GetProvState() = saved;
+    GWPROVEPONLOG(WARNING, "Warm restart: epon_ifstatus=%s gw_prov_status=%d router_ip_mode=%d\n",
+                  saved.epon_ifstatus, saved.gw_prov_status, saved.router_ip_mode)
+
+    GWPROVEPONLOG(INFO, "Exiting from %s\n",__FUNCTION__)
+    return 1;
+}
+
 static void  notifySysEvents()
 {
     GWPROVEPONLOG(INFO, "Entering into %s\n",__FUNCTION__)
 
+    // A resumed instance left the LAN DHCP server running, don't bounce it
+    if (GWPEpon_CtxCurrent()->warm_restart)
+    {
+        GWPROVEPONLOG(INFO, "Exiting from %s\n",__FUNCTION__)
+        return;
+    }
+
     if (GWPEpon_SysCfgGetInt("dhcp_server_enabled") == 1)
     {
         GWPEpon_SyseventSetStr("dhcp_server-restart", "1", 0);
@@ -1762,62 +1926,134 @@ static void GWPEpon_SetDefaults()
     GWPROVEPONLOG(INFO, "Exiting from %s\n",__FUNCTION__)
 }
 
-static bool GWPEpon_Register_sysevent()
+static bool GWPEpon_Register_sysevent(GWPEpon_WanCtx *ctx)
 {
     bool status = false;
     const int max_retries = 6;
     int retry = 0;
+    char name[40], name_gs[48];
     GWPROVEPONLOG(INFO, "Entering into %s\n",__FUNCTION__)
 
+    GWPEpon_SeconnName(ctx, 0, name, sizeof(name));
+    GWPEpon_SeconnName(ctx, 1, name_gs, sizeof(name_gs));
+
     do
     {
-        sysevent_fd = sysevent_open("127.0.0.1", SE_SERVER_WELL_KNOWN_PORT, SE_VERSION, "gw_prov_epon", &sysevent_token);
-        if (sysevent_fd < 0)
+        ctx->sysevent_fd = sysevent_open("127.0.0.1", SE_SERVER_WELL_KNOWN_PORT, SE_VERSION, name, &ctx->sysevent_token);
+        if (ctx->sysevent_fd < 0)
         {
-            GWPROVEPONLOG(ERROR, "gw_prov_epon failed to register with sysevent daemon\n");
+            GWPROVEPONLOG(ERROR, "%s failed to register with sysevent daemon\n", name);
             status = false;
         }
         else
         {  
-            GWPROVEPONLOG(INFO, "gw_prov_epon registered with sysevent daemon successfully\n");
+            GWPROVEPONLOG(INFO, "%s registered with sysevent daemon successfully\n", name);
             status = true;
         }
         
         //Make another connection for gets/sets
-        sysevent_fd_gs = sysevent_open("127.0.0.1", SE_SERVER_WELL_KNOWN_PORT, SE_VERSION, "gw_prov_epon-gs", &sysevent_token_gs);
-        if (sysevent_fd_gs < 0)
+        ctx->sysevent_fd_gs = sysevent_open("127.0.0.1", SE_SERVER_WELL_KNOWN_PORT, SE_VERSION, name_gs, &ctx->sysevent_token_gs);
+        if (ctx->sysevent_fd_gs < 0)
         {
-            GWPROVEPONLOG(ERROR, "gw_prov_epon-gs failed to register with sysevent daemon\n");
+            GWPROVEPONLOG(ERROR, "%s failed to register with sysevent daemon\n", name_gs);
             status = false;
         }
         else
         {
-            GWPROVEPONLOG(INFO, "gw_prov_epon-gs registered with sysevent daemon successfully\n");
+            GWPROVEPONLOG(INFO, "%s registered with sysevent daemon successfully\n", name_gs);
             status = true;
         }
 
         if(status == false) {
-        	system("/usr/bin/syseventd");
+        	GWPEpon_System("/usr/bin/syseventd");
                 sleep(5);
         }
     }while((status == false) && (retry++ < max_retries));
 
 
-    if (status != false)
+    if (status != false && ctx->index == 0)
        GWPEpon_SetDefaults();
 
     GWPROVEPONLOG(INFO, "Exiting from %s\n",__FUNCTION__);
     return status;
 }
 
-static int GWPEpon_Init()
+static int GWPEpon_TlsPhdr(struct dl_phdr_info *info, size_t size, void *arg)
+{
+    size_t *tls = (size_t *) arg;
+    int i;
+
+    for (i = 0; i < info->dlpi_phnum; i++)
+    {
+        if (info->dlpi_phdr[i].p_type == PT_TLS)
+            *tls += info->dlpi_phdr[i].p_memsz + info->dlpi_phdr[i].p_align;
+    }
+    return 0;
+}
+
+/* Static TLS of the process, the per-context state; glibc takes it from
+   the stack of every thread */
+static size_t GWPEpon_TlsSize(void)
+{
+    size_t tls = 0;
+
+    dl_iterate_phdr(GWPEpon_TlsPhdr, &tls);
+    return tls;
+}
+
+static int GWPEpon_StartContext(GWPEpon_WanCtx *ctx)
 {
-    int status = 0;
     int thread_status = 0;
     char thread_name[THREAD_NAME_LEN];
+    pthread_attr_t attr;
+
+    // Secondary contexts are stopped and reloaded by the primary through this eventfd
+    if (ctx->index > 0 && (ctx->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0)
+    {
+        GWPROVEPONLOG(ERROR, "%s error occured while creating the %s wake eventfd\n", strerror(errno), ctx->ifname)
+        return -1;
+    }
+
+    pthread_attr_init(&attr);
+    if (GWPEPON_THREAD_STACK_SIZE > 0)
+        pthread_attr_setstacksize(&attr, GWPEPON_THREAD_STACK_SIZE + GWPEpon_TlsSize());
+    thread_status = pthread_create(&ctx->tid, &attr, GWPEpon_sysevent_handler, ctx);
+    pthread_attr_destroy(&attr);
+    if (thread_status != 0)
+    {
+        GWPROVEPONLOG(ERROR, "%s error occured while creating GWPEpon_sysevent_handler thread for %s\n",
+                      strerror(thread_status), ctx->ifname)
+        return -1;
+    }
+    ctx->running = 1;
+    GWPROVEPONLOG(INFO, "GWPEpon_sysevent_handler thread for %s created successfully\n", ctx->ifname);
+
+    memset( thread_name, '\0', sizeof(char) * THREAD_NAME_LEN );
+    if (ctx->index == 0)
+        strcpy( thread_name, "GWPEponsysevent");
+    else
+        snprintf(thread_name, sizeof(thread_name), "GWPEpon%.8s", ctx->ifname);
+
+    if (pthread_setname_np(ctx->tid, thread_name) == 0)
+        GWPROVEPONLOG(INFO, "GWPEpon_sysevent_handler thread name %s set successfully\n", thread_name)
+    else
+        GWPROVEPONLOG(ERROR, "%s error occured while setting GWPEpon_sysevent_handler thread name\n", strerror(errno))
+    return 0;
+}
+
+static int GWPEpon_Init()
+{
+    GWPEpon_WanCtx *ctx;
+    int status = 0;
+    int i;
     GWPROVEPONLOG(INFO, "Entering into %s\n",__FUNCTION__)
 
-    if (GWPEpon_Register_sysevent() == false)
+    // Shared read only by the context threads once they run
+    GWPEpon_EventRegistryInit();
+    GWPEpon_CtxLoad();
+    GWPEpon_CtxBind(GWPEpon_CtxGet(0));
+
+    if (GWPEpon_Register_sysevent(GWPEpon_CtxGet(0)) == false)
     {
         GWPROVEPONLOG(ERROR, "GWPEpon_Register_sysevent failed\n")
         status = -1;
@@ -1825,27 +2061,25 @@ static int GWPEpon_Init()
     else 
     {
         GWPROVEPONLOG(INFO, "GWPEpon_Register_sysevent Successful\n")
-    
-        thread_status = pthread_create(&sysevent_tid, NULL, GWPEpon_sysevent_handler, NULL);
-        if (thread_status == 0)
-        {
-            GWPROVEPONLOG(INFO, "GWPEpon_sysevent_handler thread created successfully\n");
 
-            memset( thread_name, '\0', sizeof(char) * THREAD_NAME_LEN );
-            strcpy( thread_name, "GWPEponsysevent");
+        // Signals are serviced by the primary's signalfd, so every thread must block them
+        GWPEpon_EvLoopBlockSignals();
 
-            if (pthread_setname_np(sysevent_tid, thread_name) == 0)
-                GWPROVEPONLOG(INFO, "GWPEpon_sysevent_handler thread name %s set successfully\n", thread_name)
+        // A secondary WAN that cannot start leaves the others running
+        for (i = 1; (ctx = GWPEpon_CtxGet(i)) != NULL; i++)
+        {
+            if (GWPEpon_Register_sysevent(ctx) == false)
+                GWPROVEPONLOG(ERROR, "GWPEpon_Register_sysevent failed for %s\n", ctx->ifname)
             else
-                GWPROVEPONLOG(ERROR, "%s error occured while setting GWPEpon_sysevent_handler thread name\n", strerror(errno))
-                
-            sleep(5);
+                GWPEpon_StartContext(ctx);
         }
-        else
-        {
-            GWPROVEPONLOG(ERROR, "%s error occured while creating GWPEpon_sysevent_handler thread\n", strerror(errno))
+
+        // Started last, so a signal it reads finds every secondary it has to stop
+        if (GWPEpon_StartContext(GWPEpon_CtxGet(0)) < 0)
             status = -1;
-        }
+
+        if (status == 0)
+            sleep(5);
     }
     GWPROVEPONLOG(INFO, "Exiting from %s\n",__FUNCTION__)
     return status;
@@ -1857,6 +2091,19 @@ static bool checkIfAlreadyRunning(const char* name)
     bool status = true;
 	
     FILE *fp = fopen("/tmp/.gwprovepon.pid", "r");
+    if (fp != NULL)
+    {
+        int pid = 0;
+
+        // A pid file left behind by a crashed instance must not block the restart
+        if ((fscanf(fp, "%d", &pid) != 1) || (pid <= 0) || (kill(pid, 0) < 0 && errno == ESRCH))
+        {
+            GWPROVEPONLOG(WARNING, "Removing stale /tmp/.gwprovepon.pid (pid %d)\n", pid)
+            fclose(fp);
+            unlink("/tmp/.gwprovepon.pid");
+            fp = NULL;
+        }
+    }
     if (fp == NULL) 
     {
         GWPROVEPONLOG(ERROR, "File /tmp/.gwprovepon.pid doesn't exist\n")
@@ -1939,6 +2186,33 @@ int main(int argc, char *argv[])
     int status = 0;
     const int max_retries = 6;
     int retry = 0;
+    GWPEpon_WanCtx *ctx;
+    int arg = 1;
+    int i;
+
+    // Client mode: gw_prov_epon [-i <secondary ifname>] -c STATE | ACTIONS | EVENTS | INJECT <name> [value]
+    if ((argc > 3) && (strcmp(argv[1], "-i") == 0))
+        arg = 3;
+    if ((argc > arg + 1) && (strcmp(argv[arg], "-c") == 0))
+    {
+        char request[GWPEPON_CTL_REQ_LEN];
+        static char resp[GWPEPON_CTL_REPLY_LEN];
+        char path[GWPEPON_CTL_PATH_LEN];
+        int len = 0;
+
+        if (arg == 3)
+            snprintf(path, sizeof(path), "%s.%s", GWPEPON_CTL_SOCKET, argv[2]);
+        else
+            snprintf(path, sizeof(path), "%s", GWPEPON_CTL_SOCKET);
+
+        request[0] = '\0';
+        for (i = arg + 1; i < argc; i++)
+            len += snprintf(request + len, sizeof(request) - len, "%s%s", (i > arg + 1) ? " " : "", argv[i]);
+
+        status = GWPEpon_CtlRequest(path, request, resp, sizeof(resp));
+        fputs(resp, stdout);
+        return (status == 0) ? 0 : 1;
+    }
 
 #ifdef FEATURE_SUPPORT_RDKLOG
     pComponentName = compName;
@@ -1974,11 +2248,14 @@ int main(int argc, char *argv[])
             else
             {
                 GWPROVEPONLOG(INFO, "GwProvEpon initialization completed\n")
-                notifySysEvents();
-                //wait for sysevent_tid thread to terminate
-                pthread_join(sysevent_tid, NULL);
+                //wait for the WAN context threads to terminate
+                for (i = 0; (ctx = GWPEpon_CtxGet(i)) != NULL; i++)
+                {
+                    if (ctx->running)
+                        pthread_join(ctx->tid, NULL);
+                }
                 
-                GWPROVEPONLOG(INFO,"sysevent_tid thread terminated\n")
+                GWPROVEPONLOG(INFO,"sysevent handler threads terminated\n")
             }
         }
         else
@@ -0,0 +1,309 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*! \file gw_prov_epon_state.c
+    \brief provisioning state checkpoint for warm restarts
+*/
+
+/**************************************************************************/
+/*      INCLUDES:                                                         */
+/**************************************************************************/
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "gw_prov_epon.h"
+#include "gw_prov_epon_ctx.h"
+#include "gw_prov_epon_evloop.h"
+#include "gw_prov_epon_log.h"
+#include "gw_prov_epon_state.h"
+#include "gw_prov_epon_status.h"
+
+/**************************************************************************/
+/*      LOCAL DECLARATIONS:                                               */
+/**************************************************************************/
+#define GWPEPON_BOOT_ID_FILE    "/proc/sys/kernel/random/boot_id"
+#define GWPEPON_BOOT_ID_LEN     40
+
+/**************************************************************************/
+/*      LOCAL VARIABLES:                                                  */
+/**************************************************************************/
+static GWPEPON_THREAD_LOCAL GWPEpon_ProvState prov_state =
+{
+    .router_ip_mode = IpProvModeNone,
+    .lan_wan_v4 = EPON_OPER_NONE,
+    .lan_wan_v6 = EPON_OPER_NONE,
+    .bridge_mode = -1,
+};
+static GWPEPON_THREAD_LOCAL int ckpt_dirty = 0;
+
+/**************************************************************************/
+/*      LOCAL FUNCTIONS:                                                  */
+/**************************************************************************/
+static void GWPEpon_ReadBootId(char *boot_id, int len)
+{
+    FILE *fp = fopen(GWPEPON_BOOT_ID_FILE, "r");
+
+    boot_id[0] = '\0';
+    if (fp)
+    {
+        if (fgets(boot_id, len, fp) != NULL)
+            boot_id[strcspn(boot_id, "\n")] = '\0';
+        fclose(fp);
+    }
+}
+
+static void GWPEpon_CkptTimer(void *arg)
+{
+    (void) arg;
+    GWPEpon_CkptFlush();
+}
+
+GWPEpon_ProvState *GWPEpon_GetProvState(void)
+{
+    return &prov_state;
+}
+
+void GWPEpon_StateChanged(void)
+{
+    ckpt_dirty = 1;
+    GWPEpon_StatusPublish();
+}
+
+/**************************************************************************/
+/*! \fn int GWPEpon_CkptInit(void)
+ **************************************************************************
+ *  \brief Start the periodic checkpoint of the provisioning state
+ *  \return 0 on success, -1 on failure
+ **************************************************************************/
+int GWPEpon_CkptInit(void)
+{
+    if (GWPEpon_TimerAdd(GWPEPON_CKPT_PERIOD_MS, GWPEPON_CKPT_PERIOD_MS, GWPEpon_CkptTimer, NULL) == 0)
+    {
+        GWPROVEPONLOG(ERROR, "failed to start checkpoint timer\n")
+        return -1;
+    }
+    return 0;
+}
+
+void GWPEpon_CkptFlush(void)
+{
+    if (ckpt_dirty && GWPEpon_CkptSave(&prov_state) == 0)
+        ckpt_dirty = 0;
+}
+
+/**************************************************************************/
+/*! \fn int GWPEpon_CkptSave(const GWPEpon_ProvState *state)
+ **************************************************************************
+ *  \brief Write the checkpoint to a temporary file and rename it in place,
+ *    so a reader never sees a partial checkpoint
+ *  \return 0 on success, -1 on failure
+ **************************************************************************/
+int GWPEpon_CkptSave(const GWPEpon_ProvState *state)
+{
+    char boot_id[GWPEPON_BOOT_ID_LEN];
+    char path[GWPEPON_CKPT_PATH_LEN];
+    char tmp_path[GWPEPON_CKPT_PATH_LEN + 4];
+    const char *file;
+    FILE *fp;
+    int ret;
+
+    GWPEpon_ReadBootId(boot_id, sizeof(boot_id));
+    file = GWPEpon_CtxPath(GWPEPON_CKPT_FILE, path, sizeof(path));
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", file);
+
+    fp = fopen(tmp_path, "w");
+    if (fp == NULL)
+    {
+        GWPROVEPONLOG(ERROR, "cannot create %s: %s\n", tmp_path, strerror(errno))
+        return -1;
+    }
+
+    fprintf(fp, "version=%d\n", GWPEPON_CKPT_VERSION);
+    fprintf(fp, "boot_id=%s\n", boot_id);
+    fprintf(fp, "epon_ifstatus=%s\n", state->epon_ifstatus);
+    fprintf(fp, "ipv4_status=%s\n", state->ipv4_status);
+    fprintf(fp, "ipv6_status=%s\n", state->ipv6_status);
+    fprintf(fp, "router_ip_mode=%d\n", (int) state->router_ip_mode);
+    fprintf(fp, "gw_prov_status=%d\n", state->gw_prov_status);
+    fprintf(fp, "ipv4_service=%d\n", state->ipv4_service);
+    fprintf(fp, "ipv6_service=%d\n", state->ipv6_service);
+    fprintf(fp, "lan_wan_v4=%d\n", (int) state->lan_wan_v4);
+    fprintf(fp, "lan_wan_v6=%d\n", (int) state->lan_wan_v6);
+    fprintf(fp, "bridge_mode=%d\n", state->bridge_mode);
+    fprintf(fp, "erouter_reset_count=%d\n", state->erouter_reset_count);
+    fprintf(fp, "xconf_call_time=%ld\n", (long) state->xconf_call_time);
+    fprintf(fp, "end=1\n");
+
+    ret = fflush(fp);
+    if (ret == 0)
+        ret = fsync(fileno(fp));
+    if (fclose(fp) != 0 || ret != 0)
+    {
+        GWPROVEPONLOG(ERROR, "cannot write %s\n", tmp_path)
+        unlink(tmp_path);
+        return -1;
+    }
+
+    if (rename(tmp_path, file) < 0)
+    {
+        GWPROVEPONLOG(ERROR, "cannot rename %s: %s\n", tmp_path, strerror(errno))
+        unlink(tmp_path);
+        return -1;
+    }
+    return 0;
+}
+
+/**************************************************************************/
+/*! \fn int GWPEpon_CkptLoad(GWPEpon_ProvState *state)
+ **************************************************************************
+ *  \brief Read back a checkpoint written during the current boot
+ *  \return 0 on success, -1 if missing, stale or incomplete
+ **************************************************************************/
+int GWPEpon_CkptLoad(GWPEpon_ProvState *state)
+{
+    char boot_id[GWPEPON_BOOT_ID_LEN];
+    char path[GWPEPON_CKPT_PATH_LEN];
+    char line[128];
+    int version = 0, same_boot = 0, complete = 0;
+    FILE *fp;
+
+    fp = fopen(GWPEpon_CtxPath(GWPEPON_CKPT_FILE, path, sizeof(path)), "r");
+    if (fp == NULL)
+        return -1;
+
+    GWPEpon_ReadBootId(boot_id, sizeof(boot_id));
+    while (fgets(line, sizeof(line), fp) != NULL)
+    {
+        char *val = strchr(line, '=');
+
+        if (val == NULL)
+            continue;
+        *val++ = '\0';
+        val[strcspn(val, "\n")] = '\0';
+
+        if (strcmp(line, "version") == 0)
+            version = atoi(val);
+        else if (strcmp(line, "boot_id") == 0)
+            same_boot = (boot_id[0] != '\0' && strcmp(val, boot_id) == 0);
+        else if (strcmp(line, "epon_ifstatus") == 0)
+            snprintf(state->epon_ifstatus, sizeof(state->epon_ifstatus), "%s", val);
+        else if (strcmp(line, "ipv4_status") == 0)
+            snprintf(state->ipv4_status, sizeof(state->ipv4_status), "%s", val);
+        else if (strcmp(line, "ipv6_status") == 0)
+            snprintf(state->ipv6_status, sizeof(state->ipv6_status), "%s", val);
+        else if (strcmp(line, "router_ip_mode") == 0)
+            state->router_ip_mode = (EPON_IpProvMode) atoi(val);
+        else if (strcmp(line, "gw_prov_status") == 0)
+            state->gw_prov_status = atoi(val);
+        else if (strcmp(line, "ipv4_service") == 0)
+            state->ipv4_service = atoi(val);
+        else if (strcmp(line, "ipv6_service") == 0)
+            state->ipv6_service = atoi(val);
+        else if (strcmp(line, "lan_wan_v4") == 0)
+            state->lan_wan_v4 = (EPON_IpProvStatus) atoi(val);
+        else if (strcmp(line, "lan_wan_v6") == 0)
+            state->lan_wan_v6 = (EPON_IpProvStatus) atoi(val);
+        else if (strcmp(line, "bridge_mode") == 0)
+            state->bridge_mode = atoi(val);
+        else if (strcmp(line, "erouter_reset_count") == 0)
+            state->erouter_reset_count = atoi(val);
+        else if (strcmp(line, "xconf_call_time") == 0)
+            state->xconf_call_time = (time_t) atol(val);
+        else if (strcmp(line, "end") == 0)
+            complete = 1;
+    }
+    fclose(fp);
+
+    if (version != GWPEPON_CKPT_VERSION || !same_boot || !complete)
+    {
+        GWPROVEPONLOG(WARNING, "ignoring checkpoint version=%d same_boot=%d complete=%d\n", version, same_boot, complete)
+        return -1;
+    }
+    return 0;
+}
+
+static int GWPEpon_CkptMatchStr(const char *name, const char *expected)
+{
+    unsigned char live[GWPEPON_STATUS_LEN];
+
+    live[0] = '\0';
+    GWPEpon_SyseventGetStr(name, live, sizeof(live));
+    if (strcmp((char *) live, expected) != 0)
+    {
+        GWPROVEPONLOG(WARNING, "checkpoint mismatch %s: live=%s saved=%s\n", name, live, expected)
+        return 0;
+    }
+    return 1;
+}
+
+static int GWPEpon_CkptMatchMarker(const char *marker, int expected)
+{
+    char buf[GWPEPON_CKPT_PATH_LEN];
+    const char *path = GWPEpon_CtxPath(marker, buf, sizeof(buf));
+    int present = (access(path, F_OK) == 0);
+
+    if (present != (expected != 0))
+    {
+        GWPROVEPONLOG(WARNING, "checkpoint mismatch %s: present=%d saved=%d\n", path, present, expected)
+        return 0;
+    }
+    return 1;
+}
+
+/**************************************************************************/
+/*! \fn int GWPEpon_CkptValidate(const GWPEpon_ProvState *state)
+ **************************************************************************
+ *  \brief Check a loaded checkpoint against the live sysevent tuples and
+ *    service markers. Anything that changed while the daemon was down
+ *    makes the checkpoint unusable.
+ *  \return 1 when the state can be resumed, 0 otherwise
+ **************************************************************************/
+int GWPEpon_CkptValidate(const GWPEpon_ProvState *state)
+{
+    int gw_prov_status;
+
+    if (!GWPEpon_CkptMatchStr("epon_ifstatus", state->epon_ifstatus) ||
+        !GWPEpon_CkptMatchStr("ipv4-status", state->ipv4_status) ||
+        !GWPEpon_CkptMatchStr("ipv6-status", state->ipv6_status))
+        return 0;
+
+    gw_prov_status = GWPEpon_SyseventGetInt("gw_prov_status");
+    if (gw_prov_status < 0)
+        gw_prov_status = 0;
+    if (gw_prov_status != state->gw_prov_status)
+    {
+        GWPROVEPONLOG(WARNING, "checkpoint mismatch gw_prov_status: live=%d saved=%d\n", gw_prov_status, state->gw_prov_status)
+        return 0;
+    }
+
+    if (state->router_ip_mode != IpProvModeNone &&
+        GWPEpon_SyseventGetInt("cur_router_ip_mode") != (int) state->router_ip_mode)
+    {
+        GWPROVEPONLOG(WARNING, "checkpoint mismatch cur_router_ip_mode\n")
+        return 0;
+    }
+
+    if (!GWPEpon_CkptMatchMarker(GWPEPON_IPV4_MARKER, state->ipv4_service) ||
+        !GWPEpon_CkptMatchMarker(GWPEPON_IPV6_MARKER, state->ipv6_service))
+        return 0;
+
+    return 1;
+}
@@ -0,0 +1,163 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*! \file gw_prov_epon_status.c
+    \brief writer side of the shared provisioning status page
+
+    Each WAN context owns its page and is its only writer, so publishing
+    takes no lock. The page survives a daemon restart: the new instance
+    maps the same object and carries on with its generation counter.
+*/
+
+/**************************************************************************/
+/*      INCLUDES:                                                         */
+/**************************************************************************/
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "gw_prov_epon_ctx.h"
+#include "gw_prov_epon_evloop.h"
+#include "gw_prov_epon_log.h"
+#include "gw_prov_epon_state.h"
+#include "gw_prov_epon_status.h"
+
+/**************************************************************************/
+/*      LOCAL VARIABLES:                                                  */
+/**************************************************************************/
+static GWPEPON_THREAD_LOCAL GWPEpon_StatusPage *status_page = NULL;
+static GWPEPON_THREAD_LOCAL GWPEpon_Status status_last;
+
+/**************************************************************************/
+/*      LOCAL FUNCTIONS:                                                  */
+/**************************************************************************/
+static void GWPEpon_StatusStamp(GWPEpon_Status *next, GWPEpon_Milestone ms, int now_set, int was_set,
+                                unsigned long long now)
+{
+    if (now_set && (!was_set || next->milestone_ms[ms] == 0))
+        next->milestone_ms[ms] = now;
+}
+
+/**************************************************************************/
+/*! \fn int GWPEpon_StatusInit(void)
+ **************************************************************************
+ *  \brief Create or reopen the status page of the current context
+ *  \return 0 on success, -1 on failure (the sysevent tuples still work)
+ **************************************************************************/
+int GWPEpon_StatusInit(void)
+{
+    GWPEpon_WanCtx *ctx = GWPEpon_CtxCurrent();
+    char buf[GWPEPON_CKPT_PATH_LEN];
+    const char *name = GWPEpon_CtxPath(GWPEPON_STATUS_SHM, buf, sizeof(buf));
+    void *addr;
+    int fd;
+
+    fd = shm_open(name, O_CREAT | O_RDWR | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        GWPROVEPONLOG(ERROR, "cannot open status page %s: %s\n", name, strerror(errno))
+        return -1;
+    }
+    // Readers map it read only, whatever the umask of the daemon
+    if (fchmod(fd, 0644) < 0 || ftruncate(fd, sizeof(GWPEpon_StatusPage)) < 0)
+    {
+        GWPROVEPONLOG(ERROR, "cannot size status page %s: %s\n", name, strerror(errno))
+        close(fd);
+        return -1;
+    }
+    addr = mmap(NULL, sizeof(GWPEpon_StatusPage), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED)
+    {
+        GWPROVEPONLOG(ERROR, "cannot map status page %s: %s\n", name, strerror(errno))
+        return -1;
+    }
+    status_page = (GWPEpon_StatusPage *) addr;
+
+    memset(&status_last, 0, sizeof(status_last));
+    if (status_page->magic == GWPEPON_STATUS_MAGIC && status_page->version == GWPEPON_STATUS_VERSION)
+    {
+        // Keep the generation and milestones of the previous instance
+        status_last = status_page->status;
+        status_last.milestone_ms[GWPEPON_MS_READY] = 0;
+        // A writer killed in the middle of an update left seq odd
+        if (status_page->seq & 1)
+            __atomic_store_n(&status_page->seq, status_page->seq + 1, __ATOMIC_RELEASE);
+    }
+    else
+    {
+        status_page->seq = 0;
+        status_page->version = GWPEPON_STATUS_VERSION;
+        __atomic_store_n(&status_page->magic, GWPEPON_STATUS_MAGIC, __ATOMIC_RELEASE);
+    }
+    status_last.pid = (int32_t) getpid();
+    snprintf(status_last.ifname, sizeof(status_last.ifname), "%s", ctx->ifname);
+    // Force the first publication of this instance
+    status_last.updated_ms = 0;
+
+    GWPEpon_StatusPublish();
+    return 0;
+}
+
+/**************************************************************************/
+/*! \fn void GWPEpon_StatusPublish(void)
+ **************************************************************************
+ *  \brief Copy the provisioning state into the status page when it
+ *    changed, under the seqlock
+ *  \return void
+ **************************************************************************/
+void GWPEpon_StatusPublish(void)
+{
+    const GWPEpon_ProvState *state = GWPEpon_GetProvState();
+    unsigned long long now = GWPEpon_NowMs();
+    GWPEpon_Status next;
+    uint32_t seq;
+
+    if (status_page == NULL)
+        return;
+
+    next = status_last;
+    next.gw_prov_status = (uint32_t) state->gw_prov_status;
+    next.router_ip_mode = (int32_t) state->router_ip_mode;
+    next.link_up = (strcmp(state->epon_ifstatus, "up") == 0);
+    next.erouter_reset_count = state->erouter_reset_count;
+
+    GWPEpon_StatusStamp(&next, GWPEPON_MS_READY, GWPEpon_CtxCurrent()->ready_ms != 0, 1, now);
+    GWPEpon_StatusStamp(&next, GWPEPON_MS_LINK_UP, next.link_up, status_last.link_up, now);
+    GWPEpon_StatusStamp(&next, GWPEPON_MS_IPV4_UP, next.gw_prov_status & GWPEPON_PROV_IPV4_UP,
+                        status_last.gw_prov_status & GWPEPON_PROV_IPV4_UP, now);
+    GWPEpon_StatusStamp(&next, GWPEPON_MS_IPV6_UP, next.gw_prov_status & GWPEPON_PROV_IPV6_UP,
+                        status_last.gw_prov_status & GWPEPON_PROV_IPV6_UP, now);
+
+    if (status_last.updated_ms != 0 && memcmp(&next, &status_last, sizeof(next)) == 0)
+        return;
+    next.generation++;
+    next.updated_ms = now;
+
+    seq = status_page->seq;
+    __atomic_store_n(&status_page->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(&status_page->status, &next, sizeof(next));
+    __atomic_store_n(&status_page->seq, seq + 2, __ATOMIC_RELEASE);
+
+    status_last = next;
+}
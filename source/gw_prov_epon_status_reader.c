@@ -0,0 +1,100 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*! \file gw_prov_epon_status_reader.c
+    \brief reader library of the shared provisioning status page
+
+    Linked by other processes, it must not depend on the daemon sources.
+    Only GWPEpon_StatusOpen and GWPEpon_StatusClose make syscalls.
+*/
+
+/**************************************************************************/
+/*      INCLUDES:                                                         */
+/**************************************************************************/
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "gw_prov_epon_status.h"
+
+/**************************************************************************/
+/*! \fn const GWPEpon_StatusPage *GWPEpon_StatusOpen(const char *ifname)
+ **************************************************************************
+ *  \brief Map the status page of a WAN context read only
+ *  \param[in] ifname secondary WAN interface, NULL for the primary
+ *  \return page, NULL when the daemon never published it
+ **************************************************************************/
+const GWPEpon_StatusPage *GWPEpon_StatusOpen(const char *ifname)
+{
+    char name[64];
+    void *addr;
+    int fd;
+
+    if (ifname == NULL)
+        snprintf(name, sizeof(name), "%s", GWPEPON_STATUS_SHM);
+    else
+        snprintf(name, sizeof(name), "%s.%s", GWPEPON_STATUS_SHM, ifname);
+
+    fd = shm_open(name, O_RDONLY | O_CLOEXEC, 0);
+    if (fd < 0)
+        return NULL;
+    addr = mmap(NULL, sizeof(GWPEpon_StatusPage), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED)
+        return NULL;
+    return (const GWPEpon_StatusPage *) addr;
+}
+
+/**************************************************************************/
+/*! \fn int GWPEpon_StatusRead(const GWPEpon_StatusPage *page, GWPEpon_Status *status)
+ **************************************************************************
+ *  \brief Take a consistent copy of the published status
+ *  \return 0 on success, -1 when the page is not initialised or the
+ *    writer kept updating it for GWPEPON_STATUS_READ_TRIES attempts
+ **************************************************************************/
+int GWPEpon_StatusRead(const GWPEpon_StatusPage *page, GWPEpon_Status *status)
+{
+    uint32_t seq1, seq2;
+    int tries;
+
+    if (page == NULL ||
+        __atomic_load_n(&page->magic, __ATOMIC_ACQUIRE) != GWPEPON_STATUS_MAGIC ||
+        page->version != GWPEPON_STATUS_VERSION)
+        return -1;
+
+    for (tries = 0; tries < GWPEPON_STATUS_READ_TRIES; tries++)
+    {
+        seq1 = __atomic_load_n(&page->seq, __ATOMIC_ACQUIRE);
+        if (seq1 & 1)
+            continue;
+        memcpy(status, (const void *) &page->status, sizeof(*status));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        seq2 = __atomic_load_n(&page->seq, __ATOMIC_RELAXED);
+        if (seq1 == seq2)
+            return 0;
+    }
+    return -1;
+}
+
+void GWPEpon_StatusClose(const GWPEpon_StatusPage *page)
+{
+    if (page != NULL)
+        munmap((void *) page, sizeof(GWPEpon_StatusPage));
+}
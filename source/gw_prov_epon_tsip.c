@@ -0,0 +1,227 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*! \file gw_prov_epon_tsip.c
+    \brief batching of the True Static IP operations
+
+    One batch collects the TSIP events of a window. It is applied when
+    the window closes, or when the previous batch completes if that one
+    is still running, so that two batches never run concurrently.
+*/
+
+/**************************************************************************/
+/*      INCLUDES:                                                         */
+/**************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include "gw_prov_epon.h"
+#include "gw_prov_epon_action.h"
+#include "gw_prov_epon_ctx.h"
+#include "gw_prov_epon_events.h"
+#include "gw_prov_epon_evloop.h"
+#include "gw_prov_epon_log.h"
+#include "gw_prov_epon_tsip.h"
+
+/**************************************************************************/
+/*      LOCAL DECLARATIONS:                                               */
+/**************************************************************************/
+/* In the order they are applied */
+#define TSIP_OP_STOP_ALL     0
+#define TSIP_OP_SYNC_ALL     1
+#define TSIP_OP_RESYNC       2
+#define TSIP_OP_RESYNC_ASN   3
+#define TSIP_OP_COUNT        4
+
+typedef struct
+{
+    int op;
+    char val[GWPEPON_EVENT_VAL_LEN];
+} GWPEpon_TsipOp;
+
+typedef struct
+{
+    int nops;
+    GWPEpon_TsipOp ops[GWPEPON_TSIP_MAX_OPS];    /* distinct operations, in the order they are applied */
+    unsigned int requests;      /* events folded into the batch */
+    unsigned int timer;
+} GWPEpon_TsipBatch;
+
+/**************************************************************************/
+/*      LOCAL VARIABLES:                                                  */
+/**************************************************************************/
+static const char *tsip_ops[TSIP_OP_COUNT] =
+{
+    "ipv4-stop_tsip_all",
+    "ipv4-sync_tsip_all",
+    "ipv4-resync_tsip",
+    "ipv4-resync_tsip_asn"
+};
+
+static GWPEPON_THREAD_LOCAL GWPEpon_TsipBatch tsip_batch;
+static GWPEPON_THREAD_LOCAL int tsip_running = 0;
+static GWPEPON_THREAD_LOCAL GWPEpon_TsipStats tsip_stats;
+
+/**************************************************************************/
+/*      LOCAL FUNCTIONS:                                                  */
+/**************************************************************************/
+static void GWPEpon_TsipFlush(void);
+
+static void GWPEpon_TsipDone(const char *action, const GWPEpon_ActionResult *result, void *arg)
+{
+    (void) action;
+    (void) arg;
+    tsip_running = 0;
+    if (result->exit_code != 0)
+        GWPROVEPONLOG(ERROR, "TSIP batch failed: exit %d signal %d\n", result->exit_code, result->signo)
+
+    // A batch whose window closed while this one ran goes now
+    if (tsip_batch.requests > 0 && tsip_batch.timer == 0)
+        GWPEpon_TsipFlush();
+}
+
+static void GWPEpon_TsipFlush(void)
+{
+    char tsip_cmd[GWPEPON_ACTION_CMD_LEN];
+    GWPEpon_TsipBatch *batch = &tsip_batch;
+    int len = 0;
+    int n, runs;
+
+    if (tsip_running)
+        return;
+
+    // As many operations as the command holds, the others go when it completes
+    tsip_cmd[0] = '\0';
+    for (runs = 0; runs < batch->nops; runs++)
+    {
+        n = snprintf(tsip_cmd + len, sizeof(tsip_cmd) - len, "%s%s %s %s", runs ? "; " : "", GWPEPON_TSIP_SCRIPT,
+                     tsip_ops[batch->ops[runs].op], batch->ops[runs].val);
+        if (len + n >= (int) sizeof(tsip_cmd))
+        {
+            tsip_cmd[len] = '\0';
+            break;
+        }
+        len += n;
+    }
+
+    tsip_stats.runs += runs;
+    tsip_stats.avoided += batch->requests - batch->nops;
+    GWPROVEPONLOG(INFO, "TSIP batch of %u requests applied with %d script runs, %d left\n", batch->requests, runs,
+                  batch->nops - runs)
+    batch->nops -= runs;
+    memmove(batch->ops, batch->ops + runs, batch->nops * sizeof(batch->ops[0]));
+    batch->requests = batch->nops;
+    GWPEpon_SyseventSetInt(GWPEPON_TSIP_AVOIDED_TUPLE, (int) tsip_stats.avoided);
+
+    if (runs == 0)
+        return;
+    tsip_stats.batches++;
+    tsip_running = 1;
+    if (GWPEpon_ActionRunAsync("tsip", tsip_cmd, GWPEpon_TsipDone, NULL) < 0)
+        tsip_running = 0;
+}
+
+/* Insert op after the operations applied before it or with it */
+static void GWPEpon_TsipAdd(GWPEpon_TsipBatch *batch, int op, const char *val)
+{
+    int i;
+
+    for (i = batch->nops; i > 0 && batch->ops[i - 1].op > op; i--)
+        batch->ops[i] = batch->ops[i - 1];
+    batch->ops[i].op = op;
+    snprintf(batch->ops[i].val, sizeof(batch->ops[i].val), "%s", val);
+    batch->nops++;
+}
+
+static void GWPEpon_TsipWindowClosed(void *arg)
+{
+    (void) arg;
+    tsip_batch.timer = 0;
+    GWPEpon_TsipFlush();
+}
+
+/**************************************************************************/
+/*! \fn int GWPEpon_TsipRequest(const char *name, const char *val)
+ **************************************************************************
+ *  \brief Fold a TSIP event into the current batch, opening a new batch
+ *    window when none is open
+ *  \return 0 on success, -1 when name is not a TSIP event
+ **************************************************************************/
+int GWPEpon_TsipRequest(const char *name, const char *val)
+{
+    GWPEpon_TsipBatch *batch = &tsip_batch;
+    int sync_all = 0, stop_all = 0;
+    int op, i;
+
+    for (op = 0; op < TSIP_OP_COUNT; op++)
+    {
+        if (strcmp(tsip_ops[op], name) == 0)
+            break;
+    }
+    if (op == TSIP_OP_COUNT)
+        return -1;
+
+    tsip_stats.requests++;
+    batch->requests++;
+    for (i = 0; i < batch->nops; i++)
+    {
+        if (batch->ops[i].op == TSIP_OP_SYNC_ALL)
+            sync_all = 1;
+        else if (batch->ops[i].op == TSIP_OP_STOP_ALL)
+            stop_all = 1;
+        else if (batch->ops[i].op == op && strcmp(batch->ops[i].val, val) == 0)
+            return 0;       // the same subnet resynced again
+    }
+
+    if (op == TSIP_OP_SYNC_ALL || op == TSIP_OP_STOP_ALL)
+    {
+        if (op == TSIP_OP_SYNC_ALL && stop_all)
+            tsip_stats.collapsed++;
+        // Replaces whatever was collected before
+        batch->nops = 0;
+    }
+    else if (sync_all)
+    {
+        // Covered by the sync_all of the batch, which runs with the
+        // configuration current when the batch is applied
+        return 0;
+    }
+    else if (batch->nops == GWPEPON_TSIP_MAX_OPS)
+    {
+        // More subnets than a batch tracks: re-apply them all instead
+        GWPROVEPONLOG(WARNING, "TSIP batch full, %s %s folded into a sync_all\n", name, val)
+        tsip_stats.escalated++;
+        batch->nops = 0;
+        op = TSIP_OP_SYNC_ALL;
+        val = "";
+    }
+    GWPEpon_TsipAdd(batch, op, val);
+
+    if (batch->timer == 0 && batch->requests == 1)
+    {
+        batch->timer = GWPEpon_TimerAdd(GWPEPON_TSIP_WINDOW_MS, 0, GWPEpon_TsipWindowClosed, NULL);
+        if (batch->timer == 0)
+            GWPEpon_TsipFlush();
+    }
+    return 0;
+}
+
+const GWPEpon_TsipStats *GWPEpon_TsipGetStats(void)
+{
+    return &tsip_stats;
+}
@@ -0,0 +1,408 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*! \file gw_prov_epon_wanmon.c
+    \brief rtnetlink monitor of the WAN interface
+
+    Notifications only schedule a refresh. The refresh dumps the links,
+    addresses and default routes on a second socket and recomputes the
+    observations, so a lost notification (ENOBUFS) costs nothing but a
+    refresh.
+*/
+
+/**************************************************************************/
+/*      INCLUDES:                                                         */
+/**************************************************************************/
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <net/if.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <linux/if_addr.h>
+#include "gw_prov_epon_ctx.h"
+#include "gw_prov_epon_evloop.h"
+#include "gw_prov_epon_log.h"
+#include "gw_prov_epon_netlink.h"
+#include "gw_prov_epon_state.h"
+#include "gw_prov_epon_wanmon.h"
+
+/**************************************************************************/
+/*      LOCAL DECLARATIONS:                                               */
+/**************************************************************************/
+typedef struct
+{
+    int ifindex;
+    int link_up;
+    int addr[2];                /* IPv4, IPv6 */
+    int route[2];
+} GWPEpon_WanMonScan;
+
+typedef struct
+{
+    int active;
+    int up;
+    unsigned long long since_ms;
+    unsigned int timer;
+} GWPEpon_WanMonPending;
+
+/**************************************************************************/
+/*      LOCAL VARIABLES:                                                  */
+/**************************************************************************/
+static const struct
+{
+    const char *name;
+    const char *tuple;
+    int inject;
+} wanmon_items[GWPEPON_WANMON_COUNT] =
+{
+    { "link", "epon_ifstatus", 0 },
+    { "ipv4", "ipv4-status",   1 },
+    { "ipv6", "ipv6-status",   1 },
+};
+
+static GWPEPON_THREAD_LOCAL int wanmon_fd = -1;
+static GWPEPON_THREAD_LOCAL int wanmon_dump_fd = -1;
+static GWPEPON_THREAD_LOCAL int wanmon_ifindex = 0;
+static GWPEPON_THREAD_LOCAL unsigned int wanmon_timer = 0;
+static GWPEPON_THREAD_LOCAL GWPEpon_WanMonInjectCb wanmon_inject = NULL;
+static GWPEPON_THREAD_LOCAL GWPEpon_WanMonStats wanmon_stats[GWPEPON_WANMON_COUNT];
+static GWPEPON_THREAD_LOCAL GWPEpon_WanMonPending wanmon_pending[GWPEPON_WANMON_COUNT];
+
+/**************************************************************************/
+/*      LOCAL FUNCTIONS:                                                  */
+/**************************************************************************/
+static int GWPEpon_WanMonStateUp(int item)
+{
+    const GWPEpon_ProvState *state = GWPEpon_GetProvState();
+    const char *status = (item == GWPEPON_WANMON_LINK) ? state->epon_ifstatus :
+                         (item == GWPEPON_WANMON_IPV4) ? state->ipv4_status : state->ipv6_status;
+
+    return strcmp(status, "up") == 0;
+}
+
+static int GWPEpon_WanMonLinkCb(const struct nlmsghdr *nlh, void *arg)
+{
+    GWPEpon_WanMonScan *scan = (GWPEpon_WanMonScan *) arg;
+    const struct ifinfomsg *ifi = (const struct ifinfomsg *) NLMSG_DATA(nlh);
+
+    if (nlh->nlmsg_type == RTM_NEWLINK && ifi->ifi_index == scan->ifindex)
+        scan->link_up = (ifi->ifi_flags & IFF_UP) && (ifi->ifi_flags & IFF_RUNNING);
+    return 0;
+}
+
+static int GWPEpon_WanMonAddrCb(const struct nlmsghdr *nlh, void *arg)
+{
+    GWPEpon_WanMonScan *scan = (GWPEpon_WanMonScan *) arg;
+    const struct ifaddrmsg *ifa = (const struct ifaddrmsg *) NLMSG_DATA(nlh);
+    struct rtattr *tb[IFA_MAX + 1];
+    unsigned int flags = ifa->ifa_flags;
+
+    if (nlh->nlmsg_type != RTM_NEWADDR || (int) ifa->ifa_index != scan->ifindex ||
+        ifa->ifa_scope != RT_SCOPE_UNIVERSE)
+        return 0;
+    GWPEpon_NlParseAttrs(tb, IFA_MAX, IFA_RTA(ifa), IFA_PAYLOAD(nlh));
+    if (tb[IFA_FLAGS])
+        flags = *(unsigned int *) RTA_DATA(tb[IFA_FLAGS]);
+    if (flags & (IFA_F_TENTATIVE | IFA_F_DADFAILED))
+        return 0;
+    scan->addr[ifa->ifa_family == AF_INET6] = 1;
+    return 0;
+}
+
+static int GWPEpon_WanMonRouteCb(const struct nlmsghdr *nlh, void *arg)
+{
+    GWPEpon_WanMonScan *scan = (GWPEpon_WanMonScan *) arg;
+    const struct rtmsg *rtm = (const struct rtmsg *) NLMSG_DATA(nlh);
+    struct rtattr *tb[RTA_MAX + 1];
+
+    if (nlh->nlmsg_type != RTM_NEWROUTE || rtm->rtm_dst_len != 0 || rtm->rtm_type != RTN_UNICAST)
+        return 0;
+    GWPEpon_NlParseAttrs(tb, RTA_MAX, RTM_RTA(rtm), RTM_PAYLOAD(nlh));
+    if (tb[RTA_OIF] && *(int *) RTA_DATA(tb[RTA_OIF]) == scan->ifindex)
+        scan->route[rtm->rtm_family == AF_INET6] = 1;
+    return 0;
+}
+
+static void GWPEpon_WanMonUnconfirmed(void *arg)
+{
+    int item = (int) (long) arg;
+
+    wanmon_pending[item].timer = 0;
+    wanmon_pending[item].active = 0;
+    wanmon_stats[item].unconfirmed++;
+    GWPROVEPONLOG(WARNING, "%s %s was never reported by sysevent, the DHCP client hook may have failed\n",
+                  wanmon_items[item].tuple, wanmon_pending[item].up ? "up" : "down")
+}
+
+static void GWPEpon_WanMonObserve(int item, int up)
+{
+    GWPEpon_WanMonStats *stats = &wanmon_stats[item];
+    GWPEpon_WanMonPending *pending = &wanmon_pending[item];
+    int first = (stats->observed < 0);
+    const char *val = up ? "up" : "down";
+
+    if (stats->observed == up)
+        return;
+    stats->observed = up;
+    if (first)
+    {
+        if (GWPEpon_WanMonStateUp(item) != up)
+            GWPROVEPONLOG(WARNING, "%s is %s but the kernel shows %s %s\n", wanmon_items[item].tuple,
+                          up ? "not up" : "up", wanmon_items[item].name, val)
+        return;
+    }
+
+    stats->transitions++;
+    GWPROVEPONLOG(INFO, "kernel: %s %s on %s\n", wanmon_items[item].name, val, GWPEpon_CtxCurrent()->ifname)
+    if (GWPEpon_WanMonStateUp(item) == up)
+        return;
+    if (!wanmon_items[item].inject)
+    {
+        GWPROVEPONLOG(WARNING, "%s is %s but the kernel shows %s %s\n", wanmon_items[item].tuple,
+                      up ? "not up" : "up", wanmon_items[item].name, val)
+        return;
+    }
+
+    stats->injected++;
+    GWPROVEPONLOG(WARNING, "%s %s detected by netlink ahead of sysevent\n", wanmon_items[item].tuple, val)
+    // Armed after the injection, which passes through GWPEpon_WanMonAbsorb as well
+    pending->active = 0;
+    if (wanmon_inject)
+        wanmon_inject(wanmon_items[item].tuple, val);
+
+    if (pending->timer)
+        GWPEpon_TimerCancel(pending->timer);
+    pending->active = 1;
+    pending->up = up;
+    pending->since_ms = GWPEpon_NowMs();
+    pending->timer = GWPEpon_TimerAdd(GWPEPON_WANMON_CONFIRM_MS, 0, GWPEpon_WanMonUnconfirmed, (void *) (long) item);
+}
+
+static void GWPEpon_WanMonRefresh(void *arg)
+{
+    GWPEpon_WanMonScan scan;
+    struct ifinfomsg ifi;
+    struct ifaddrmsg ifa;
+    struct rtmsg rtm;
+    int family;
+
+    (void) arg;
+    wanmon_timer = 0;
+
+    memset(&scan, 0, sizeof(scan));
+    scan.ifindex = (int) if_nametoindex(GWPEpon_CtxCurrent()->ifname);
+    wanmon_ifindex = scan.ifindex;
+    if (scan.ifindex > 0)
+    {
+        memset(&ifi, 0, sizeof(ifi));
+        ifi.ifi_family = AF_UNSPEC;
+        if (GWPEpon_NlDump(wanmon_dump_fd, RTM_GETLINK, &ifi, sizeof(ifi), GWPEpon_WanMonLinkCb, &scan) < 0)
+            return;
+        for (family = 0; family < 2; family++)
+        {
+            memset(&ifa, 0, sizeof(ifa));
+            ifa.ifa_family = family ? AF_INET6 : AF_INET;
+            memset(&rtm, 0, sizeof(rtm));
+            rtm.rtm_family = ifa.ifa_family;
+            if (GWPEpon_NlDump(wanmon_dump_fd, RTM_GETADDR, &ifa, sizeof(ifa), GWPEpon_WanMonAddrCb, &scan) < 0 ||
+                GWPEpon_NlDump(wanmon_dump_fd, RTM_GETROUTE, &rtm, sizeof(rtm), GWPEpon_WanMonRouteCb, &scan) < 0)
+                return;
+        }
+    }
+
+    GWPEpon_WanMonObserve(GWPEPON_WANMON_LINK, scan.link_up);
+    GWPEpon_WanMonObserve(GWPEPON_WANMON_IPV4, scan.link_up && scan.addr[0] && scan.route[0]);
+    GWPEpon_WanMonObserve(GWPEPON_WANMON_IPV6, scan.link_up && scan.addr[1] && scan.route[1]);
+}
+
+static void GWPEpon_WanMonSchedule(void)
+{
+    if (wanmon_timer == 0)
+        wanmon_timer = GWPEpon_TimerAdd(GWPEPON_WANMON_SETTLE_MS, 0, GWPEpon_WanMonRefresh, NULL);
+}
+
+/* Does a notification concern the WAN interface */
+static int GWPEpon_WanMonRelevant(const struct nlmsghdr *nlh)
+{
+    struct rtattr *tb[RTA_MAX + 1];
+
+    switch (nlh->nlmsg_type)
+    {
+        case RTM_NEWLINK:
+        case RTM_DELLINK:
+            // The interface may be created or renamed after startup
+            return 1;
+        case RTM_NEWADDR:
+        case RTM_DELADDR:
+            return (int) ((const struct ifaddrmsg *) NLMSG_DATA(nlh))->ifa_index == wanmon_ifindex;
+        case RTM_NEWROUTE:
+        case RTM_DELROUTE:
+        {
+            const struct rtmsg *rtm = (const struct rtmsg *) NLMSG_DATA(nlh);
+
+            if (rtm->rtm_dst_len != 0)
+                return 0;
+            GWPEpon_NlParseAttrs(tb, RTA_MAX, RTM_RTA(rtm), RTM_PAYLOAD(nlh));
+            return tb[RTA_OIF] && *(int *) RTA_DATA(tb[RTA_OIF]) == wanmon_ifindex;
+        }
+        default:
+            return 0;
+    }
+}
+
+static void GWPEpon_WanMonReadable(int fd, unsigned int events, void *arg)
+{
+    char buf[GWPEPON_NL_RECV_LEN] __attribute__((aligned(NLMSG_ALIGNTO)));
+    struct nlmsghdr *nlh;
+    int n;
+
+    (void) events;
+    (void) arg;
+    for (;;)
+    {
+        n = (int) recv(fd, buf, sizeof(buf), MSG_DONTWAIT);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && errno == ENOBUFS)
+        {
+            // Notifications were lost, the dump will tell what changed
+            GWPEpon_WanMonSchedule();
+            continue;
+        }
+        if (n <= 0)
+            return;
+        for (nlh = (struct nlmsghdr *) buf; NLMSG_OK(nlh, (unsigned int) n); nlh = NLMSG_NEXT(nlh, n))
+        {
+            if (GWPEpon_WanMonRelevant(nlh))
+                GWPEpon_WanMonSchedule();
+        }
+    }
+}
+
+/**************************************************************************/
+/*! \fn int GWPEpon_WanMonInit(GWPEpon_WanMonInjectCb inject)
+ **************************************************************************
+ *  \brief Subscribe to the link, address and route notifications and take
+ *    the first observation. inject feeds a status tuple to the state
+ *    machine as if sysevent notified it.
+ *  \return 0 on success, -1 when netlink is unavailable
+ **************************************************************************/
+int GWPEpon_WanMonInit(GWPEpon_WanMonInjectCb inject)
+{
+    int i;
+
+    for (i = 0; i < GWPEPON_WANMON_COUNT; i++)
+    {
+        memset(&wanmon_stats[i], 0, sizeof(wanmon_stats[i]));
+        memset(&wanmon_pending[i], 0, sizeof(wanmon_pending[i]));
+        wanmon_stats[i].observed = -1;
+    }
+    wanmon_inject = inject;
+
+    wanmon_fd = GWPEpon_NlOpen(RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR |
+                               RTMGRP_IPV4_ROUTE | RTMGRP_IPV6_ROUTE);
+    wanmon_dump_fd = GWPEpon_NlOpen(0);
+    if (wanmon_fd < 0 || wanmon_dump_fd < 0 ||
+        GWPEpon_EvLoopAddFd(wanmon_fd, EPOLLIN, GWPEpon_WanMonReadable, NULL) < 0)
+    {
+        GWPROVEPONLOG(ERROR, "WAN monitor unavailable, relying on sysevent only\n")
+        GWPEpon_WanMonClose();
+        return -1;
+    }
+
+    GWPEpon_WanMonRefresh(NULL);
+    return 0;
+}
+
+void GWPEpon_WanMonClose(void)
+{
+    if (wanmon_fd >= 0)
+    {
+        GWPEpon_EvLoopDelFd(wanmon_fd);
+        close(wanmon_fd);
+        wanmon_fd = -1;
+    }
+    if (wanmon_dump_fd >= 0)
+    {
+        close(wanmon_dump_fd);
+        wanmon_dump_fd = -1;
+    }
+}
+
+/**************************************************************************/
+/*! \fn int GWPEpon_WanMonAbsorb(const char *name, const char *val)
+ **************************************************************************
+ *  \brief Reconcile a status tuple reported by sysevent with the kernel
+ *  \return 1 when it only confirms a status already injected, 0 when it
+ *    must be handled
+ **************************************************************************/
+int GWPEpon_WanMonAbsorb(const char *name, const char *val)
+{
+    GWPEpon_WanMonStats *stats;
+    GWPEpon_WanMonPending *pending;
+    unsigned long long lead;
+    int up = (strcmp(val, "up") == 0);
+    int item;
+
+    for (item = 0; item < GWPEPON_WANMON_COUNT; item++)
+    {
+        if (strcmp(wanmon_items[item].tuple, name) == 0)
+            break;
+    }
+    if (item == GWPEPON_WANMON_COUNT)
+        return 0;
+    stats = &wanmon_stats[item];
+    pending = &wanmon_pending[item];
+
+    if (pending->active)
+    {
+        pending->active = 0;
+        if (pending->timer)
+            GWPEpon_TimerCancel(pending->timer);
+        pending->timer = 0;
+        if (pending->up == up)
+        {
+            lead = GWPEpon_NowMs() - pending->since_ms;
+            stats->confirmed++;
+            stats->lead_ms_total += lead;
+            if (lead > stats->lead_ms_max)
+                stats->lead_ms_max = lead;
+            return 1;
+        }
+    }
+
+    if (stats->observed >= 0 && stats->observed != up)
+    {
+        stats->disagreements++;
+        GWPROVEPONLOG(WARNING, "sysevent reports %s %s but the kernel shows %s %s\n", name, val,
+                      wanmon_items[item].name, stats->observed ? "up" : "down")
+    }
+    return 0;
+}
+
+const GWPEpon_WanMonStats *GWPEpon_WanMonGetStats(int item, const char **name, const char **tuple)
+{
+    if (item < 0 || item >= GWPEPON_WANMON_COUNT)
+        return NULL;
+    *name = wanmon_items[item].name;
+    *tuple = wanmon_items[item].tuple;
+    return &wanmon_stats[item];
+}
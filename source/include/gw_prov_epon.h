@@ -60,4 +60,9 @@ typedef enum
     EPON_OPER_IPV4_DOWN
 } EPON_IpProvStatus;
 
+int GWPEpon_SyseventGetInt(const char *name);
+int GWPEpon_SyseventSetInt(const char *name, int int_value);
+int GWPEpon_SyseventGetStr(const char *name, unsigned char *out_value, int outbufsz);
+int GWPEpon_SyseventSetStr(const char *name, unsigned char *value, int bufsz);
+
 #endif
@@ -0,0 +1,92 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/** @file gw_prov_epon_action.h
+ *  @brief Execution of provisioning actions (scripts/services) with result
+ *    capture and per-action retry policies.
+ */
+
+#ifndef _GW_PROV_EPON_ACTION_H_
+#define _GW_PROV_EPON_ACTION_H_
+
+#include <sys/types.h>
+
+#define GWPEPON_ACTION_MAX           48
+#define GWPEPON_ACTION_MAX_PENDING   16
+#define GWPEPON_ACTION_MAX_INFLIGHT  16
+#define GWPEPON_ACTION_CMD_LEN       512
+
+/* Surfaced when an action still fails after its last retry */
+#define GWPEPON_ACTION_FAILED_TUPLE    "gw_prov_action_failed"
+#define GWPEPON_ACTION_FAILURES_TUPLE  "gw_prov_action_failures"
+
+typedef struct
+{
+    const char *action;
+    unsigned int max_retries;
+    unsigned int base_ms;
+    unsigned int cap_ms;
+} GWPEpon_RetryPolicy;
+
+typedef struct
+{
+    int wstatus;
+    int exit_code;      /* -1 when killed by a signal or not started */
+    int signo;          /* 0 unless killed by a signal */
+    unsigned long long runtime_ms;
+    int cancelled;      /* stopped because a newer run superseded it */
+} GWPEpon_ActionResult;
+
+typedef struct
+{
+    const char *action;
+    unsigned int runs;
+    unsigned int failures;
+    unsigned int retries;
+    unsigned int persistent_failures;
+    unsigned int cancelled;     /* runs and retries superseded before completing */
+    unsigned long long saved_ms;    /* estimated from the last runtime of the action */
+    GWPEpon_ActionResult last;
+} GWPEpon_ActionStats;
+
+typedef void (*GWPEpon_ActionDoneCb)(const char *action, const GWPEpon_ActionResult *result, void *arg);
+
+/* A running child or a retry waiting for its backoff timer */
+typedef struct
+{
+    const char *action;
+    const char *cmd;
+    pid_t pid;                  /* -1 while queued */
+    unsigned int attempt;       /* 0 for a first run, n for the n-th retry */
+    unsigned long long since_ms;
+} GWPEpon_ActionJob;
+
+typedef void (*GWPEpon_ActionJobCb)(const GWPEpon_ActionJob *job, void *arg);
+
+void  GWPEpon_ActionInit(void);
+int   GWPEpon_ActionRun(const char *action, const char *cmd);
+pid_t GWPEpon_ActionRunAsync(const char *action, const char *cmd, GWPEpon_ActionDoneCb cb, void *arg);
+void  GWPEpon_ActionCancel(const char *action);
+const GWPEpon_ActionStats *GWPEpon_ActionGetStats(int idx);
+void  GWPEpon_ActionForEachJob(GWPEpon_ActionJobCb cb, void *arg);
+int   GWPEpon_ActionSetPolicy(const GWPEpon_RetryPolicy *policy);
+void  GWPEpon_ActionResetPolicies(void);
+pid_t GWPEpon_ActionPidOf(const char *pidfile, const char *comm);
+
+#endif
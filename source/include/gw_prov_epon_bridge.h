@@ -0,0 +1,52 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/** @file gw_prov_epon_bridge.h
+ *  @brief Router <-> bridge mode transition planner.
+ */
+
+#ifndef _GW_PROV_EPON_BRIDGE_H_
+#define _GW_PROV_EPON_BRIDGE_H_
+
+#define GWPEPON_BRIDGE_MAX_STEPS      8
+#define GWPEPON_BRIDGE_SETTLE_MS      1500
+
+#define GWPEPON_BRIDGE_TRANSITION_TUPLE   "bridge_mode_transition"
+#define GWPEPON_BRIDGE_SWITCH_MS_TUPLE    "bridge_mode_switch_ms"
+#define GWPEPON_BRIDGE_SWITCH_CNT_TUPLE   "bridge_mode_switch_count"
+
+typedef struct
+{
+    unsigned int switches;
+    unsigned int failures;      /* switches whose lan_handler.sh step failed */
+    unsigned int skipped;       /* requests for the mode already applied */
+    unsigned int collapsed;     /* intermediate targets replaced before they ran */
+    unsigned int suppressed;    /* restart events folded into a running plan */
+    unsigned long long last_outage_ms;
+    unsigned long long min_outage_ms;
+    unsigned long long max_outage_ms;
+    unsigned long long total_outage_ms;
+} GWPEpon_BridgeStats;
+
+void GWPEpon_BridgeRequest(int enable);
+int  GWPEpon_BridgeAbsorbEvent(const char *name, const char *val);
+int  GWPEpon_BridgeInTransition(void);
+const GWPEpon_BridgeStats *GWPEpon_BridgeGetStats(void);
+
+#endif
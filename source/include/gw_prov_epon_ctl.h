@@ -0,0 +1,66 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/** @file gw_prov_epon_ctl.h
+ *  @brief Local control socket for diagnostics and integration tests.
+ *
+ *  One request per SOCK_SEQPACKET message. The answer is one or more
+ *  messages of whole lines, at most GWPEPON_CTL_RESP_LEN bytes each,
+ *  closed by a GWPEPON_CTL_END message. Its first line is "OK" or
+ *  "ERR <reason>", followed by the payload lines:
+ *
+ *    STATE                 provisioning state snapshot, key=value lines
+ *    ACTIONS               running and queued actions, then per-action statistics
+ *    EVENTS                sysevent connection, per-class queue wait and per-event
+ *                          dispatch statistics
+ *    DAMPING               flap damping state and statistics of the damped events
+ *    MONITOR               WAN interface as seen by netlink, and its agreement
+ *                          with the sysevent statuses
+ *    INJECT <name> [val]   dispatch an event as if sysevent notified it;
+ *                          answered once its handler has run
+ *
+ *  A line that cannot be delivered whole is replaced by a
+ *  GWPEPON_CTL_TRUNCATED line, and so is the rest of an answer that does
+ *  not fit the client's buffer.
+ *
+ *  Every WAN context serves its own socket, GWPEPON_CTL_SOCKET for the
+ *  primary and GWPEPON_CTL_SOCKET ".<ifname>" for the others.
+ */
+
+#ifndef _GW_PROV_EPON_CTL_H_
+#define _GW_PROV_EPON_CTL_H_
+
+#define GWPEPON_CTL_SOCKET        "/tmp/.gwprovepon.ctl"
+#define GWPEPON_CTL_MAX_CLIENTS   4
+#define GWPEPON_CTL_REQ_LEN       256
+#define GWPEPON_CTL_RESP_LEN      4096
+#define GWPEPON_CTL_REPLY_LEN     65536     /* whole answer, client side */
+#define GWPEPON_CTL_END           "END\n"
+#define GWPEPON_CTL_TRUNCATED     "TRUNCATED\n"
+#define GWPEPON_CTL_PATH_LEN      108
+
+typedef int (*GWPEpon_CtlInjectCb)(const char *name, const char *val);
+
+int  GWPEpon_CtlInit(GWPEpon_CtlInjectCb inject);
+void GWPEpon_CtlClose(void);
+
+/* Client side, usable without the event loop */
+int  GWPEpon_CtlRequest(const char *path, const char *request, char *resp, int resplen);
+
+#endif
@@ -0,0 +1,95 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/** @file gw_prov_epon_ctx.h
+ *  @brief Per WAN interface provisioning contexts.
+ *
+ *  The interfaces listed in syscfg epon_wan_ifnames (default "erouter0")
+ *  are each driven by their own handler thread, event loop, sysevent
+ *  connections and provisioning state. The module state of the event
+ *  loop, action runner, checkpoint, gates and event registry is thread
+ *  local, so a context never takes a lock to reach its own state.
+ *
+ *  The first interface is the primary context: it keeps the historical
+ *  tuple names and file paths, and also owns the LAN, routing and config
+ *  events and the process signals. A secondary context only follows the
+ *  WAN lane events, under tuple names prefixed with "<ifname>_"
+ *  (e.g. "erouter1_ipv4-status"), and suffixes its files with
+ *  ".<ifname>".
+ */
+
+#ifndef _GW_PROV_EPON_CTX_H_
+#define _GW_PROV_EPON_CTX_H_
+
+#include <net/if.h>
+#include <pthread.h>
+#include <sysevent/sysevent.h>
+
+#define GWPEPON_THREAD_LOCAL       __thread
+
+#define GWPEPON_MAX_WAN            4
+#define GWPEPON_WAN_IFNAMES        "epon_wan_ifnames"
+#define GWPEPON_WAN_IFNAME_DEFAULT "erouter0"
+#define GWPEPON_CTX_TUPLE_LEN      80
+
+/* Usable stack of the handler threads, their static TLS is added to it;
+   0 keeps the libc default (RLIMIT_STACK, usually 8 MB of address space) */
+#ifndef GWPEPON_THREAD_STACK_SIZE
+#define GWPEPON_THREAD_STACK_SIZE  0
+#endif
+
+/* Requests posted to a secondary context by the primary */
+#define GWPEPON_CTX_REQ_STOP       0x1
+#define GWPEPON_CTX_REQ_RELOAD     0x2
+
+typedef struct
+{
+    int index;                          /* 0 is the primary context */
+    char ifname[IFNAMSIZ];
+    char prefix[IFNAMSIZ + 1];          /* tuple prefix, "" for the primary */
+    int sysevent_fd;                    /* notifications */
+    token_t sysevent_token;
+    int sysevent_fd_gs;                 /* gets and sets */
+    token_t sysevent_token_gs;
+    pthread_t tid;
+    int running;                        /* handler thread started */
+    int wake_fd;                        /* eventfd, signals pending requests */
+    unsigned int requests;              /* GWPEPON_CTX_REQ_*, atomic */
+    int warm_restart;
+    unsigned long long ready_ms;        /* process start to event loop running */
+} GWPEpon_WanCtx;
+
+int  GWPEpon_CtxLoad(void);
+int  GWPEpon_CtxCount(void);
+GWPEpon_WanCtx *GWPEpon_CtxGet(int index);
+
+void GWPEpon_CtxBind(GWPEpon_WanCtx *ctx);
+GWPEpon_WanCtx *GWPEpon_CtxCurrent(void);
+int  GWPEpon_CtxIsPrimary(void);
+
+int  GWPEpon_CtxScoped(const char *tuple);
+const char *GWPEpon_CtxTuple(const char *tuple, char *buf, int len);
+const char *GWPEpon_CtxUnscope(const char *tuple);
+const char *GWPEpon_CtxPath(const char *path, char *buf, int len);
+const char *GWPEpon_CtxUnit(const char *service, char *buf, int len);
+
+int  GWPEpon_CtxRequest(GWPEpon_WanCtx *ctx, unsigned int req);
+unsigned int GWPEpon_CtxTakeRequests(GWPEpon_WanCtx *ctx);
+
+#endif
@@ -0,0 +1,68 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/** @file gw_prov_epon_damp.h
+ *  @brief Flap damping of up/down status tuples, after BGP route flap
+ *    damping (RFC 2439).
+ *
+ *  Each change between "up" and any other value is a flap and adds
+ *  penalty to the event. The penalty halves every half_life_ms. Once it
+ *  reaches the suppress threshold the event is held: its values are
+ *  neither handled nor seen by the gates. When the penalty decayed below
+ *  the reuse threshold, the last held value is dispatched if it changed
+ *  the up/down state, and dropped otherwise. The penalty is capped so
+ *  that an event is never held longer than max_suppress_ms after its
+ *  last flap.
+ */
+
+#ifndef _GW_PROV_EPON_DAMP_H_
+#define _GW_PROV_EPON_DAMP_H_
+
+#include "gw_prov_epon_events.h"
+
+#define GWPEPON_DAMP_CHECK_MS   1000
+
+typedef struct
+{
+    unsigned int penalty;           /* per flap, 0 disables damping */
+    unsigned int suppress;
+    unsigned int reuse;
+    unsigned int half_life_ms;
+    unsigned int max_suppress_ms;
+} GWPEpon_DampPolicy;
+
+typedef struct
+{
+    unsigned int flaps;
+    unsigned int suppressions;
+    unsigned int held;              /* values not dispatched while suppressed */
+    unsigned int released;          /* held value dispatched on reuse */
+    unsigned int absorbed;          /* suppression ended in the state it started in */
+    unsigned int penalty;           /* at the last update */
+    int suppressed;
+    unsigned long long suppressed_ms;
+} GWPEpon_DampStats;
+
+typedef void (*GWPEpon_DampReleaseCb)(GWPEpon_EventId id, const char *val);
+
+void GWPEpon_DampInit(GWPEpon_DampReleaseCb release);
+int  GWPEpon_DampFilter(GWPEpon_EventId id, const char *val);
+const GWPEpon_DampStats *GWPEpon_DampGetStats(GWPEpon_EventId id);
+
+#endif
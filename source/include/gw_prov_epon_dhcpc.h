@@ -0,0 +1,72 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/** @file gw_prov_epon_dhcpc.h
+ *  @brief WAN DHCP clients driven in place.
+ *
+ *  The clients are found through their pid files, checked against
+ *  /proc/<pid>/comm so a recycled pid is never signalled. A live client
+ *  keeps its lease across a link bounce and is told to renew when the
+ *  link comes back: udhcpc renews on SIGUSR1 and releases on SIGUSR2,
+ *  dibbler-client confirms its bindings by itself when it sees the link
+ *  again and releases them when it exits. Only a dead client is
+ *  restarted through its systemd unit.
+ *
+ *  The time from the start request to the status tuple reporting "up" is
+ *  recorded separately for in place reacquisitions and for restarts.
+ */
+
+#ifndef _GW_PROV_EPON_DHCPC_H_
+#define _GW_PROV_EPON_DHCPC_H_
+
+/* Per WAN context, suffixed with ".<ifname>" for secondary interfaces */
+#ifndef GWPEPON_DHCPC_UDHCPC_PIDFILE
+#define GWPEPON_DHCPC_UDHCPC_PIDFILE     "/tmp/udhcpc.pid"
+#endif
+#ifndef GWPEPON_DHCPC_DIBBLER_PIDFILE
+#define GWPEPON_DHCPC_DIBBLER_PIDFILE    "/tmp/dibbler/client.pid"
+#endif
+
+typedef enum
+{
+    GWPEPON_DHCPC_V4 = 0,
+    GWPEPON_DHCPC_V6,
+    GWPEPON_DHCPC_COUNT
+} GWPEpon_DhcpcFamily;
+
+typedef struct
+{
+    unsigned int renews;            /* live client reused on start */
+    unsigned int restarts;          /* client dead, unit restarted */
+    unsigned int kept;              /* lease kept across a link down */
+    unsigned int releases;
+    unsigned int inplace_samples;   /* reacquisitions by a reused client */
+    unsigned long long inplace_ms_total;
+    unsigned long long inplace_ms_max;
+    unsigned int restart_samples;   /* acquisitions by a restarted client */
+    unsigned long long restart_ms_total;
+    unsigned long long restart_ms_max;
+} GWPEpon_DhcpcStats;
+
+int  GWPEpon_DhcpcStart(GWPEpon_DhcpcFamily family);
+void GWPEpon_DhcpcStop(GWPEpon_DhcpcFamily family, int release);
+void GWPEpon_DhcpcBound(GWPEpon_DhcpcFamily family);
+const GWPEpon_DhcpcStats *GWPEpon_DhcpcGetStats(int family, const char **client);
+
+#endif
@@ -0,0 +1,69 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/** @file gw_prov_epon_dhcps.h
+ *  @brief LAN DHCP/DNS server controller.
+ *
+ *  A dhcp_server-restart or dhcpv6s_server request compares the inputs
+ *  of the server configuration with those it last applied:
+ *
+ *    nothing changed             the request is dropped
+ *    upstream DNS servers only   dnsmasq rereads them on SIGHUP, its
+ *                                leases and DHCP service are untouched
+ *    anything else               lan_handler.sh regenerates the
+ *                                configuration and restarts the server
+ *
+ *  A server without a live pid file (GWPEPON_DHCPS_PIDFILE, whose
+ *  process must be GWPEPON_DHCPS_COMM) is always restarted. The restart
+ *  does not hold up the event loop; requests made while it runs are
+ *  folded into one, checked against what it applied.
+ *
+ *  The applied inputs are recorded with the server pid in
+ *  GWPEPON_DHCPS_CKPT_FILE. After a warm restart the first request takes
+ *  them over when the same server is still running, so it is not
+ *  restarted for nothing.
+ */
+
+#ifndef _GW_PROV_EPON_DHCPS_H_
+#define _GW_PROV_EPON_DHCPS_H_
+
+#ifndef GWPEPON_DHCPS_PIDFILE
+#define GWPEPON_DHCPS_PIDFILE        "/var/run/dnsmasq.pid"
+#endif
+#define GWPEPON_DHCPS_COMM           "dnsmasq"
+#define GWPEPON_DHCPS_CKPT_FILE      "/tmp/.gwprovepon.dhcps"
+#define GWPEPON_DHCPS_SCRIPT         "sh /usr/ccsp/lan_handler.sh dhcp_restart"
+#define GWPEPON_DHCPS_VAL_LEN        128
+
+#define GWPEPON_DHCPS_AVOIDED_TUPLE  "dhcp_server_restarts_avoided"
+
+typedef struct
+{
+    unsigned int requests;
+    unsigned int unchanged;     /* dropped, configuration as applied */
+    unsigned int reloads;       /* SIGHUP instead of a restart */
+    unsigned int restarts;
+    unsigned int avoided;       /* unchanged + reloads */
+    unsigned int resumed;       /* applied inputs taken over after a warm restart */
+} GWPEpon_DhcpsStats;
+
+int  GWPEpon_DhcpsRequest(const char *name);
+const GWPEpon_DhcpsStats *GWPEpon_DhcpsGetStats(void);
+
+#endif
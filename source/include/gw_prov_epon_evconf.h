@@ -0,0 +1,82 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/** @file gw_prov_epon_evconf.h
+ *  @brief Event -> action mappings and event policies loaded from a
+ *    config file.
+ *
+ *  One rule per line, '#' starts a comment:
+ *
+ *    <event>[=<value>]  <action>  [<option>=<n> ...]  : <command>
+ *    <event>            -         <option>=<n> ...
+ *
+ *  A rule runs <command> as action <action> when <event> is received
+ *  with <value> (any value when omitted); the first matching rule of an
+ *  event wins. In the command %n expands to the event name, %v to its
+ *  value as one single-quoted shell word, %i to the WAN interface and
+ *  %% to '%'. An event with rules runs
+ *  them instead of its built-in handler. The "-" form only sets options.
+ *
+ *  Options:
+ *    priority=<0-9>              dispatch priority of the event, 0 most
+ *                                urgent; defaults to 1 for the WAN lane,
+ *                                4 for config and 7 for LAN and routing
+ *    debounce=<ms>               run once, with the last value, after the
+ *                                event has been quiet for <ms>
+ *    dedupe=1                    ignore a value equal to the previous one
+ *    supersede=1                 a new value drops the values of the event
+ *                                still queued, only the latest one runs
+ *    retry=<n>/<base_ms>/<cap_ms>  retry policy of the rule's action
+ *    damp=<penalty>/<suppress>/<reuse>/<half_life_ms>/<max_ms>
+ *                                flap damping of an up/down status, see
+ *                                gw_prov_epon_damp.h; penalty 0 disables it
+ *
+ *  The lane of an event is fixed by the registry, it decides which WAN
+ *  context owns the tuple and cannot be configured.
+ *
+ *  The built-in rules are always compiled first. An event named in the
+ *  file takes its rules from the file only, its options are merged.
+ */
+
+#ifndef _GW_PROV_EPON_EVCONF_H_
+#define _GW_PROV_EPON_EVCONF_H_
+
+#include "gw_prov_epon_damp.h"
+#include "gw_prov_epon_events.h"
+
+#define GWPEPON_EVCONF_FILE         "/etc/gw_prov_epon.conf"
+#define GWPEPON_EVCONF_MAX_RULES    64
+#define GWPEPON_EVCONF_MATCH_LEN    24
+#define GWPEPON_EVCONF_CMD_LEN      160
+#define GWPEPON_EVCONF_NAMES_LEN    1024
+
+typedef struct
+{
+    int priority;
+    unsigned int debounce_ms;
+    int dedupe;
+    int supersede;
+    GWPEpon_DampPolicy damp;
+} GWPEpon_EventPolicy;
+
+int  GWPEpon_EvConfLoad(const char *path);
+const GWPEpon_EventPolicy *GWPEpon_EvConfPolicy(GWPEpon_EventId id);
+int  GWPEpon_EvConfRun(GWPEpon_EventId id, const char *val);
+
+#endif
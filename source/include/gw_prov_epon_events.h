@@ -0,0 +1,181 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/** @file gw_prov_epon_events.h
+ *  @brief Registry of the sysevent notifications handled by the daemon.
+ *
+ *  GWPEPON_EVENT_LIST is the only place an event is described. It
+ *  generates the event ids, the sysevent registration, the dispatch
+ *  table and the per-event statistics. Adding an event is one line
+ *  here plus its handler.
+ */
+
+#ifndef _GW_PROV_EPON_EVENTS_H_
+#define _GW_PROV_EPON_EVENTS_H_
+
+#include <sysevent/sysevent.h>
+
+/* Value parsers, the result is passed to the handler as ival */
+#define GWPEPON_PARSE_NONE     0    /* ival = 0 */
+#define GWPEPON_PARSE_BOOL     1    /* "1" -> 1, "0" -> 0, anything else -> -1 */
+#define GWPEPON_PARSE_UPDOWN   2    /* "up" -> 1, "down" -> 0, anything else -> -1 */
+#define GWPEPON_PARSE_INT      3    /* atoi */
+
+/* Lanes group the events by the part of the gateway they reconfigure. WAN
+   lane tuples exist once per WAN interface, see gw_prov_epon_ctx.h */
+#define GWPEPON_LANE_WAN       0    /* EPON link, WAN addressing and provisioning mode */
+#define GWPEPON_LANE_LAN       1    /* LAN bridge, ports and LAN services */
+#define GWPEPON_LANE_ROUTE     2    /* routing, firewall and tunnels */
+#define GWPEPON_LANE_CONFIG    3    /* xconf and time settings */
+#define GWPEPON_LANE_COUNT     4
+
+#define GWPEPON_EVENT_NAME_LEN 64
+#define GWPEPON_EVENT_VAL_LEN  64
+
+/* Registration flags */
+#define GWPEPON_EVF_EVENT      0x01 /* mark the tuple TUPLE_FLAG_EVENT, notify on every set */
+#define GWPEPON_EVF_STATE      0x02 /* level tuple, re-read after a sysevent reconnection */
+#define GWPEPON_EVF_LEVEL      (GWPEPON_EVF_EVENT | GWPEPON_EVF_STATE)
+
+/*  id                      name                      parser                 handler                           lane                 flags */
+#define GWPEPON_EVENT_LIST(X) \
+    X(EPON_IFSTATUS,          "epon_ifstatus",          GWPEPON_PARSE_UPDOWN,  GWPEpon_HandleIfStatus,           GWPEPON_LANE_WAN,    GWPEPON_EVF_LEVEL) \
+    X(IPV4_STATUS,            "ipv4-status",            GWPEPON_PARSE_UPDOWN,  GWPEpon_HandleIpv4Status,         GWPEPON_LANE_WAN,    GWPEPON_EVF_LEVEL) \
+    X(WAN4_IPPREF,            "wan4_ippref",            GWPEPON_PARSE_NONE,    GWPEpon_HandleWANIpPref,          GWPEPON_LANE_WAN,    GWPEPON_EVF_EVENT) \
+    X(IPV4_TIMEOFFSET,        "ipv4-timeoffset",        GWPEPON_PARSE_NONE,    GWPEpon_HandleIpv4Timeoffset,     GWPEPON_LANE_CONFIG, GWPEPON_EVF_EVENT) \
+    X(IPV6_STATUS,            "ipv6-status",            GWPEPON_PARSE_UPDOWN,  GWPEpon_HandleIpv6Status,         GWPEPON_LANE_WAN,    GWPEPON_EVF_LEVEL) \
+    X(WAN6_IPPREF,            "wan6_ippref",            GWPEPON_PARSE_NONE,    GWPEpon_HandleWANIpPref,          GWPEPON_LANE_WAN,    GWPEPON_EVF_EVENT) \
+    X(IPV6_TIMEOFFSET,        "ipv6-timeoffset",        GWPEPON_PARSE_NONE,    GWPEpon_HandleIpv6Timeoffset,     GWPEPON_LANE_CONFIG, GWPEPON_EVF_EVENT) \
+    X(DHCP_SERVER_RESTART,    "dhcp_server-restart",    GWPEPON_PARSE_NONE,    GWPEpon_HandleDHCPServer,         GWPEPON_LANE_LAN,    GWPEPON_EVF_EVENT) \
+    X(ETH_ENABLED,            "eth_enabled",            GWPEPON_PARSE_BOOL,    GWPEpon_HandlePortEnable,         GWPEPON_LANE_LAN,    GWPEPON_EVF_LEVEL) \
+    X(MOCA_ENABLED,           "moca_enabled",           GWPEPON_PARSE_BOOL,    GWPEpon_HandlePortEnable,         GWPEPON_LANE_LAN,    GWPEPON_EVF_LEVEL) \
+    X(WL_ENABLED,             "wl_enabled",             GWPEPON_PARSE_BOOL,    GWPEpon_HandlePortEnable,         GWPEPON_LANE_LAN,    GWPEPON_EVF_LEVEL) \
+    X(XCONF_ROUTER_IP_MODE,   "xconf_router_ip_mode",   GWPEPON_PARSE_BOOL,    GWPEpon_HandleXconfRouterIpMode,  GWPEPON_LANE_CONFIG, GWPEPON_EVF_EVENT) \
+    X(XCONF_POD_SEED,         "xconf_pod_seed",         GWPEPON_PARSE_BOOL,    GWPEpon_HandleXconfPoDSeed,       GWPEPON_LANE_CONFIG, GWPEPON_EVF_EVENT) \
+    X(XCONF_DST_ADJ,          "xconf_dst_adj",          GWPEPON_PARSE_BOOL,    GWPEpon_HandleXconfDstAdj,        GWPEPON_LANE_CONFIG, GWPEPON_EVF_EVENT) \
+    X(XCONF_GW_PROV_MODE,     "xconf_gw_prov_mode",     GWPEPON_PARSE_BOOL,    GWPEpon_HandleXconfGwProvMode,    GWPEPON_LANE_CONFIG, GWPEPON_EVF_EVENT) \
+    X(BRIDGE_MODE,            "bridge_mode",            GWPEPON_PARSE_BOOL,    GWPEpon_HandleBridgeMode,         GWPEPON_LANE_LAN,    GWPEPON_EVF_LEVEL) \
+    X(FIREWALL_RESTART,       "firewall-restart",       GWPEPON_PARSE_NONE,    GWPEpon_HandleFirewall,           GWPEPON_LANE_ROUTE,  GWPEPON_EVF_EVENT) \
+    X(IPV4_TIMEZONE,          "ipv4_timezone",          GWPEPON_PARSE_NONE,    GWPEpon_HandleIpv4Timezone,       GWPEPON_LANE_CONFIG, GWPEPON_EVF_EVENT) \
+    X(IPV6_TIMEZONE,          "ipv6_timezone",          GWPEPON_PARSE_NONE,    GWPEpon_HandleIpv6Timezone,       GWPEPON_LANE_CONFIG, GWPEPON_EVF_EVENT) \
+    X(LAN_RESTART,            "lan-restart",            GWPEPON_PARSE_BOOL,    NULL,                             GWPEPON_LANE_LAN,    GWPEPON_EVF_EVENT) \
+    X(LAN_STOP,               "lan-stop",               GWPEPON_PARSE_NONE,    NULL,                             GWPEPON_LANE_LAN,    GWPEPON_EVF_EVENT) \
+    X(LAN_STATUS,             "lan-status",             GWPEPON_PARSE_NONE,    GWPEpon_HandleLanStatus,          GWPEPON_LANE_LAN,    GWPEPON_EVF_LEVEL) \
+    X(FORWARDING_RESTART,     "forwarding-restart",     GWPEPON_PARSE_NONE,    NULL,                             GWPEPON_LANE_ROUTE,  GWPEPON_EVF_EVENT) \
+    X(DHCPV6S_SERVER,         "dhcpv6s_server",         GWPEPON_PARSE_NONE,    GWPEpon_HandleDHCPServer,         GWPEPON_LANE_LAN,    GWPEPON_EVF_EVENT) \
+    X(PNM_STATUS,             "pnm-status",             GWPEPON_PARSE_UPDOWN,  GWPEpon_HandlePNMStatus,          GWPEPON_LANE_LAN,    GWPEPON_EVF_STATE) \
+    X(MULTINET_SYNCMEMBERS,   "multinet-syncMembers",   GWPEPON_PARSE_INT,     GWPEpon_HandleSyncMembers,        GWPEPON_LANE_LAN,    GWPEPON_EVF_LEVEL) \
+    X(GRE_RESTART,            "gre-restart",            GWPEPON_PARSE_NONE,    GWPEpon_HandleGre,                GWPEPON_LANE_ROUTE,  GWPEPON_EVF_EVENT) \
+    X(GRE_FORCERESTART,       "gre-forceRestart",       GWPEPON_PARSE_NONE,    GWPEpon_HandleGre,                GWPEPON_LANE_ROUTE,  GWPEPON_EVF_EVENT) \
+    X(TSIP_SYNC_ALL,          "ipv4-sync_tsip_all",     GWPEPON_PARSE_NONE,    GWPEpon_HandleTSIP,               GWPEPON_LANE_ROUTE,  GWPEPON_EVF_EVENT) \
+    X(TSIP_STOP_ALL,          "ipv4-stop_tsip_all",     GWPEPON_PARSE_NONE,    GWPEpon_HandleTSIP,               GWPEPON_LANE_ROUTE,  GWPEPON_EVF_EVENT) \
+    X(TSIP_RESYNC,            "ipv4-resync_tsip",       GWPEPON_PARSE_NONE,    GWPEpon_HandleTSIP,               GWPEPON_LANE_ROUTE,  GWPEPON_EVF_EVENT) \
+    X(TSIP_RESYNC_ASN,        "ipv4-resync_tsip_asn",   GWPEPON_PARSE_NONE,    GWPEpon_HandleTSIP,               GWPEPON_LANE_ROUTE,  GWPEPON_EVF_EVENT) \
+    X(WAN_STATUS,             "wan-status",             GWPEPON_PARSE_NONE,    GWPEpon_HandleWanStatus,          GWPEPON_LANE_ROUTE,  GWPEPON_EVF_LEVEL) \
+    X(DHCPV6_OPTION_CHANGED,  "dhcpv6_option_changed",  GWPEPON_PARSE_NONE,    GWPEpon_HandleRouted,             GWPEPON_LANE_ROUTE,  GWPEPON_EVF_EVENT) \
+    X(RIPD_RESTART,           "ripd-restart",           GWPEPON_PARSE_NONE,    GWPEpon_HandleRouted,             GWPEPON_LANE_ROUTE,  GWPEPON_EVF_EVENT) \
+    X(ZEBRA_RESTART,          "zebra-restart",          GWPEPON_PARSE_NONE,    GWPEpon_HandleRouted,             GWPEPON_LANE_ROUTE,  GWPEPON_EVF_EVENT) \
+    X(STATICROUTE_RESTART,    "staticroute-restart",    GWPEPON_PARSE_NONE,    GWPEpon_HandleStaticRoute,        GWPEPON_LANE_ROUTE,  GWPEPON_EVF_EVENT) \
+    X(CUR_GW_PROV_MODE,       "cur_gw_prov_mode",       GWPEPON_PARSE_NONE,    NULL,                             GWPEPON_LANE_WAN,    GWPEPON_EVF_STATE)
+
+#define GWPEPON_EVENT_ENUM(id, name, parser, handler, lane, flags)   GWPEPON_EV_##id,
+
+typedef enum
+{
+    GWPEPON_EVENT_LIST(GWPEPON_EVENT_ENUM)
+    GWPEPON_EV_COUNT
+} GWPEpon_EventId;
+
+typedef struct
+{
+    GWPEpon_EventId id;
+    const char *name;
+    const char *val;
+    int ival;                   /* val as parsed by the event's parser */
+} GWPEpon_EventArg;
+
+typedef void (*GWPEpon_EventHandler)(const GWPEpon_EventArg *ev);
+
+typedef struct
+{
+    const char *name;
+    int parser;
+    GWPEpon_EventHandler handler;   /* NULL for tuples that only feed the gates or only run
+                                       the rules of gw_prov_epon_evconf.h */
+    int lane;
+    unsigned int flags;
+} GWPEpon_EventDesc;
+
+#define GWPEPON_EVENT_DESC(id, name, parser, handler, lane, flags)   { name, parser, handler, lane, flags },
+
+typedef struct
+{
+    unsigned int count;
+    unsigned int dropped;           /* lost to a full event queue */
+    unsigned int deduped;           /* same value as the previous one, ignored */
+    unsigned int debounced;         /* superseded during a debounce window */
+    unsigned int superseded;        /* dropped from the queue by a newer value */
+    unsigned long long saved_ms;    /* handler time not spent on superseded values */
+    unsigned long long last_ms;
+    unsigned long long queue_ms_max;
+    unsigned long long queue_ms_total;
+    unsigned long long run_ms_max;
+    unsigned long long run_ms_total;
+} GWPEpon_EventStats;
+
+/* Dispatch classes, derived from the event priority (0 most urgent). A
+   queued event runs when no event of a more urgent class waits, or once
+   it waited past the age limit of its class (starvation guard). */
+typedef enum
+{
+    GWPEPON_CLASS_WAN = 0,          /* priority 0-2: WAN link and addressing */
+    GWPEPON_CLASS_NORMAL,           /* priority 3-6 */
+    GWPEPON_CLASS_BULK,             /* priority 7-9: LAN and routing housekeeping */
+    GWPEPON_CLASS_COUNT
+} GWPEpon_EventClass;
+
+#define GWPEPON_CLASS_NORMAL_AGE_MS    1000
+#define GWPEPON_CLASS_BULK_AGE_MS      3000
+
+typedef struct
+{
+    unsigned int count;
+    unsigned int aged;              /* run ahead of a more urgent class */
+    unsigned long long wait_ms_max;
+    unsigned long long wait_ms_total;
+} GWPEpon_ClassStats;
+
+/* The dispatch table, instantiated by the module that defines the handlers */
+extern const GWPEpon_EventDesc gwpepon_event_table[GWPEPON_EV_COUNT];
+
+void GWPEpon_EventRegistryInit(void);
+int  GWPEpon_EventRegister(int fd, token_t token);
+int  GWPEpon_EventLookup(const char *name);
+void GWPEpon_EventDispatch(GWPEpon_EventId id, const char *val, unsigned long long enqueue_ms);
+void GWPEpon_EventInvoke(GWPEpon_EventId id, const char *val, unsigned long long enqueue_ms);
+void GWPEpon_EventDropped(GWPEpon_EventId id);
+void GWPEpon_EventSuperseded(GWPEpon_EventId id);
+const GWPEpon_EventStats *GWPEpon_EventGetStats(GWPEpon_EventId id);
+
+GWPEpon_EventClass GWPEpon_EventClassOf(GWPEpon_EventId id);
+const char *GWPEpon_EventClassName(GWPEpon_EventClass cls);
+void GWPEpon_EventClassWait(GWPEpon_EventClass cls, unsigned long long wait_ms, int aged);
+const GWPEpon_ClassStats *GWPEpon_EventGetClassStats(GWPEpon_EventClass cls);
+
+#endif
@@ -0,0 +1,72 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/** @file gw_prov_epon_evloop.h
+ *  @brief Single threaded event loop used by the provisioning handler.
+ *
+ *  The loop multiplexes file descriptors (sysevent, control socket, ...),
+ *  a timer wheel for deferred/periodic work, signals through signalfd and
+ *  asynchronous child completion through pidfd (or SIGCHLD on kernels
+ *  without pidfd support).
+ *
+ *  The loop state is thread local: every provisioning context thread
+ *  runs its own loop, and a signal is only read by the loop that added
+ *  a watch for it.
+ */
+
+#ifndef _GW_PROV_EPON_EVLOOP_H_
+#define _GW_PROV_EPON_EVLOOP_H_
+
+#include <sys/types.h>
+
+#define GWPEPON_EVLOOP_MAX_FDS        32
+#define GWPEPON_EVLOOP_MAX_TIMERS     64
+#define GWPEPON_EVLOOP_MAX_CHILDREN   16
+#define GWPEPON_TIMER_TICK_MS         10
+#define GWPEPON_TIMER_WHEEL_SLOTS     256
+
+typedef void (*GWPEpon_FdCb)(int fd, unsigned int events, void *arg);
+typedef void (*GWPEpon_TimerCb)(void *arg);
+typedef void (*GWPEpon_SignalCb)(int signo, void *arg);
+typedef void (*GWPEpon_ChildCb)(pid_t pid, int wstatus, void *arg);
+
+/* Must be called from the main thread before any thread is created */
+int  GWPEpon_EvLoopBlockSignals(void);
+
+int  GWPEpon_EvLoopInit(void);
+int  GWPEpon_EvLoopRun(void);
+void GWPEpon_EvLoopStop(void);
+void GWPEpon_EvLoopClose(void);
+
+int  GWPEpon_EvLoopAddFd(int fd, unsigned int events, GWPEpon_FdCb cb, void *arg);
+int  GWPEpon_EvLoopDelFd(int fd);
+int  GWPEpon_EvLoopAddSignal(int signo, GWPEpon_SignalCb cb, void *arg);
+
+unsigned int GWPEpon_TimerAdd(unsigned int delay_ms, unsigned int period_ms, GWPEpon_TimerCb cb, void *arg);
+void GWPEpon_TimerCancel(unsigned int id);
+
+pid_t GWPEpon_ChildSpawn(const char *cmd, GWPEpon_ChildCb cb, void *arg);
+int   GWPEpon_ChildKill(pid_t pid, int signo);
+int   GWPEpon_System(const char *cmd);
+
+unsigned long long GWPEpon_NowMs(void);
+unsigned long long GWPEpon_NowUs(void);
+unsigned long long GWPEpon_ProcessAgeMs(void);
+
+#endif
@@ -0,0 +1,73 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/** @file gw_prov_epon_fw.h
+ *  @brief Firewall updates applied as a delta of the last ruleset.
+ *
+ *  The generator renders the whole desired ruleset of each family in
+ *  iptables-restore format without applying it. The kernel ruleset is
+ *  read with iptables-save, and a chain is rewritten when the generator
+ *  changed it since the last restore, or when its kernel copy is no
+ *  longer what iptables-save showed right after that restore (another
+ *  component restored or edited it). Only those chains are flushed and
+ *  refilled, chains that disappeared from the generated ruleset are
+ *  deleted, all in one iptables-restore --noflush transaction per family.
+ *  Chains left alone keep their rules and the connections they match are
+ *  not disturbed. Nothing is applied when no chain changed.
+ *
+ *  Without a ruleset to compare with (first run, a failed apply or
+ *  iptables-save, a fallback) the whole generated ruleset is restored.
+ *  lan_handler.sh only runs when the generator or a restore fails.
+ */
+
+#ifndef _GW_PROV_EPON_FW_H_
+#define _GW_PROV_EPON_FW_H_
+
+#ifndef GWPEPON_FW_GENERATE
+#define GWPEPON_FW_GENERATE      "/usr/bin/firewall_render"
+#endif
+#define GWPEPON_FW_RULES_V4      "/tmp/.ipt"
+#define GWPEPON_FW_RULES_V6      "/tmp/.ipt_v6"
+#define GWPEPON_FW_DELTA_V4      "/tmp/.ipt_delta"
+#define GWPEPON_FW_DELTA_V6      "/tmp/.ipt_v6_delta"
+#define GWPEPON_FW_LIVE_V4       "/tmp/.ipt_live"
+#define GWPEPON_FW_LIVE_V6       "/tmp/.ipt_v6_live"
+#define GWPEPON_FW_SCRIPT        "sh /usr/ccsp/lan_handler.sh firewall_restart"
+#define GWPEPON_FW_MAX_TABLES    8
+#define GWPEPON_FW_MAX_CHAINS    1024    /* all tables of a family */
+
+typedef struct
+{
+    unsigned int requests;
+    unsigned int unchanged;         /* nothing applied */
+    unsigned int deltas;            /* changed chains restored with --noflush */
+    unsigned int full;              /* whole ruleset restored */
+    unsigned int fallbacks;         /* lan_handler.sh runs */
+    unsigned int rules;             /* rules of the last generated ruleset */
+    unsigned int chains;
+    unsigned int rules_applied;     /* rules written by the last restore */
+    unsigned int chains_changed;    /* chains created, refilled or deleted by it */
+    unsigned long long last_us;     /* last restore run */
+    unsigned long long max_us;
+} GWPEpon_FwStats;
+
+int  GWPEpon_FwRequest(const char *why);
+const GWPEpon_FwStats *GWPEpon_FwGetStats(int idx, const char **family);
+
+#endif
@@ -0,0 +1,56 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/** @file gw_prov_epon_gate.h
+ *  @brief Readiness gates: actions that fire once when a set of sysevent
+ *    tuple conditions becomes true.
+ *
+ *  A gate is declared with an expression such as
+ *  "lan-status==started && wan-status==started". Terms compare a tuple
+ *  with == or !=, are joined with &&, and alternatives are separated by
+ *  ||. Conditions are checked against tuple values tracked from received
+ *  notifications and from the daemon's own sets, never by querying
+ *  sysevent.
+ */
+
+#ifndef _GW_PROV_EPON_GATE_H_
+#define _GW_PROV_EPON_GATE_H_
+
+#define GWPEPON_GATE_MAX           16
+#define GWPEPON_GATE_MAX_TERMS     8
+#define GWPEPON_GATE_MAX_TUPLES    32
+#define GWPEPON_GATE_NAME_LEN      64
+#define GWPEPON_GATE_VAL_LEN       64
+
+/* Called when the gate opens. A non-zero return refuses the action, the
+   gate stays closed and is tried again on the next evaluation. */
+typedef int (*GWPEpon_GateOpenCb)(const char *gate, void *arg);
+/* Called when an opened gate's conditions stop holding */
+typedef void (*GWPEpon_GateCloseCb)(const char *gate, void *arg);
+
+void GWPEpon_GateInit(void);
+int  GWPEpon_GateAdd(const char *name, const char *expr,
+                     GWPEpon_GateOpenCb on_open, GWPEpon_GateCloseCb on_close, void *arg);
+void GWPEpon_GateUpdate(const char *tuple, const char *val);
+void GWPEpon_GateRecheck(void);
+void GWPEpon_GateLatch(void);
+const char *GWPEpon_GateGetTuple(const char *tuple);
+int  GWPEpon_GateGetInfo(int idx, const char **name, int *open);
+
+#endif
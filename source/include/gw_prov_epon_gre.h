@@ -0,0 +1,61 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/** @file gw_prov_epon_gre.h
+ *  @brief Hotspot GRE tunnel reconfigured in place.
+ *
+ *  gre-restart compares the tunnel endpoint chosen by hotspotfd
+ *  (sysevent hotspotfd-tunnelEP) and the WAN interface the tunnel runs
+ *  over with the parameters of the existing tunnel. A change is applied
+ *  to the tunnel over netlink: its VLAN interfaces, the hotspot bridges
+ *  and their clients stay in place. gre-forceRestart, a missing tunnel or
+ *  an endpoint that is not an IPv4 address rebuild everything with
+ *  service_xfinity_hotspot.sh.
+ *
+ *  The disruption of each event is the time the tunnel could not carry
+ *  client traffic: none when unchanged, the netlink request for a
+ *  change, the whole script run for a rebuild.
+ */
+
+#ifndef _GW_PROV_EPON_GRE_H_
+#define _GW_PROV_EPON_GRE_H_
+
+#define GWPEPON_GRE_IFNAME       "gretap0"
+#define GWPEPON_GRE_ENDPOINT     "hotspotfd-tunnelEP"
+#define GWPEPON_GRE_SCRIPT       "sh /etc/utopia/service.d/service_xfinity_hotspot.sh xfinity-hotspot-restart"
+#define GWPEPON_GRE_DATA_LEN     256     /* IFLA_INFO_DATA of the tunnel */
+
+typedef struct
+{
+    unsigned int requests;
+    unsigned int unchanged;
+    unsigned int updates;           /* endpoint or WAN device changed in place */
+    unsigned int rebuilds;
+    unsigned int forced;            /* rebuilds requested by gre-forceRestart */
+    unsigned int failures;
+    unsigned long long last_us;     /* disruption of the last event */
+    unsigned long long update_us_max;
+    unsigned long long rebuild_us_max;
+    unsigned long long total_us;
+} GWPEpon_GreStats;
+
+int  GWPEpon_GreRequest(int force);
+const GWPEpon_GreStats *GWPEpon_GreGetStats(void);
+
+#endif
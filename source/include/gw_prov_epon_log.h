@@ -0,0 +1,46 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/** @file gw_prov_epon_log.h
+ *  @brief Logging macros shared by the gateway provisioning sources.
+ */
+
+#ifndef _GW_PROV_EPON_LOG_H_
+#define _GW_PROV_EPON_LOG_H_
+
+#include <stdio.h>
+
+#define INFO  0
+#define WARNING  1
+#define ERROR 2
+
+/* Lowest level compiled in; the low footprint build raises it to WARNING,
+   which drops the INFO entry/exit traces and their format strings */
+#ifndef GWPEPON_LOG_LEVEL
+#define GWPEPON_LOG_LEVEL INFO
+#endif
+
+#ifdef FEATURE_SUPPORT_RDKLOG
+#include "ccsp_trace.h"
+#define GWPROVEPONLOG(x, ...) { if((x)<(GWPEPON_LOG_LEVEL)){}else if((x)==(INFO)){CcspTraceInfo((__VA_ARGS__));}else if((x)==(WARNING)){CcspTraceWarning((__VA_ARGS__));}else if((x)==(ERROR)){CcspTraceError((__VA_ARGS__));} }
+#else
+#define GWPROVEPONLOG(x, ...) { if((x)>=(GWPEPON_LOG_LEVEL)){fprintf(stderr, "GwProvEponLog<%s:%d> ", __FUNCTION__, __LINE__);fprintf(stderr, __VA_ARGS__);} }
+#endif
+
+#endif
@@ -0,0 +1,59 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/** @file gw_prov_epon_member.h
+ *  @brief Bridge membership of the XHS capable LAN port.
+ *
+ *  multinet-syncMembers names the multinet instance the port belongs to:
+ *  2 for the XHS bridge (sysevent multinet_2-name), anything else for
+ *  the local LAN bridge (syscfg lan_ifname). The port is moved with one
+ *  RTM_NEWLINK setting its master, the kernel releases it from the old
+ *  bridge and enslaves it to the new one in the same request.
+ *  lan_handler.sh eth3_to_xhs / eth3_to_local only run when the port or
+ *  the bridge does not exist or the kernel refused the move.
+ *
+ *  When the daemon decides the membership itself, it applies it first
+ *  and then publishes multinet-syncMembers for the other components. The
+ *  notification of that set is recognized as its own echo and dropped.
+ */
+
+#ifndef _GW_PROV_EPON_MEMBER_H_
+#define _GW_PROV_EPON_MEMBER_H_
+
+#define GWPEPON_MEMBER_PORT      "eth3"
+#define GWPEPON_MEMBER_TUPLE     "multinet-syncMembers"
+#define GWPEPON_MEMBER_XHS       2       /* multinet instance of the XHS bridge */
+#define GWPEPON_MEMBER_ECHO_MS   5000    /* how long the echo of our own set is expected */
+
+typedef struct
+{
+    unsigned int requests;
+    unsigned int moves;             /* port moved over netlink */
+    unsigned int unchanged;         /* already in the requested bridge */
+    unsigned int echoes;            /* notifications of our own sets dropped */
+    unsigned int fallbacks;         /* lan_handler.sh runs */
+    unsigned long long last_us;     /* last move, request to ack */
+    unsigned long long max_us;
+} GWPEpon_MemberStats;
+
+int  GWPEpon_MemberRequest(int instance);
+int  GWPEpon_MemberSync(int instance);
+const GWPEpon_MemberStats *GWPEpon_MemberGetStats(void);
+
+#endif
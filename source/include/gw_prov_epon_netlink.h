@@ -0,0 +1,68 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/** @file gw_prov_epon_netlink.h
+ *  @brief Minimal rtnetlink client shared by the modules that program the
+ *    kernel directly instead of running ip/brctl/ifconfig.
+ *
+ *  Requests are collected in a batch and sent with a single sendmsg; the
+ *  kernel processes them in order and acknowledges each one, and
+ *  GWPEpon_NlBatchSend waits for every acknowledgement:
+ *
+ *    GWPEpon_NlBatch batch;
+ *    struct nlmsghdr *nlh;
+ *
+ *    GWPEpon_NlBatchInit(&batch);
+ *    nlh = GWPEpon_NlBatchAdd(&batch, RTM_NEWROUTE, NLM_F_CREATE | NLM_F_REPLACE, &rtm, sizeof(rtm));
+ *    GWPEpon_NlAddAttr(&batch, nlh, RTA_DST, &dst, sizeof(dst));
+ *    failed = GWPEpon_NlBatchSend(fd, &batch);
+ */
+
+#ifndef _GW_PROV_EPON_NETLINK_H_
+#define _GW_PROV_EPON_NETLINK_H_
+
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+
+#define GWPEPON_NL_BATCH_LEN     8192
+#define GWPEPON_NL_RECV_LEN      16384
+#define GWPEPON_NL_TIMEOUT_MS    1000
+
+typedef struct
+{
+    char buf[GWPEPON_NL_BATCH_LEN] __attribute__((aligned(NLMSG_ALIGNTO)));
+    int len;
+    int count;                  /* requests in the batch */
+    unsigned int first_seq;
+} GWPEpon_NlBatch;
+
+/* Returns 0 to continue the dump, non-zero to stop it */
+typedef int (*GWPEpon_NlCb)(const struct nlmsghdr *nlh, void *arg);
+
+int  GWPEpon_NlOpen(unsigned int groups);
+void GWPEpon_NlBatchInit(GWPEpon_NlBatch *batch);
+struct nlmsghdr *GWPEpon_NlBatchAdd(GWPEpon_NlBatch *batch, int type, int flags, const void *body, int len);
+int  GWPEpon_NlAddAttr(GWPEpon_NlBatch *batch, struct nlmsghdr *nlh, int type, const void *data, int len);
+struct rtattr *GWPEpon_NlNestStart(GWPEpon_NlBatch *batch, struct nlmsghdr *nlh, int type);
+void GWPEpon_NlNestEnd(struct nlmsghdr *nlh, struct rtattr *nest);
+int  GWPEpon_NlBatchSend(int fd, GWPEpon_NlBatch *batch);
+int  GWPEpon_NlDump(int fd, int type, const void *body, int len, GWPEpon_NlCb cb, void *arg);
+void GWPEpon_NlParseAttrs(struct rtattr **tb, int max, struct rtattr *rta, int len);
+
+#endif
@@ -0,0 +1,59 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/** @file gw_prov_epon_port.h
+ *  @brief LAN port control over netlink.
+ *
+ *  Every port class has its interfaces listed in syscfg and its ports
+ *  belong to the LAN bridge (syscfg lan_ifname):
+ *
+ *    class  event          syscfg list                      default
+ *    eth    eth_enabled    lan_ethernet_physical_ifnames    eth1 eth2 eth3
+ *    moca   moca_enabled   lan_moca_physical_ifnames        moca0
+ *    wl     wl_enabled     lan_wl_physical_ifnames          wl0 wl1
+ *
+ *  Enabling a class sets its ports up and enslaves those that are in no
+ *  bridge yet to the LAN bridge, disabling sets them down, all in one
+ *  netlink batch. A port already in a bridge is left there, and the XHS
+ *  port (GWPEPON_MEMBER_PORT, moved between the bridges by the member
+ *  module) only ever has its link state changed.
+ *  lan_handler.sh only runs for what needs vendor steps: a port or the
+ *  bridge that does not exist yet, or a request the kernel refused.
+ */
+
+#ifndef _GW_PROV_EPON_PORT_H_
+#define _GW_PROV_EPON_PORT_H_
+
+#define GWPEPON_PORT_MAX         8       /* ports per class */
+#define GWPEPON_PORT_LIST_LEN    128
+
+typedef struct
+{
+    unsigned int enables;
+    unsigned int disables;
+    unsigned int ports;             /* port changes sent over netlink */
+    unsigned int fallbacks;         /* lan_handler.sh runs */
+    unsigned long long last_us;     /* netlink batch, send to last ack */
+    unsigned long long max_us;
+} GWPEpon_PortStats;
+
+int  GWPEpon_PortSet(const char *event, int enable);
+const GWPEpon_PortStats *GWPEpon_PortGetStats(int idx, const char **cls);
+
+#endif
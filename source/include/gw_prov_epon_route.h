@@ -0,0 +1,63 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/** @file gw_prov_epon_route.h
+ *  @brief Static routes programmed over netlink.
+ *
+ *  The static routes of syscfg (StaticRouteCount, then namespace sr_<n>
+ *  with dest, netmask, gw and interface "wan", "lan" or an interface
+ *  name) are installed with protocol GWPEPON_ROUTE_PROTO. They are
+ *  compared with the main table routes of that protocol on the WAN
+ *  interface and the LAN bridges, and only the missing and stale routes
+ *  are added and deleted. Routes installed by anyone else, whatever their
+ *  protocol, are never deleted; a configured route replaces one with the
+ *  same destination and metric.
+ *
+ *  The requests go in a single netlink batch, which is not a transaction:
+ *  the kernel applies them one by one and a refused request leaves the
+ *  others applied. After a refusal the table is read again and the
+ *  counters report what it actually holds; the next apply converges from
+ *  there.
+ */
+
+#ifndef _GW_PROV_EPON_ROUTE_H_
+#define _GW_PROV_EPON_ROUTE_H_
+
+#define GWPEPON_ROUTE_MAX            32
+#define GWPEPON_ROUTE_COUNT_KEY      "StaticRouteCount"
+#define GWPEPON_ROUTE_LAN_BRIDGES    "brlan"
+#define GWPEPON_ROUTE_PROTO          201     /* unassigned in /etc/iproute2/rt_protos */
+
+typedef struct
+{
+    unsigned int applies;
+    unsigned int added;
+    unsigned int deleted;
+    unsigned int unchanged;         /* applies with nothing to do */
+    unsigned int partial;           /* applies with a refused request, table read back */
+    unsigned int failed;            /* routes left differing from syscfg */
+    unsigned int fallbacks;         /* service_routed.sh runs, netlink unusable */
+    unsigned long long last_us;     /* apply latency, routing table read to last ack */
+    unsigned long long max_us;
+} GWPEpon_RouteStats;
+
+int  GWPEpon_RouteApplyStatic(void);
+const GWPEpon_RouteStats *GWPEpon_RouteGetStats(void);
+
+#endif
@@ -0,0 +1,77 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/** @file gw_prov_epon_routed.h
+ *  @brief In-place reconfiguration of zebra and ripd.
+ *
+ *  The part of the routing configuration that follows the provisioning
+ *  events is rendered from the current tuples:
+ *
+ *    zebra  interface <lan_ifname>: router advertisements, with the LAN
+ *           prefix and DNS servers, while lan-status is started
+ *    ripd   router rip: RIP on the WAN interface while wan-status is
+ *           started and syscfg rip_enabled is 1
+ *
+ *  It is compared with the configuration last applied to each daemon and
+ *  only the difference is sent, over the daemon's vty socket, as the
+ *  commands vtysh would send. The applied configuration is never assumed:
+ *  it is read back with "show running-config", keeping only the lines the
+ *  adapter renders, the first time a daemon is seen and after every
+ *  restart. A daemon whose socket does not answer, or that rejects a
+ *  command, is restarted through service_routed.sh as before.
+ *  ripd-restart and zebra-restart stay explicit restart requests.
+ *
+ *  The socket paths and the script can be set at build time to drive
+ *  stand-in daemons, test/routed checks the rendered configuration
+ *  against the one service_routed.sh writes.
+ */
+
+#ifndef _GW_PROV_EPON_ROUTED_H_
+#define _GW_PROV_EPON_ROUTED_H_
+
+#ifndef GWPEPON_ROUTED_ZEBRA_VTY
+#define GWPEPON_ROUTED_ZEBRA_VTY     "/var/run/quagga/zebra.vty"
+#endif
+#ifndef GWPEPON_ROUTED_RIPD_VTY
+#define GWPEPON_ROUTED_RIPD_VTY      "/var/run/quagga/ripd.vty"
+#endif
+#ifndef GWPEPON_ROUTED_SCRIPT
+#define GWPEPON_ROUTED_SCRIPT        "sh /etc/utopia/service.d/service_routed.sh"
+#endif
+#define GWPEPON_ROUTED_TIMEOUT_MS    1000
+#define GWPEPON_ROUTED_MAX_LINES     24
+#define GWPEPON_ROUTED_SECTION_LEN   32
+#define GWPEPON_ROUTED_LINE_LEN      96
+#define GWPEPON_ROUTED_SHOW_LEN      8192    /* running configuration read back */
+
+typedef struct
+{
+    unsigned int updates;       /* events handled */
+    unsigned int readbacks;     /* running configurations taken over without a restart */
+    unsigned int unchanged;     /* nothing to send to the daemon */
+    unsigned int pushes;        /* configuration changes applied over the vty */
+    unsigned int commands;      /* vty commands sent by those pushes */
+    unsigned int restarts;      /* service_routed.sh runs */
+    unsigned int failures;      /* vty sessions that fell back to a restart */
+} GWPEpon_RoutedStats;
+
+int  GWPEpon_RoutedUpdate(const char *name, const char *val);
+const GWPEpon_RoutedStats *GWPEpon_RoutedGetStats(int idx, const char **daemon);
+
+#endif
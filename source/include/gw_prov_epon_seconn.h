@@ -0,0 +1,87 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/** @file gw_prov_epon_seconn.h
+ *  @brief Supervision of the sysevent connections of a WAN context.
+ *
+ *  A failed notification read, get or set checks its connection. A
+ *  connection closed by syseventd, or one that failed
+ *  GWPEPON_SECONN_MAX_ERRORS times in a row, takes both connections
+ *  down: they are closed and the notification socket leaves the event
+ *  loop, so a dead socket can no longer wake the loop.
+ *
+ *  Both connections are then reopened from a timer, with a delay
+ *  doubling from GWPEPON_SECONN_BASE_MS up to GWPEPON_SECONN_CAP_MS. Once
+ *  both are open, the subscribe callback registers the events again and
+ *  re-reads the state tuples, so transitions made during the outage are
+ *  dispatched like notifications.
+ *
+ *  Gets fail while the connections are down. Sets are kept instead: the
+ *  last value of every tuple the daemon owns (the list given to
+ *  GWPEpon_SeconnInit), and up to GWPEPON_SECONN_QUEUE_LEN other sets in
+ *  order, the oldest dropped first. Once reconnected the queued sets are
+ *  made again, then every owned tuple whose live value is not the last
+ *  one set is published again, which also restores the tuples a
+ *  restarted syseventd lost.
+ */
+
+#ifndef _GW_PROV_EPON_SECONN_H_
+#define _GW_PROV_EPON_SECONN_H_
+
+#include "gw_prov_epon_ctx.h"
+
+#define GWPEPON_SECONN_BASE_MS      250
+#define GWPEPON_SECONN_CAP_MS       30000
+#define GWPEPON_SECONN_MAX_ERRORS   8       /* consecutive failures of a live connection */
+#define GWPEPON_SECONN_QUEUE_LEN    16      /* sets of tuples not owned, made while down */
+#define GWPEPON_SECONN_MAX_OWNED    16
+#define GWPEPON_SECONN_NAME_LEN     64
+#define GWPEPON_SECONN_VAL_LEN      128
+
+typedef struct
+{
+    int up;
+    unsigned int errors;            /* failed notification reads, gets and sets */
+    unsigned int outages;
+    unsigned int attempts;          /* reconnections tried */
+    unsigned int reconnects;
+    unsigned int replayed;          /* tuples that changed during the outages */
+    unsigned int queued;            /* sets made while down */
+    unsigned int dropped;           /* queued sets lost to a full queue */
+    unsigned int republished;       /* sets made again after a reconnection */
+    unsigned long long outage_ms_last;
+    unsigned long long outage_ms_max;
+    unsigned long long outage_ms_total;
+} GWPEpon_SeconnStats;
+
+/* Registers the events again on the new connections and dispatches the
+   tuples that changed meanwhile: their count, -1 to retry later */
+typedef int (*GWPEpon_SeconnSubscribeCb)(void);
+
+void GWPEpon_SeconnName(const GWPEpon_WanCtx *ctx, int gs, char *buf, int len);
+void GWPEpon_SeconnInit(GWPEpon_SeconnSubscribeCb subscribe, const char *const *owned);
+void GWPEpon_SeconnClose(void);
+void GWPEpon_SeconnOk(void);
+void GWPEpon_SeconnFailed(int fd, int err);
+void GWPEpon_SeconnLost(const char *why);
+void GWPEpon_SeconnRecord(const char *name, const char *value);
+int  GWPEpon_SeconnQueue(const char *name, const char *value);
+const GWPEpon_SeconnStats *GWPEpon_SeconnGetStats(void);
+
+#endif
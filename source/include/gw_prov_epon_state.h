@@ -0,0 +1,65 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/** @file gw_prov_epon_state.h
+ *  @brief In-memory provisioning state and its tmpfs checkpoint, used to
+ *    resume after a daemon restart without disrupting the WAN.
+ */
+
+#ifndef _GW_PROV_EPON_STATE_H_
+#define _GW_PROV_EPON_STATE_H_
+
+#include <time.h>
+#include "gw_prov_epon.h"
+
+/* Per WAN context paths, suffixed with ".<ifname>" for secondary interfaces */
+#define GWPEPON_CKPT_FILE          "/tmp/.gwprovepon.state"
+#define GWPEPON_IPV4_MARKER        "/tmp/.start_ipv4"
+#define GWPEPON_IPV6_MARKER        "/tmp/.start_ipv6"
+#define GWPEPON_CKPT_PATH_LEN      64
+#define GWPEPON_CKPT_VERSION       1
+#define GWPEPON_CKPT_PERIOD_MS     5000
+#define GWPEPON_STATUS_LEN         16
+
+typedef struct
+{
+    char epon_ifstatus[GWPEPON_STATUS_LEN];
+    char ipv4_status[GWPEPON_STATUS_LEN];
+    char ipv6_status[GWPEPON_STATUS_LEN];
+    EPON_IpProvMode router_ip_mode;
+    int gw_prov_status;
+    int ipv4_service;                   /* udhcp started by us */
+    int ipv6_service;                   /* dibbler started by us */
+    EPON_IpProvStatus lan_wan_v4;       /* last applied LAN/WAN connect */
+    EPON_IpProvStatus lan_wan_v6;
+    int bridge_mode;                    /* last applied bridge mode, -1 unknown */
+    int erouter_reset_count;
+    time_t xconf_call_time;
+} GWPEpon_ProvState;
+
+GWPEpon_ProvState *GWPEpon_GetProvState(void);
+void GWPEpon_StateChanged(void);
+
+int  GWPEpon_CkptInit(void);
+int  GWPEpon_CkptSave(const GWPEpon_ProvState *state);
+int  GWPEpon_CkptLoad(GWPEpon_ProvState *state);
+int  GWPEpon_CkptValidate(const GWPEpon_ProvState *state);
+void GWPEpon_CkptFlush(void);
+
+#endif
@@ -0,0 +1,99 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/** @file gw_prov_epon_status.h
+ *  @brief Provisioning status page shared with other processes.
+ *
+ *  gw_prov_epon publishes its provisioning state in a POSIX shared memory
+ *  object, one per WAN context ("/gwprovepon_status" for the primary,
+ *  "/gwprovepon_status.<ifname>" for the others). Processes that used to
+ *  poll gw_prov_status, gw_prov_status_str or erouter_reset_count through
+ *  syseventd can map it read only and read it without any syscall; the
+ *  sysevent tuples are still set for compatibility.
+ *
+ *  The page has a single writer and is published under a seqlock: seq is
+ *  odd while an update is in progress, a reader copies the status and
+ *  retries when seq was odd or changed meanwhile. generation counts the
+ *  published changes, a reader polling it sees whether anything moved.
+ *
+ *  Reader library (libgwprovepon_status):
+ *
+ *    const GWPEpon_StatusPage *page = GWPEpon_StatusOpen(NULL);
+ *    GWPEpon_Status st;
+ *    if (page && GWPEpon_StatusRead(page, &st) == 0 && (st.gw_prov_status & GWPEPON_PROV_IPV4_UP))
+ *        ...
+ *    GWPEpon_StatusClose(page);
+ */
+
+#ifndef _GW_PROV_EPON_STATUS_H_
+#define _GW_PROV_EPON_STATUS_H_
+
+#include <stdint.h>
+
+#define GWPEPON_STATUS_SHM          "/gwprovepon_status"
+#define GWPEPON_STATUS_MAGIC        0x47575053      /* "GWPS" */
+#define GWPEPON_STATUS_VERSION      1
+#define GWPEPON_STATUS_READ_TRIES   64
+
+/* gw_prov_status bits, same values as the sysevent tuple */
+#define GWPEPON_PROV_IPV6_UP        0x1
+#define GWPEPON_PROV_IPV4_UP        0x2
+
+/* Milestones, CLOCK_MONOTONIC ms of the last time they were reached */
+typedef enum
+{
+    GWPEPON_MS_READY = 0,               /* daemon event loop running */
+    GWPEPON_MS_LINK_UP,                 /* epon_ifstatus up */
+    GWPEPON_MS_IPV4_UP,
+    GWPEPON_MS_IPV6_UP,
+    GWPEPON_MS_COUNT
+} GWPEpon_Milestone;
+
+typedef struct
+{
+    uint32_t generation;                /* incremented on every published change */
+    uint32_t gw_prov_status;            /* GWPEPON_PROV_* */
+    int32_t  router_ip_mode;            /* EPON_IpProvMode */
+    int32_t  link_up;
+    int32_t  erouter_reset_count;
+    int32_t  pid;                       /* publishing daemon */
+    char     ifname[16];
+    uint64_t updated_ms;
+    uint64_t milestone_ms[GWPEPON_MS_COUNT];
+} GWPEpon_Status;
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t seq;                       /* odd while the writer updates status */
+    uint32_t reserved;
+    GWPEpon_Status status;
+} GWPEpon_StatusPage;
+
+/* Reader library */
+const GWPEpon_StatusPage *GWPEpon_StatusOpen(const char *ifname);
+int  GWPEpon_StatusRead(const GWPEpon_StatusPage *page, GWPEpon_Status *status);
+void GWPEpon_StatusClose(const GWPEpon_StatusPage *page);
+
+/* Writer, gw_prov_epon only */
+int  GWPEpon_StatusInit(void);
+void GWPEpon_StatusPublish(void);
+
+#endif
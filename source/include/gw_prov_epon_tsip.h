@@ -0,0 +1,57 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/** @file gw_prov_epon_tsip.h
+ *  @brief Batching of the True Static IP (TSIP) operations.
+ *
+ *  The TSIP events arrive in bursts at provisioning time, one per subnet.
+ *  They are collected for GWPEPON_TSIP_WINDOW_MS and reduced before
+ *  service_ipv4.sh runs: the last sync_all or stop_all replaces every
+ *  earlier operation (a stop_all followed by a sync_all collapses into
+ *  the sync_all), a resync is dropped when a sync_all of the same batch
+ *  re-applies the whole configuration, and a resync repeated with the
+ *  same value merges into one. Resyncs of different subnets are all kept
+ *  with their value; past GWPEPON_TSIP_MAX_OPS of them the batch turns
+ *  into a sync_all. The reduced operations run chained in one "tsip"
+ *  action, or in a few when they do not fit a single command.
+ */
+
+#ifndef _GW_PROV_EPON_TSIP_H_
+#define _GW_PROV_EPON_TSIP_H_
+
+#define GWPEPON_TSIP_WINDOW_MS      500
+#define GWPEPON_TSIP_MAX_OPS        16
+#define GWPEPON_TSIP_SCRIPT         "sh /etc/utopia/service.d/service_ipv4.sh"
+
+#define GWPEPON_TSIP_AVOIDED_TUPLE  "tsip_runs_avoided"
+
+typedef struct
+{
+    unsigned int requests;      /* TSIP events received */
+    unsigned int batches;       /* "tsip" actions started */
+    unsigned int runs;          /* script runs of those actions */
+    unsigned int avoided;       /* script runs saved by the reduction */
+    unsigned int collapsed;     /* stop_all followed by sync_all in a batch */
+    unsigned int escalated;     /* full batches turned into a sync_all */
+} GWPEpon_TsipStats;
+
+int  GWPEpon_TsipRequest(const char *name, const char *val);
+const GWPEpon_TsipStats *GWPEpon_TsipGetStats(void);
+
+#endif
@@ -0,0 +1,72 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/** @file gw_prov_epon_wanmon.h
+ *  @brief rtnetlink monitor of the WAN interface of a context.
+ *
+ *  The link, address and route notifications of the kernel are turned
+ *  into three observations:
+ *
+ *    link   the interface is up and running
+ *    ipv4   a global IPv4 address and an IPv4 default route on it
+ *    ipv6   a global IPv6 address past DAD and an IPv6 default route on it
+ *
+ *  When the ipv4 or ipv6 observation changes and the provisioning state
+ *  says otherwise, ipv4-status/ipv6-status is injected right away instead
+ *  of waiting for the DHCP client hook. The tuple the hook sets later is
+ *  then absorbed as a confirmation. epon_ifstatus belongs to the EPON
+ *  agent and is never injected, only reconciled. A sysevent status that
+ *  contradicts the kernel, or an injected status never confirmed, is
+ *  logged and counted.
+ */
+
+#ifndef _GW_PROV_EPON_WANMON_H_
+#define _GW_PROV_EPON_WANMON_H_
+
+#define GWPEPON_WANMON_SETTLE_MS     50      /* one refresh per burst of notifications */
+#define GWPEPON_WANMON_CONFIRM_MS    10000   /* sysevent expected after an injected status */
+
+typedef enum
+{
+    GWPEPON_WANMON_LINK = 0,
+    GWPEPON_WANMON_IPV4,
+    GWPEPON_WANMON_IPV6,
+    GWPEPON_WANMON_COUNT
+} GWPEpon_WanMonItem;
+
+typedef struct
+{
+    int observed;                   /* -1 unknown, 0 down, 1 up */
+    unsigned int transitions;
+    unsigned int injected;          /* statuses fed ahead of sysevent */
+    unsigned int confirmed;         /* later reported the same by sysevent */
+    unsigned int unconfirmed;       /* not reported within GWPEPON_WANMON_CONFIRM_MS */
+    unsigned int disagreements;     /* sysevent reported the opposite of the kernel */
+    unsigned long long lead_ms_max; /* how much earlier than sysevent */
+    unsigned long long lead_ms_total;
+} GWPEpon_WanMonStats;
+
+typedef int (*GWPEpon_WanMonInjectCb)(const char *name, const char *val);
+
+int  GWPEpon_WanMonInit(GWPEpon_WanMonInjectCb inject);
+void GWPEpon_WanMonClose(void);
+int  GWPEpon_WanMonAbsorb(const char *name, const char *val);
+const GWPEpon_WanMonStats *GWPEpon_WanMonGetStats(int item, const char **name, const char **tuple);
+
+#endif
@@ -0,0 +1,101 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*! \file driver.c
+    \brief runs the static route programming outside the daemon
+
+    usage: driver <config>
+
+    The route source is compiled in, with syscfg answered from the config
+    file: one "<name> <value>" or "<namespace>::<name> <value>" per line.
+    Applies the configuration once, then prints the counters and the
+    return value on stdout:
+      added=<n> deleted=<n> unchanged=<n> partial=<n> failed=<n> ret=<n>
+*/
+
+#include <time.h>
+#include "gw_prov_epon_route.c"
+
+static GWPEpon_WanCtx driver_ctx = { .ifname = "erouter0" };
+static const char *driver_config;
+
+int syscfg_get(const char *ns, const char *name, char *out_value, int outbufsz)
+{
+    char key[128], line[256];
+    size_t klen;
+    FILE *fp;
+    int ret = -1;
+
+    if (ns)
+        snprintf(key, sizeof(key), "%s::%s", ns, name);
+    else
+        snprintf(key, sizeof(key), "%s", name);
+    klen = strlen(key);
+    out_value[0] = '\0';
+    if ((fp = fopen(driver_config, "r")) == NULL)
+        return -1;
+    while (ret < 0 && fgets(line, sizeof(line), fp) != NULL)
+    {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (strncmp(line, key, klen) == 0 && (line[klen] == ' ' || line[klen] == '\0'))
+        {
+            snprintf(out_value, outbufsz, "%s", line[klen] ? line + klen + 1 : "");
+            ret = 0;
+        }
+    }
+    fclose(fp);
+    return ret;
+}
+
+GWPEpon_WanCtx *GWPEpon_CtxCurrent(void)
+{
+    return &driver_ctx;
+}
+
+int GWPEpon_ActionRun(const char *action, const char *cmd)
+{
+    fprintf(stderr, "fallback %s: %s\n", action, cmd);
+    return -1;
+}
+
+unsigned long long GWPEpon_NowUs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long) ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+int main(int argc, char **argv)
+{
+    const GWPEpon_RouteStats *stats;
+    int ret;
+
+    if (argc != 2)
+    {
+        fprintf(stderr, "usage: driver <config>\n");
+        return 2;
+    }
+    driver_config = argv[1];
+    ret = GWPEpon_RouteApplyStatic();
+    stats = GWPEpon_RouteGetStats();
+    printf("added=%u deleted=%u unchanged=%u partial=%u failed=%u ret=%d\n",
+           stats->added, stats->deleted, stats->unchanged, stats->partial, stats->failed, ret);
+    return stats->fallbacks ? 1 : 0;
+}
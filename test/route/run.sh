@@ -0,0 +1,96 @@
+#!/bin/sh
+##########################################################################
+# If not stated otherwise in this file or this component's Licenses.txt
+# file the following copyright and licenses apply:
+#
+# Copyright 2016 RDK Management
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+##########################################################################
+#
+# Checks the static route programming (source/gw_prov_epon_route.c) in an
+# unprivileged network namespace, with a veth erouter0 and a bridge
+# brlan0:
+# - configured routes are added, routes of other components are left
+#   alone, whatever their protocol
+# - a second apply is a no-op
+# - shrinking the configuration deletes only the removed routes
+# - a refused request leaves the rest of the batch applied, and the
+#   counters report what the table holds
+#
+# usage: run.sh
+
+HERE=$(cd "$(dirname "$0")" && pwd)
+SRC=$HERE/../../source
+CC=${CC:-cc}
+
+if [ "$1" != --in-netns ]; then
+    exec unshare -rn sh "$0" --in-netns
+fi
+
+W=$(mktemp -d /tmp/route_test.XXXXXX) || exit 1
+trap 'rm -rf "${W:?}"' EXIT
+FAILED=0
+
+$CC -Wall -I"$HERE/../routed/include" -I"$SRC" -I"$SRC/include" -DGWPEPON_LOG_LEVEL=WARNING \
+    -o "$W/driver" "$HERE/driver.c" "$SRC/gw_prov_epon_netlink.c" || exit 1
+
+ip link set lo up
+ip link add erouter0 type veth peer name wanpeer
+ip link add brlan0 type bridge
+ip addr add 192.0.2.2/24 dev erouter0
+ip addr add 10.0.0.1/24 dev brlan0
+ip link set erouter0 up
+ip link set wanpeer up
+ip link set brlan0 up
+# Routes of other components on the managed interfaces
+ip route add 192.0.2.128/25 via 192.0.2.1 dev erouter0 proto static
+ip route add 10.1.0.0/16 dev brlan0 proto boot
+
+expect() {
+    if [ "$2" = "$3" ]; then
+        echo "PASS $1"
+    else
+        echo "FAIL $1"
+        echo "  expected: $3"
+        echo "  got:      $2"
+        FAILED=1
+    fi
+}
+
+routes() {
+    ip -4 route show table main | grep -v 'proto kernel' | sed 's/ *$//' | sort | tr '\n' ';'
+}
+
+FOREIGN="10.1.0.0/16 dev brlan0 scope link;192.0.2.128/25 via 192.0.2.1 dev erouter0 proto static;"
+
+expect "configured routes added" "$("$W/driver" "$HERE/cases/two.conf")" \
+    "added=2 deleted=0 unchanged=0 partial=0 failed=0 ret=0"
+expect "other components' routes left alone" "$(routes)" \
+    "${FOREIGN}198.51.100.0/24 via 192.0.2.1 dev erouter0 proto 201;203.0.113.0/25 dev brlan0 proto 201 scope link;"
+
+expect "second apply is a no-op" "$("$W/driver" "$HERE/cases/two.conf")" \
+    "added=0 deleted=0 unchanged=1 partial=0 failed=0 ret=0"
+
+expect "removed route deleted" "$("$W/driver" "$HERE/cases/one.conf")" \
+    "added=0 deleted=1 unchanged=0 partial=0 failed=0 ret=0"
+expect "only the removed route deleted" "$(routes)" \
+    "${FOREIGN}198.51.100.0/24 via 192.0.2.1 dev erouter0 proto 201;"
+
+"$W/driver" "$HERE/cases/two.conf" > /dev/null
+expect "refused request accounted from the table" "$("$W/driver" "$HERE/cases/unreachable.conf" 2> /dev/null)" \
+    "added=0 deleted=1 unchanged=0 partial=1 failed=1 ret=-1"
+expect "rest of the batch applied" "$(routes)" \
+    "${FOREIGN}198.51.100.0/24 via 192.0.2.1 dev erouter0 proto 201;"
+
+exit $FAILED
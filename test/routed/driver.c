@@ -0,0 +1,194 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*! \file driver.c
+    \brief runs the routing adapter outside the daemon
+
+    usage: driver render <daemon>
+           driver filter <daemon> <config>
+           driver run < commands
+
+    The adapter source is compiled in, with sysevent and syscfg answered
+    from the tuple file named by ROUTED_TUPLES: one "sysevent <name>
+    <value>" or "syscfg <name> <value>" per line. Restarts run
+    GWPEPON_ROUTED_SCRIPT with system().
+
+    render prints the lines the adapter renders for the tuples, filter the
+    lines of a config file written by service_routed.sh that the adapter
+    owns, both as "<section>|<command>". run reads commands from stdin:
+      tuples <file>           answer from another tuple file
+      update <event> [value]  GWPEpon_RoutedUpdate, prints the restarts
+      show <daemon>           owned lines of the daemon's running config
+      stats <daemon>          counters of the daemon
+*/
+
+#include <stdlib.h>
+#include "gw_prov_epon_routed.c"
+
+static GWPEpon_WanCtx driver_ctx = { .ifname = "erouter0" };
+
+static int DriverTuple(const char *kind, const char *name, char *out, int len)
+{
+    const char *path = getenv("ROUTED_TUPLES");
+    char line[512];
+    size_t klen = strlen(kind), nlen = strlen(name);
+    FILE *fp;
+    int ret = -1;
+
+    out[0] = '\0';
+    if (path == NULL || (fp = fopen(path, "r")) == NULL)
+        return -1;
+    while (ret < 0 && fgets(line, sizeof(line), fp) != NULL)
+    {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (strncmp(line, kind, klen) == 0 && line[klen] == ' ' && strncmp(line + klen + 1, name, nlen) == 0 &&
+            (line[klen + 1 + nlen] == ' ' || line[klen + 1 + nlen] == '\0'))
+        {
+            snprintf(out, len, "%s", line[klen + 1 + nlen] ? line + klen + nlen + 2 : "");
+            ret = 0;
+        }
+    }
+    fclose(fp);
+    return ret;
+}
+
+int GWPEpon_SyseventGetStr(const char *name, unsigned char *out_value, int outbufsz)
+{
+    DriverTuple("sysevent", name, (char *) out_value, outbufsz);
+    return out_value[0] != '\0' ? 0 : -1;
+}
+
+int syscfg_get(const char *ns, const char *name, char *out_value, int outbufsz)
+{
+    (void) ns;
+    return DriverTuple("syscfg", name, out_value, outbufsz);
+}
+
+GWPEpon_WanCtx *GWPEpon_CtxCurrent(void)
+{
+    return &driver_ctx;
+}
+
+int GWPEpon_ActionRun(const char *action, const char *cmd)
+{
+    (void) action;
+    return system(cmd) == 0 ? 0 : -1;
+}
+
+static int DriverDaemon(const char *name)
+{
+    int i;
+
+    for (i = 0; i < ROUTED_DAEMONS; i++)
+    {
+        if (strcmp(routed_daemons[i].name, name) == 0)
+            return i;
+    }
+    fprintf(stderr, "unknown daemon %s\n", name);
+    exit(2);
+}
+
+static void DriverPrint(const GWPEpon_RoutedConf *conf)
+{
+    int i;
+
+    for (i = 0; i < conf->count; i++)
+        printf("%s|%s\n", conf->lines[i].section, conf->lines[i].cmd);
+}
+
+static int DriverRun(void)
+{
+    GWPEpon_RoutedConf conf;
+    const GWPEpon_RoutedStats *stats;
+    char line[256];
+    char *cmd, *arg, *val, *saveptr;
+    int i;
+
+    while (fgets(line, sizeof(line), stdin) != NULL)
+    {
+        saveptr = NULL;
+        line[strcspn(line, "\r\n")] = '\0';
+        if ((cmd = strtok_r(line, " ", &saveptr)) == NULL || cmd[0] == '#')
+            continue;
+        arg = strtok_r(NULL, " ", &saveptr);
+        val = strtok_r(NULL, "", &saveptr);
+
+        if (strcmp(cmd, "tuples") == 0 && arg)
+        {
+            setenv("ROUTED_TUPLES", arg, 1);
+        }
+        else if (strcmp(cmd, "update") == 0 && arg)
+        {
+            printf("restarts=%d\n", GWPEpon_RoutedUpdate(arg, val ? val : ""));
+        }
+        else if (strcmp(cmd, "show") == 0 && arg)
+        {
+            i = DriverDaemon(arg);
+            if (GWPEpon_RoutedReadBack(&routed_daemons[i], &conf) < 0)
+                printf("%s down\n", arg);
+            else
+                DriverPrint(&conf);
+        }
+        else if (strcmp(cmd, "stats") == 0 && arg)
+        {
+            stats = &routed_state[DriverDaemon(arg)].stats;
+            printf("%s updates=%u readbacks=%u unchanged=%u pushes=%u commands=%u restarts=%u failures=%u\n", arg,
+                   stats->updates, stats->readbacks, stats->unchanged, stats->pushes, stats->commands,
+                   stats->restarts, stats->failures);
+        }
+        else
+        {
+            fprintf(stderr, "bad command %s\n", cmd);
+            return 2;
+        }
+        fflush(stdout);
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    GWPEpon_RoutedConf conf;
+    FILE *fp;
+    size_t len;
+
+    if (argc == 3 && strcmp(argv[1], "render") == 0)
+    {
+        conf.count = 0;
+        routed_daemons[DriverDaemon(argv[2])].build(&conf);
+        DriverPrint(&conf);
+        return 0;
+    }
+    if (argc == 4 && strcmp(argv[1], "filter") == 0)
+    {
+        if ((fp = fopen(argv[3], "r")) == NULL)
+            return 1;
+        len = fread(routed_show, 1, sizeof(routed_show) - 1, fp);
+        fclose(fp);
+        routed_show[len] = '\0';
+        GWPEpon_RoutedParse(&routed_daemons[DriverDaemon(argv[2])], routed_show, &conf);
+        DriverPrint(&conf);
+        return 0;
+    }
+    if (argc == 2 && strcmp(argv[1], "run") == 0)
+        return DriverRun();
+
+    fprintf(stderr, "usage: driver render|filter|run ...\n");
+    return 2;
+}
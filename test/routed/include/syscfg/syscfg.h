@@ -0,0 +1,5 @@
+/* Host stand-in: answered by driver.c from the tuple file */
+#ifndef _SYSCFG_H_
+#define _SYSCFG_H_
+int syscfg_get(const char *ns, const char *name, char *out_value, int outbufsz);
+#endif
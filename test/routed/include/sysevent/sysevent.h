@@ -0,0 +1,5 @@
+/* Host stand-in: the adapter only needs the token type of the context */
+#ifndef _SYSEVENT_H_
+#define _SYSEVENT_H_
+typedef unsigned int token_t;
+#endif
@@ -0,0 +1,215 @@
+#!/bin/sh
+##########################################################################
+# If not stated otherwise in this file or this component's Licenses.txt
+# file the following copyright and licenses apply:
+#
+# Copyright 2016 RDK Management
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+##########################################################################
+#
+# Checks the zebra/ripd adapter (source/gw_prov_epon_routed.c) on a host.
+#
+# usage: run.sh [-s script]
+#   -s  service_routed.sh to compare with (default
+#       /etc/utopia/service.d/service_routed.sh, that part is skipped when
+#       the script is missing)
+#
+# 1. For every cases/*.tuples, the lines the adapter renders must be the
+#    lines of the same sections that the script puts in the zebra and ripd
+#    configurations for the same tuples. The script runs with sysevent,
+#    syscfg, zebra, ripd and killall replaced by commands answering from
+#    the tuple file and capturing the configuration the daemons are
+#    started with. The script still writes its files where it always
+#    does, run it as root in a scratch container.
+# 2. Against stand-in daemons (vtyd.c), unprivileged: running daemons are
+#    taken over without a restart, changes are pushed in place and
+#    converge to the rendered configuration without touching the lines
+#    the adapter does not render, a daemon that is down or rejects a
+#    command is restarted.
+
+HERE=$(cd "$(dirname "$0")" && pwd)
+SRC=$HERE/../../source
+SCRIPT=/etc/utopia/service.d/service_routed.sh
+CC=${CC:-cc}
+
+while getopts "s:" opt; do
+    case $opt in
+        s) SCRIPT=$OPTARG ;;
+        *) sed -n 's/^# usage: /usage: /p' "$0"; exit 1 ;;
+    esac
+done
+
+W=$(mktemp -d /tmp/routed_test.XXXXXX) || exit 1
+trap 'for p in "$W"/*.pid; do [ -f "$p" ] && kill $(cat "$p") 2>/dev/null; done; rm -rf "${W:?}"' EXIT
+FAILED=0
+
+pass() { echo "PASS $1"; }
+fail() { echo "FAIL $1"; FAILED=1; }
+
+# "section|command" lines to the daemon configuration format
+to_conf() {
+    awk -F'|' '$1 != s { if (s != "") print "!"; print $1; s = $1 } { print " " $2 } END { print "!" }'
+}
+
+$CC -Wall -o "$W/vtyd" "$HERE/vtyd.c" || exit 1
+$CC -Wall -I"$HERE/include" -I"$SRC" -I"$SRC/include" -DGWPEPON_LOG_LEVEL=WARNING \
+    -DGWPEPON_ROUTED_ZEBRA_VTY="\"$W/zebra.vty\"" -DGWPEPON_ROUTED_RIPD_VTY="\"$W/ripd.vty\"" \
+    -DGWPEPON_ROUTED_SCRIPT="\"sh $W/restart.sh\"" -o "$W/driver" "$HERE/driver.c" || exit 1
+
+##########################################################################
+# 1. rendered configuration against service_routed.sh
+##########################################################################
+if [ ! -f "$SCRIPT" ]; then
+    echo "SKIP $SCRIPT not found, rendered configuration not compared"
+else
+    mkdir -p "$W/bin"
+    for cmd in sysevent syscfg; do
+        cat > "$W/bin/$cmd" <<SHIM
+#!/bin/sh
+[ "\$1" = get ] || exit 0
+awk -v k=$cmd -v n="\$2" '\$1 == k && \$2 == n { sub(/^[^ ]+ [^ ]+ ?/, ""); print; exit }' "\$ROUTED_TUPLES"
+SHIM
+    done
+    for cmd in zebra ripd; do
+        cat > "$W/bin/$cmd" <<SHIM
+#!/bin/sh
+while [ \$# -gt 0 ]; do
+    [ "\$1" = -f ] && cp "\$2" "\$ROUTED_OUT/$cmd.conf"
+    shift
+done
+exit 0
+SHIM
+    done
+    printf '#!/bin/sh\nexit 0\n' > "$W/bin/killall"
+    chmod +x "$W"/bin/*
+
+    for case in "$HERE"/cases/*.tuples; do
+        name=$(basename "$case" .tuples)
+        out=$W/out/$name
+        mkdir -p "$out"
+        for daemon in zebra ripd; do
+            ROUTED_TUPLES=$case ROUTED_OUT=$out PATH=$W/bin:$PATH sh "$SCRIPT" $daemon-restart > "$out/$daemon.log" 2>&1
+            touch "$out/$daemon.conf"
+            ROUTED_TUPLES=$case "$W/driver" render $daemon | sort > "$out/$daemon.rendered"
+            "$W/driver" filter $daemon "$out/$daemon.conf" | sort > "$out/$daemon.script"
+            if diff -u "$out/$daemon.script" "$out/$daemon.rendered"; then
+                pass "$name: $daemon renders what the script configures"
+            else
+                fail "$name: $daemon renders something else than the script"
+            fi
+        done
+    done
+fi
+
+##########################################################################
+# 2. in-place updates against stand-in daemons
+##########################################################################
+cat > "$W/restart.sh" <<EOF
+echo "\$@" >> "$W/restarts"
+case \$1 in
+    zebra-restart) d=zebra ;;
+    ripd-restart) d=ripd ;;
+    *) exit 0 ;;
+esac
+[ -f "$W/\$d.pid" ] && kill \$(cat "$W/\$d.pid") 2>/dev/null
+"$W/vtyd" -l "$W/\$d.cmds" "$W/\$d.vty" "$W/\$d.seed" > /dev/null 2>&1 &
+echo \$! > "$W/\$d.pid"
+for i in 1 2 3 4 5 6 7 8 9 10; do [ -S "$W/\$d.vty" ] && exit 0; sleep 0.1; done
+exit 1
+EOF
+
+# start <daemon> [rejected command prefix]
+start() {
+    if [ -n "$2" ]; then
+        "$W/vtyd" -r "$2" -l "$W/$1.cmds" "$W/$1.vty" "$W/$1.seed" > /dev/null 2>&1 &
+    else
+        "$W/vtyd" -l "$W/$1.cmds" "$W/$1.vty" "$W/$1.seed" > /dev/null 2>&1 &
+    fi
+    echo $! > "$W/$1.pid"
+    while [ ! -S "$W/$1.vty" ]; do sleep 0.1; done
+}
+
+stop() {
+    kill $(cat "$W/$1.pid") 2>/dev/null
+    wait $(cat "$W/$1.pid") 2>/dev/null
+    rm -f "${W:?}/$1.pid" "${W:?}/$1.vty"
+}
+
+expect() {
+    if [ "$2" = "$3" ]; then
+        pass "$1"
+    else
+        fail "$1"
+        echo "  expected: $3"
+        echo "  got:      $2"
+    fi
+}
+
+run() {
+    printf "$1" | "$W/driver" run | tr '\n' ';'
+}
+
+sorted() {
+    tr ';' '\n' | sort | tr '\n' ';'
+}
+
+rendered() {
+    ROUTED_TUPLES=$HERE/cases/$1.tuples "$W/driver" render $2 | sort | tr '\n' ';'
+}
+
+# Daemons already running the lan_up configuration, with lines of their own
+{ ROUTED_TUPLES=$HERE/cases/lan_up.tuples "$W/driver" render zebra | to_conf
+  printf 'interface brlan0\n ipv6 nd ra-interval 10\n!\ninterface brlan1\n no ipv6 nd suppress-ra\n!\n'; } > "$W/zebra.seed"
+{ ROUTED_TUPLES=$HERE/cases/lan_up.tuples "$W/driver" render ripd | to_conf
+  printf 'router rip\n version 2\n!\n'; } > "$W/ripd.seed"
+start zebra
+start ripd
+
+OUT=$(run "tuples $HERE/cases/lan_up.tuples\nupdate lan-status started\nstats zebra\nstats ripd\n")
+expect "running daemons taken over without a restart" "$OUT" \
+    "restarts=0;zebra updates=1 readbacks=1 unchanged=1 pushes=0 commands=0 restarts=0 failures=0;ripd updates=1 readbacks=1 unchanged=1 pushes=0 commands=0 restarts=0 failures=0;"
+
+for step in lan_newprefix:dhcpv6_option_changed lan_down:lan-status rip_off:wan-status; do
+    case=${step%%:*}
+    OUT=$(run "tuples $HERE/cases/$case.tuples\nupdate ${step#*:}\n")
+    expect "$case applied without a restart" "${OUT%%;*}" "restarts=0"
+    expect "$case zebra converged" "$(run "tuples $HERE/cases/$case.tuples\nshow zebra\n" | sorted)" "$(rendered $case zebra)"
+    expect "$case ripd converged" "$(run "tuples $HERE/cases/$case.tuples\nshow ripd\n" | sorted)" "$(rendered $case ripd)"
+done
+if grep -q 'ra-interval\|brlan1\|version' "$W/zebra.cmds" "$W/ripd.cmds"; then
+    fail "lines not rendered by the adapter left alone"
+else
+    pass "lines not rendered by the adapter left alone"
+fi
+if [ -f "$W/restarts" ]; then
+    fail "no restart while the daemons answer: $(cat "$W/restarts")"
+    rm -f "${W:?}/restarts"
+fi
+
+# A daemon that is down is restarted, then taken over again
+stop ripd
+OUT=$(run "tuples $HERE/cases/lan_up.tuples\nupdate wan-status started\nstats ripd\nshow ripd\n")
+expect "ripd down restarted" "$OUT$(cat "$W/restarts" 2>/dev/null)" \
+    "restarts=1;ripd updates=1 readbacks=0 unchanged=0 pushes=0 commands=0 restarts=1 failures=0;$(rendered lan_up ripd)ripd-restart"
+rm -f "${W:?}/restarts"
+
+# A daemon rejecting a command is restarted
+stop zebra
+ROUTED_TUPLES=$HERE/cases/lan_down.tuples "$W/driver" render zebra | to_conf > "$W/zebra.seed"
+start zebra "ipv6 nd rdnss"
+OUT=$(run "tuples $HERE/cases/lan_up.tuples\nupdate lan-status started\nstats zebra\n")
+expect "zebra rejecting a command restarted" "$OUT$(cat "$W/restarts" 2>/dev/null)" \
+    "restarts=1;zebra updates=1 readbacks=1 unchanged=0 pushes=0 commands=0 restarts=1 failures=1;zebra-restart"
+
+exit $FAILED
@@ -0,0 +1,308 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2016 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*! \file vtyd.c
+    \brief stand-in for zebra/ripd, speaking their vtysh socket protocol
+
+    usage: vtyd [-r prefix] [-l log] <socket> [config]
+
+    Serves one vtysh session at a time on the unix socket. Each command
+    arrives NUL terminated and is answered with its output, three NUL
+    bytes and the status (0 success, 2 unknown or rejected command).
+    The configuration starts from the config file, in the format the
+    daemons read, and is kept as sections of lines: "C" replaces "no C"
+    and "no C" removes "C", except for the RA toggle which is kept in
+    either form, as zebra shows it. "show running-config" prints it back.
+    Commands starting with the -r prefix are rejected, every command
+    received is appended to the -l log.
+*/
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define VTYD_MAX_LINES   128
+#define VTYD_LINE_LEN    128
+#define VTYD_TOGGLE      "ipv6 nd suppress-ra"
+
+#define NODE_VIEW        0
+#define NODE_ENABLE      1
+#define NODE_CONFIG      2
+#define NODE_SECTION     3
+
+typedef struct
+{
+    char section[VTYD_LINE_LEN];    /* "" for a top level command */
+    char cmd[VTYD_LINE_LEN];
+} VtydLine;
+
+static VtydLine vtyd_conf[VTYD_MAX_LINES];
+static int vtyd_count = 0;
+static const char *vtyd_reject = NULL;
+static FILE *vtyd_log = NULL;
+
+static int VtydFind(const char *section, const char *cmd)
+{
+    int i;
+
+    for (i = 0; i < vtyd_count; i++)
+    {
+        if (strcmp(vtyd_conf[i].section, section) == 0 && strcmp(vtyd_conf[i].cmd, cmd) == 0)
+            return i;
+    }
+    return -1;
+}
+
+static void VtydRemove(const char *section, const char *cmd)
+{
+    int i = VtydFind(section, cmd);
+
+    if (i < 0)
+        return;
+    memmove(&vtyd_conf[i], &vtyd_conf[i + 1], (vtyd_count - i - 1) * sizeof(vtyd_conf[0]));
+    vtyd_count--;
+}
+
+/* Insert after the last line of the section, so sections stay together */
+static int VtydAdd(const char *section, const char *cmd)
+{
+    char negated[VTYD_LINE_LEN];
+    int i, at = vtyd_count;
+
+    if (strncmp(cmd, "no ", 3) == 0)
+        snprintf(negated, sizeof(negated), "%s", cmd + 3);
+    else
+        snprintf(negated, sizeof(negated), "no %s", cmd);
+    VtydRemove(section, negated);
+    if (VtydFind(section, cmd) >= 0)
+        return 0;
+    if (vtyd_count == VTYD_MAX_LINES)
+        return -1;
+
+    for (i = 0; i < vtyd_count; i++)
+    {
+        if (strcmp(vtyd_conf[i].section, section) == 0)
+            at = i + 1;
+    }
+    memmove(&vtyd_conf[at + 1], &vtyd_conf[at], (vtyd_count - at) * sizeof(vtyd_conf[0]));
+    snprintf(vtyd_conf[at].section, sizeof(vtyd_conf[at].section), "%s", section);
+    snprintf(vtyd_conf[at].cmd, sizeof(vtyd_conf[at].cmd), "%s", cmd);
+    vtyd_count++;
+    return 0;
+}
+
+static int VtydIsSection(const char *cmd)
+{
+    return strncmp(cmd, "interface ", 10) == 0 || strncmp(cmd, "router ", 7) == 0;
+}
+
+static void VtydLoad(const char *path)
+{
+    char line[VTYD_LINE_LEN];
+    char section[VTYD_LINE_LEN] = "";
+    FILE *fp = fopen(path, "r");
+
+    if (fp == NULL)
+    {
+        perror(path);
+        exit(1);
+    }
+    while (fgets(line, sizeof(line), fp) != NULL)
+    {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '!' || line[0] == '\0')
+            section[0] = '\0';
+        else if (line[0] == ' ')
+            VtydAdd(section, line + strspn(line, " "));
+        else if (VtydIsSection(line))
+            snprintf(section, sizeof(section), "%s", line);
+        else
+            VtydAdd("", line);
+    }
+    fclose(fp);
+}
+
+static void VtydShow(FILE *out)
+{
+    const char *section = NULL;
+    int i;
+
+    fprintf(out, "!\n");
+    for (i = 0; i < vtyd_count; i++)
+    {
+        if (vtyd_conf[i].section[0] == '\0')
+        {
+            fprintf(out, "%s\n", vtyd_conf[i].cmd);
+            continue;
+        }
+        if (section == NULL || strcmp(section, vtyd_conf[i].section) != 0)
+        {
+            if (section != NULL)
+                fprintf(out, "!\n");
+            section = vtyd_conf[i].section;
+            fprintf(out, "%s\n", section);
+        }
+        fprintf(out, " %s\n", vtyd_conf[i].cmd);
+    }
+    fprintf(out, "!\nend\n");
+}
+
+static int VtydExec(const char *cmd, int *node, char *section, FILE *out)
+{
+    if (vtyd_log)
+    {
+        fprintf(vtyd_log, "%s\n", cmd);
+        fflush(vtyd_log);
+    }
+    if (vtyd_reject && strncmp(cmd, vtyd_reject, strlen(vtyd_reject)) == 0)
+    {
+        fprintf(out, "%% Unknown command.\n");
+        return 2;
+    }
+
+    if (strcmp(cmd, "show running-config") == 0 && *node >= NODE_ENABLE)
+    {
+        VtydShow(out);
+        return 0;
+    }
+    if (strcmp(cmd, "enable") == 0)
+    {
+        *node = NODE_ENABLE;
+        return 0;
+    }
+    if (strcmp(cmd, "configure terminal") == 0 && *node == NODE_ENABLE)
+    {
+        *node = NODE_CONFIG;
+        return 0;
+    }
+    if (strcmp(cmd, "end") == 0 && *node >= NODE_CONFIG)
+    {
+        *node = NODE_ENABLE;
+        return 0;
+    }
+    if (strcmp(cmd, "exit") == 0 && *node >= NODE_CONFIG)
+    {
+        *node = (*node == NODE_SECTION) ? NODE_CONFIG : NODE_ENABLE;
+        return 0;
+    }
+    if (*node == NODE_CONFIG && VtydIsSection(cmd))
+    {
+        snprintf(section, VTYD_LINE_LEN, "%s", cmd);
+        *node = NODE_SECTION;
+        return 0;
+    }
+    if (*node == NODE_CONFIG || *node == NODE_SECTION)
+    {
+        const char *sect = (*node == NODE_SECTION) ? section : "";
+
+        if (strncmp(cmd, "no ", 3) == 0 && strcmp(cmd, "no " VTYD_TOGGLE) != 0)
+        {
+            VtydRemove(sect, cmd + 3);
+            return 0;
+        }
+        return VtydAdd(sect, cmd) == 0 ? 0 : 2;
+    }
+    fprintf(out, "%% Unknown command.\n");
+    return 2;
+}
+
+static void VtydServe(int fd)
+{
+    char cmd[VTYD_LINE_LEN];
+    char section[VTYD_LINE_LEN] = "";
+    char *outbuf = NULL;
+    size_t outlen = 0;
+    unsigned char trailer[4] = { 0, 0, 0, 0 };
+    int node = NODE_VIEW;
+    int len = 0;
+    char c;
+    FILE *out;
+
+    while (read(fd, &c, 1) == 1)
+    {
+        if (c != '\0')
+        {
+            if (len < (int) sizeof(cmd) - 1)
+                cmd[len++] = c;
+            continue;
+        }
+        cmd[len] = '\0';
+        len = 0;
+
+        out = open_memstream(&outbuf, &outlen);
+        trailer[3] = (unsigned char) VtydExec(cmd, &node, section, out);
+        fclose(out);
+        if (write(fd, outbuf, outlen) != (ssize_t) outlen || write(fd, trailer, sizeof(trailer)) != sizeof(trailer))
+            break;
+        free(outbuf);
+        outbuf = NULL;
+    }
+    free(outbuf);
+}
+
+int main(int argc, char *argv[])
+{
+    struct sockaddr_un addr;
+    int opt, fd, client;
+
+    while ((opt = getopt(argc, argv, "r:l:")) != -1)
+    {
+        if (opt == 'r')
+            vtyd_reject = optarg;
+        else if (opt == 'l' && (vtyd_log = fopen(optarg, "a")) == NULL)
+            return 1;
+        else if (opt != 'l')
+            return 1;
+    }
+    if (optind >= argc)
+    {
+        fprintf(stderr, "usage: vtyd [-r prefix] [-l log] <socket> [config]\n");
+        return 1;
+    }
+    if (optind + 1 < argc)
+        VtydLoad(argv[optind + 1]);
+    signal(SIGPIPE, SIG_IGN);
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", argv[optind]);
+    unlink(addr.sun_path);
+    if (fd < 0 || bind(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0 || listen(fd, 4) < 0)
+    {
+        perror(argv[optind]);
+        return 1;
+    }
+
+    for (;;)
+    {
+        client = accept(fd, NULL, NULL);
+        if (client < 0 && errno == EINTR)
+            continue;
+        if (client < 0)
+            return 1;
+        VtydServe(client);
+        close(client);
+    }
+}